@@ -39,6 +39,7 @@ switch (d_type) {
   CASE_TO_STRING(DEFINE_TRANSITION_SYSTEM)
   CASE_TO_STRING(ASSUME)
   CASE_TO_STRING(QUERY)
+  CASE_TO_STRING(MULTI_QUERY)
 default:
   assert(false);
 }
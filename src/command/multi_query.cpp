@@ -0,0 +1,79 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "multi_query.h"
+
+#include <cassert>
+#include <iostream>
+#include <boost/thread/exceptions.hpp>
+
+namespace sally {
+namespace cmd {
+
+multi_query::multi_query(std::string system_id)
+: command(MULTI_QUERY)
+, d_system_id(system_id)
+{}
+
+void multi_query::push_back(const query* q) {
+  assert(q->get_system_id() == d_system_id);
+  d_queries.push_back(q);
+}
+
+size_t multi_query::size() const {
+  return d_queries.size();
+}
+
+void multi_query::run(system::context* ctx, engine* e) {
+  // If in parse only mode, we're done
+  if (ctx->get_options().has_option("parse-only")) { return; }
+  // We need an engine
+  if (e == 0) { throw exception("Engine needed to do a query."); }
+  // Get the transition system
+  const system::transition_system* T = ctx->get_transition_system(d_system_id);
+  // Check all the formulas
+  std::vector<const system::state_formula*> properties;
+  for (size_t i = 0; i < d_queries.size(); ++ i) {
+    properties.push_back(d_queries[i]->get_query());
+  }
+  std::vector<engine::result> results;
+  try {
+    e->query_all(T, properties, results);
+  } catch (boost::thread_interrupted&) {
+    // Stopped (out of budget), keep the results decided so far
+    results.clear();
+    for (size_t i = 0; i < properties.size(); ++ i) {
+      results.push_back(e->get_property_result(i));
+    }
+  }
+  // Output the results in order
+  for (size_t i = 0; i < d_queries.size(); ++ i) {
+    d_queries[i]->output(ctx, e, results[i], i);
+  }
+}
+
+void multi_query::to_stream(std::ostream& out) const {
+  out << "[" << get_command_type_string() << " " << d_system_id;
+  for (size_t i = 0; i < d_queries.size(); ++ i) {
+    out << std::endl << *d_queries[i];
+  }
+  out << "]";
+}
+
+}
+}
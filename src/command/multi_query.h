@@ -0,0 +1,64 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "command.h"
+#include "query.h"
+
+#include <vector>
+
+namespace sally {
+namespace cmd {
+
+/**
+ * Queries of the same system checked together, so that the engine can share
+ * the work between them (see engine::query_all()). The queries are not owned
+ * by the command.
+ */
+class multi_query : public command {
+
+  /** Id of the system the queries are about */
+  std::string d_system_id;
+
+  /** The queries */
+  std::vector<const query*> d_queries;
+
+public:
+
+  /** Multi-query for the given system */
+  multi_query(std::string system_id);
+
+  /** Get the id of the system */
+  std::string get_system_id() const { return d_system_id; }
+
+  /** Add a query (of the same system) */
+  void push_back(const query* q);
+
+  /** Get the number of queries */
+  size_t size() const;
+
+  /** Run the command on an engine */
+  void run(system::context* ctx, engine* e);
+
+  /** Output the command to stream */
+  void to_stream(std::ostream& out) const;
+};
+
+}
+}
@@ -1,6 +1,7 @@
 #include "query.h"
 
 #include <iostream>
+#include <boost/thread/exceptions.hpp>
 
 namespace sally {
 namespace cmd {
@@ -22,21 +23,31 @@ void query::run(system::context* ctx, engine* e) {
   if (e == 0) { throw exception("Engine needed to do a query."); }
   // Get the transition system
   const system::transition_system* T = ctx->get_transition_system(d_system_id);
-  // Check the formula
-  engine::result result = e->query(T, d_query);
+  // Check the formula (the engine stops if out of budget)
+  engine::result result = engine::INTERRUPTED;
+  try {
+    result = e->query(T, d_query);
+  } catch (boost::thread_interrupted&) {
+    // Stopped
+  }
+  // Output the result
+  output(ctx, e, result);
+}
+
+void query::output(system::context* ctx, engine* e, engine::result result, size_t i) const {
   // Output the result if not silent
   if (result != engine::SILENT) {
     std::cout << result << std::endl;
   }
   // If invalid, and asked to, show the trace
   if (result == engine::INVALID && ctx->get_options().has_option("show-trace")) {
-    const system::trace_helper* trace = e->get_trace();
+    const system::trace_helper* trace = i == single_query ? e->get_trace() : e->get_property_trace(i);
     std::cout << *trace << std::endl;
   }
   // If valid, and asked to, show the invariant
   if (result == engine::VALID && ctx->get_options().has_option("show-invariant")) {
-    engine::invariant inv = e->get_invariant();
-    const system::state_type* state_type = T->get_state_type();
+    engine::invariant inv = i == single_query ? e->get_invariant() : e->get_property_invariant(i);
+    const system::state_type* state_type = ctx->get_transition_system(d_system_id)->get_state_type();
     state_type->use_namespace();
     state_type->use_namespace(system::state_type::STATE_CURRENT);
     std::cout << "(invariant " << inv.depth << " " << inv.F << ")" << std::endl;
@@ -34,6 +34,16 @@ public:
   /** Run the command on an engine */
   void run(system::context* ctx, engine* e);
 
+  /** Index for the output of a single query */
+  static const size_t single_query = -1;
+
+  /**
+   * Output the result of the query. The trace and invariant, if asked for,
+   * are obtained from the engine: from the last query, or for property i of
+   * the last multi-property query.
+   */
+  void output(system::context* ctx, engine* e, engine::result result, size_t i = single_query) const;
+
   /** Output the command to stream */
   void to_stream(std::ostream& out) const;
 };
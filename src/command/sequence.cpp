@@ -1,4 +1,6 @@
 #include "sequence.h"
+#include "query.h"
+#include "multi_query.h"
 
 #include <iostream>
 
@@ -28,8 +30,24 @@ command* sequence::operator [] (size_t i) const {
 }
 
 void sequence::run(system::context* ctx, engine* e) {
-  for (size_t i = 0; i < d_commands.size(); ++ i) {
-    d_commands[i]->run(ctx, e);
+  bool multi_property = ctx->get_options().has_option("multi-property");
+  size_t i = 0;
+  while (i < d_commands.size()) {
+    if (multi_property && d_commands[i]->get_type() == QUERY) {
+      // Check the consecutive queries of the same system together
+      const query* q = static_cast<const query*>(d_commands[i]);
+      multi_query queries(q->get_system_id());
+      for (; i < d_commands.size() && d_commands[i]->get_type() == QUERY; ++ i) {
+        q = static_cast<const query*>(d_commands[i]);
+        if (q->get_system_id() != queries.get_system_id()) {
+          break;
+        }
+        queries.push_back(q);
+      }
+      queries.run(ctx, e);
+    } else {
+      d_commands[i++]->run(ctx, e);
+    }
   }
 }
 
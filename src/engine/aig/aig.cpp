@@ -0,0 +1,92 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/aig/aig.h"
+
+#include <cassert>
+
+namespace sally {
+namespace aig {
+
+const aig::lit aig::lit_false;
+const aig::lit aig::lit_true;
+const aig::lit aig::input_mark;
+
+aig::aig()
+: d_inputs(0)
+{
+  // The constant
+  d_nodes.push_back(node(lit_false, lit_false));
+}
+
+aig::lit aig::mk_input() {
+  lit result = 2*d_nodes.size();
+  d_nodes.push_back(node(input_mark, d_inputs ++));
+  return result;
+}
+
+aig::lit aig::mk_and(lit a1, lit a2) {
+
+  // Normalize the order
+  if (a1 > a2) {
+    lit tmp = a1;
+    a1 = a2;
+    a2 = tmp;
+  }
+
+  // Simplify
+  if (a1 == lit_false) return lit_false;
+  if (a1 == lit_true) return a2;
+  if (a1 == a2) return a1;
+  if (a1 == neg(a2)) return lit_false;
+
+  // Structural hashing
+  std::pair<lit, lit> key(a1, a2);
+  and_table::const_iterator find = d_and_table.find(key);
+  if (find != d_and_table.end()) {
+    return find->second;
+  }
+
+  lit result = 2*d_nodes.size();
+  d_nodes.push_back(node(a1, a2));
+  d_and_table[key] = result;
+  return result;
+}
+
+aig::lit aig::mk_and(const std::vector<lit>& a) {
+  lit result = lit_true;
+  for (size_t i = 0; i < a.size(); ++ i) {
+    result = mk_and(result, a[i]);
+  }
+  return result;
+}
+
+aig::lit aig::mk_xor(lit a1, lit a2) {
+  lit t1 = mk_and(a1, neg(a2));
+  lit t2 = mk_and(neg(a1), a2);
+  return mk_or(t1, t2);
+}
+
+aig::lit aig::mk_ite(lit c, lit a1, lit a2) {
+  lit t1 = mk_and(c, a1);
+  lit t2 = mk_and(neg(c), a2);
+  return mk_or(t1, t2);
+}
+
+}
+}
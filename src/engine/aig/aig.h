@@ -0,0 +1,129 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include <boost/unordered_map.hpp>
+
+namespace sally {
+namespace aig {
+
+/**
+ * And-inverter graph, kept in a compact array of nodes. Literals are encoded
+ * as 2*var + sign, where the sign is 1 for negated literals. Variable 0 is
+ * the constant false, so literal 0 is false and literal 1 is true. All other
+ * variables are either inputs or and gates. And gates are structurally
+ * hashed, and trivial ands are simplified away.
+ */
+class aig {
+
+public:
+
+  /** Literals */
+  typedef uint32_t lit;
+
+  /** The false literal */
+  static const lit lit_false = 0;
+
+  /** The true literal */
+  static const lit lit_true = 1;
+
+  /** Negate a literal */
+  static lit neg(lit l) { return l ^ 1; }
+
+  /** Variable of the literal */
+  static size_t var_of(lit l) { return l >> 1; }
+
+  /** Is the literal negated */
+  static bool is_negated(lit l) { return (l & 1) != 0; }
+
+private:
+
+  /** Marks inputs in the left child */
+  static const lit input_mark = (lit)-1;
+
+  /** A node: and gate of the children, or an input (right child is the index) */
+  struct node {
+    lit left;
+    lit right;
+    node(lit left, lit right): left(left), right(right) {}
+  };
+
+  /** All the nodes */
+  std::vector<node> d_nodes;
+
+  /** Number of inputs */
+  size_t d_inputs;
+
+  /** Structural hashing of the and gates */
+  typedef boost::unordered_map<std::pair<lit, lit>, lit> and_table;
+  and_table d_and_table;
+
+public:
+
+  aig();
+
+  /** Number of variables, including the constant */
+  size_t size() const { return d_nodes.size(); }
+
+  /** Number of inputs */
+  size_t inputs() const { return d_inputs; }
+
+  /** Make a new input, returns the positive literal */
+  lit mk_input();
+
+  /** Is the variable an input */
+  bool is_input(size_t var) const { return var > 0 && d_nodes[var].left == input_mark; }
+
+  /** Is the variable an and gate */
+  bool is_and(size_t var) const { return var > 0 && d_nodes[var].left != input_mark; }
+
+  /** Index of the input variable (in order of creation) */
+  size_t input_index(size_t var) const { return d_nodes[var].right; }
+
+  /** Left child of the and gate */
+  lit left(size_t var) const { return d_nodes[var].left; }
+
+  /** Right child of the and gate */
+  lit right(size_t var) const { return d_nodes[var].right; }
+
+  /** Make a1 & a2 */
+  lit mk_and(lit a1, lit a2);
+
+  /** Make a conjunction of the literals */
+  lit mk_and(const std::vector<lit>& a);
+
+  /** Make a1 | a2 */
+  lit mk_or(lit a1, lit a2) { return neg(mk_and(neg(a1), neg(a2))); }
+
+  /** Make a1 xor a2 */
+  lit mk_xor(lit a1, lit a2);
+
+  /** Make a1 <=> a2 */
+  lit mk_eq(lit a1, lit a2) { return neg(mk_xor(a1, a2)); }
+
+  /** Make (c ? a1 : a2) */
+  lit mk_ite(lit c, lit a1, lit a2);
+};
+
+}
+}
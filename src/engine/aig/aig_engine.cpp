@@ -0,0 +1,411 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/aig/aig_engine.h"
+#include "engine/aig/sat_solver.h"
+
+#include "system/state_type.h"
+#include "utils/exception.h"
+#include "utils/trace.h"
+#include "utils/budget.h"
+
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+namespace sally {
+namespace aig {
+
+/**
+ * Unrolling of the graph into a SAT solver. Inputs of the graph are the
+ * current state variables, the next state variables, and the input
+ * variables, in this order. Each frame gets its own SAT variables for the
+ * state and the input variables.
+ */
+class unrolling {
+
+  /** The graph */
+  const aig& d_aig;
+
+  /** Number of state variables */
+  size_t d_state_size;
+
+  /** Number of input variables */
+  size_t d_input_size;
+
+  /** The SAT solver */
+  sat_solver d_solver;
+
+  /** The false literal */
+  sat_solver::lit d_false;
+
+  /** State variables per frame */
+  std::vector< std::vector<sat_solver::lit> > d_state_vars;
+
+  /** Input variables per frame */
+  std::vector< std::vector<sat_solver::lit> > d_input_vars;
+
+  /** SAT literals of the graph variables already encoded, per frame */
+  std::vector< std::vector<sat_solver::lit> > d_encoded;
+
+  /** Make sure frame k has variables */
+  void ensure_frame(size_t k);
+
+  /** The SAT literal of the graph input when instantiated at frame k */
+  sat_solver::lit input_at(size_t index, size_t k);
+
+public:
+
+  unrolling(const aig& g, size_t state_size, size_t input_size);
+
+  /** Encode the graph literal, with current state at k (and next at k + 1) */
+  sat_solver::lit encode(aig::lit a, size_t k);
+
+  /** Assert the graph literal at frame k */
+  void assert_at(aig::lit a, size_t k) {
+    d_solver.add_clause(encode(a, k));
+  }
+
+  /** Check if the graph literal can be true at frame k */
+  smt::solver::result check_at(aig::lit a, size_t k);
+
+  /** Value of the state variable at frame k in the last model */
+  bool get_state_value(size_t k, size_t i) {
+    ensure_frame(k);
+    return d_solver.get_model_value(d_state_vars[k][i]);
+  }
+
+  /** Value of the input variable at frame k in the last model */
+  bool get_input_value(size_t k, size_t i) {
+    ensure_frame(k);
+    return d_solver.get_model_value(d_input_vars[k][i]);
+  }
+
+  /** The SAT solver */
+  const sat_solver& solver() const { return d_solver; }
+};
+
+unrolling::unrolling(const aig& g, size_t state_size, size_t input_size)
+: d_aig(g)
+, d_state_size(state_size)
+, d_input_size(input_size)
+{
+  d_false = sat_solver::mk_lit(d_solver.new_var(), true);
+  d_solver.add_clause(sat_solver::neg(d_false));
+}
+
+void unrolling::ensure_frame(size_t k) {
+  while (d_state_vars.size() <= k) {
+    d_state_vars.push_back(std::vector<sat_solver::lit>());
+    d_input_vars.push_back(std::vector<sat_solver::lit>());
+    for (size_t i = 0; i < d_state_size; ++ i) {
+      d_state_vars.back().push_back(sat_solver::mk_lit(d_solver.new_var(), false));
+    }
+    for (size_t i = 0; i < d_input_size; ++ i) {
+      d_input_vars.back().push_back(sat_solver::mk_lit(d_solver.new_var(), false));
+    }
+  }
+}
+
+sat_solver::lit unrolling::input_at(size_t index, size_t k) {
+  if (index < d_state_size) {
+    ensure_frame(k);
+    return d_state_vars[k][index];
+  }
+  index -= d_state_size;
+  if (index < d_state_size) {
+    ensure_frame(k + 1);
+    return d_state_vars[k + 1][index];
+  }
+  index -= d_state_size;
+  assert(index < d_input_size);
+  ensure_frame(k);
+  return d_input_vars[k][index];
+}
+
+sat_solver::lit unrolling::encode(aig::lit a, size_t k) {
+
+  // Map from graph variables to SAT literals at frame k, kept across calls so
+  // that each node is encoded only once per frame
+  while (d_encoded.size() <= k) {
+    d_encoded.push_back(std::vector<sat_solver::lit>());
+  }
+  std::vector<sat_solver::lit>& map = d_encoded[k];
+  if (map.empty()) {
+    map.resize(d_aig.size(), sat_solver::lit_undef);
+    map[0] = d_false;
+  }
+  assert(map.size() == d_aig.size());
+
+  // Encode the cone (Tseitin) without recursion
+  std::vector<size_t> to_encode;
+  to_encode.push_back(aig::var_of(a));
+  while (!to_encode.empty()) {
+    size_t var = to_encode.back();
+    if (map[var] != sat_solver::lit_undef) {
+      to_encode.pop_back();
+      continue;
+    }
+    if (d_aig.is_input(var)) {
+      map[var] = input_at(d_aig.input_index(var), k);
+      to_encode.pop_back();
+      continue;
+    }
+    assert(d_aig.is_and(var));
+    size_t left = aig::var_of(d_aig.left(var));
+    size_t right = aig::var_of(d_aig.right(var));
+    if (map[left] == sat_solver::lit_undef) {
+      to_encode.push_back(left);
+    } else if (map[right] == sat_solver::lit_undef) {
+      to_encode.push_back(right);
+    } else {
+      sat_solver::lit l = map[left] ^ (d_aig.left(var) & 1);
+      sat_solver::lit r = map[right] ^ (d_aig.right(var) & 1);
+      sat_solver::lit g = sat_solver::mk_lit(d_solver.new_var(), false);
+      // g <=> l & r
+      d_solver.add_clause(sat_solver::neg(g), l);
+      d_solver.add_clause(sat_solver::neg(g), r);
+      d_solver.add_clause(g, sat_solver::neg(l), sat_solver::neg(r));
+      map[var] = g;
+      to_encode.pop_back();
+    }
+  }
+
+  return map[aig::var_of(a)] ^ (a & 1);
+}
+
+smt::solver::result unrolling::check_at(aig::lit a, size_t k) {
+  // The model covers all the frames, even if nothing was encoded in them
+  ensure_frame(k);
+  std::vector<sat_solver::lit> assumptions;
+  assumptions.push_back(encode(a, k));
+  return d_solver.check(assumptions);
+}
+
+aig_engine::aig_engine(const system::context& ctx)
+: engine(ctx)
+, d_trace(0)
+, d_invariant(expr::term_ref(), 0)
+, d_state_size(0)
+, d_input_size(0)
+{
+  d_stats.nodes = new utils::stat_int("aig::nodes", 0);
+  d_stats.conflicts = new utils::stat_int("aig::conflicts", 0);
+  d_stats.decisions = new utils::stat_int("aig::decisions", 0);
+  ctx.get_statistics().add(new utils::stat_delimiter());
+  ctx.get_statistics().add(d_stats.nodes);
+  ctx.get_statistics().add(d_stats.conflicts);
+  ctx.get_statistics().add(d_stats.decisions);
+}
+
+aig_engine::~aig_engine() {
+}
+
+aig::lit aig_engine::to_aig(expr::term_ref f, term_to_lit_map& cache) {
+
+  // Post-order traversal of the formula
+  std::vector<expr::term_ref> to_convert;
+  to_convert.push_back(f);
+  std::vector<aig::lit> children;
+  while (!to_convert.empty()) {
+    expr::term_ref t = to_convert.back();
+    if (cache.find(t) != cache.end()) {
+      to_convert.pop_back();
+      continue;
+    }
+
+    const expr::term& t_term = tm().term_of(t);
+    expr::term_op op = t_term.op();
+
+    if (op == expr::CONST_BOOL) {
+      cache[t] = tm().get_boolean_constant(t_term) ? aig::lit_true : aig::lit_false;
+      to_convert.pop_back();
+      continue;
+    }
+
+    // Make sure the children are converted first
+    bool children_done = true;
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      if (cache.find(t_term[i]) == cache.end()) {
+        to_convert.push_back(t_term[i]);
+        children_done = false;
+      }
+    }
+    if (!children_done) {
+      continue;
+    }
+    children.clear();
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      children.push_back(cache[t_term[i]]);
+    }
+
+    aig::lit result = aig::lit_false;
+    switch (op) {
+    case expr::TERM_AND:
+      result = d_aig.mk_and(children);
+      break;
+    case expr::TERM_OR:
+      result = aig::lit_false;
+      for (size_t i = 0; i < children.size(); ++ i) {
+        result = d_aig.mk_or(result, children[i]);
+      }
+      break;
+    case expr::TERM_NOT:
+      result = aig::neg(children[0]);
+      break;
+    case expr::TERM_IMPLIES:
+      result = d_aig.mk_or(aig::neg(children[0]), children[1]);
+      break;
+    case expr::TERM_XOR:
+      result = aig::lit_false;
+      for (size_t i = 0; i < children.size(); ++ i) {
+        result = d_aig.mk_xor(result, children[i]);
+      }
+      break;
+    case expr::TERM_EQ:
+      result = d_aig.mk_eq(children[0], children[1]);
+      break;
+    case expr::TERM_ITE:
+      result = d_aig.mk_ite(children[0], children[1], children[2]);
+      break;
+    default: {
+      std::stringstream ss;
+      ss << "aig: only Boolean systems are supported, got " << t;
+      throw exception(ss.str());
+    }
+    }
+
+    cache[t] = result;
+    to_convert.pop_back();
+  }
+
+  return cache[f];
+}
+
+engine::result aig_engine::query(const system::transition_system* ts, const system::state_formula* sf) {
+
+  // The trace we are building
+  d_trace = ts->get_trace_helper();
+  d_trace->clear_model();
+
+  // Make the graph: inputs are the current, next and input variables
+  d_aig = aig();
+  const system::state_type* state_type = ts->get_state_type();
+  const std::vector<expr::term_ref>& x = state_type->get_variables(system::state_type::STATE_CURRENT);
+  const std::vector<expr::term_ref>& x_next = state_type->get_variables(system::state_type::STATE_NEXT);
+  const std::vector<expr::term_ref>& input = state_type->get_variables(system::state_type::STATE_INPUT);
+  d_state_size = x.size();
+  d_input_size = input.size();
+
+  term_to_lit_map cache;
+  const std::vector<expr::term_ref>* vars[3] = { &x, &x_next, &input };
+  for (size_t k = 0; k < 3; ++ k) {
+    for (size_t i = 0; i < vars[k]->size(); ++ i) {
+      expr::term_ref var = (*vars[k])[i];
+      if (tm().type_of(var) != tm().boolean_type()) {
+        std::stringstream ss;
+        ss << "aig: only Boolean systems are supported, got variable " << var;
+        throw exception(ss.str());
+      }
+      cache[var] = d_aig.mk_input();
+    }
+  }
+
+  aig::lit initial_states = to_aig(ts->get_initial_states(), cache);
+  aig::lit transition = to_aig(ts->get_transition_relation(), cache);
+  aig::lit property = to_aig(sf->get_formula(), cache);
+  aig::lit property_not = aig::neg(property);
+
+  d_stats.nodes->get_value() = d_aig.size();
+
+  MSG(1) << "AIG: " << d_aig.size() << " nodes" << std::endl;
+
+  /*
+     Same as k-induction, but on the graph:
+     * base unrolls I and T_0 and ... and T_{k-1}, and checks not P_k
+     * step unrolls P_0 and T_0 and ... and P_{k-1} and T_{k-1}, and checks not P_k
+   */
+  unrolling base(d_aig, d_state_size, d_input_size);
+  unrolling step(d_aig, d_state_size, d_input_size);
+  base.assert_at(initial_states, 0);
+
+  unsigned aig_max = ctx().get_options().get_unsigned("aig-max");
+  bool check_induction = !ctx().get_options().get_bool("aig-bmc");
+
+  for (size_t k = 0; k < aig_max; ++ k) {
+
+    // Stop here if we've been interrupted (e.g. in a portfolio) or ran out of budget
+    utils::budget::interruption_point();
+
+    MSG(1) << "AIG: checking initialization " << k << std::endl;
+
+    smt::solver::result r_base = base.check_at(property_not, k);
+    d_stats.conflicts->get_value() = base.solver().get_stats().conflicts + step.solver().get_stats().conflicts;
+    d_stats.decisions->get_value() = base.solver().get_stats().decisions + step.solver().get_stats().decisions;
+
+    MSG(1) << "AIG: got " << r_base << std::endl;
+
+    if (r_base == smt::solver::SAT) {
+      // Report the counter-example through the terms
+      expr::model::ref m = new expr::model(tm(), true);
+      for (size_t i = 0; i <= k; ++ i) {
+        const std::vector<expr::term_ref>& x_i = d_trace->get_state_variables(i);
+        for (size_t j = 0; j < x_i.size(); ++ j) {
+          m->set_variable_value(x_i[j], expr::value(base.get_state_value(i, j)));
+        }
+        if (i < k) {
+          const std::vector<expr::term_ref>& input_i = d_trace->get_input_variables(i);
+          for (size_t j = 0; j < input_i.size(); ++ j) {
+            m->set_variable_value(input_i[j], expr::value(base.get_input_value(i, j)));
+          }
+        }
+      }
+      d_trace->set_model(m, 0, k);
+      return INVALID;
+    }
+
+    // Unroll once more
+    base.assert_at(transition, k);
+    step.assert_at(property, k);
+    step.assert_at(transition, k);
+
+    // Check consecution
+    if (check_induction) {
+      MSG(1) << "AIG: checking consecution " << k + 1 << std::endl;
+      smt::solver::result r_step = step.check_at(property_not, k + 1);
+      MSG(1) << "AIG: got " << r_step << std::endl;
+      if (r_step == smt::solver::UNSAT) {
+        d_invariant = invariant(sf->get_formula(), k + 1);
+        return VALID;
+      }
+    }
+  }
+
+  return UNKNOWN;
+}
+
+const system::trace_helper* aig_engine::get_trace() {
+  return d_trace;
+}
+
+engine::invariant aig_engine::get_invariant() {
+  return d_invariant;
+}
+
+}
+}
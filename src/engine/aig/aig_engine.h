@@ -0,0 +1,92 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "engine/engine.h"
+#include "engine/aig/aig.h"
+#include "system/context.h"
+#include "system/trace_helper.h"
+#include "expr/term.h"
+#include "utils/statistics.h"
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace sally {
+namespace aig {
+
+/**
+ * Bit-level engine for pure Boolean systems (e.g. from the aiger front-end).
+ * The system is converted into an and-inverter graph, and k-induction (and
+ * BMC) is done directly on an incremental SAT solver, without going through
+ * the SMT solvers. Terms are only used again to report counter-examples.
+ *
+ * Options aig-max sets the maximal k to try, and aig-bmc disables the
+ * induction checks.
+ */
+class aig_engine : public engine {
+
+  /** The trace we're building */
+  system::trace_helper* d_trace;
+
+  /** The invariant if proven */
+  invariant d_invariant;
+
+  /** The graph of the current system */
+  aig d_aig;
+
+  /** Number of state variables */
+  size_t d_state_size;
+
+  /** Number of input variables */
+  size_t d_input_size;
+
+  /** Map from terms to graph literals */
+  typedef boost::unordered_map<expr::term_ref, aig::lit, expr::term_ref_hasher> term_to_lit_map;
+
+  /** Convert a Boolean formula to the graph */
+  aig::lit to_aig(expr::term_ref f, term_to_lit_map& cache);
+
+  struct stats {
+    utils::stat_int* nodes;
+    utils::stat_int* conflicts;
+    utils::stat_int* decisions;
+  } d_stats;
+
+public:
+
+  aig_engine(const system::context& ctx);
+  ~aig_engine();
+
+  /** Query */
+  result query(const system::transition_system* ts, const system::state_formula* sf);
+
+  /** Trace */
+  const system::trace_helper* get_trace();
+
+  /** Invariant */
+  invariant get_invariant();
+
+  /** Nothing to collect */
+  void gc_collect(const expr::gc_relocator& gc_reloc) {}
+
+};
+
+}
+}
@@ -0,0 +1,527 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/aig/sat_solver.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sally {
+namespace aig {
+
+const sat_solver::lit sat_solver::lit_undef;
+
+/** Luby sequence for the restarts: 1 1 2 1 1 2 4 1 1 2 ... */
+static double luby(double y, int x) {
+  int size, seq;
+  for (size = 1, seq = 0; size < x + 1; seq ++, size = 2*size + 1) {}
+  while (size - 1 != x) {
+    size = (size - 1) >> 1;
+    seq --;
+    x = x % size;
+  }
+  double result = 1;
+  for (int i = 0; i < seq; ++ i) {
+    result *= y;
+  }
+  return result;
+}
+
+sat_solver::sat_solver()
+: d_ok(true)
+, d_qhead(0)
+, d_var_inc(1)
+, d_clause_inc(1)
+, d_max_learnts(0)
+{
+}
+
+sat_solver::~sat_solver() {
+  for (size_t i = 0; i < d_clauses.size(); ++ i) {
+    delete d_clauses[i];
+  }
+  for (size_t i = 0; i < d_learnts.size(); ++ i) {
+    delete d_learnts[i];
+  }
+}
+
+size_t sat_solver::new_var() {
+  size_t var = d_values.size();
+  d_values.push_back(L_UNDEF);
+  d_levels.push_back(0);
+  d_reasons.push_back(0);
+  d_phases.push_back(1);
+  d_activity.push_back(0);
+  d_seen.push_back(0);
+  d_heap_index.push_back(-1);
+  d_watches.push_back(std::vector<clause*>());
+  d_watches.push_back(std::vector<clause*>());
+  heap_insert(var);
+  return var;
+}
+
+bool sat_solver::add_clause(lit l1) {
+  std::vector<lit> c;
+  c.push_back(l1);
+  return add_clause(c);
+}
+
+bool sat_solver::add_clause(lit l1, lit l2) {
+  std::vector<lit> c;
+  c.push_back(l1);
+  c.push_back(l2);
+  return add_clause(c);
+}
+
+bool sat_solver::add_clause(lit l1, lit l2, lit l3) {
+  std::vector<lit> c;
+  c.push_back(l1);
+  c.push_back(l2);
+  c.push_back(l3);
+  return add_clause(c);
+}
+
+bool sat_solver::add_clause(const std::vector<lit>& lits) {
+  assert(decision_level() == 0);
+
+  if (!d_ok) {
+    return false;
+  }
+
+  // Simplify: remove duplicates and false literals, skip satisfied clauses
+  std::vector<lit> c(lits);
+  std::sort(c.begin(), c.end());
+  size_t j = 0;
+  for (size_t i = 0; i < c.size(); ++ i) {
+    assert(var_of(c[i]) < num_vars());
+    if (value(c[i]) == L_TRUE || (i > 0 && c[i] == neg(c[i-1]))) {
+      return true;
+    }
+    if (value(c[i]) == L_FALSE || (i > 0 && c[i] == c[i-1])) {
+      continue;
+    }
+    c[j ++] = c[i];
+  }
+  c.resize(j);
+
+  if (c.size() == 0) {
+    d_ok = false;
+    return false;
+  }
+
+  if (c.size() == 1) {
+    enqueue(c[0], 0);
+    d_ok = (propagate() == 0);
+    return d_ok;
+  }
+
+  clause* new_clause = new clause(c, false);
+  d_clauses.push_back(new_clause);
+  attach(new_clause);
+  return true;
+}
+
+void sat_solver::attach(clause* c) {
+  assert(c->lits.size() >= 2);
+  d_watches[neg(c->lits[0])].push_back(c);
+  d_watches[neg(c->lits[1])].push_back(c);
+}
+
+void sat_solver::enqueue(lit l, clause* reason) {
+  assert(value(l) == L_UNDEF);
+  size_t var = var_of(l);
+  d_values[var] = is_negated(l) ? L_FALSE : L_TRUE;
+  d_levels[var] = decision_level();
+  d_reasons[var] = reason;
+  d_trail.push_back(l);
+}
+
+sat_solver::clause* sat_solver::propagate() {
+  clause* conflict = 0;
+
+  while (d_qhead < d_trail.size() && conflict == 0) {
+    lit p = d_trail[d_qhead ++];
+    lit false_lit = neg(p);
+    std::vector<clause*>& ws = d_watches[p];
+    d_stats.propagations ++;
+
+    size_t i = 0, j = 0;
+    while (i < ws.size()) {
+      clause* c = ws[i ++];
+      if (c->removed) {
+        continue;
+      }
+      std::vector<lit>& lits = c->lits;
+      // Make sure the false literal is the second one
+      if (lits[0] == false_lit) {
+        lits[0] = lits[1];
+        lits[1] = false_lit;
+      }
+      assert(lits[1] == false_lit);
+      // If the other watch is true, we're done
+      if (value(lits[0]) == L_TRUE) {
+        ws[j ++] = c;
+        continue;
+      }
+      // Look for a new watch
+      bool found = false;
+      for (size_t k = 2; k < lits.size(); ++ k) {
+        if (value(lits[k]) != L_FALSE) {
+          lits[1] = lits[k];
+          lits[k] = false_lit;
+          d_watches[neg(lits[1])].push_back(c);
+          found = true;
+          break;
+        }
+      }
+      if (found) {
+        continue;
+      }
+      // Unit or conflict
+      ws[j ++] = c;
+      if (value(lits[0]) == L_FALSE) {
+        conflict = c;
+        while (i < ws.size()) {
+          ws[j ++] = ws[i ++];
+        }
+      } else {
+        enqueue(lits[0], c);
+      }
+    }
+    ws.resize(j);
+  }
+
+  return conflict;
+}
+
+void sat_solver::analyze(clause* conflict, std::vector<lit>& learnt, size_t& bt_level) {
+
+  learnt.clear();
+  learnt.push_back(lit_undef);
+
+  size_t path_count = 0;
+  lit p = lit_undef;
+  size_t index = d_trail.size();
+
+  // Resolve until the first UIP
+  do {
+    assert(conflict != 0);
+    if (conflict->learnt) {
+      bump_clause(conflict);
+    }
+    const std::vector<lit>& lits = conflict->lits;
+    for (size_t i = (p == lit_undef ? 0 : 1); i < lits.size(); ++ i) {
+      lit q = lits[i];
+      size_t var = var_of(q);
+      if (!d_seen[var] && d_levels[var] > 0) {
+        bump_var(var);
+        d_seen[var] = 1;
+        if ((size_t) d_levels[var] >= decision_level()) {
+          path_count ++;
+        } else {
+          learnt.push_back(q);
+        }
+      }
+    }
+    // Next literal to resolve on
+    while (!d_seen[var_of(d_trail[-- index])]) {}
+    p = d_trail[index];
+    conflict = d_reasons[var_of(p)];
+    d_seen[var_of(p)] = 0;
+    path_count --;
+  } while (path_count > 0);
+  learnt[0] = neg(p);
+
+  // Remove the literals implied by the other literals of the clause
+  std::vector<lit> to_clear(learnt);
+  size_t j = 1;
+  for (size_t i = 1; i < learnt.size(); ++ i) {
+    clause* reason = d_reasons[var_of(learnt[i])];
+    bool redundant = reason != 0;
+    for (size_t k = 1; redundant && k < reason->lits.size(); ++ k) {
+      size_t var = var_of(reason->lits[k]);
+      if (!d_seen[var] && d_levels[var] > 0) {
+        redundant = false;
+      }
+    }
+    if (!redundant) {
+      learnt[j ++] = learnt[i];
+    }
+  }
+  learnt.resize(j);
+  for (size_t i = 0; i < to_clear.size(); ++ i) {
+    d_seen[var_of(to_clear[i])] = 0;
+  }
+
+  // Backtrack level is the max level of the rest, and we watch it
+  bt_level = 0;
+  if (learnt.size() > 1) {
+    size_t max_i = 1;
+    for (size_t i = 2; i < learnt.size(); ++ i) {
+      if (d_levels[var_of(learnt[i])] > d_levels[var_of(learnt[max_i])]) {
+        max_i = i;
+      }
+    }
+    std::swap(learnt[1], learnt[max_i]);
+    bt_level = d_levels[var_of(learnt[1])];
+  }
+}
+
+void sat_solver::cancel_until(size_t level) {
+  if (decision_level() > level) {
+    for (size_t i = d_trail.size(); i > d_trail_lim[level]; -- i) {
+      size_t var = var_of(d_trail[i-1]);
+      d_phases[var] = is_negated(d_trail[i-1]) ? 1 : 0;
+      d_values[var] = L_UNDEF;
+      d_reasons[var] = 0;
+      if (d_heap_index[var] < 0) {
+        heap_insert(var);
+      }
+    }
+    d_trail.resize(d_trail_lim[level]);
+    d_trail_lim.resize(level);
+    d_qhead = d_trail.size();
+  }
+}
+
+sat_solver::lit sat_solver::pick_branch_lit() {
+  while (!d_heap.empty()) {
+    size_t var = heap_pop();
+    if (d_values[var] == L_UNDEF) {
+      return mk_lit(var, d_phases[var] != 0);
+    }
+  }
+  return lit_undef;
+}
+
+bool sat_solver::is_locked(const clause* c) const {
+  size_t var = var_of(c->lits[0]);
+  return d_reasons[var] == c && value(c->lits[0]) == L_TRUE;
+}
+
+static bool clause_activity_less(const std::pair<double, size_t>& c1, const std::pair<double, size_t>& c2) {
+  return c1.first < c2.first;
+}
+
+void sat_solver::reduce_learnts() {
+  // Remove half of the learnts with lowest activity (keeping binary clauses
+  // and the reasons of current assignments)
+  std::vector< std::pair<double, size_t> > order;
+  for (size_t i = 0; i < d_learnts.size(); ++ i) {
+    order.push_back(std::make_pair(d_learnts[i]->activity, i));
+  }
+  std::sort(order.begin(), order.end(), clause_activity_less);
+  for (size_t i = 0; i < order.size() / 2; ++ i) {
+    clause* c = d_learnts[order[i].second];
+    if (c->lits.size() > 2 && !is_locked(c)) {
+      c->removed = true;
+    }
+  }
+
+  // Remove from the watches and delete
+  for (size_t i = 0; i < d_watches.size(); ++ i) {
+    std::vector<clause*>& ws = d_watches[i];
+    size_t j = 0;
+    for (size_t k = 0; k < ws.size(); ++ k) {
+      if (!ws[k]->removed) {
+        ws[j ++] = ws[k];
+      }
+    }
+    ws.resize(j);
+  }
+  size_t j = 0;
+  for (size_t i = 0; i < d_learnts.size(); ++ i) {
+    if (d_learnts[i]->removed) {
+      delete d_learnts[i];
+    } else {
+      d_learnts[j ++] = d_learnts[i];
+    }
+  }
+  d_learnts.resize(j);
+}
+
+void sat_solver::bump_var(size_t var) {
+  d_activity[var] += d_var_inc;
+  if (d_activity[var] > 1e100) {
+    // Rescale
+    for (size_t i = 0; i < d_activity.size(); ++ i) {
+      d_activity[i] *= 1e-100;
+    }
+    d_var_inc *= 1e-100;
+  }
+  if (d_heap_index[var] >= 0) {
+    heap_up(d_heap_index[var]);
+  }
+}
+
+void sat_solver::bump_clause(clause* c) {
+  c->activity += d_clause_inc;
+  if (c->activity > 1e20) {
+    // Rescale
+    for (size_t i = 0; i < d_learnts.size(); ++ i) {
+      d_learnts[i]->activity *= 1e-20;
+    }
+    d_clause_inc *= 1e-20;
+  }
+}
+
+void sat_solver::heap_insert(size_t var) {
+  d_heap_index[var] = d_heap.size();
+  d_heap.push_back(var);
+  heap_up(d_heap.size() - 1);
+}
+
+size_t sat_solver::heap_pop() {
+  size_t var = d_heap[0];
+  d_heap[0] = d_heap.back();
+  d_heap_index[d_heap[0]] = 0;
+  d_heap_index[var] = -1;
+  d_heap.pop_back();
+  if (d_heap.size() > 1) {
+    heap_down(0);
+  }
+  return var;
+}
+
+void sat_solver::heap_up(size_t i) {
+  size_t var = d_heap[i];
+  while (i > 0) {
+    size_t parent = (i - 1) >> 1;
+    if (!heap_less(var, d_heap[parent])) {
+      break;
+    }
+    d_heap[i] = d_heap[parent];
+    d_heap_index[d_heap[i]] = i;
+    i = parent;
+  }
+  d_heap[i] = var;
+  d_heap_index[var] = i;
+}
+
+void sat_solver::heap_down(size_t i) {
+  size_t var = d_heap[i];
+  while (2*i + 1 < d_heap.size()) {
+    size_t child = 2*i + 1;
+    if (child + 1 < d_heap.size() && heap_less(d_heap[child + 1], d_heap[child])) {
+      child ++;
+    }
+    if (!heap_less(d_heap[child], var)) {
+      break;
+    }
+    d_heap[i] = d_heap[child];
+    d_heap_index[d_heap[i]] = i;
+    i = child;
+  }
+  d_heap[i] = var;
+  d_heap_index[var] = i;
+}
+
+smt::solver::result sat_solver::search(const std::vector<lit>& assumptions, int conflicts_budget) {
+
+  int conflicts = 0;
+  std::vector<lit> learnt;
+
+  for (;;) {
+    clause* conflict = propagate();
+    if (conflict != 0) {
+      d_stats.conflicts ++;
+      conflicts ++;
+      if (decision_level() == 0) {
+        d_ok = false;
+        return smt::solver::UNSAT;
+      }
+      size_t bt_level;
+      analyze(conflict, learnt, bt_level);
+      cancel_until(bt_level);
+      if (learnt.size() == 1) {
+        enqueue(learnt[0], 0);
+      } else {
+        clause* c = new clause(learnt, true);
+        d_learnts.push_back(c);
+        attach(c);
+        bump_clause(c);
+        enqueue(learnt[0], c);
+      }
+      d_var_inc /= 0.95;
+      d_clause_inc /= 0.999;
+    } else {
+      if (conflicts_budget >= 0 && conflicts >= conflicts_budget) {
+        cancel_until(0);
+        return smt::solver::UNKNOWN;
+      }
+      if (d_learnts.size() >= d_trail.size() + d_max_learnts) {
+        reduce_learnts();
+      }
+      // Decide the assumptions first
+      lit next = lit_undef;
+      while (decision_level() < assumptions.size()) {
+        lit p = assumptions[decision_level()];
+        if (value(p) == L_TRUE) {
+          // Already true, just open a level
+          d_trail_lim.push_back(d_trail.size());
+        } else if (value(p) == L_FALSE) {
+          // Unsatisfiable under the assumptions
+          return smt::solver::UNSAT;
+        } else {
+          next = p;
+          break;
+        }
+      }
+      if (next == lit_undef) {
+        d_stats.decisions ++;
+        next = pick_branch_lit();
+        if (next == lit_undef) {
+          // All assigned, we have a model
+          d_model = d_values;
+          return smt::solver::SAT;
+        }
+      }
+      d_trail_lim.push_back(d_trail.size());
+      enqueue(next, 0);
+    }
+  }
+}
+
+smt::solver::result sat_solver::check(const std::vector<lit>& assumptions) {
+
+  if (!d_ok) {
+    return smt::solver::UNSAT;
+  }
+
+  d_max_learnts = d_clauses.size() / 3.0 + 1000;
+
+  smt::solver::result result = smt::solver::UNKNOWN;
+  for (int restarts = 0; result == smt::solver::UNKNOWN; ++ restarts) {
+    result = search(assumptions, (int) (luby(2, restarts) * 100));
+    d_max_learnts *= 1.05;
+    d_stats.restarts ++;
+  }
+
+  cancel_until(0);
+  return result;
+}
+
+bool sat_solver::get_model_value(lit l) const {
+  size_t var = var_of(l);
+  assert(var < d_model.size());
+  bool value = d_model[var] == L_TRUE;
+  return is_negated(l) ? !value : value;
+}
+
+}
+}
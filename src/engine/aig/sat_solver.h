@@ -0,0 +1,211 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "smt/solver.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace sally {
+namespace aig {
+
+/**
+ * A small incremental CDCL SAT solver (two watched literals, first-UIP
+ * learning, VSIDS branching, Luby restarts). Clauses can be added between
+ * the checks, and checks can be made under assumptions.
+ *
+ * Literals are encoded as 2*var + sign, where the sign is 1 for negative
+ * literals.
+ */
+class sat_solver {
+
+public:
+
+  /** Literals */
+  typedef uint32_t lit;
+
+  /** Undefined literal */
+  static const lit lit_undef = (lit)-1;
+
+  /** Make a literal */
+  static lit mk_lit(size_t var, bool negated) { return (lit)(2*var + (negated ? 1 : 0)); }
+
+  /** Negate a literal */
+  static lit neg(lit l) { return l ^ 1; }
+
+  /** Variable of the literal */
+  static size_t var_of(lit l) { return l >> 1; }
+
+  /** Is the literal negative */
+  static bool is_negated(lit l) { return (l & 1) != 0; }
+
+  /** Statistics of the solver */
+  struct stats {
+    size_t conflicts;
+    size_t decisions;
+    size_t propagations;
+    size_t restarts;
+    stats(): conflicts(0), decisions(0), propagations(0), restarts(0) {}
+  };
+
+private:
+
+  /** Values of the variables */
+  enum lbool {
+    L_UNDEF,
+    L_TRUE,
+    L_FALSE
+  };
+
+  struct clause {
+    /** The literals, the first two are watched */
+    std::vector<lit> lits;
+    /** Activity (for learnt clauses) */
+    double activity;
+    /** Is this a learnt clause */
+    bool learnt;
+    /** Has the clause been removed */
+    bool removed;
+    clause(const std::vector<lit>& lits, bool learnt)
+    : lits(lits), activity(0), learnt(learnt), removed(false) {}
+  };
+
+  /** False if the clauses are unsatisfiable (without assumptions) */
+  bool d_ok;
+
+  /** Problem clauses */
+  std::vector<clause*> d_clauses;
+
+  /** Learnt clauses */
+  std::vector<clause*> d_learnts;
+
+  /** Watches, indexed by literal l, clauses where neg(l) is watched */
+  std::vector< std::vector<clause*> > d_watches;
+
+  /** Current values of the variables */
+  std::vector<char> d_values;
+
+  /** Decision level of the variables */
+  std::vector<int> d_levels;
+
+  /** Reasons of the variables (null for decisions and units) */
+  std::vector<clause*> d_reasons;
+
+  /** Saved phases */
+  std::vector<char> d_phases;
+
+  /** Variable activities */
+  std::vector<double> d_activity;
+
+  /** Scratch flags for conflict analysis */
+  std::vector<char> d_seen;
+
+  /** The assignment trail */
+  std::vector<lit> d_trail;
+
+  /** Trail size at the start of each decision level */
+  std::vector<size_t> d_trail_lim;
+
+  /** Propagation head */
+  size_t d_qhead;
+
+  /** Heap of variables ordered by activity */
+  std::vector<size_t> d_heap;
+
+  /** Position in the heap (-1 if not in the heap) */
+  std::vector<int> d_heap_index;
+
+  /** Activity increments */
+  double d_var_inc;
+  double d_clause_inc;
+
+  /** Max number of learnts before reduction */
+  double d_max_learnts;
+
+  /** The model of the last satisfiable check */
+  std::vector<char> d_model;
+
+  /** Statistics */
+  stats d_stats;
+
+  lbool value(lit l) const {
+    char v = d_values[var_of(l)];
+    if (v == L_UNDEF) return L_UNDEF;
+    return ((v == L_TRUE) != is_negated(l)) ? L_TRUE : L_FALSE;
+  }
+
+  size_t decision_level() const { return d_trail_lim.size(); }
+
+  void enqueue(lit l, clause* reason);
+  void attach(clause* c);
+  clause* propagate();
+  void analyze(clause* conflict, std::vector<lit>& learnt, size_t& bt_level);
+  void cancel_until(size_t level);
+  lit pick_branch_lit();
+  void reduce_learnts();
+  bool is_locked(const clause* c) const;
+
+  void bump_var(size_t var);
+  void bump_clause(clause* c);
+
+  bool heap_less(size_t v1, size_t v2) const { return d_activity[v1] > d_activity[v2]; }
+  void heap_insert(size_t var);
+  size_t heap_pop();
+  void heap_up(size_t i);
+  void heap_down(size_t i);
+
+  /** Search for a model with the conflict budget (-1 no limit) */
+  smt::solver::result search(const std::vector<lit>& assumptions, int conflicts_budget);
+
+public:
+
+  sat_solver();
+  ~sat_solver();
+
+  /** Make a new variable */
+  size_t new_var();
+
+  /** Number of variables */
+  size_t num_vars() const { return d_values.size(); }
+
+  /** Add a clause, returns false if the clauses became unsatisfiable */
+  bool add_clause(const std::vector<lit>& clause);
+
+  /** Add a unit clause */
+  bool add_clause(lit l1);
+
+  /** Add a binary clause */
+  bool add_clause(lit l1, lit l2);
+
+  /** Add a ternary clause */
+  bool add_clause(lit l1, lit l2, lit l3);
+
+  /** Check satisfiability under the given assumptions (SAT or UNSAT) */
+  smt::solver::result check(const std::vector<lit>& assumptions);
+
+  /** Value of the literal in the model of the last satisfiable check */
+  bool get_model_value(lit l) const;
+
+  /** Get the statistics */
+  const stats& get_stats() const { return d_stats; }
+};
+
+}
+}
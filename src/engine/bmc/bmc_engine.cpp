@@ -19,9 +19,16 @@
 #include "engine/bmc/bmc_engine.h"
 
 #include "smt/factory.h"
+#include "system/system_copy.h"
+#include "system/lemma_bus.h"
 #include "utils/trace.h"
+#include "utils/budget.h"
 
 #include <sstream>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <iostream>
 
 namespace sally {
@@ -37,6 +44,34 @@ bmc_engine::~bmc_engine() {}
 
 engine::result bmc_engine::query(const system::transition_system* ts, const system::state_formula* sf) {
 
+  size_t workers = ctx().get_options().get_unsigned("bmc-workers");
+  if (workers > 0) {
+    smt::factory::check_thread_safe(ctx().get_options(), "bmc-workers");
+    return query_parallel(ts, sf, workers);
+  }
+
+  // Check it as the only property
+  std::vector<const system::state_formula*> properties(1, sf);
+  std::vector<result> results;
+  query_all(ts, properties, results);
+  if (results[0] == INVALID) {
+    // Put the counterexample into d_trace
+    get_property_trace(0);
+  }
+  return results[0];
+}
+
+void bmc_engine::query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results) {
+
+  // The parallel workers check one property at a time
+  if (ctx().get_options().get_unsigned("bmc-workers") > 0) {
+    engine::query_all(ts, properties, results);
+    return;
+  }
+
+  clear_property_results(ts, properties.size());
+  results.assign(properties.size(), UNKNOWN);
+
   // Make the solver
   smt::solver::ref d_solver(smt::factory::mk_default_solver(tm(), ctx().get_options(), ctx().get_statistics()));
 
@@ -44,6 +79,9 @@ engine::result bmc_engine::query(const system::transition_system* ts, const syst
   d_trace = ts->get_trace_helper();
   d_trace->clear_model();
 
+  // Lemmas from other engines
+  system::lemma_bus::client lemmas(ctx().get_lemma_bus(), ts->get_state_type());
+
   // Initial states
   expr::term_ref initial_states = ts->get_initial_states();
   const std::vector<expr::term_ref>& state_vars = d_trace->get_state_variables(0);
@@ -53,19 +91,26 @@ engine::result bmc_engine::query(const system::transition_system* ts, const syst
   // Transition formula
   expr::term_ref transition_formula = ts->get_transition_relation();
 
-  // The property
-  expr::term_ref property = sf->get_formula();
+  // The negated properties, all checked on the same unrolling
+  std::vector<expr::term_ref> properties_not;
+  for (size_t i = 0; i < properties.size(); ++ i) {
+    properties_not.push_back(tm().mk_term(expr::TERM_NOT, properties[i]->get_formula()));
+  }
+  size_t unresolved = properties.size();
 
   // The loop
   size_t bmc_min = ctx().get_options().get_unsigned("bmc-min");
   size_t bmc_max = ctx().get_options().get_unsigned("bmc-max");
 
-  // Did we get an unknown result
-  bool unknown = false;
+  // Did we get an unknown result for the property
+  std::vector<bool> unknown(properties.size(), false);
 
   // BMC loop
-  for (size_t k = 0; k <= bmc_max; ++ k) {
-  
+  for (size_t k = 0; k <= bmc_max && unresolved > 0; ++ k) {
+
+    // Stop here if we've been interrupted (e.g. in a portfolio) or ran out of budget
+    utils::budget::interruption_point();
+
     // Check the current unrolling
     if (k >= bmc_min) {
 
@@ -81,39 +126,52 @@ engine::result bmc_engine::query(const system::transition_system* ts, const syst
       }
 
       if (!d_solver->is_consistent()) {
-        // Inconsistent unrolling, property trivially valid
-        if (unknown) {
-          return UNKNOWN;
-        } else {
-          return VALID;
+        // Inconsistent unrolling, properties trivially valid
+        for (size_t i = 0; i < properties.size(); ++ i) {
+          if (results[i] == UNKNOWN && !unknown[i]) {
+            results[i] = VALID;
+            set_property_valid(i);
+          }
         }
+        return;
       }
 
-      d_solver->push();
-      expr::term_ref property_not = tm().mk_term(expr::TERM_NOT, property);
-      d_solver->add(d_trace->get_state_formula(property_not, k), smt::solver::CLASS_A);
-      smt::solver::result r = d_solver->check();
+      lemmas.assert_lemmas(&*d_solver, d_trace, k + 1);
 
-      MSG(1) << "BMC: got " << r << std::endl;
+      for (size_t i = 0; i < properties.size(); ++ i) {
 
-      // See what happened
-      switch (r) {
-      case smt::solver::SAT: {
-        expr::model::ref m = d_solver->get_model();
-        d_trace->set_model(m, 0, k);
-        return INVALID;
-      }
-      case smt::solver::UNKNOWN:
-        unknown = true;
-      case smt::solver::UNSAT:
-        // No counterexample found, continue
-        break;
-      default:
-        assert(false);
-      }
+        // Skip the ones with a counterexample already
+        if (results[i] != UNKNOWN) {
+          continue;
+        }
+
+        d_solver->push();
+        d_solver->add(d_trace->get_state_formula(properties_not[i], k), smt::solver::CLASS_A);
+        smt::solver::result r = d_solver->check();
+
+        MSG(1) << "BMC: got " << r << std::endl;
 
-      // Pop the solver
-      d_solver->pop();
+        // See what happened
+        switch (r) {
+        case smt::solver::SAT: {
+          expr::model::ref m = d_solver->get_model();
+          results[i] = INVALID;
+          set_property_cex(i, m, k + 1);
+          unresolved --;
+          break;
+        }
+        case smt::solver::UNKNOWN:
+          unknown[i] = true;
+        case smt::solver::UNSAT:
+          // No counterexample found, continue
+          break;
+        default:
+          assert(false);
+        }
+
+        // Pop the solver
+        d_solver->pop();
+      }
     }
 
     // Add the variables to the solver
@@ -124,6 +182,281 @@ engine::result bmc_engine::query(const system::transition_system* ts, const syst
     // Unroll once more
     d_solver->add(d_trace->get_transition_formula(transition_formula, k), smt::solver::CLASS_A);
   }
+}
+
+/** Shared state of the parallel workers, depths are "none" if > bmc-max */
+struct bmc_status {
+  /** Lock for the status */
+  boost::mutex mutex;
+  /** Notified every time a worker finishes */
+  boost::condition_variable worker_done;
+  /** Number of finished workers */
+  size_t finished;
+  /** Shortest counterexample found */
+  size_t cex_depth;
+  /** Smallest depth where the unrolling is inconsistent */
+  size_t inconsistent_depth;
+  /** Smallest depth where the solver returned unknown */
+  size_t unknown_depth;
+  /** Smallest depth where a worker failed */
+  size_t error_depth;
+  /** The error at error_depth */
+  std::string error;
+
+  bmc_status(size_t none)
+  : finished(0), cex_depth(none), inconsistent_depth(none), unknown_depth(none), error_depth(none)
+  {}
+
+  /** No need to check depths from here on */
+  size_t limit() const {
+    return std::min(cex_depth, std::min(inconsistent_depth, error_depth));
+  }
+};
+
+struct bmc_engine::worker {
+
+  /** Private copy of the problem */
+  system::system_copy copy;
+
+  /** Solver for the unrolling */
+  smt::solver::ref solver;
+
+  /** Lemmas from other engines */
+  system::lemma_bus::client lemmas;
+
+  /** First depth to check */
+  size_t first;
+
+  /** Distance between the depths to check */
+  size_t stride;
+
+  /** The thread running the worker */
+  boost::thread* thread;
+
+  /** Smallest depth of ours not checked yet (protected by the status mutex) */
+  size_t depth;
+
+  /** Has the worker finished (protected by the status mutex) */
+  bool done;
+
+  worker(const system::context& ctx, const system::transition_system* ts, const system::state_formula* sf, size_t first, size_t stride)
+  : copy(ctx, ts, sf)
+  , solver(smt::factory::mk_default_solver(copy.tm(), copy.get_options(), copy.get_statistics()))
+  , lemmas(ctx.get_lemma_bus(), copy.get_transition_system()->get_state_type())
+  , first(first)
+  , stride(stride)
+  , thread(0)
+  , depth(first)
+  , done(false)
+  {}
+
+  ~worker() {
+    delete thread;
+  }
+
+  /** Check the depths first, first + stride, ... up to bmc_max */
+  void check(bmc_status* status, size_t bmc_max);
+
+  /** Run the worker and mark it finished in the status */
+  void run(bmc_status* status, size_t bmc_max);
+};
+
+void bmc_engine::worker::check(bmc_status* status, size_t bmc_max) {
+
+  const system::transition_system* ts = copy.get_transition_system();
+  system::trace_helper* trace = ts->get_trace_helper();
+  trace->clear_model();
+
+  bool check_deadlock = copy.get_options().get_bool("bmc-check-deadlock");
+
+  // Initial states
+  const std::vector<expr::term_ref>& state_vars = trace->get_state_variables(0);
+  solver->add_variables(state_vars.begin(), state_vars.end(), smt::solver::CLASS_A);
+  solver->add(trace->get_state_formula(ts->get_initial_states(), 0), smt::solver::CLASS_A);
+
+  expr::term_ref transition_formula = ts->get_transition_relation();
+  expr::term_ref property_not = copy.tm().mk_term(expr::TERM_NOT, copy.get_property()->get_formula());
+
+  for (size_t k = 0; k <= bmc_max; ++ k) {
+
+    utils::budget::interruption_point();
+
+    // Check our depths, unless decided below already
+    if (k >= first && (k - first) % stride == 0) {
+
+      {
+        boost::lock_guard<boost::mutex> lock(status->mutex);
+        if (k >= status->limit()) {
+          return;
+        }
+      }
+
+      MSG(1) << "BMC: checking " << k << std::endl;
+
+      if (check_deadlock && solver->check() == smt::solver::UNSAT) {
+        std::stringstream ss;
+        ss << "Error: System in deadlock at step " << k << ".";
+        boost::lock_guard<boost::mutex> lock(status->mutex);
+        if (k < status->error_depth) {
+          status->error_depth = k;
+          status->error = ss.str();
+        }
+        return;
+      }
+
+      if (!solver->is_consistent()) {
+        // Inconsistent unrolling, no counterexamples from here on
+        boost::lock_guard<boost::mutex> lock(status->mutex);
+        status->inconsistent_depth = std::min(status->inconsistent_depth, k);
+        return;
+      }
+
+      lemmas.assert_lemmas(&*solver, trace, k + 1);
+
+      solver->push();
+      solver->add(trace->get_state_formula(property_not, k), smt::solver::CLASS_A);
+      smt::solver::result r = solver->check();
+
+      MSG(1) << "BMC: got " << r << std::endl;
+
+      if (r == smt::solver::SAT) {
+        trace->set_model(solver->get_model(), 0, k);
+        boost::lock_guard<boost::mutex> lock(status->mutex);
+        status->cex_depth = std::min(status->cex_depth, k);
+        return;
+      }
+      {
+        boost::lock_guard<boost::mutex> lock(status->mutex);
+        if (r == smt::solver::UNKNOWN) {
+          status->unknown_depth = std::min(status->unknown_depth, k);
+        }
+        depth = k + stride;
+      }
+
+      solver->pop();
+    }
+
+    // Unroll once more
+    const std::vector<expr::term_ref>& state_vars = trace->get_state_variables(k+1);
+    solver->add_variables(state_vars.begin(), state_vars.end(), smt::solver::CLASS_A);
+    const std::vector<expr::term_ref>& input_vars = trace->get_input_variables(k);
+    solver->add_variables(input_vars.begin(), input_vars.end(), smt::solver::CLASS_A);
+    solver->add(trace->get_transition_formula(transition_formula, k), smt::solver::CLASS_A);
+  }
+}
+
+void bmc_engine::worker::run(bmc_status* status, size_t bmc_max) {
+
+  std::string error;
+  try {
+    check(status, bmc_max);
+  } catch (boost::thread_interrupted&) {
+    // Stopped
+  } catch (const sally::exception& ex) {
+    error = ex.get_message();
+  } catch (...) {
+    error = "unknown error";
+  }
+
+  boost::lock_guard<boost::mutex> lock(status->mutex);
+  if (error.size() > 0) {
+    // We don't know the depth, so this error stops everyone
+    status->error_depth = 0;
+    status->error = error;
+  }
+  status->finished ++;
+  done = true;
+  status->worker_done.notify_all();
+}
+
+engine::result bmc_engine::query_parallel(const system::transition_system* ts, const system::state_formula* sf, size_t n) {
+
+  d_trace = ts->get_trace_helper();
+  d_trace->clear_model();
+
+  size_t bmc_min = ctx().get_options().get_unsigned("bmc-min");
+  size_t bmc_max = ctx().get_options().get_unsigned("bmc-max");
+
+  // Make the workers (sequentially, all terms are created here)
+  std::vector<worker*> workers;
+  for (size_t i = 0; i < n && bmc_min + i <= bmc_max; ++ i) {
+    workers.push_back(new worker(ctx(), ts, sf, bmc_min + i, n));
+  }
+
+  // Run them until they all finish (each stops once a smaller depth decides the query)
+  bmc_status status(bmc_max + 1);
+  for (size_t i = 0; i < workers.size(); ++ i) {
+    workers[i]->thread = new boost::thread(&worker::run, workers[i], &status, bmc_max);
+  }
+  bool interrupted = false;
+  try {
+    boost::unique_lock<boost::mutex> lock(status.mutex);
+    while (status.finished < workers.size()) {
+      status.worker_done.timed_wait(lock, boost::posix_time::milliseconds(10));
+      // Stop the checks past a counterexample (or inconsistency) found
+      // meanwhile, they can't change the result
+      for (size_t i = 0; i < workers.size(); ++ i) {
+        if (!workers[i]->done && workers[i]->depth >= status.limit()) {
+          smt::solver::interrupt_all(&workers[i]->copy.tm());
+        }
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    interrupted = true;
+  }
+
+  // Workers out of budget stop on their own
+  bool out_of_budget = utils::budget::exhausted();
+
+  // Wait for everyone (they reference our data)
+  {
+    boost::this_thread::disable_interruption no_interrupt;
+    for (size_t i = 0; i < workers.size(); ++ i) {
+      if (interrupted || out_of_budget) {
+        workers[i]->thread->interrupt();
+        // Stop the check in progress too
+        while (!workers[i]->thread->timed_join(boost::posix_time::milliseconds(10))) {
+          smt::solver::interrupt_all(&workers[i]->copy.tm());
+        }
+      }
+      workers[i]->thread->join();
+    }
+  }
+
+  // Out of budget, the result still holds if all the smaller depths were checked
+  if (out_of_budget) {
+    for (size_t i = 0; i < workers.size(); ++ i) {
+      if (workers[i]->depth < status.limit()) {
+        interrupted = true;
+      }
+    }
+  }
+
+  // Shortest counterexample (all smaller depths have been checked)
+  bool cex = !interrupted && status.cex_depth < status.error_depth && status.cex_depth <= bmc_max;
+  if (cex) {
+    size_t k = status.cex_depth;
+    MSG(1) << "BMC: counterexample at " << k << std::endl;
+    workers[(k - bmc_min) % n]->copy.copy_trace_to_main(d_trace);
+  }
+
+  for (size_t i = 0; i < workers.size(); ++ i) {
+    delete workers[i];
+  }
+
+  if (interrupted) {
+    throw boost::thread_interrupted();
+  }
+  if (cex) {
+    return INVALID;
+  }
+  if (status.error_depth <= bmc_max) {
+    throw exception(status.error);
+  }
+  if (status.inconsistent_depth <= bmc_max && status.unknown_depth > status.inconsistent_depth) {
+    // Inconsistent unrolling, property trivially valid
+    return VALID;
+  }
 
   return UNKNOWN;
 }
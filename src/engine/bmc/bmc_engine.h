@@ -29,12 +29,22 @@ namespace bmc {
 
 /**
  * Bounded model checking engine.
+ *
+ * With option bmc-workers set to n > 0, the depths are checked by n workers,
+ * each in its own thread with a private copy of the problem. Worker i checks
+ * depths i, i + n, i + 2n, ..., and the shortest counterexample is reported.
  */
 class bmc_engine : public engine {
 
   /** The trace we're building */
   system::trace_helper* d_trace;
 
+  /** A worker checking some of the depths on a private copy of the problem */
+  struct worker;
+
+  /** Query with the depths checked by the given number of workers */
+  result query_parallel(const system::transition_system* ts, const system::state_formula* sf, size_t n);
+
 public:
 
   bmc_engine(const system::context& ctx);
@@ -43,6 +53,9 @@ public:
   /** Query */
   result query(const system::transition_system* ts, const system::state_formula* sf);
 
+  /** Query all the properties on the same unrolling */
+  void query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results);
+
   /** Trace */
   const system::trace_helper* get_trace();
 
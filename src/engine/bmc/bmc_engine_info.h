@@ -33,6 +33,7 @@ struct bmc_engine_info {
         ("bmc-max", value<unsigned>()->default_value(10), "Maximal unrolling length to check.")
         ("bmc-min", value<unsigned>()->default_value(0), "Minimal unrolling length to check.")
         ("bmc-check-deadlock", "Check for deadlocks throughout the algorithm.")
+        ("bmc-workers", value<unsigned>()->default_value(0), "Number of threads checking the depths in parallel, strided by depth (0 for sequential).")
         ;
   }
 
@@ -18,14 +18,18 @@
 
 #include "engine/engine.h"
 #include "utils/output.h"
+#include "system/transition_system.h"
+#include "utils/exception.h"
 
 #include <iostream>
+#include <cassert>
 
 namespace sally {
 
 engine::engine(const system::context& ctx)
 : gc_participant(ctx.tm())
 , d_ctx(ctx)
+, d_property_system(0)
 {}
 
 const system::context& engine::ctx() const {
@@ -36,6 +40,82 @@ expr::term_manager& engine::tm() const {
   return ctx().tm();
 }
 
+void engine::query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results) {
+  clear_property_results(ts, properties.size());
+  results.clear();
+  for (size_t i = 0; i < properties.size(); ++ i) {
+    result r = query(ts, properties[i]);
+    set_property_result(i, r);
+    results.push_back(r);
+  }
+}
+
+void engine::clear_property_results(const system::transition_system* ts, size_t n) {
+  d_property_system = ts;
+  d_property_results.clear();
+  d_property_results.resize(n);
+}
+
+void engine::set_property_result(size_t i, result r) {
+  assert(i < d_property_results.size());
+  property_result& pr = d_property_results[i];
+  pr.r = r;
+  pr.recorded = true;
+  if (r == INVALID) {
+    const system::trace_helper* trace = get_trace();
+    pr.model = trace->get_model();
+    pr.model_size = trace->get_model_size();
+  }
+  if (r == VALID) {
+    pr.inv = get_invariant();
+  }
+}
+
+void engine::set_property_cex(size_t i, expr::model::ref m, size_t size) {
+  assert(i < d_property_results.size());
+  assert(size > 0);
+  property_result& pr = d_property_results[i];
+  pr.r = INVALID;
+  pr.recorded = true;
+  pr.model = m;
+  pr.model_size = size;
+}
+
+void engine::set_property_valid(size_t i) {
+  assert(i < d_property_results.size());
+  d_property_results[i].r = VALID;
+  d_property_results[i].recorded = true;
+}
+
+engine::result engine::get_property_result(size_t i) const {
+  if (i >= d_property_results.size() || !d_property_results[i].recorded) {
+    return INTERRUPTED;
+  }
+  return d_property_results[i].r;
+}
+
+const system::trace_helper* engine::get_property_trace(size_t i) {
+  assert(i < d_property_results.size());
+  const property_result& pr = d_property_results[i];
+  if (pr.r != INVALID) {
+    throw exception("No counterexample for this property.");
+  }
+  // Put the counterexample back into the trace of the system
+  system::trace_helper* trace = d_property_system->get_trace_helper();
+  trace->clear_model();
+  trace->set_model(pr.model, 0, pr.model_size - 1);
+  return trace;
+}
+
+engine::invariant engine::get_property_invariant(size_t i) {
+  assert(i < d_property_results.size());
+  const property_result& pr = d_property_results[i];
+  if (pr.r != VALID || pr.inv.F.is_null()) {
+    throw exception("No invariant for this property.");
+  }
+  return pr.inv;
+}
+
 std::ostream& operator << (std::ostream& out, engine::result result) {
 
   output::language lang = output::get_output_language(out);
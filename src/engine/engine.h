@@ -24,6 +24,7 @@
 #include "../system/trace_helper.h"
 
 #include <string>
+#include <vector>
 
 namespace sally {
 
@@ -87,6 +88,65 @@ public:
   virtual
   invariant get_invariant() = 0;
 
+  /**
+   * Query several properties of the same system, results[i] is the result
+   * for properties[i]. The default is to query the properties one by one,
+   * engines that can share work between the properties override this.
+   */
+  virtual
+  void query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results);
+
+  /**
+   * Get the result of property i of the previous query_all(), INTERRUPTED if
+   * it wasn't decided (e.g. query_all() was interrupted before).
+   */
+  result get_property_result(size_t i) const;
+
+  /** Get the counter-example trace of property i of the previous query_all() */
+  const system::trace_helper* get_property_trace(size_t i);
+
+  /** Get the invariant of property i of the previous query_all() */
+  invariant get_property_invariant(size_t i);
+
+protected:
+
+  /** Start recording the results of query_all() for n properties of ts */
+  void clear_property_results(const system::transition_system* ts, size_t n);
+
+  /** Record the result of property i, with the trace or invariant of the last query() */
+  void set_property_result(size_t i, result r);
+
+  /** Record property i as invalid with the counterexample of given size (model over trace variables) */
+  void set_property_cex(size_t i, expr::model::ref m, size_t size);
+
+  /** Record property i as valid (no invariant) */
+  void set_property_valid(size_t i);
+
+private:
+
+  /** Result of one property in query_all() */
+  struct property_result {
+    /** The result */
+    result r;
+    /** The counterexample, if invalid */
+    expr::model::ref model;
+    /** Number of frames in the counterexample */
+    size_t model_size;
+    /** The invariant, if valid and available */
+    invariant inv;
+    /** Has the result been recorded */
+    bool recorded;
+
+    property_result()
+    : r(UNKNOWN), model_size(0), inv(expr::term_ref(), 0), recorded(false) {}
+  };
+
+  /** The system of the last query_all() */
+  const system::transition_system* d_property_system;
+
+  /** Results of the last query_all() */
+  std::vector<property_result> d_property_results;
+
 };
 
 std::ostream& operator << (std::ostream& out, engine::result result);
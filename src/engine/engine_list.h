@@ -22,16 +22,22 @@
 // ADD ALL THE ENGINES HERE
 //
 
+#include "engine/aig/aig_engine_info.h"
 #include "engine/bmc/bmc_engine_info.h"
 #include "engine/kind/kind_engine_info.h"
 #include "engine/pdkind/pdkind_engine_info.h"
+#include "engine/portfolio/portfolio_engine_info.h"
+#include "engine/sim/sim_engine_info.h"
 
 #include "engine/translator/translator_info.h"
 
 sally::engine_data::engine_data() {
+  add_module_info<aig::aig_engine_info>();
   add_module_info<bmc::bmc_engine_info>();
   add_module_info<kind::kind_engine_info>();
   add_module_info<pdkind::pdkind_engine_info>();
+  add_module_info<portfolio::portfolio_engine_info>();
+  add_module_info<sim::sim_engine_info>();
   add_module_info<output::translator_info>();
 }
 
@@ -19,9 +19,17 @@
 #include "engine/kind/kind_engine.h"
 
 #include "smt/factory.h"
+#include "system/system_copy.h"
+#include "system/lemma_bus.h"
 #include "utils/trace.h"
+#include "utils/budget.h"
 
 #include <sstream>
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <iostream>
 #include "../../system/trace_helper.h"
 #include <cassert>
@@ -41,6 +49,11 @@ kind_engine::~kind_engine() {
 
 engine::result kind_engine::query(const system::transition_system* ts, const system::state_formula* sf) {
 
+  if (ctx().get_options().get_bool("kind-parallel")) {
+    smt::factory::check_thread_safe(ctx().get_options(), "kind-parallel");
+    return query_parallel(ts, sf);
+  }
+
   /*
 
     We try to find a k such that:
@@ -67,6 +80,10 @@ engine::result kind_engine::query(const system::transition_system* ts, const sys
   d_trace = ts->get_trace_helper();
   d_trace->clear_model();
 
+  // Lemmas from other engines (for each solver)
+  system::lemma_bus::client lemmas1(ctx().get_lemma_bus(), ts->get_state_type());
+  system::lemma_bus::client lemmas2(ctx().get_lemma_bus(), ts->get_state_type());
+
   typedef std::vector<expr::term_ref> var_vec;
 
   // Add initial state variables
@@ -102,9 +119,13 @@ engine::result kind_engine::query(const system::transition_system* ts, const sys
       return UNKNOWN;
     }
 
+    // Stop here if we've been interrupted (e.g. in a portfolio) or ran out of budget
+    utils::budget::interruption_point();
+
     MSG(1) << "K-Induction: checking initialization " << k << std::endl;
 
     // Check the current unrolling (1)
+    lemmas1.assert_lemmas(&*solver1, d_trace, k + 1);
     solver1->push();
     solver1->add(property_not_k, smt::solver::CLASS_A);
     smt::solver::result r_1 = solver1->check();
@@ -160,6 +181,7 @@ engine::result kind_engine::query(const system::transition_system* ts, const sys
 
     // Check the current unrolling (2)
     if (check_consecution) {
+      lemmas2.assert_lemmas(&*solver2, d_trace, k + 1);
       solver2->push();
       solver2->add(property_not_k, smt::solver::CLASS_A);
       smt::solver::result r_2 = solver2->check_relaxed();
@@ -172,11 +194,15 @@ engine::result kind_engine::query(const system::transition_system* ts, const sys
       case smt::solver::UNKNOWN:
         // Couldn't prove it, continue
         break;
-      case smt::solver::UNSAT:
-        // Proved it, done
-        d_invariant = invariant(property, k);
+      case smt::solver::UNSAT: {
+        // Proved it, done (invariant includes the lemmas we used, and is as
+        // deep as the deepest of them)
+        std::vector<expr::term_ref> invariant_conjuncts(1, property);
+        lemmas2.get_asserted(invariant_conjuncts);
+        d_invariant = invariant(tm().mk_and(invariant_conjuncts), std::max<size_t>(k, lemmas2.get_asserted_depth()));
+        lemmas1.publish(property, d_invariant.depth);
         return VALID;
-        break;
+      }
       default:
         assert(false);
       }
@@ -192,6 +218,280 @@ engine::result kind_engine::query(const system::transition_system* ts, const sys
   return UNKNOWN;
 }
 
+/** Shared state of the parallel base case and step workers */
+struct kind_status {
+  /** Lock for the status */
+  boost::mutex mutex;
+  /** Notified every time the status changes */
+  boost::condition_variable changed;
+  /** Set when the workers should stop */
+  boost::atomic<bool> stop;
+  /** The property holds at steps 0, ..., base_checked-1 */
+  size_t base_checked;
+  /** Base case found a counterexample of length base_checked */
+  bool base_cex;
+  /** Base case worker is done */
+  bool base_done;
+  /** Step proved the property at this k (0 if not proved) */
+  size_t step_proved;
+  /** Step worker is done */
+  bool step_done;
+
+  kind_status()
+  : stop(false), base_checked(0), base_cex(false), base_done(false), step_proved(0), step_done(false)
+  {}
+
+  /** Is the property decided (invalid or valid) */
+  bool decided() const {
+    return base_cex || (step_proved > 0 && base_checked >= step_proved);
+  }
+
+  /** Is there anything more to expect from the workers */
+  bool finished() const {
+    return decided() || (base_done && (step_done || step_proved > 0));
+  }
+};
+
+struct kind_engine::worker {
+
+  /** Private copy of the problem */
+  system::system_copy copy;
+
+  /** Solver for the unrolling */
+  smt::solver::ref solver;
+
+  /** Lemmas from other engines */
+  system::lemma_bus::client lemmas;
+
+  /** Is this the base case worker (otherwise step) */
+  bool base;
+
+  /** Error message if the worker failed */
+  std::string error;
+
+  /** The thread running the worker */
+  boost::thread* thread;
+
+  worker(const system::context& ctx, const system::transition_system* ts, const system::state_formula* sf, bool base)
+  : copy(ctx, ts, sf)
+  , solver(smt::factory::mk_default_solver(copy.tm(), copy.get_options(), copy.get_statistics()))
+  , lemmas(ctx.get_lemma_bus(), copy.get_transition_system()->get_state_type())
+  , base(base)
+  , thread(0)
+  {}
+
+  ~worker() {
+    delete thread;
+  }
+
+  /** Check (1) for k = 0, ..., kind_max-1 */
+  void check_base(kind_status* status, unsigned kind_max);
+
+  /** Check (2) for k = kind_min+1, ..., kind_max */
+  void check_step(kind_status* status, unsigned kind_min, unsigned kind_max);
+
+  /** Run the worker and mark it done in the status */
+  void run(kind_status* status, unsigned kind_min, unsigned kind_max);
+};
+
+void kind_engine::worker::check_base(kind_status* status, unsigned kind_max) {
+
+  system::trace_helper* trace = copy.get_transition_system()->get_trace_helper();
+  trace->clear_model();
+
+  expr::term_ref initial_states = copy.get_transition_system()->get_initial_states();
+  expr::term_ref transition_formula = copy.get_transition_system()->get_transition_relation();
+  expr::term_ref property = copy.get_property()->get_formula();
+
+  solver->add_variables(trace->get_state_variables(0), smt::solver::CLASS_A);
+  solver->add(trace->get_state_formula(initial_states, 0), smt::solver::CLASS_A);
+
+  for (unsigned k = 0; k < kind_max && !status->stop; ++ k) {
+
+    utils::budget::interruption_point();
+
+    MSG(1) << "K-Induction: checking initialization " << k << std::endl;
+
+    // Check the current unrolling (1)
+    expr::term_ref property_k = trace->get_state_formula(property, k);
+    lemmas.assert_lemmas(&*solver, trace, k + 1);
+    solver->push();
+    solver->add(copy.tm().mk_term(expr::TERM_NOT, property_k), smt::solver::CLASS_A);
+    smt::solver::result r = solver->check();
+
+    MSG(1) << "K-Induction: got " << r << std::endl;
+
+    if (r == smt::solver::SAT) {
+      trace->set_model(solver->get_model(), 0, k);
+      boost::lock_guard<boost::mutex> lock(status->mutex);
+      status->base_checked = k;
+      status->base_cex = true;
+      return;
+    }
+    if (r == smt::solver::UNKNOWN) {
+      return;
+    }
+    solver->pop();
+
+    // Property holds at 0, ..., k
+    {
+      boost::lock_guard<boost::mutex> lock(status->mutex);
+      status->base_checked = k + 1;
+      status->changed.notify_all();
+    }
+
+    // One more transition
+    solver->add_variables(trace->get_input_variables(k), smt::solver::CLASS_A);
+    solver->add_variables(trace->get_state_variables(k+1), smt::solver::CLASS_A);
+    solver->add(trace->get_transition_formula(transition_formula, k), smt::solver::CLASS_A);
+  }
+}
+
+void kind_engine::worker::check_step(kind_status* status, unsigned kind_min, unsigned kind_max) {
+
+  system::trace_helper* trace = copy.get_transition_system()->get_trace_helper();
+
+  expr::term_ref transition_formula = copy.get_transition_system()->get_transition_relation();
+  expr::term_ref property = copy.get_property()->get_formula();
+
+  solver->add_variables(trace->get_state_variables(0), smt::solver::CLASS_A);
+
+  for (unsigned k = 0; k < kind_max && !status->stop; ++ k) {
+
+    utils::budget::interruption_point();
+
+    // Add property and transition at k
+    solver->add_variables(trace->get_input_variables(k), smt::solver::CLASS_A);
+    solver->add_variables(trace->get_state_variables(k+1), smt::solver::CLASS_A);
+    solver->add(trace->get_state_formula(property, k), smt::solver::CLASS_A);
+    solver->add(trace->get_transition_formula(transition_formula, k), smt::solver::CLASS_A);
+
+    if (k < kind_min) {
+      continue;
+    }
+
+    MSG(1) << "K-Induction: checking consecution " << k << std::endl;
+
+    // Check the current unrolling (2)
+    expr::term_ref property_next = trace->get_state_formula(property, k + 1);
+    lemmas.assert_lemmas(&*solver, trace, k + 2);
+    solver->push();
+    solver->add(copy.tm().mk_term(expr::TERM_NOT, property_next), smt::solver::CLASS_A);
+    smt::solver::result r = solver->check_relaxed();
+
+    MSG(1) << "K-Induction: got " << r << std::endl;
+
+    if (r == smt::solver::UNSAT) {
+      boost::lock_guard<boost::mutex> lock(status->mutex);
+      status->step_proved = k + 1;
+      return;
+    }
+    solver->pop();
+  }
+}
+
+void kind_engine::worker::run(kind_status* status, unsigned kind_min, unsigned kind_max) {
+
+  try {
+    if (base) {
+      check_base(status, kind_max);
+    } else {
+      check_step(status, kind_min, kind_max);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Stopped
+  } catch (const sally::exception& ex) {
+    error = ex.get_message();
+  } catch (...) {
+    error = "unknown error";
+  }
+
+  boost::lock_guard<boost::mutex> lock(status->mutex);
+  if (base) {
+    status->base_done = true;
+  } else {
+    status->step_done = true;
+  }
+  status->changed.notify_all();
+}
+
+engine::result kind_engine::query_parallel(const system::transition_system* ts, const system::state_formula* sf) {
+
+  d_trace = ts->get_trace_helper();
+  d_trace->clear_model();
+
+  unsigned kind_min = ctx().get_options().get_unsigned("kind-min");
+  unsigned kind_max = ctx().get_options().get_unsigned("kind-max");
+
+  // Make the workers (sequentially, all terms are created here)
+  worker base(ctx(), ts, sf, true);
+  worker step(ctx(), ts, sf, false);
+
+  // Run until the property is decided, or both workers give up
+  kind_status status;
+  base.thread = new boost::thread(&worker::run, &base, &status, kind_min, kind_max);
+  step.thread = new boost::thread(&worker::run, &step, &status, kind_min, kind_max);
+  bool interrupted = false;
+  try {
+    boost::unique_lock<boost::mutex> lock(status.mutex);
+    while (!status.finished()) {
+      status.changed.wait(lock);
+    }
+  } catch (boost::thread_interrupted&) {
+    interrupted = true;
+  }
+
+  // Stop both workers and wait for them (they reference our data)
+  {
+    boost::this_thread::disable_interruption no_interrupt;
+    status.stop = true;
+    base.thread->interrupt();
+    step.thread->interrupt();
+    // Stop the checks in progress too
+    while (!base.thread->timed_join(boost::posix_time::milliseconds(10))) {
+      smt::solver::interrupt_all(&base.copy.tm());
+    }
+    while (!step.thread->timed_join(boost::posix_time::milliseconds(10))) {
+      smt::solver::interrupt_all(&step.copy.tm());
+    }
+  }
+
+  if (interrupted) {
+    throw boost::thread_interrupted();
+  }
+
+  if (status.base_cex) {
+    MSG(1) << "K-Induction: counterexample at " << status.base_checked << std::endl;
+    base.copy.copy_trace_to_main(d_trace);
+    return INVALID;
+  }
+
+  if (status.decided()) {
+    MSG(1) << "K-Induction: proved at " << status.step_proved << std::endl;
+    std::vector<expr::term_ref> step_lemmas, invariant_conjuncts(1, sf->get_formula());
+    step.lemmas.get_asserted(step_lemmas);
+    for (size_t i = 0; i < step_lemmas.size(); ++ i) {
+      invariant_conjuncts.push_back(step.copy.to_main(step_lemmas[i]));
+    }
+    d_invariant = invariant(tm().mk_and(invariant_conjuncts), std::max(status.step_proved, step.lemmas.get_asserted_depth()));
+    system::lemma_bus::client lemmas(ctx().get_lemma_bus(), ts->get_state_type());
+    lemmas.publish(sf->get_formula(), d_invariant.depth);
+    return VALID;
+  }
+
+  if (base.error.size() > 0) {
+    throw exception(base.error);
+  }
+  if (step.error.size() > 0) {
+    throw exception(step.error);
+  }
+
+  // The workers might have stopped because we're out of budget
+  utils::budget::interruption_point();
+
+  return UNKNOWN;
+}
+
 const system::trace_helper* kind_engine::get_trace() {
   return d_trace;
 }
@@ -37,6 +37,10 @@ namespace kind {
  *     and_{0 <= i < k} (P_i and T_i) => P_k
  *
  * Options kind-min and kind-max set the range of k to try.
+ *
+ * With option kind-parallel, (1) and (2) are checked by two workers, each in
+ * its own thread with a private copy of the problem. Each worker advances its
+ * own unrolling, and both stop as soon as the property is decided.
  */
 class kind_engine : public engine {
 
@@ -46,6 +50,12 @@ class kind_engine : public engine {
   /** The invariant if proven */
   invariant d_invariant;
 
+  /** A worker checking (1) or (2) on a private copy of the problem */
+  struct worker;
+
+  /** Query with the base case and the step checked in parallel */
+  result query_parallel(const system::transition_system* ts, const system::state_formula* sf);
+
 public:
 
   kind_engine(const system::context& ctx);
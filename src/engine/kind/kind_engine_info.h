@@ -32,6 +32,7 @@ struct kind_engine_info {
     options.add_options()
         ("kind-max", value<unsigned>()->default_value(10), "Maximal k for k-induction.")
         ("kind-min", value<unsigned>()->default_value(0), "Minimal k for k-induction.")
+        ("kind-parallel", "Check the base case and the induction step in parallel threads.")
         ;
   }
 
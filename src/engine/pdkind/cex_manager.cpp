@@ -30,6 +30,7 @@ namespace pdkind {
 
 void cex_manager::clear() {
   d_cex_graph.clear();
+  d_roots.clear();
 }
 
 void cex_manager::add_edge(expr::term_ref A, expr::term_ref B, size_t edge_length, size_t property_id) {
@@ -60,6 +61,24 @@ void cex_manager::mark_root(expr::term_ref A, size_t property_id) {
   d_roots.push_back(cex_root(A, property_id));
 }
 
+void cex_manager::get_edges(std::vector<expr::term_ref>& from, edge_vector& edges) const {
+  cex_graph::const_iterator it = d_cex_graph.begin();
+  for (; it != d_cex_graph.end(); ++ it) {
+    edge_list::const_iterator edge = it->second.begin();
+    for (; edge != it->second.end(); ++ edge) {
+      from.push_back(it->first);
+      edges.push_back(*edge);
+    }
+  }
+}
+
+void cex_manager::get_roots(std::vector<expr::term_ref>& roots, std::vector<size_t>& property_ids) const {
+  for (size_t i = 0; i < d_roots.size(); ++ i) {
+    roots.push_back(d_roots[i].A);
+    property_ids.push_back(d_roots[i].property_id);
+  }
+}
+
 const size_t infty = -1;
 
 /** Comparison for Dijkstra, comapre based on shortest paths */
@@ -105,6 +105,12 @@ public:
    */
   expr::term_ref get_full_cex(size_t property_id, edge_vector& edges) const;
 
+  /** Get all the edges, edges[i] going out of from[i] */
+  void get_edges(std::vector<expr::term_ref>& from, edge_vector& edges) const;
+
+  /** Get all the roots, with their property ids */
+  void get_roots(std::vector<expr::term_ref>& roots, std::vector<size_t>& property_ids) const;
+
   /** Print to stream */
   void to_stream(std::ostream& out) const;
 
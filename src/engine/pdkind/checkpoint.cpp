@@ -0,0 +1,650 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/pdkind/checkpoint.h"
+
+#include "expr/term_manager.h"
+#include "expr/term_map.h"
+#include "utils/exception.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+
+namespace sally {
+namespace pdkind {
+
+namespace {
+
+/** Identifies the checkpoint files */
+const std::string checkpoint_magic = "sally-pdkind";
+
+/** Version of the format */
+const uint64_t checkpoint_version = 2;
+
+/** Write x in 7-bit groups, the high bit marks that more groups follow */
+void write_uint(std::ostream& out, uint64_t x) {
+  while (x >= 0x80) {
+    out.put((char) ((x & 0x7f) | 0x80));
+    x >>= 7;
+  }
+  out.put((char) x);
+}
+
+uint64_t read_uint(std::istream& in) {
+  uint64_t x = 0;
+  for (size_t shift = 0; shift < 64; shift += 7) {
+    int c = in.get();
+    if (c == EOF) {
+      throw exception("pdkind: checkpoint file is truncated");
+    }
+    x |= ((uint64_t) (c & 0x7f)) << shift;
+    if (!(c & 0x80)) {
+      return x;
+    }
+  }
+  throw exception("pdkind: checkpoint file is corrupt");
+}
+
+void write_string(std::ostream& out, const std::string& s) {
+  write_uint(out, s.size());
+  out.write(s.data(), s.size());
+}
+
+std::string read_string(std::istream& in) {
+  size_t size = read_uint(in);
+  std::string s;
+  for (size_t i = 0; i < size; ++ i) {
+    int c = in.get();
+    if (c == EOF) {
+      throw exception("pdkind: checkpoint file is truncated");
+    }
+    s.push_back((char) c);
+  }
+  return s;
+}
+
+/** Doubles are written as their bits, least significant byte first */
+void write_double(std::ostream& out, double x) {
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  for (size_t i = 0; i < 8; ++ i) {
+    out.put((char) (bits & 0xff));
+    bits >>= 8;
+  }
+}
+
+double read_double(std::istream& in) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < 8; ++ i) {
+    int c = in.get();
+    if (c == EOF) {
+      throw exception("pdkind: checkpoint file is truncated");
+    }
+    bits |= ((uint64_t) (c & 0xff)) << (8*i);
+  }
+  double x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+/** The state variable classes we store */
+const system::state_type::var_class var_classes[3] = {
+  system::state_type::STATE_CURRENT,
+  system::state_type::STATE_INPUT,
+  system::state_type::STATE_NEXT
+};
+
+/** Signature of the state variables (their types), to check we load for the same system */
+std::string state_signature(const system::state_type* st) {
+  std::stringstream ss;
+  ss << expr::set_tm(st->tm());
+  for (size_t vc = 0; vc < 3; ++ vc) {
+    const std::vector<expr::term_ref>& vars = st->get_variables(var_classes[vc]);
+    ss << vars.size();
+    for (size_t i = 0; i < vars.size(); ++ i) {
+      ss << " " << st->tm().type_of(vars[i]);
+    }
+    ss << ";";
+  }
+  return ss.str();
+}
+
+/**
+ * Collects the terms into a table, children before parents. Each term is
+ * written as its operator, payload and indices of children. Variables are
+ * written as their class and index in the state type.
+ */
+class term_table_writer {
+
+  /** The term manager */
+  expr::term_manager& d_tm;
+
+  /** Position of the state variables: var -> (class, index) */
+  expr::term_ref_hash_map< std::pair<size_t, size_t> > d_vars;
+
+  /** Index of the terms already in the table */
+  expr::term_ref_hash_map<size_t> d_ids;
+
+  /** The table so far */
+  std::ostringstream d_table;
+
+  /** Terms to add */
+  std::vector<expr::term_ref> d_to_process;
+
+  /** Write the term, children must already be in the table */
+  void write_term(expr::term_ref t);
+
+public:
+
+  term_table_writer(const system::state_type* st);
+
+  /** Index of t in the table (adds t if not there yet) */
+  size_t id(expr::term_ref t);
+
+  /** Write id(t) */
+  void write_ref(std::ostream& out, expr::term_ref t) {
+    write_uint(out, id(t));
+  }
+
+  /** Number of terms in the table */
+  size_t size() const { return d_ids.size(); }
+
+  /** The table */
+  std::string table() const { return d_table.str(); }
+};
+
+term_table_writer::term_table_writer(const system::state_type* st)
+: d_tm(st->tm())
+{
+  for (size_t vc = 0; vc < 3; ++ vc) {
+    const std::vector<expr::term_ref>& vars = st->get_variables(var_classes[vc]);
+    for (size_t i = 0; i < vars.size(); ++ i) {
+      d_vars[vars[i]] = std::make_pair(vc, i);
+    }
+  }
+}
+
+size_t term_table_writer::id(expr::term_ref t) {
+
+  d_to_process.push_back(t);
+  while (!d_to_process.empty()) {
+    expr::term_ref current = d_to_process.back();
+
+    // Already there
+    if (d_ids.find(current) != d_ids.end()) {
+      d_to_process.pop_back();
+      continue;
+    }
+
+    // Add the children first (variable children are their types)
+    const expr::term& current_term = d_tm.term_of(current);
+    bool children_done = true;
+    if (current_term.op() != expr::VARIABLE) {
+      for (size_t i = 0; i < current_term.size(); ++ i) {
+        if (d_ids.find(current_term[i]) == d_ids.end()) {
+          d_to_process.push_back(current_term[i]);
+          children_done = false;
+        }
+      }
+    }
+    if (!children_done) {
+      continue;
+    }
+
+    d_to_process.pop_back();
+    write_term(current);
+    size_t current_id = d_ids.size();
+    d_ids[current] = current_id;
+  }
+
+  return d_ids.find(t)->second;
+}
+
+void term_table_writer::write_term(expr::term_ref t) {
+
+  const expr::term& t_term = d_tm.term_of(t);
+  expr::term_op op = t_term.op();
+  write_uint(d_table, op);
+
+  // Payload
+  switch (op) {
+  case expr::VARIABLE: {
+    expr::term_ref_hash_map< std::pair<size_t, size_t> >::const_iterator find = d_vars.find(t);
+    if (find == d_vars.end()) {
+      std::stringstream ss;
+      ss << expr::set_tm(d_tm) << "pdkind: can't checkpoint " << t << ", it's not a state variable";
+      throw exception(ss.str());
+    }
+    write_uint(d_table, find->second.first);
+    write_uint(d_table, find->second.second);
+    // Type is known from the state type
+    return;
+  }
+  case expr::CONST_BOOL:
+    write_uint(d_table, d_tm.get_boolean_constant(t_term));
+    break;
+  case expr::CONST_RATIONAL:
+    write_string(d_table, d_tm.get_rational_constant(t_term).mpq().get_str(10));
+    break;
+  case expr::CONST_BITVECTOR: {
+    expr::bitvector bv = d_tm.get_bitvector_constant(t_term);
+    write_uint(d_table, bv.size());
+    write_string(d_table, bv.mpz().get_str(16));
+    break;
+  }
+  case expr::CONST_STRING:
+    write_string(d_table, d_tm.get_string_constant(t_term));
+    break;
+  case expr::CONST_ENUM:
+    write_uint(d_table, d_tm.get_enum_constant_value(t));
+    break;
+  case expr::TYPE_BITVECTOR:
+    write_uint(d_table, d_tm.get_bitvector_type_size(t));
+    break;
+  case expr::TERM_BV_EXTRACT: {
+    expr::bitvector_extract extract = d_tm.get_bitvector_extract(t_term);
+    write_uint(d_table, extract.high);
+    write_uint(d_table, extract.low);
+    break;
+  }
+  case expr::TERM_BV_SGN_EXTEND:
+    write_uint(d_table, d_tm.get_bitvector_sgn_extend(t_term).size);
+    break;
+  case expr::TERM_TUPLE_READ:
+    write_uint(d_table, d_tm.get_tuple_read_index(t));
+    break;
+  case expr::TERM_TUPLE_WRITE:
+    write_uint(d_table, d_tm.get_tuple_write_index(t));
+    break;
+  case expr::TYPE_TYPE:
+  case expr::TYPE_STRING:
+  case expr::TYPE_PREDICATE_SUBTYPE:
+  case expr::TERM_ARRAY_LAMBDA:
+  case expr::TERM_LAMBDA:
+  case expr::TERM_EXISTS:
+  case expr::TERM_FORALL: {
+    // Not rebuilt when loading (and have bound variables)
+    std::stringstream ss;
+    ss << expr::set_tm(d_tm) << "pdkind: can't checkpoint " << t;
+    throw exception(ss.str());
+  }
+  default:
+    break;
+  }
+
+  // Children
+  write_uint(d_table, t_term.size());
+  for (size_t i = 0; i < t_term.size(); ++ i) {
+    write_uint(d_table, d_ids.find(t_term[i])->second);
+  }
+}
+
+/** Reads the term table and rebuilds the terms */
+class term_table_reader {
+
+  /** The term manager */
+  expr::term_manager& d_tm;
+
+  /** The state type */
+  const system::state_type* d_st;
+
+  /** The terms read so far */
+  std::vector<expr::term_ref> d_terms;
+
+  /** Children of the current term */
+  std::vector<expr::term_ref> d_children;
+
+  /** Read one term */
+  expr::term_ref read_term(std::istream& in);
+
+  /** Get child i of the current term */
+  expr::term_ref child(size_t i) const;
+
+  /** Get the children of the current term as (name, term) pairs */
+  expr::term_manager::id_to_term_map read_fields() const;
+
+public:
+
+  term_table_reader(const system::state_type* st)
+  : d_tm(st->tm()), d_st(st) {}
+
+  /** Read the whole table */
+  void read(std::istream& in);
+
+  /** Read a reference to a term in the table */
+  expr::term_ref read_ref(std::istream& in) const;
+};
+
+void term_table_reader::read(std::istream& in) {
+  size_t size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    d_terms.push_back(read_term(in));
+  }
+}
+
+expr::term_ref term_table_reader::read_ref(std::istream& in) const {
+  size_t id = read_uint(in);
+  if (id >= d_terms.size()) {
+    throw exception("pdkind: checkpoint file is corrupt");
+  }
+  return d_terms[id];
+}
+
+expr::term_ref term_table_reader::child(size_t i) const {
+  if (i >= d_children.size()) {
+    throw exception("pdkind: checkpoint file is corrupt");
+  }
+  return d_children[i];
+}
+
+expr::term_manager::id_to_term_map term_table_reader::read_fields() const {
+  if (d_children.size() % 2) {
+    throw exception("pdkind: checkpoint file is corrupt");
+  }
+  expr::term_manager::id_to_term_map fields;
+  for (size_t i = 0; i < d_children.size(); i += 2) {
+    const expr::term& name = d_tm.term_of(d_children[i]);
+    if (name.op() != expr::CONST_STRING) {
+      throw exception("pdkind: checkpoint file is corrupt");
+    }
+    fields[d_tm.get_string_constant(name)] = d_children[i + 1];
+  }
+  return fields;
+}
+
+expr::term_ref term_table_reader::read_term(std::istream& in) {
+
+  uint64_t op_value = read_uint(in);
+  if (op_value >= expr::OP_LAST) {
+    throw exception("pdkind: checkpoint file is corrupt");
+  }
+  expr::term_op op = (expr::term_op) op_value;
+
+  // Payload
+  uint64_t p1 = 0, p2 = 0;
+  std::string s;
+  switch (op) {
+  case expr::VARIABLE: {
+    size_t vc = read_uint(in);
+    size_t i = read_uint(in);
+    if (vc >= 3 || i >= d_st->get_variables(var_classes[vc]).size()) {
+      throw exception("pdkind: checkpoint file is corrupt");
+    }
+    return d_st->get_variables(var_classes[vc])[i];
+  }
+  case expr::CONST_BOOL:
+  case expr::CONST_ENUM:
+  case expr::TYPE_BITVECTOR:
+  case expr::TERM_BV_SGN_EXTEND:
+  case expr::TERM_TUPLE_READ:
+  case expr::TERM_TUPLE_WRITE:
+    p1 = read_uint(in);
+    break;
+  case expr::CONST_RATIONAL:
+  case expr::CONST_STRING:
+    s = read_string(in);
+    break;
+  case expr::CONST_BITVECTOR:
+    p1 = read_uint(in);
+    s = read_string(in);
+    break;
+  case expr::TERM_BV_EXTRACT:
+    p1 = read_uint(in);
+    p2 = read_uint(in);
+    break;
+  default:
+    break;
+  }
+
+  // Children
+  d_children.clear();
+  size_t size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    d_children.push_back(read_ref(in));
+  }
+
+  // Make the term
+  switch (op) {
+  case expr::CONST_BOOL:
+    return d_tm.mk_boolean_constant(p1);
+  case expr::CONST_RATIONAL:
+    return d_tm.mk_rational_constant(expr::rational(s));
+  case expr::CONST_BITVECTOR:
+    return d_tm.mk_bitvector_constant(expr::bitvector(p1, expr::integer(s, 16)));
+  case expr::CONST_STRING:
+    return d_tm.mk_string_constant(s);
+  case expr::CONST_ENUM:
+    return d_tm.mk_enum_constant(p1, child(0));
+  case expr::TYPE_BOOL:
+    return d_tm.boolean_type();
+  case expr::TYPE_INTEGER:
+    return d_tm.integer_type();
+  case expr::TYPE_REAL:
+    return d_tm.real_type();
+  case expr::TYPE_BITVECTOR:
+    return d_tm.bitvector_type(p1);
+  case expr::TYPE_ENUM: {
+    std::vector<std::string> values;
+    for (size_t i = 0; i < d_children.size(); ++ i) {
+      values.push_back(d_tm.get_string_constant(d_tm.term_of(d_children[i])));
+    }
+    return d_tm.enum_type(values);
+  }
+  case expr::TERM_BV_EXTRACT:
+    return d_tm.mk_bitvector_extract(child(0), expr::bitvector_extract(p1, p2));
+  case expr::TERM_BV_SGN_EXTEND:
+    return d_tm.mk_bitvector_sgn_extend(child(0), expr::bitvector_sgn_extend(p1));
+  case expr::TERM_TUPLE_READ:
+    return d_tm.mk_tuple_read(child(0), p1);
+  case expr::TERM_TUPLE_WRITE:
+    return d_tm.mk_tuple_write(child(0), p1, child(1));
+  case expr::TYPE_ARRAY:
+    return d_tm.array_type(child(0), child(1));
+  case expr::TYPE_FUNCTION:
+    return d_tm.function_type(d_children);
+  case expr::TYPE_TUPLE:
+    return d_tm.tuple_type(d_children);
+  case expr::TYPE_RECORD:
+    return d_tm.record_type(read_fields());
+  case expr::TERM_ARRAY_READ:
+    return d_tm.mk_array_read(child(0), child(1));
+  case expr::TERM_ARRAY_WRITE:
+    return d_tm.mk_array_write(child(0), child(1), child(2));
+  case expr::TERM_TUPLE_CONSTRUCT:
+    return d_tm.mk_tuple(d_children);
+  case expr::TERM_RECORD_CONSTRUCT:
+    return d_tm.mk_record(read_fields());
+  case expr::TERM_RECORD_READ:
+    return d_tm.mk_record_read(child(0), child(1));
+  case expr::TERM_RECORD_WRITE:
+    return d_tm.mk_record_write(child(0), child(1), child(2));
+  default:
+    return d_tm.mk_term(op, d_children);
+  }
+}
+
+void write_obligation(std::ostream& out, term_table_writer& terms, const induction_obligation& ind) {
+  terms.write_ref(out, ind.F_fwd);
+  terms.write_ref(out, ind.F_cex);
+  write_uint(out, ind.d);
+  write_double(out, ind.score);
+  write_uint(out, ind.refined);
+}
+
+induction_obligation read_obligation(std::istream& in, expr::term_manager& tm, const term_table_reader& terms) {
+  expr::term_ref F_fwd = terms.read_ref(in);
+  expr::term_ref F_cex = terms.read_ref(in);
+  size_t d = read_uint(in);
+  double score = read_double(in);
+  size_t refined = read_uint(in);
+  return induction_obligation(tm, F_fwd, F_cex, d, score, refined);
+}
+
+void write_refs(std::ostream& out, term_table_writer& terms, const std::vector<expr::term_ref>& refs) {
+  write_uint(out, refs.size());
+  for (size_t i = 0; i < refs.size(); ++ i) {
+    terms.write_ref(out, refs[i]);
+  }
+}
+
+void read_refs(std::istream& in, const term_table_reader& terms, std::vector<expr::term_ref>& refs) {
+  size_t size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    refs.push_back(terms.read_ref(in));
+  }
+}
+
+}
+
+void checkpoint::save(const system::state_type* st, std::string filename) const {
+
+  // Write the content first, collecting the terms
+  term_table_writer terms(st);
+  std::ostringstream body;
+
+  write_uint(body, frame_index);
+  write_uint(body, frame_depth);
+  write_uint(body, frame_next_index);
+  write_refs(body, terms, properties);
+
+  assert(frame.size() == frame_pending.size());
+  write_uint(body, frame.size());
+  for (size_t i = 0; i < frame.size(); ++ i) {
+    write_obligation(body, terms, frame[i]);
+    write_uint(body, frame_pending[i]);
+  }
+  write_uint(body, frame_next.size());
+  for (size_t i = 0; i < frame_next.size(); ++ i) {
+    write_obligation(body, terms, frame_next[i]);
+  }
+
+  write_uint(body, reachability_frames.size());
+  for (size_t k = 0; k < reachability_frames.size(); ++ k) {
+    write_refs(body, terms, reachability_frames[k]);
+  }
+
+  assert(cex_edges_from.size() == cex_edges.size());
+  write_uint(body, cex_edges.size());
+  for (size_t i = 0; i < cex_edges.size(); ++ i) {
+    terms.write_ref(body, cex_edges_from[i]);
+    terms.write_ref(body, cex_edges[i].B);
+    write_uint(body, cex_edges[i].edge_length);
+    write_uint(body, cex_edges[i].property_id);
+  }
+  assert(cex_roots.size() == cex_roots_property.size());
+  write_uint(body, cex_roots.size());
+  for (size_t i = 0; i < cex_roots.size(); ++ i) {
+    terms.write_ref(body, cex_roots[i]);
+    write_uint(body, cex_roots_property[i]);
+  }
+
+  write_refs(body, terms, lemmas);
+  write_uint(body, lemmas_depth);
+
+  // Write the file: header, term table, content
+  std::string tmp_filename = filename + ".tmp";
+  std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+  if (!out) {
+    throw exception("pdkind: can't open checkpoint file " + tmp_filename);
+  }
+  write_string(out, checkpoint_magic);
+  write_uint(out, checkpoint_version);
+  write_string(out, state_signature(st));
+  write_uint(out, terms.size());
+  out << terms.table();
+  out << body.str();
+  out.close();
+  if (!out) {
+    throw exception("pdkind: error writing checkpoint file " + tmp_filename);
+  }
+
+  // Replace the old checkpoint
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    throw exception("pdkind: can't rename " + tmp_filename + " to " + filename);
+  }
+}
+
+void checkpoint::load(const system::state_type* st, std::string filename) {
+
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  if (!in) {
+    throw exception("pdkind: can't open checkpoint file " + filename);
+  }
+
+  // Header
+  if (read_string(in) != checkpoint_magic) {
+    throw exception("pdkind: " + filename + " is not a checkpoint file");
+  }
+  if (read_uint(in) != checkpoint_version) {
+    throw exception("pdkind: unsupported checkpoint version in " + filename);
+  }
+  if (read_string(in) != state_signature(st)) {
+    throw exception("pdkind: checkpoint " + filename + " is for a different system");
+  }
+
+  // Terms
+  expr::term_manager& tm = st->tm();
+  term_table_reader terms(st);
+  terms.read(in);
+
+  // Content
+  frame_index = read_uint(in);
+  frame_depth = read_uint(in);
+  frame_next_index = read_uint(in);
+  read_refs(in, terms, properties);
+
+  size_t size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    frame.push_back(read_obligation(in, tm, terms));
+    frame_pending.push_back(read_uint(in));
+  }
+  size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    frame_next.push_back(read_obligation(in, tm, terms));
+  }
+
+  size = read_uint(in);
+  reachability_frames.resize(size);
+  for (size_t k = 0; k < size; ++ k) {
+    read_refs(in, terms, reachability_frames[k]);
+  }
+
+  size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    cex_edges_from.push_back(terms.read_ref(in));
+    expr::term_ref B = terms.read_ref(in);
+    size_t edge_length = read_uint(in);
+    size_t property_id = read_uint(in);
+    cex_edges.push_back(cex_manager::cex_edge(B, edge_length, property_id));
+  }
+  size = read_uint(in);
+  for (size_t i = 0; i < size; ++ i) {
+    cex_roots.push_back(terms.read_ref(in));
+    cex_roots_property.push_back(read_uint(in));
+  }
+
+  read_refs(in, terms, lemmas);
+  lemmas_depth = read_uint(in);
+}
+
+}
+}
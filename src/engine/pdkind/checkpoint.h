@@ -0,0 +1,86 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "induction_obligation.h"
+#include "cex_manager.h"
+
+#include "expr/term.h"
+#include "system/state_type.h"
+
+#include <vector>
+#include <string>
+
+namespace sally {
+namespace pdkind {
+
+/**
+ * A snapshot of the pdkind search, taken between two induction checks, so
+ * that long runs can be resumed. On file all the formulas are stored once, in
+ * a shared term table where each term refers to its children by their index
+ * in the table. State variables are stored by their position in the state
+ * type, so a checkpoint can only be loaded for the same system.
+ */
+struct checkpoint {
+
+  /** The current induction frame */
+  size_t frame_index;
+  /** The current induction depth */
+  size_t frame_depth;
+  /** Where the obligations of the next frame are valid */
+  size_t frame_next_index;
+
+  /** The property components */
+  std::vector<expr::term_ref> properties;
+
+  /** All obligations of the induction frame */
+  std::vector<induction_obligation> frame;
+  /** Whether frame[i] is still waiting in the queue */
+  std::vector<bool> frame_pending;
+  /** Obligations already pushed to the next frame */
+  std::vector<induction_obligation> frame_next;
+
+  /** Content of the reachability frames */
+  std::vector< std::vector<expr::term_ref> > reachability_frames;
+
+  /** Counter-example graph: cex_edges[i] goes out of cex_edges_from[i] */
+  std::vector<expr::term_ref> cex_edges_from;
+  cex_manager::edge_vector cex_edges;
+  /** Counter-example roots with their property ids */
+  std::vector<expr::term_ref> cex_roots;
+  std::vector<size_t> cex_roots_property;
+
+  /** Lemmas received from other engines */
+  std::vector<expr::term_ref> lemmas;
+  /** Largest induction depth of the lemmas */
+  size_t lemmas_depth;
+
+  checkpoint()
+  : frame_index(0), frame_depth(0), frame_next_index(0), lemmas_depth(1) {}
+
+  /** Save to file (through a temporary file, so the old checkpoint stays valid until done) */
+  void save(const system::state_type* st, std::string filename) const;
+
+  /** Load from file, creating the terms in the term manager of the state type */
+  void load(const system::state_type* st, std::string filename);
+
+};
+
+}
+}
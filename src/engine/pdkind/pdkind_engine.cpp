@@ -18,10 +18,12 @@
 
 #include "engine/pdkind/pdkind_engine.h"
 #include "engine/pdkind/solvers.h"
+#include "engine/pdkind/checkpoint.h"
 #include "engine/factory.h"
 
 #include "smt/factory.h"
 #include "utils/trace.h"
+#include "utils/budget.h"
 #include "expr/gc_relocator.h"
 
 #include <stack>
@@ -44,13 +46,19 @@ pdkind_engine::pdkind_engine(const system::context& ctx)
 , d_property(0)
 , d_trace(0)
 , d_invariant(expr::term_ref(), 0)
+, d_solver_pool(ctx, ctx.get_options().get_unsigned("pdkind-solver-pool-size"))
 , d_smt(0)
+, d_workers(0)
+, d_lemmas(0)
+, d_lemmas_received_depth(1)
+, d_shared_lemmas_depth(1)
 , d_reachability(ctx, d_cex_manager)
 , d_induction_frame_index(0)
 , d_induction_frame_depth(0)
 , d_induction_frame_depth_count(0)
 , d_induction_frame_next_index(0)
 , d_property_invalid(false)
+, d_checkpoint_time(0)
 , d_learning_type(LEARN_UNDEFINED)
 {
   d_stats.frame_index = new utils::stat_int("pdkind::frame_index", 0);
@@ -59,6 +67,9 @@ pdkind_engine::pdkind_engine(const system::context& ctx)
   d_stats.frame_pushed = new utils::stat_int("pdkind::frame_pushed", 0);
   d_stats.queue_size = new utils::stat_int("pdkind::queue_size", 0);
   d_stats.max_cex_depth = new utils::stat_int("pdkind::max_cex_depth", 0);
+  d_stats.query_cache_hits = new utils::stat_int("pdkind::query_cache_hits", 0);
+  d_stats.query_cache_misses = new utils::stat_int("pdkind::query_cache_misses", 0);
+  d_stats.lemmas_published = new utils::stat_int("pdkind::lemmas_published", 0);
   ctx.get_statistics().add(new utils::stat_delimiter());
   ctx.get_statistics().add(d_stats.frame_index);
   ctx.get_statistics().add(d_stats.induction_depth);
@@ -66,10 +77,15 @@ pdkind_engine::pdkind_engine(const system::context& ctx)
   ctx.get_statistics().add(d_stats.frame_pushed);
   ctx.get_statistics().add(d_stats.queue_size);
   ctx.get_statistics().add(d_stats.max_cex_depth);
+  ctx.get_statistics().add(d_stats.query_cache_hits);
+  ctx.get_statistics().add(d_stats.query_cache_misses);
+  ctx.get_statistics().add(d_stats.lemmas_published);
 }
 
 pdkind_engine::~pdkind_engine() {
   delete d_smt;
+  delete d_workers;
+  delete d_lemmas;
 }
 
 void pdkind_engine::reset() {
@@ -82,10 +98,19 @@ void pdkind_engine::reset() {
   d_induction_frame_depth = 0;
   d_induction_frame_depth_count = 0;
   d_induction_obligations.clear();
+  d_induction_obligations_handles.clear();
   d_induction_obligations_next.clear();
   d_induction_obligations_count.clear();
   delete d_smt;
   d_smt = 0;
+  delete d_workers;
+  d_workers = 0;
+  delete d_lemmas;
+  d_lemmas = 0;
+  d_lemmas_received.clear();
+  d_lemmas_received_depth = 1;
+  d_lemmas_published.clear();
+  d_lemmas_tried.clear();
   d_properties.clear();
   d_property_invalid = false;
   d_reachability.clear();
@@ -108,12 +133,31 @@ void pdkind_engine::enqueue_induction_obligation(const induction_obligation& ind
   d_stats.queue_size->get_value() = d_induction_obligations.size();
 }
 
-pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligation& ind) {
+void pdkind_engine::push_to_next_frame(const induction_obligation& ind) {
+  d_induction_obligations_next.push_back(ind);
+  d_stats.frame_pushed->get_value() = d_induction_obligations_next.size();
+}
+
+void pdkind_engine::add_to_induction_solver(expr::term_ref f, solvers::induction_assertion_type type) {
+  d_smt->add_to_induction_solver(f, type);
+  if (d_workers) {
+    d_workers->add_to_induction_solver(f, type);
+  }
+}
+
+void pdkind_engine::reset_induction_solver(size_t depth) {
+  d_smt->reset_induction_solver(depth);
+  if (d_workers) {
+    d_workers->reset_induction_solver(depth);
+  }
+}
+
+pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligation& ind, const solvers::query_result* known_fwd_result) {
 
   TRACE("pdkind") << "pdkind: Trying F_fwd at " << d_induction_frame_index << ": " << ind.F_fwd << std::endl;
 
   // Check if F_cex is inductive. If not then, if it can be reached, we can find a counter-example.
-  solvers::query_result fwd_result = d_smt->check_inductive(ind.F_fwd);
+  solvers::query_result fwd_result = known_fwd_result ? *known_fwd_result : d_smt->check_inductive(ind.F_fwd);
 
   // If UNSAT we can push it
   if (fwd_result.result == smt::solver::UNSAT) {
@@ -121,8 +165,7 @@ pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligat
     assert(d_induction_frame.find(ind) != d_induction_frame.end());
     TRACE("pdkind") << "pdkind: pushed " << ind.F_fwd << std::endl;
     // Add it to set of pushed facts
-    d_induction_obligations_next.push_back(ind);
-    d_stats.frame_pushed->get_value() = d_induction_obligations_next.size();
+    push_to_next_frame(ind);
     // We're done
     return INDUCTION_SUCCESS;
   }
@@ -174,8 +217,8 @@ pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligat
     assert(d_induction_frame.find(new_ind) == d_induction_frame.end());
     d_induction_frame.insert(new_ind);
     d_stats.frame_size->get_value() = d_induction_frame.size();
-    d_smt->add_to_induction_solver(F_fwd, solvers::INDUCTION_FIRST);
-    d_smt->add_to_induction_solver(F_fwd, solvers::INDUCTION_INTERMEDIATE);
+    add_to_induction_solver(F_fwd, solvers::INDUCTION_FIRST);
+    add_to_induction_solver(F_fwd, solvers::INDUCTION_INTERMEDIATE);
     enqueue_induction_obligation(new_ind);
 
     // Remember the counter-example
@@ -225,8 +268,7 @@ pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligat
     d_stats.frame_size->get_value() = d_induction_frame.size();
     // No need to assert anything, we already have F_fwd => !F_cex
     // Also, just add to next
-    d_induction_obligations_next.push_back(new_ind);
-    d_stats.frame_pushed->get_value() = d_induction_obligations_next.size();
+    push_to_next_frame(new_ind);
 
     // Current obligation has failed, we know it will become invalid
     return INDUCTION_FAIL;
@@ -234,8 +276,8 @@ pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligat
 
   // Learn something forward that refutes reachability of CTI
   expr::term_ref F_fwd = d_smt->learn_forward(d_induction_frame_index, cti_result.generalization);
-  d_smt->add_to_induction_solver(F_fwd, solvers::INDUCTION_FIRST);
-  d_smt->add_to_induction_solver(F_fwd, solvers::INDUCTION_INTERMEDIATE);
+  add_to_induction_solver(F_fwd, solvers::INDUCTION_FIRST);
+  add_to_induction_solver(F_fwd, solvers::INDUCTION_INTERMEDIATE);
 
   F_fwd = tm().mk_and(ind.F_fwd, F_fwd);
   TRACE("pdkind") << "pdkind: new F_fwd: " << F_fwd << std::endl;
@@ -249,30 +291,131 @@ pdkind_engine::induction_result pdkind_engine::push_obligation(induction_obligat
   return INDUCTION_RETRY;
 }
 
+void pdkind_engine::receive_lemmas() {
+  std::vector<expr::term_ref> received;
+  std::vector<size_t> depths;
+  d_lemmas->receive(received, depths);
+  for (size_t i = 0; i < received.size(); ++ i) {
+    // Lemmas hold in all reachable states
+    TRACE("pdkind") << "pdkind: received lemma " << received[i] << std::endl;
+    add_lemma(received[i], depths[i]);
+  }
+}
+
+void pdkind_engine::add_lemma(expr::term_ref lemma, size_t depth) {
+  d_lemmas_received.push_back(lemma);
+  d_lemmas_received_depth = std::max(d_lemmas_received_depth, depth);
+  add_to_induction_solver(lemma, solvers::INDUCTION_FIRST);
+  add_to_induction_solver(lemma, solvers::INDUCTION_INTERMEDIATE);
+}
+
+void pdkind_engine::publish_lemmas() {
+
+  // Nobody to share with
+  if (ctx().get_lemma_bus() == 0) {
+    return;
+  }
+
+  // Facts are checked relative to the invariants we know of
+  std::vector<expr::term_ref> known(d_lemmas_received);
+  known.insert(known.end(), d_lemmas_published.begin(), d_lemmas_published.end());
+
+  std::vector<induction_obligation>::const_iterator it = d_induction_obligations_next.begin();
+  for (; it != d_induction_obligations_next.end(); ++ it) {
+    expr::term_ref F = it->F_fwd;
+    if (!d_lemmas_tried.insert(F).second) {
+      continue;
+    }
+    if (d_smt->is_invariant(F, known)) {
+      // Inductive relative to the known invariants
+      TRACE("pdkind") << "pdkind: publishing lemma " << F << std::endl;
+      d_lemmas->publish(F, d_lemmas_received_depth);
+      d_lemmas_published.push_back(F);
+      known.push_back(F);
+      d_stats.lemmas_published->get_value() ++;
+    }
+  }
+}
+
 void pdkind_engine::push_current_frame() {
 
+  // Obligations to process one by one
+  std::vector<induction_obligation> to_process;
+
+  // Batch of obligations to check in parallel
+  std::vector<expr::term_ref> batch_formulas;
+  std::vector<solvers::query_result> batch_results;
+  size_t batch_version = 0;
+
   // Search while we have something to do
   while (!d_induction_obligations.empty() && !d_property_invalid) {
 
-    // Pick a formula to try and prove inductive, i.e. that F_k & P & T => P'
-    induction_obligation ind = pop_induction_obligation();
+    // Stop here if we've been interrupted (e.g. in a portfolio) or ran out of budget
+    utils::budget::interruption_point();
+
+    // Save the state if asked to
+    checkpoint_if_due();
+
+    // Use any new lemmas from other engines
+    receive_lemmas();
+
+    to_process.clear();
+    if (d_workers) {
+      // Check a batch of obligations in parallel. The inductive ones are
+      // pushed right away, the others are processed one by one. Facts learned
+      // meanwhile only strengthen the induction solver, so the inductive ones
+      // stay inductive.
+      batch_formulas.clear();
+      while (to_process.size() < d_workers->size() && !d_induction_obligations.empty()) {
+        to_process.push_back(pop_induction_obligation());
+        batch_formulas.push_back(to_process.back().F_fwd);
+      }
+      d_workers->check_inductive(batch_formulas, batch_results);
+      batch_version = d_smt->get_induction_solver_version();
+      size_t kept = 0;
+      for (size_t i = 0; i < to_process.size(); ++ i) {
+        if (batch_results[i].result == smt::solver::UNSAT) {
+          TRACE("pdkind") << "pdkind: pushed " << to_process[i].F_fwd << std::endl;
+          push_to_next_frame(to_process[i]);
+        } else {
+          batch_results[kept] = batch_results[i];
+          to_process[kept ++] = to_process[i];
+        }
+      }
+      to_process.erase(to_process.begin() + kept, to_process.end());
+      batch_results.erase(batch_results.begin() + kept, batch_results.end());
+    } else {
+      // Pick a formula to try and prove inductive, i.e. that F_k & P & T => P'
+      to_process.push_back(pop_induction_obligation());
+    }
+
+    for (size_t i = 0; i < to_process.size() && !d_property_invalid; ++ i) {
 
-    // Push the formula forward if it's inductive at the frame
-    induction_result ind_result = push_obligation(ind);
+      induction_obligation& ind = to_process[i];
 
-    // See what happened
-    switch (ind_result) {
-    case INDUCTION_RETRY:
-      // We'll retry the same formula (it's already added to the solver)
-      enqueue_induction_obligation(ind);
-      break;
-    case INDUCTION_SUCCESS:
-      // Boss, we're done with this one
-      break;
-    case INDUCTION_FAIL:
-      // Failure, we didn't push, either counter-example found, or we couldn't push
-      // and decided not to try again
-      break;
+      // Push the formula forward if it's inductive at the frame. The workers'
+      // counterexample can be reused unless the induction solver has changed
+      // since the batch was checked.
+      const solvers::query_result* fwd_result = 0;
+      if (d_workers && d_smt->get_induction_solver_version() == batch_version) {
+        fwd_result = &batch_results[i];
+      }
+      induction_result ind_result = push_obligation(ind, fwd_result);
+
+      // See what happened
+      switch (ind_result) {
+      case INDUCTION_RETRY:
+        // We'll retry the same formula (it's already added to the solver)
+        enqueue_induction_obligation(ind);
+        break;
+      case INDUCTION_SUCCESS:
+        // Boss, we're done with this one
+        break;
+      case INDUCTION_FAIL:
+        // Failure, we didn't push, either counter-example found, or we couldn't push
+        // and decided not to try again
+        break;
+      }
     }
   }
 }
@@ -282,12 +425,6 @@ engine::result pdkind_engine::search() {
   // Push frame by frame */
   for(;;) {
 
-    // d_induction_cutoff = d_induction_frame_index + d_induction_frame_depth;
-
-    // Set how far we can go
-    // d_induction_frame_next_index = d_induction_frame_index + 1;
-    d_induction_frame_next_index = d_induction_frame_index + d_induction_frame_depth;
-
     MSG(1) << "pdkind: working on induction frame " << d_induction_frame_index << " (" << d_induction_frame.size() << ") with induction depth " << d_induction_frame_depth << std::endl;
 
     // Push the current induction frame forward
@@ -305,10 +442,20 @@ engine::result pdkind_engine::search() {
       std::set<expr::term_ref> invariant;
       induction_frame_type::const_iterator it = d_induction_frame.begin(), end = d_induction_frame.end();
       for (; it != end; ++ it) { invariant.insert(it->F_fwd); }
-      d_invariant = engine::invariant(tm().mk_and(invariant), d_induction_frame_depth);
+      // The invariant relies on the lemmas we used, so it's as deep as the deepest of them
+      size_t depth = std::max(d_induction_frame_depth, d_lemmas_received_depth);
+      // All the frame formulas are now invariants, share them
+      std::set<expr::term_ref>::const_iterator inv_it = invariant.begin();
+      for (; inv_it != invariant.end(); ++ inv_it) { d_lemmas->publish(*inv_it, depth); }
+      invariant.insert(d_lemmas_received.begin(), d_lemmas_received.end());
+      d_invariant = engine::invariant(tm().mk_and(invariant), depth);
       return engine::VALID;
     }
 
+    // Share the pushed facts that are already invariants, so that other
+    // engines don't have to wait for the property to be proven
+    publish_lemmas();
+
     // Set depth of induction for next time
     d_induction_frame_depth ++;
 
@@ -328,7 +475,19 @@ engine::result pdkind_engine::search() {
     if (ctx().get_options().get_unsigned("pdkind-induction-max") != 0 && d_induction_frame_depth > ctx().get_options().get_unsigned("pdkind-induction-max")) {
       d_induction_frame_depth = ctx().get_options().get_unsigned("pdkind-induction-max");
     }
-    d_smt->reset_induction_solver(d_induction_frame_depth);
+    reset_induction_solver(d_induction_frame_depth);
+
+    // d_induction_cutoff = d_induction_frame_index + d_induction_frame_depth;
+
+    // Set how far we can go
+    // d_induction_frame_next_index = d_induction_frame_index + 1;
+    d_induction_frame_next_index = d_induction_frame_index + d_induction_frame_depth;
+
+    // Lemmas from other engines hold in the new frame too
+    for (size_t i = 0; i < d_lemmas_received.size(); ++ i) {
+      add_to_induction_solver(d_lemmas_received[i], solvers::INDUCTION_FIRST);
+      add_to_induction_solver(d_lemmas_received[i], solvers::INDUCTION_INTERMEDIATE);
+    }
 
     if (ctx().get_options().get_bool("pdkind-minimize-frames")) {
       d_smt->minimize_frame(d_induction_obligations_next);
@@ -342,8 +501,8 @@ engine::result pdkind_engine::search() {
       induction_obligation ind = *next_it;
       ind.score = ind.score/2 + 0.5; // Keep old score and add 1 for effort
       assert(d_induction_frame.find(ind) == d_induction_frame.end());
-      d_smt->add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_FIRST);
-      d_smt->add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_INTERMEDIATE);
+      add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_FIRST);
+      add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_INTERMEDIATE);
       d_induction_frame.insert(ind);
       d_stats.frame_size->get_value() = d_induction_frame.size();
       enqueue_induction_obligation(ind);
@@ -357,7 +516,10 @@ engine::result pdkind_engine::search() {
     d_stats.frame_index->get_value() = d_induction_frame_index;
     d_stats.induction_depth->get_value() = d_induction_frame_depth;
 
-    // Do garbage collection
+    // Do garbage collection (of the solvers only, terms are not collected
+    // because the engine, the context and the callers still keep weak
+    // references to terms, e.g. the received lemmas, the properties and the
+    // counter-example graph, that a term_manager::gc() would drop)
     d_smt->gc();
   }
 
@@ -383,24 +545,55 @@ engine::result pdkind_engine::query(const system::transition_system* ts, const s
 
   // Initialize the solvers
   if (d_smt) { delete d_smt; }
-  d_smt = new solvers(ctx(), ts, d_trace);
+  d_smt = new solvers(ctx(), ts, d_trace, &d_solver_pool);
+  d_smt->set_query_cache_stats(d_stats.query_cache_hits, d_stats.query_cache_misses);
+
+  // Initialize the workers
+  size_t workers = ctx().get_options().get_unsigned("pdkind-workers");
+  if (workers > 1) {
+    smt::factory::check_thread_safe(ctx().get_options(), "pdkind-workers");
+    d_workers = new solver_workers(ctx(), ts, workers);
+  }
 
   // Initialize the reachability solver
-  d_reachability.init(d_transition_system, d_smt);
+  if (d_workers && ctx().get_options().get_bool("pdkind-parallel-reachability")) {
+    d_reachability.init(d_transition_system, d_smt, d_workers);
+  } else {
+    d_reachability.init(d_transition_system, d_smt);
+  }
+
+  // Connect to the lemmas of other engines
+  d_lemmas = new system::lemma_bus::client(ctx().get_lemma_bus(), ts->get_state_type());
 
   // Initialize the induction solver
   d_induction_frame_index = 0;
   d_induction_frame_depth = 1;
-  d_smt->reset_induction_solver(1);
+  d_induction_frame_next_index = 1;
+  reset_induction_solver(1);
 
-  // Add the property we're trying to prove (if not already invalid at frame 0)
-  bool ok = add_property(d_property->get_formula());
-  if (!ok) {
+  d_checkpoint_time = std::time(0);
+  if (ctx().get_options().has_option("pdkind-resume")) {
+    // Continue from where we stopped
+    load_checkpoint(ctx().get_options().get_string("pdkind-resume"));
+  } else {
+    // Reuse what we learned for the previous properties
+    for (size_t k = 0; k < d_shared_frames.size(); ++ k) {
+      for (size_t i = 0; i < d_shared_frames[k].size(); ++ i) {
+        d_reachability.add_to_frame(k, d_shared_frames[k][i]);
+      }
+    }
+    for (size_t i = 0; i < d_shared_lemmas.size(); ++ i) {
+      add_lemma(d_shared_lemmas[i], d_shared_lemmas_depth);
+    }
+    // Add the property we're trying to prove (if not already invalid at frame 0)
+    bool ok = add_property(d_property->get_formula());
+    if (!ok) {
 #ifndef NDEBUG
-    // Check trace generation if not asked for explicityly
-    if (!ctx().get_options().has_option("show-trace")) { get_trace(); }  
+      // Check trace generation if not asked for explicityly
+      if (!ctx().get_options().has_option("show-trace")) { get_trace(); }
 #endif
-    return engine::INVALID;
+      return engine::INVALID;
+    }
   }
 
   while (r == UNKNOWN) {
@@ -428,6 +621,158 @@ engine::result pdkind_engine::query(const system::transition_system* ts, const s
   return r;
 }
 
+void pdkind_engine::checkpoint_if_due() {
+  if (!ctx().get_options().has_option("pdkind-checkpoint")) {
+    return;
+  }
+  std::time_t now = std::time(0);
+  if (now - d_checkpoint_time < (std::time_t) ctx().get_options().get_unsigned("pdkind-checkpoint-interval")) {
+    return;
+  }
+  save_checkpoint(ctx().get_options().get_string("pdkind-checkpoint"));
+  d_checkpoint_time = std::time(0);
+}
+
+void pdkind_engine::save_checkpoint(std::string filename) {
+
+  MSG(1) << "pdkind: saving checkpoint to " << filename << std::endl;
+
+  checkpoint cp;
+  cp.frame_index = d_induction_frame_index;
+  cp.frame_depth = d_induction_frame_depth;
+  cp.frame_next_index = d_induction_frame_next_index;
+  cp.properties.insert(cp.properties.end(), d_properties.begin(), d_properties.end());
+
+  // The frame, with the queued obligations as they are in the queue (scores change)
+  induction_frame_type::const_iterator it = d_induction_frame.begin();
+  for (; it != d_induction_frame.end(); ++ it) {
+    std::map<induction_obligation, induction_obligation_queue::handle_type>::const_iterator find = d_induction_obligations_handles.find(*it);
+    if (find != d_induction_obligations_handles.end()) {
+      cp.frame.push_back(*find->second);
+      cp.frame_pending.push_back(true);
+    } else {
+      cp.frame.push_back(*it);
+      cp.frame_pending.push_back(false);
+    }
+  }
+  cp.frame_next = d_induction_obligations_next;
+
+  cp.reachability_frames.resize(d_reachability.size());
+  for (size_t k = 0; k < d_reachability.size(); ++ k) {
+    d_reachability.get_frame_content(k, cp.reachability_frames[k]);
+  }
+
+  d_cex_manager.get_edges(cp.cex_edges_from, cp.cex_edges);
+  d_cex_manager.get_roots(cp.cex_roots, cp.cex_roots_property);
+  cp.lemmas = d_lemmas_received;
+  cp.lemmas_depth = d_lemmas_received_depth;
+
+  cp.save(d_transition_system->get_state_type(), filename);
+}
+
+void pdkind_engine::load_checkpoint(std::string filename) {
+
+  MSG(1) << "pdkind: resuming from checkpoint " << filename << std::endl;
+
+  checkpoint cp;
+  cp.load(d_transition_system->get_state_type(), filename);
+
+  // Should be the same problem
+  std::set<expr::term_ref> properties(cp.properties.begin(), cp.properties.end());
+  std::set<expr::term_ref> expected;
+  expected.insert(d_property->get_formula());
+  if (properties != expected) {
+    throw exception("pdkind: checkpoint " + filename + " is for a different property");
+  }
+  d_properties = properties;
+
+  // Frame position
+  d_induction_frame_index = cp.frame_index;
+  d_induction_frame_depth = cp.frame_depth;
+  d_induction_frame_next_index = cp.frame_next_index;
+  reset_induction_solver(d_induction_frame_depth);
+
+  // Reachability frames (solvers get the formulas as they are added)
+  for (size_t k = 0; k < cp.reachability_frames.size(); ++ k) {
+    for (size_t i = 0; i < cp.reachability_frames[k].size(); ++ i) {
+      d_reachability.add_to_frame(k, cp.reachability_frames[k][i]);
+    }
+  }
+
+  // Counter-example graph
+  for (size_t i = 0; i < cp.cex_edges.size(); ++ i) {
+    const cex_manager::cex_edge& edge = cp.cex_edges[i];
+    d_cex_manager.add_edge(cp.cex_edges_from[i], edge.B, edge.edge_length, edge.property_id);
+  }
+  for (size_t i = 0; i < cp.cex_roots.size(); ++ i) {
+    d_cex_manager.mark_root(cp.cex_roots[i], cp.cex_roots_property[i]);
+  }
+
+  // Lemmas from other engines
+  for (size_t i = 0; i < cp.lemmas.size(); ++ i) {
+    add_lemma(cp.lemmas[i], cp.lemmas_depth);
+  }
+
+  // The induction frame, all the formulas are assumptions
+  for (size_t i = 0; i < cp.frame.size(); ++ i) {
+    const induction_obligation& ind = cp.frame[i];
+    d_induction_frame.insert(ind);
+    add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_FIRST);
+    add_to_induction_solver(ind.F_fwd, solvers::INDUCTION_INTERMEDIATE);
+    if (cp.frame_pending[i]) {
+      enqueue_induction_obligation(ind);
+    }
+  }
+  d_induction_obligations_next = cp.frame_next;
+
+  // Update stats
+  d_stats.frame_index->get_value() = d_induction_frame_index;
+  d_stats.induction_depth->get_value() = d_induction_frame_depth;
+  d_stats.frame_size->get_value() = d_induction_frame.size();
+  d_stats.frame_pushed->get_value() = d_induction_obligations_next.size();
+}
+
+void pdkind_engine::query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results) {
+
+  // A checkpoint holds the search of a single property
+  if (properties.size() > 1) {
+    if (ctx().get_options().has_option("pdkind-checkpoint") || ctx().get_options().has_option("pdkind-resume")) {
+      throw exception("pdkind: checkpoints can only be used with one property at a time (not with multi-property).");
+    }
+  }
+
+  clear_property_results(ts, properties.size());
+  results.clear();
+  d_shared_frames.clear();
+  d_shared_lemmas.clear();
+  d_shared_lemmas_depth = 1;
+
+  for (size_t i = 0; i < properties.size(); ++ i) {
+
+    MSG(1) << "pdkind: checking property " << i << " of " << properties.size() << std::endl;
+
+    result r = query(ts, properties[i]);
+    set_property_result(i, r);
+    results.push_back(r);
+
+    // Reachability frames don't depend on the property, keep them
+    d_shared_frames.resize(d_reachability.size());
+    for (size_t k = 0; k < d_reachability.size(); ++ k) {
+      d_shared_frames[k].clear();
+      d_reachability.get_frame_content(k, d_shared_frames[k]);
+    }
+
+    // Proven properties hold in all reachable states
+    if (r == VALID) {
+      d_shared_lemmas.push_back(d_invariant.F);
+      d_shared_lemmas_depth = std::max(d_shared_lemmas_depth, d_invariant.depth);
+    }
+  }
+
+  d_shared_frames.clear();
+  d_shared_lemmas.clear();
+}
+
 bool pdkind_engine::add_property(expr::term_ref P) {
   // Add to cex manager
   expr::term_ref P_cex = tm().mk_not(P);
@@ -442,7 +787,7 @@ bool pdkind_engine::add_property(expr::term_ref P) {
       assert(d_induction_frame_depth == 1);
       d_induction_frame.insert(ind);
       d_stats.frame_size->get_value() = d_induction_frame.size();
-      d_smt->add_to_induction_solver(P, solvers::INDUCTION_FIRST);
+      add_to_induction_solver(P, solvers::INDUCTION_FIRST);
       enqueue_induction_obligation(ind);
     }
     d_properties.insert(P);
@@ -558,6 +903,13 @@ void pdkind_engine::gc_collect(const expr::gc_relocator& gc_reloc) {
   assert(d_induction_obligations_next.size() == 0);
   d_smt->gc_collect(gc_reloc);
   d_reachability.gc_collect(gc_reloc);
+  gc_reloc.reloc(d_lemmas_received);
+  gc_reloc.reloc(d_lemmas_published);
+  gc_reloc.reloc(d_lemmas_tried);
+  for (size_t k = 0; k < d_shared_frames.size(); ++ k) {
+    gc_reloc.reloc(d_shared_frames[k]);
+  }
+  gc_reloc.reloc(d_shared_lemmas);
 }
 
 engine::invariant pdkind_engine::get_invariant() {
@@ -21,10 +21,12 @@
 #include "solvers.h"
 #include "reachability.h"
 #include "induction_obligation.h"
+#include "solver_workers.h"
 #include "cex_manager.h"
 
 #include "smt/solver.h"
 #include "system/context.h"
+#include "system/lemma_bus.h"
 #include "engine/engine.h"
 #include "expr/term.h"
 #include "expr/term_map.h"
@@ -33,6 +35,7 @@
 #include <boost/heap/fibonacci_heap.hpp>
 #include <boost/unordered_map.hpp>
 #include <map>
+#include <ctime>
 #include <iosfwd>
 
 namespace sally {
@@ -92,9 +95,48 @@ class pdkind_engine : public engine {
   /** The invariant, if we prove it */
   engine::invariant d_invariant;
 
+  /** Solvers kept across resets and queries */
+  solver_pool d_solver_pool;
+
   /** The solvers */
   solvers* d_smt;
 
+  /** Workers for parallel induction and reachability checks (null if sequential) */
+  solver_workers* d_workers;
+
+  /** Connection to the lemmas of other engines */
+  system::lemma_bus::client* d_lemmas;
+
+  /** Lemmas received from other engines (asserted in the induction solver) */
+  std::vector<expr::term_ref> d_lemmas_received;
+
+  /** Largest induction depth of the received lemmas (at least 1) */
+  size_t d_lemmas_received_depth;
+
+  /** Receive new lemmas from other engines and add them to the induction solver */
+  void receive_lemmas();
+
+  /** Add a formula that is an invariant of the given depth to the induction solver */
+  void add_lemma(expr::term_ref lemma, size_t depth);
+
+  /** Invariants we have published to other engines */
+  std::vector<expr::term_ref> d_lemmas_published;
+
+  /** Pushed facts already checked for being invariants on their own */
+  std::set<expr::term_ref> d_lemmas_tried;
+
+  /** Publish the facts pushed to the next frame that are invariants on their own */
+  void publish_lemmas();
+
+  /** Reachability frames learned by the previous properties of query_all() */
+  std::vector< std::vector<expr::term_ref> > d_shared_frames;
+
+  /** Invariants proven by the previous properties of query_all() */
+  std::vector<expr::term_ref> d_shared_lemmas;
+
+  /** Largest induction depth of the shared invariants (at least 1) */
+  size_t d_shared_lemmas_depth;
+
   /** Manager for counter-examples */
   cex_manager d_cex_manager;
 
@@ -109,6 +151,9 @@ class pdkind_engine : public engine {
     utils::stat_int* frame_pushed;
     utils::stat_int* queue_size;
     utils::stat_int* max_cex_depth;
+    utils::stat_int* query_cache_hits;
+    utils::stat_int* query_cache_misses;
+    utils::stat_int* lemmas_published;
   } d_stats;
 
 
@@ -128,8 +173,21 @@ class pdkind_engine : public engine {
     INDUCTION_RETRY
   };
 
-  /** Push the formula forward if its inductive. Returns true if inductive. */
-  induction_result push_obligation(induction_obligation& o);
+  /**
+   * Push the formula forward if its inductive. Returns true if inductive. If
+   * fwd_result is not null, it's the result of the induction check of F_fwd
+   * against the current induction solver.
+   */
+  induction_result push_obligation(induction_obligation& o, const solvers::query_result* fwd_result = 0);
+
+  /** The obligation holds at the next frame */
+  void push_to_next_frame(const induction_obligation& ind);
+
+  /** Add to the induction solver (and to the solvers of the workers) */
+  void add_to_induction_solver(expr::term_ref f, solvers::induction_assertion_type type);
+
+  /** Reset the induction solver (and the solvers of the workers) */
+  void reset_induction_solver(size_t depth);
 
   /** The current frame we are trying to push */
   size_t d_induction_frame_index;
@@ -196,6 +254,18 @@ class pdkind_engine : public engine {
   /** Push the current frame */
   void push_current_frame();
 
+  /** Last time the state was saved to the checkpoint file */
+  std::time_t d_checkpoint_time;
+
+  /** Save the state to the checkpoint file if the interval has passed */
+  void checkpoint_if_due();
+
+  /** Save the state to the file */
+  void save_checkpoint(std::string filename);
+
+  /** Restore the state from the file (solvers must be already initialized) */
+  void load_checkpoint(std::string filename);
+
   /** Search */
   result search();
 
@@ -226,6 +296,9 @@ public:
   /** Query */
   result query(const system::transition_system* ts, const system::state_formula* sf);
 
+  /** Query the properties one by one, reusing the frames and proven properties */
+  void query_all(const system::transition_system* ts, const std::vector<const system::state_formula*>& properties, std::vector<result>& results);
+
   /** Trace */
   const system::trace_helper* get_trace();
 
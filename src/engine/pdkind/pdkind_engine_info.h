@@ -40,6 +40,13 @@ struct pdkind_engine_info {
         ("pdkind-minimize-generalizations", "Try to minimize generalizations")
         ("pdkind-minimize-frames", "Try to minimize frames")
         ("pdkind-output-cex-graph", value<std::string>(), "Print the CEX graph into this file when done.")
+        ("pdkind-workers", value<unsigned>()->default_value(0), "Number of threads checking induction obligations in parallel (0 for sequential).")
+        ("pdkind-no-query-cache", "Don't cache the results of repeated solver queries.")
+        ("pdkind-parallel-reachability", "Check reachability at all frames speculatively in parallel (uses the pdkind workers).")
+        ("pdkind-checkpoint", value<std::string>(), "Periodically save the search state to this file (one property only, not with multi-property).")
+        ("pdkind-checkpoint-interval", value<unsigned>()->default_value(600), "Seconds between two checkpoints.")
+        ("pdkind-resume", value<std::string>(), "Resume the search from this checkpoint file (one property only, not with multi-property).")
+        ("pdkind-solver-pool-size", value<unsigned>()->default_value(16), "Number of idle solvers to keep for reuse, with the transition relation already loaded (0 to always build new ones).")
         ;
   }
 
@@ -15,15 +15,18 @@ reachability::reachability(const system::context& ctx, cex_manager& cm)
 , d_ctx(ctx)
 , d_transition_system(0)
 , d_smt(0)
+, d_workers(0)
 , d_cex_manager(cm)
 {
   d_stats.reachable = new utils::stat_int("sally::pdkind::reachable", 0);
   d_stats.unreachable = new utils::stat_int("sally::pdkind::unreachable", 0);
   d_stats.queries = new utils::stat_int("sally::pdkind::reachability_queries", 0);
+  d_stats.speculative_unreachable = new utils::stat_int("sally::pdkind::speculative_unreachable", 0);
   ctx.get_statistics().add(new utils::stat_delimiter());
   ctx.get_statistics().add(d_stats.reachable);
   ctx.get_statistics().add(d_stats.unreachable);
   ctx.get_statistics().add(d_stats.queries);
+  ctx.get_statistics().add(d_stats.speculative_unreachable);
 }
 
 solvers::query_result reachability::check_one_step_reachable(size_t k, expr::term_ref F) {
@@ -71,7 +74,32 @@ reachability::status reachability::check_reachable(size_t start, size_t end, exp
 
   status result;
 
+  // Speculatively check one-step reachability at all frames in parallel, with
+  // the workers learning the refutations. The frames only get stronger while
+  // we check sequentially below, so if f is not reachable in one step now it
+  // will stay that way, and the refutations stay valid.
+  size_t first = start > 0 ? start : 1;
+  std::vector<expr::term_ref> speculative;
+  if (d_workers && first < end) {
+    ensure_frame(end);
+    std::vector<size_t> frames;
+    for (size_t k = first; k <= end; ++ k) {
+      frames.push_back(k);
+    }
+    d_workers->learn_unreachable(frames, f, speculative);
+    d_stats.queries->get_value() += frames.size();
+  }
+
   for (result.k = start; result.k <= end; ++ result.k) {
+    // Merge the speculative result at k, if any
+    if (result.k >= first && result.k - first < speculative.size() && !speculative[result.k - first].is_null()) {
+      TRACE("pdkind") << "pdkind: checking reachability at " << result.k << ": unreachable (speculative)" << std::endl;
+      add_learnt(result.k, speculative[result.k - first]);
+      d_stats.speculative_unreachable->get_value() ++;
+      d_stats.unreachable->get_value() ++;
+      result.r = UNREACHABLE;
+      continue;
+    }
     // Check reachability at k
     result.r = check_reachable(result.k, f, property_id);
     // Check result of the current one
@@ -143,15 +171,7 @@ reachability::result reachability::check_reachable(size_t k, expr::term_ref f, s
       // Proven, remove from obligations
       reachability_obligations.pop_back();
       // Learn something at k that refutes the formula
-      expr::term_ref learnt = d_smt->learn_forward(reach.frame(), reach.formula());
-      // Add any unreachability learnts
-      if (!frame_contains(reach.frame(), learnt)) {
-        if (d_ctx.get_options().get_bool("pdkind-add-backward")) {
-          add_valid_up_to(reach.frame(), learnt);
-        } else {
-          add_to_frame(reach.frame(), learnt);
-        }
-      } else {
+      if (!learn_unreachable(reach.frame(), reach.formula())) {
         // The only frame where we don't know consistency with formula
         assert(reach.frame() == k && reach.formula() == f);
       }
@@ -175,12 +195,34 @@ reachability::result reachability::check_reachable(size_t k, expr::term_ref f, s
   }
 }
 
+bool reachability::learn_unreachable(size_t k, expr::term_ref F) {
+  // Learn something at k that refutes the formula
+  expr::term_ref learnt = d_smt->learn_forward(k, F);
+  return add_learnt(k, learnt);
+}
+
+bool reachability::add_learnt(size_t k, expr::term_ref learnt) {
+  // Add any unreachability learnts
+  if (frame_contains(k, learnt)) {
+    return false;
+  }
+  if (d_ctx.get_options().get_bool("pdkind-add-backward")) {
+    add_valid_up_to(k, learnt);
+  } else {
+    add_to_frame(k, learnt);
+  }
+  return true;
+}
+
 void reachability::ensure_frame(size_t k) {
   // Upsize the frames if necessary
   while (d_frame_content.size() <= k) {
     // Add the empty frame content
     d_frame_content.push_back(formula_set());
     d_smt->new_reachability_frame();
+    if (d_workers) {
+      d_workers->new_reachability_frame();
+    }
   }
 }
 
@@ -211,24 +253,40 @@ void reachability::add_to_frame(size_t k, expr::term_ref f) {
 
   // Add to solvers
   d_smt->add_to_reachability_solver(k, f);
+  if (d_workers) {
+    d_workers->add_to_reachability_solver(k, f);
+  }
   // Remember
   d_frame_content[k].insert(f);
 }
 
-void reachability::init(const system::transition_system* transition_system, solvers* smt_solvers) {
+size_t reachability::size() const {
+  return d_frame_content.size();
+}
+
+void reachability::get_frame_content(size_t k, std::vector<expr::term_ref>& out) const {
+  assert(k < d_frame_content.size());
+  out.insert(out.end(), d_frame_content[k].begin(), d_frame_content[k].end());
+}
+
+void reachability::init(const system::transition_system* transition_system, solvers* smt_solvers, solver_workers* workers) {
   d_transition_system = transition_system;
   d_smt = smt_solvers;
+  d_workers = workers;
   d_frame_content.clear();
 }
 
 void reachability::clear() {
   d_transition_system = 0;
   d_smt = 0;
+  d_workers = 0;
   d_frame_content.clear();
 }
 
 void reachability::gc_collect(const expr::gc_relocator& gc_reloc) {
-  // TODO
+  for (size_t k = 0; k < d_frame_content.size(); ++ k) {
+    gc_reloc.reloc(d_frame_content[k]);
+  }
 }
 
 }
@@ -12,6 +12,7 @@
 #include "system/context.h"
 #include "system/transition_system.h"
 #include "solvers.h"
+#include "solver_workers.h"
 #include "cex_manager.h"
 
 #include <deque>
@@ -51,6 +52,9 @@ private:
   /** Solvers we're using */
   solvers* d_smt;
 
+  /** Workers for speculative parallel checks (null if sequential) */
+  solver_workers* d_workers;
+
   /** CEX manager */
   cex_manager& d_cex_manager;
 
@@ -61,6 +65,8 @@ private:
     utils::stat_int* reachable;
     /** Number of unreachable reasults */
     utils::stat_int* unreachable;
+    /** Number of frames refuted by speculative parallel checks */
+    utils::stat_int* speculative_unreachable;
 
   } d_stats;
 
@@ -80,6 +86,18 @@ private:
    */
   solvers::query_result check_one_step_reachable(size_t k, expr::term_ref F);
 
+  /**
+   * F is unreachable in one step at frame k, learn a refutation and add it to
+   * the frames. Returns false if frame k already contains the refutation.
+   */
+  bool learn_unreachable(size_t k, expr::term_ref F);
+
+  /**
+   * Add the refutation learned at frame k to the frames. Returns false if
+   * frame k already contains it.
+   */
+  bool add_learnt(size_t k, expr::term_ref learnt);
+
   /**
    * Check if f is reachable at k, assuming f is unreachable in < k steps.
    */
@@ -90,8 +108,12 @@ public:
   /** Construct the reachability checker */
   reachability(const system::context& ctx, cex_manager& cm);
 
-  /** Initialize the reachability engine */
-  void init(const system::transition_system* transition_system, solvers* smt_solvers);
+  /**
+   * Initialize the reachability engine. If workers are given, the frames are
+   * mirrored to the workers and check_reachable() first checks all the frames
+   * speculatively in parallel.
+   */
+  void init(const system::transition_system* transition_system, solvers* smt_solvers, solver_workers* workers = 0);
 
   /** Clear all internal data */
   void clear();
@@ -101,6 +123,12 @@ public:
    */
   void add_to_frame(size_t k, expr::term_ref F);
 
+  /** Number of frames */
+  size_t size() const;
+
+  /** Get the content of frame k */
+  void get_frame_content(size_t k, std::vector<expr::term_ref>& out) const;
+
   /**
    * Add to frames 1..k.
    */
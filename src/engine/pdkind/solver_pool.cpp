@@ -0,0 +1,179 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/pdkind/solver_pool.h"
+
+#include "smt/factory.h"
+#include "utils/trace.h"
+
+#include <cassert>
+
+namespace sally {
+namespace pdkind {
+
+solver_pool::solver_pool(const system::context& ctx, size_t max_idle)
+: d_ctx(ctx)
+, d_transition_system(0)
+, d_trace(0)
+, d_max_idle(max_idle)
+{
+}
+
+solver_pool::~solver_pool() {
+  assert(d_in_use.empty());
+  clear_idle();
+}
+
+void solver_pool::clear_idle() {
+  std::list<std::pair<base_key, smt::solver*> >::iterator it = d_idle.begin();
+  for (; it != d_idle.end(); ++ it) {
+    delete it->second;
+  }
+  d_idle.clear();
+}
+
+void solver_pool::set_system(const system::transition_system* transition_system, system::trace_helper* trace) {
+  assert(d_in_use.empty());
+  if (d_transition_system != transition_system || d_trace != trace) {
+    clear_idle();
+    d_transition_system = transition_system;
+    d_trace = trace;
+  }
+}
+
+smt::solver* solver_pool::mk_solver(solver_type type, size_t depth) {
+
+  assert(d_transition_system != 0);
+
+  const system::state_type* state_type = d_transition_system->get_state_type();
+  const std::vector<expr::term_ref>& x = state_type->get_variables(system::state_type::STATE_CURRENT);
+  const std::vector<expr::term_ref>& x_next = state_type->get_variables(system::state_type::STATE_NEXT);
+  const std::vector<expr::term_ref>& input = state_type->get_variables(system::state_type::STATE_INPUT);
+
+  smt::solver* solver = smt::factory::mk_default_solver(d_ctx.tm(), d_ctx.get_options(), d_ctx.get_statistics());
+
+  switch (type) {
+  case REACHABILITY:
+  case REACHABILITY_INITIAL:
+    solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
+    solver->add_variables(x_next.begin(), x_next.end(), smt::solver::CLASS_B);
+    solver->add_variables(input.begin(), input.end(), smt::solver::CLASS_T);
+    solver->add(d_transition_system->get_transition_relation(), smt::solver::CLASS_T);
+    if (type == REACHABILITY_INITIAL) {
+      solver->add(d_transition_system->get_initial_states(), smt::solver::CLASS_A);
+    }
+    break;
+  case INITIAL:
+    solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
+    solver->add(d_transition_system->get_initial_states(), smt::solver::CLASS_A);
+    break;
+  case MINIMIZATION:
+    solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
+    break;
+  case INDUCTION: {
+    expr::term_ref transition_relation = d_transition_system->get_transition_relation();
+    for (size_t k = 0; k <= depth; ++ k) {
+      if (k == 0) {
+        // First frame is A
+        solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
+      } else {
+        // Intermediate frames are T, last frame is B
+        const std::vector<expr::term_ref>& x_k = d_trace->get_state_variables(k);
+        solver->add_variables(x_k.begin(), x_k.end(), k < depth ? smt::solver::CLASS_T : smt::solver::CLASS_B);
+        // Input variables
+        const std::vector<expr::term_ref>& input_k = d_trace->get_input_variables(k-1);
+        solver->add_variables(input_k.begin(), input_k.end(), smt::solver::CLASS_T);
+        // Formula T(x_{k-1}, x_k), from state variables if transitioning from initial state
+        expr::term_ref T = d_trace->get_transition_formula(transition_relation, k-1);
+        if (k == 1) {
+          T = d_trace->get_state_formula(0, T);
+        }
+        solver->add(T, smt::solver::CLASS_T);
+      }
+    }
+    break;
+  }
+  default:
+    assert(false);
+  }
+
+  return solver;
+}
+
+smt::solver* solver_pool::acquire(solver_type type, size_t depth) {
+
+  base_key key(type, type == INDUCTION ? depth : 0);
+
+  // Reuse an idle one if any, otherwise make a new one
+  smt::solver* solver = 0;
+  std::list<std::pair<base_key, smt::solver*> >::iterator it = d_idle.begin();
+  for (; it != d_idle.end(); ++ it) {
+    if (it->first == key) {
+      solver = it->second;
+      d_idle.erase(it);
+      TRACE("pdkind::pool") << "pdkind: reusing solver " << type << "@" << depth << std::endl;
+      break;
+    }
+  }
+  if (solver == 0) {
+    solver = mk_solver(type, depth);
+  }
+
+  // Everything else goes into a scope
+  solver->push();
+  d_in_use[solver] = key;
+
+  return solver;
+}
+
+void solver_pool::release(smt::solver* solver) {
+
+  if (solver == 0) {
+    return;
+  }
+
+  std::map<smt::solver*, base_key>::iterator find = d_in_use.find(solver);
+  assert(find != d_in_use.end());
+  base_key key = find->second;
+  d_in_use.erase(find);
+
+  if (d_max_idle == 0) {
+    delete solver;
+    return;
+  }
+
+  // Back to the base context
+  solver->pop();
+  d_idle.push_back(std::make_pair(key, solver));
+
+  // Keep the most recent ones
+  while (d_idle.size() > d_max_idle) {
+    delete d_idle.front().second;
+    d_idle.pop_front();
+  }
+}
+
+void solver_pool::gc() {
+  std::list<std::pair<base_key, smt::solver*> >::iterator it = d_idle.begin();
+  for (; it != d_idle.end(); ++ it) {
+    it->second->gc();
+  }
+}
+
+}
+}
@@ -0,0 +1,108 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "smt/solver.h"
+#include "system/context.h"
+#include "system/transition_system.h"
+#include "system/trace_helper.h"
+
+#include <map>
+#include <list>
+
+namespace sally {
+namespace pdkind {
+
+/**
+ * Pool of solvers with a pre-loaded base context (the variables and the
+ * transition relation). A solver is handed out with a scope pushed on top of
+ * its base context, and when released it is popped back to the base and kept
+ * for the next request of the same kind. This way the base context is
+ * converted and internalized once instead of on every reset.
+ */
+class solver_pool {
+
+public:
+
+  /** The kinds of base contexts */
+  enum solver_type {
+    /** Transition relation, for reachability at frames > 0 */
+    REACHABILITY,
+    /** Transition relation and initial states, for reachability at frame 0 */
+    REACHABILITY_INITIAL,
+    /** Initial states */
+    INITIAL,
+    /** Only the state variables */
+    MINIMIZATION,
+    /** Transition relation unrolled to the given depth */
+    INDUCTION
+  };
+
+private:
+
+  /** Kind and depth of a base context */
+  typedef std::pair<solver_type, size_t> base_key;
+
+  /** Context */
+  const system::context& d_ctx;
+
+  /** Transition system of the base contexts */
+  const system::transition_system* d_transition_system;
+
+  /** The trace for the unrolling */
+  system::trace_helper* d_trace;
+
+  /** Maximal number of idle solvers to keep */
+  size_t d_max_idle;
+
+  /** Solvers handed out */
+  std::map<smt::solver*, base_key> d_in_use;
+
+  /** Idle solvers at their base context, oldest first */
+  std::list<std::pair<base_key, smt::solver*> > d_idle;
+
+  /** Make a new solver with the base context */
+  smt::solver* mk_solver(solver_type type, size_t depth);
+
+  /** Delete all idle solvers */
+  void clear_idle();
+
+public:
+
+  /** Create a pool keeping at most max_idle idle solvers */
+  solver_pool(const system::context& ctx, size_t max_idle);
+
+  /** Deletes all the solvers */
+  ~solver_pool();
+
+  /** Set the system, dropping the idle solvers if it changed */
+  void set_system(const system::transition_system* transition_system, system::trace_helper* trace);
+
+  /** Get a solver with the base context and a fresh scope (depth only for induction) */
+  smt::solver* acquire(solver_type type, size_t depth = 0);
+
+  /** Give the solver back to the pool (null is ignored) */
+  void release(smt::solver* solver);
+
+  /** Collect garbage in the idle solvers */
+  void gc();
+};
+
+}
+}
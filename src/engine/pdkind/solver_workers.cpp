@@ -0,0 +1,283 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/pdkind/solver_workers.h"
+
+#include "system/system_copy.h"
+#include "utils/exception.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <cassert>
+
+namespace sally {
+namespace pdkind {
+
+struct solver_workers::worker {
+
+  /** Kinds of queries a worker can run */
+  enum task {
+    /** Check if the formulas are inductive */
+    CHECK_INDUCTIVE,
+    /** Check if the formula is unreachable in one step at the frames, and learn a refutation */
+    LEARN_UNREACHABLE
+  };
+
+  /** Private copy of the system */
+  system::system_copy copy;
+
+  /** Solvers on the copy */
+  solvers* smt;
+
+  /** The current task */
+  task current;
+
+  /** Formulas to check (in the private term manager) */
+  std::vector<expr::term_ref> formulas;
+
+  /** Frames to check at (for reachability queries) */
+  std::vector<size_t> frames;
+
+  /** Learned refutations, null if reachable (for reachability queries) */
+  std::vector<expr::term_ref> lemmas;
+
+  /** Results of the checks */
+  std::vector<smt::solver::result> results;
+
+  /** Full results of the induction checks (model and generalization if SAT) */
+  std::vector<solvers::query_result> inductive_results;
+
+  /** Error message if the checks failed */
+  std::string error;
+
+  /** Were the checks interrupted */
+  bool interrupted;
+
+  worker(const system::context& ctx, const system::transition_system* ts)
+  : copy(ctx, ts, 0)
+  , smt(0)
+  , current(CHECK_INDUCTIVE)
+  , interrupted(false)
+  {
+    const system::transition_system* copy_ts = copy.get_transition_system();
+    smt = new solvers(copy.ctx(), copy_ts, copy_ts->get_trace_helper());
+  }
+
+  ~worker() {
+    delete smt;
+  }
+
+  /** Clear the task data */
+  void clear(task t) {
+    current = t;
+    formulas.clear();
+    frames.clear();
+    lemmas.clear();
+    results.clear();
+    inductive_results.clear();
+    error.clear();
+    interrupted = false;
+  }
+
+  /** Run all the queries */
+  void run();
+};
+
+void solver_workers::worker::run() {
+  try {
+    for (size_t i = 0; i < formulas.size(); ++ i) {
+      switch (current) {
+      case CHECK_INDUCTIVE:
+        inductive_results.push_back(smt->check_inductive(formulas[i]));
+        results.push_back(inductive_results.back().result);
+        break;
+      case LEARN_UNREACHABLE: {
+        const system::state_type* state_type = copy.get_transition_system()->get_state_type();
+        expr::term_ref f_next = state_type->change_formula_vars(system::state_type::STATE_CURRENT, system::state_type::STATE_NEXT, formulas[i]);
+        results.push_back(smt->check_with_transition_at(frames[i] - 1, f_next, smt::solver::CLASS_B));
+        if (results.back() == smt::solver::UNSAT) {
+          lemmas.push_back(smt->learn_forward(frames[i], formulas[i]));
+        } else {
+          lemmas.push_back(expr::term_ref());
+        }
+        break;
+      }
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    interrupted = true;
+  } catch (const sally::exception& e) {
+    error = e.get_message();
+  } catch (...) {
+    error = "unknown error";
+  }
+}
+
+solver_workers::solver_workers(const system::context& ctx, const system::transition_system* ts, size_t n)
+: d_tm(ctx.tm())
+, d_trace(ts->get_trace_helper())
+, d_induction_depth(0)
+{
+  for (size_t i = 0; i < n; ++ i) {
+    d_workers.push_back(new worker(ctx, ts));
+  }
+}
+
+solver_workers::~solver_workers() {
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    delete d_workers[i];
+  }
+}
+
+void solver_workers::reset_induction_solver(size_t depth) {
+  d_induction_depth = depth;
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    d_workers[i]->smt->reset_induction_solver(depth);
+  }
+}
+
+void solver_workers::add_to_induction_solver(expr::term_ref f, solvers::induction_assertion_type type) {
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    worker* w = d_workers[i];
+    w->smt->add_to_induction_solver(w->copy.from_main(f), type);
+  }
+}
+
+void solver_workers::new_reachability_frame() {
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    d_workers[i]->smt->new_reachability_frame();
+  }
+}
+
+void solver_workers::add_to_reachability_solver(size_t k, expr::term_ref f) {
+  // Only the owner of the frame needs it
+  worker* w = d_workers[frame_owner(k)];
+  w->smt->add_to_reachability_solver(k, w->copy.from_main(f));
+}
+
+void solver_workers::run_workers() {
+
+  // Run the workers, and wait for all of them (the workers reference our
+  // data so we can't be interrupted while they run)
+  {
+    boost::this_thread::disable_interruption no_interrupt;
+    std::vector<boost::thread*> threads;
+    for (size_t i = 0; i < d_workers.size(); ++ i) {
+      if (d_workers[i]->formulas.size() > 0) {
+        threads.push_back(new boost::thread(&worker::run, d_workers[i]));
+      }
+    }
+    for (size_t i = 0; i < threads.size(); ++ i) {
+      // If we're asked to stop, stop the checks of the workers
+      while (!threads[i]->timed_join(boost::posix_time::milliseconds(10))) {
+        if (boost::this_thread::interruption_requested()) {
+          for (size_t j = 0; j < d_workers.size(); ++ j) {
+            smt::solver::interrupt_all(&d_workers[j]->copy.ctx().tm());
+          }
+        }
+      }
+      delete threads[i];
+    }
+  }
+
+  // Report any errors
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    if (d_workers[i]->error.size() > 0) {
+      throw exception(d_workers[i]->error);
+    }
+  }
+
+  // Stop if interrupted
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    if (d_workers[i]->interrupted) {
+      throw boost::thread_interrupted();
+    }
+  }
+}
+
+expr::model::ref solver_workers::induction_model_to_main(worker* w, expr::model::ref copy_model) const {
+  // The induction model is over the trace variables up to the induction depth
+  system::trace_helper* copy_trace = w->copy.get_transition_system()->get_trace_helper();
+  expr::model::ref model = new expr::model(d_tm, true);
+  for (size_t k = 0; k <= d_induction_depth; ++ k) {
+    system::system_copy::copy_values(copy_trace->get_state_variables(k), copy_model, d_trace->get_state_variables(k), model);
+    if (k < d_induction_depth) {
+      system::system_copy::copy_values(copy_trace->get_input_variables(k), copy_model, d_trace->get_input_variables(k), model);
+    }
+  }
+  return model;
+}
+
+void solver_workers::check_inductive(const std::vector<expr::term_ref>& f, std::vector<solvers::query_result>& out) {
+
+  // Distribute the formulas (translation happens here, in the main thread)
+  size_t n = d_workers.size();
+  for (size_t i = 0; i < n; ++ i) {
+    d_workers[i]->clear(worker::CHECK_INDUCTIVE);
+  }
+  for (size_t i = 0; i < f.size(); ++ i) {
+    worker* w = d_workers[i % n];
+    w->formulas.push_back(w->copy.from_main(f[i]));
+  }
+
+  run_workers();
+
+  // Collect the results
+  // Collect the results, with the models and generalizations translated back
+  out.clear();
+  for (size_t i = 0; i < f.size(); ++ i) {
+    worker* w = d_workers[i % n];
+    const solvers::query_result& r = w->inductive_results[i / n];
+    out.push_back(solvers::query_result());
+    out.back().result = r.result;
+    if (r.result == smt::solver::SAT) {
+      out.back().model = induction_model_to_main(w, r.model);
+      out.back().generalization = w->copy.to_main(r.generalization);
+    }
+  }
+}
+
+void solver_workers::learn_unreachable(const std::vector<size_t>& frames, expr::term_ref f, std::vector<expr::term_ref>& out) {
+
+  // Each frame is checked by the owner of the frame below it
+  size_t n = d_workers.size();
+  for (size_t i = 0; i < n; ++ i) {
+    d_workers[i]->clear(worker::LEARN_UNREACHABLE);
+  }
+  std::vector<size_t> position;
+  for (size_t i = 0; i < frames.size(); ++ i) {
+    assert(frames[i] > 0);
+    worker* w = d_workers[frame_owner(frames[i] - 1)];
+    position.push_back(w->formulas.size());
+    w->formulas.push_back(w->copy.from_main(f));
+    w->frames.push_back(frames[i]);
+  }
+
+  run_workers();
+
+  // Collect the lemmas, translated back
+  out.clear();
+  for (size_t i = 0; i < frames.size(); ++ i) {
+    worker* w = d_workers[frame_owner(frames[i] - 1)];
+    expr::term_ref lemma = w->lemmas[position[i]];
+    out.push_back(lemma.is_null() ? lemma : w->copy.to_main(lemma));
+  }
+}
+
+}
+}
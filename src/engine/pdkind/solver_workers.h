@@ -0,0 +1,110 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "solvers.h"
+
+#include "system/context.h"
+#include "system/transition_system.h"
+#include "expr/term.h"
+
+#include <vector>
+
+namespace sally {
+namespace pdkind {
+
+/**
+ * Workers for checking several queries in parallel. Each worker has a private
+ * copy of the system, with its own term manager and its own solvers. All
+ * formulas added to the main induction and reachability solvers should also
+ * be sent to the workers: the induction solvers of the workers are clones of
+ * the main one, while each reachability frame is kept only by the worker that
+ * owns it.
+ *
+ * All methods should be called from the main thread, the workers only run
+ * during check_inductive() and learn_unreachable().
+ */
+class solver_workers {
+
+  /** A worker with the copy of the system */
+  struct worker;
+
+  /** The workers */
+  std::vector<worker*> d_workers;
+
+  /** The main term manager */
+  expr::term_manager& d_tm;
+
+  /** The main trace */
+  system::trace_helper* d_trace;
+
+  /** Depth of the induction solvers */
+  size_t d_induction_depth;
+
+  /** Translate an induction model of the worker to the main trace */
+  expr::model::ref induction_model_to_main(worker* w, expr::model::ref copy_model) const;
+
+  /** The worker that keeps the reachability frame k */
+  size_t frame_owner(size_t k) const { return k % d_workers.size(); }
+
+  /** Run the workers that have something to do and wait for them to finish */
+  void run_workers();
+
+public:
+
+  /** Create n workers for the given system */
+  solver_workers(const system::context& ctx, const system::transition_system* ts, size_t n);
+
+  /** Delete the workers */
+  ~solver_workers();
+
+  /** Number of workers */
+  size_t size() const { return d_workers.size(); }
+
+  /** Reset the induction solvers of all workers to the given depth */
+  void reset_induction_solver(size_t depth);
+
+  /** Add the formula to the induction solvers of all workers */
+  void add_to_induction_solver(expr::term_ref f, solvers::induction_assertion_type type);
+
+  /**
+   * Check which of the formulas are inductive, in parallel. The result for
+   * formula f[i] is stored in out[i], as check_inductive() of the main
+   * solvers would return it (with the model and generalization if not
+   * inductive).
+   */
+  void check_inductive(const std::vector<expr::term_ref>& f, std::vector<solvers::query_result>& out);
+
+  /** Add a new reachability frame to all workers */
+  void new_reachability_frame();
+
+  /** Add the formula to the reachability frame k of the worker that owns it */
+  void add_to_reachability_solver(size_t k, expr::term_ref f);
+
+  /**
+   * Check, in parallel, if f is unreachable in one step at each of the frames
+   * (all > 0), and learn a refutation if so. The refutation at frames[i] is
+   * stored in out[i], or null if f is reachable in one step from frame
+   * frames[i] - 1.
+   */
+  void learn_unreachable(const std::vector<size_t>& frames, expr::term_ref f, std::vector<expr::term_ref>& out);
+};
+
+}
+}
@@ -18,7 +18,6 @@
 
 #include "engine/pdkind/solvers.h"
 
-#include "smt/factory.h"
 #include "utils/trace.h"
 
 #include <iostream>
@@ -29,30 +28,43 @@
 namespace sally {
 namespace pdkind {
 
-solvers::solvers(const system::context& ctx, const system::transition_system* transition_system, system::trace_helper* trace)
+solvers::solvers(const system::context& ctx, const system::transition_system* transition_system, system::trace_helper* trace, solver_pool* pool)
 : d_ctx(ctx)
 , d_tm(ctx.tm())
 , d_transition_system(transition_system)
 , d_size(0)
 , d_trace(trace)
+, d_pool(pool)
+, d_own_pool(pool == 0)
 , d_reachability_solver(0)
 , d_initial_solver(0)
 , d_induction_solver(0)
 , d_induction_generalizer(0)
 , d_minimization_solver(0)
 , d_induction_solver_depth(0)
+, d_induction_solver_version(0)
 , d_generate_models_for_queries(false)
+, d_use_query_cache(!ctx.get_options().get_bool("pdkind-no-query-cache"))
+, d_cache_hits(0)
+, d_cache_misses(0)
 {
+  if (d_own_pool) {
+    d_pool = new solver_pool(ctx, ctx.get_options().get_unsigned("pdkind-solver-pool-size"));
+  }
+  d_pool->set_system(transition_system, trace);
 }
 
 solvers::~solvers() {
-  delete d_reachability_solver;
-  delete d_initial_solver;
-  delete d_induction_solver;
-  delete d_induction_generalizer;
-  delete d_minimization_solver;
+  d_pool->release(d_reachability_solver);
+  d_pool->release(d_initial_solver);
+  d_pool->release(d_induction_solver);
+  d_pool->release(d_induction_generalizer);
+  d_pool->release(d_minimization_solver);
   for (size_t k = 0; k < d_reachability_solvers.size(); ++ k) {
-    delete d_reachability_solvers[k];
+    d_pool->release(d_reachability_solvers[k]);
+  }
+  if (d_own_pool) {
+    delete d_pool;
   }
 }
 
@@ -62,33 +74,36 @@ void solvers::reset(const std::vector<solvers::formula_set>& frames) {
 
   if (d_ctx.get_options().get_bool("pdkind-single-solver")) {
     // Restart the reachability solver
-    delete d_reachability_solver;
+    d_pool->release(d_reachability_solver);
     d_reachability_solver = 0;
   } else {
     // Restart the solver
     assert(d_size == d_reachability_solvers.size());
     assert(d_size == frames.size());
     for (size_t k = 0; k < d_size; ++ k) {
-      delete d_reachability_solvers[k];
+      d_pool->release(d_reachability_solvers[k]);
       d_reachability_solvers[k] = 0;
     }
     d_reachability_solvers.clear();
   }
 
   // Clear the initial solver
-  delete d_initial_solver;
+  d_pool->release(d_initial_solver);
   d_initial_solver = 0;
 
   // Clear the induction solver
-  delete d_induction_solver;
+  d_pool->release(d_induction_solver);
   d_induction_solver = 0;
-  delete d_induction_generalizer;
+  d_pool->release(d_induction_generalizer);
   d_induction_generalizer = 0;
 
   // Reset the minimization solver
-  delete d_minimization_solver;
+  d_pool->release(d_minimization_solver);
   d_minimization_solver = 0;
 
+  // Clear the cached results
+  cache_clear();
+
   assert(d_size == frames.size());
 
   // Add the frame content
@@ -106,37 +121,16 @@ void solvers::init_reachability_solver(size_t k) {
   assert(!d_ctx.get_options().get_bool("pdkind-single-solver"));
   assert(k < d_size);
 
-  if (d_reachability_solvers.size() <= k) {
-
-    // The variables from the state types
-    const std::vector<expr::term_ref>& x = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_CURRENT);
-    const std::vector<expr::term_ref>& x_next = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_NEXT);
-    const std::vector<expr::term_ref>& input = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_INPUT);
-
-    // A solver per frame
-    while (d_reachability_solvers.size() <= k) {
-      smt::solver* solver = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
-      d_reachability_solvers.push_back(solver);
-      solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
-      solver->add_variables(x_next.begin(), x_next.end(), smt::solver::CLASS_B);
-      solver->add_variables(input.begin(), input.end(), smt::solver::CLASS_T);
-      // Add transition relation
-      solver->add(d_transition_system->get_transition_relation(), smt::solver::CLASS_T);
-      if (d_reachability_solvers.size() == 1) {
-        solver->add(d_transition_system->get_initial_states(), smt::solver::CLASS_A);
-      }
-    }
+  // A solver per frame, the first one also with the initial states
+  while (d_reachability_solvers.size() <= k) {
+    bool initial = d_reachability_solvers.empty();
+    d_reachability_solvers.push_back(d_pool->acquire(initial ? solver_pool::REACHABILITY_INITIAL : solver_pool::REACHABILITY));
   }
 }
 
 smt::solver* solvers::get_initial_solver() {
   if (d_initial_solver == 0) {
-    // The variables from the state types
-    const std::vector<expr::term_ref>& x = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_CURRENT);
-    // Make the solver
-    d_initial_solver = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
-    d_initial_solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
-    d_initial_solver->add(d_transition_system->get_initial_states(), smt::solver::CLASS_A);
+    d_initial_solver = d_pool->acquire(solver_pool::INITIAL);
   }
   return d_initial_solver;
 }
@@ -145,16 +139,7 @@ smt::solver* solvers::get_initial_solver() {
 smt::solver* solvers::get_reachability_solver() {
   assert(d_ctx.get_options().get_bool("pdkind-single-solver"));
   if (d_reachability_solver == 0) {
-    // The variables from the state types
-    const std::vector<expr::term_ref>& x = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_CURRENT);
-    const std::vector<expr::term_ref>& x_next = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_NEXT);
-    const std::vector<expr::term_ref>& input = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_INPUT);
-    // Make the solver
-    d_reachability_solver = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
-    d_reachability_solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
-    d_reachability_solver->add_variables(x_next.begin(), x_next.end(), smt::solver::CLASS_B);
-    d_reachability_solver->add_variables(input.begin(), input.end(), smt::solver::CLASS_T);
-    d_reachability_solver->add(d_transition_system->get_transition_relation(), smt::solver::CLASS_T);
+    d_reachability_solver = d_pool->acquire(solver_pool::REACHABILITY);
   }
   return d_reachability_solver;
 }
@@ -167,10 +152,7 @@ smt::solver* solvers::get_reachability_solver(size_t k) {
 
 smt::solver* solvers::get_minimization_solver() {
   if (d_minimization_solver == 0) {
-    // Make the solver
-    const std::vector<expr::term_ref>& x = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_CURRENT);
-    d_minimization_solver = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
-    d_minimization_solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_A);
+    d_minimization_solver = d_pool->acquire(solver_pool::MINIMIZATION);
   }
   return d_minimization_solver;
 }
@@ -193,6 +175,7 @@ void solvers::gc() {
   if (d_reachability_solver) {
     d_reachability_solver->gc();
   }
+  d_pool->gc();
 }
 
 solvers::query_result::query_result()
@@ -202,14 +185,76 @@ solvers::query_result::query_result()
 }
 
 smt::solver::result solvers::query_at_init(expr::term_ref f) {
-  smt::solver* solver = get_initial_solver();
-  smt::solver_scope scope(solver);
-  scope.push();
 
+  query_key key(f, smt::solver::CLASS_A);
   query_result result;
+  if (cache_lookup(d_initial_cache, key, result)) {
+    return result.result;
+  }
 
+  smt::solver* solver = get_initial_solver();
+  std::vector<expr::term_ref> assumptions(1, f);
+  result.result = solver->check(assumptions, smt::solver::CLASS_A);
+
+  cache_store(d_initial_cache, key, result);
+  return result.result;
+}
+
+bool solvers::is_invariant(expr::term_ref f, const std::vector<expr::term_ref>& invariants) {
+
+  // Holds initially
+  if (query_at_init(d_tm.mk_term(expr::TERM_NOT, f)) != smt::solver::UNSAT) {
+    return false;
+  }
+
+  // Inductive: invariants & f & T & !f' is unsat (first frame is over the state variables)
+  smt::solver* solver = d_pool->acquire(solver_pool::INDUCTION, 1);
+  for (size_t i = 0; i < invariants.size(); ++ i) {
+    solver->add(invariants[i], smt::solver::CLASS_A);
+  }
   solver->add(f, smt::solver::CLASS_A);
-  return solver->check();
+  solver->add(d_trace->get_state_formula(d_tm.mk_term(expr::TERM_NOT, f), 1), smt::solver::CLASS_B);
+  smt::solver::result result = solver->check();
+  d_pool->release(solver);
+
+  return result == smt::solver::UNSAT;
+}
+
+bool solvers::cache_lookup(const query_cache& cache, const query_key& key, query_result& result) const {
+  if (!d_use_query_cache) {
+    return false;
+  }
+  query_cache::const_iterator find = cache.find(key);
+  if (find == cache.end()) {
+    if (d_cache_misses) { d_cache_misses->get_value() ++; }
+    return false;
+  }
+  if (find->second.result == smt::solver::SAT && d_generate_models_for_queries && !find->second.model) {
+    // Cached without the model, but we need it now
+    if (d_cache_misses) { d_cache_misses->get_value() ++; }
+    return false;
+  }
+  if (d_cache_hits) { d_cache_hits->get_value() ++; }
+  result = find->second;
+  return true;
+}
+
+void solvers::cache_store(query_cache& cache, const query_key& key, const query_result& result) {
+  if (d_use_query_cache) {
+    cache[key] = result;
+  }
+}
+
+void solvers::cache_clear() {
+  d_reachability_cache.clear();
+  d_initial_cache.clear();
+  d_induction_cache.clear();
+  d_induction_evaluators.clear();
+}
+
+void solvers::set_query_cache_stats(utils::stat_int* hits, utils::stat_int* misses) {
+  d_cache_hits = hits;
+  d_cache_misses = misses;
 }
 
 solvers::query_result solvers::query_with_transition_at(size_t k, expr::term_ref f, smt::solver::formula_class f_class) {
@@ -217,6 +262,15 @@ solvers::query_result solvers::query_with_transition_at(size_t k, expr::term_ref
   smt::solver* solver = 0;
   query_result result;
 
+  // Check the cache first
+  if (d_reachability_cache.size() <= k) {
+    d_reachability_cache.resize(k + 1);
+  }
+  query_key key(f, f_class);
+  if (cache_lookup(d_reachability_cache[k], key, result)) {
+    return result;
+  }
+
   if (d_ctx.get_options().get_bool("pdkind-single-solver")) {
     solver = get_reachability_solver();
   } else {
@@ -224,12 +278,9 @@ solvers::query_result solvers::query_with_transition_at(size_t k, expr::term_ref
   }
   smt::solver_scope scope(solver);
 
-  // Add the formula
-  scope.push();
-  solver->add(f, f_class);
-
-  // Figure out the result
-  result.result = solver->check();
+  // Check with the formula (pushed into the scope only if the solver can't assume it)
+  std::vector<expr::term_ref> assumptions(1, f);
+  result.result = scope.check(assumptions, f_class);
   switch (result.result) {
   case smt::solver::SAT: {
     if (d_generate_models_for_queries) {
@@ -245,6 +296,30 @@ solvers::query_result solvers::query_with_transition_at(size_t k, expr::term_ref
     throw exception("SMT unknown result.");
   }
 
+  cache_store(d_reachability_cache[k], key, result);
+  return result;
+}
+
+smt::solver::result solvers::check_with_transition_at(size_t k, expr::term_ref f, smt::solver::formula_class f_class) {
+
+  smt::solver* solver = 0;
+
+  if (d_ctx.get_options().get_bool("pdkind-single-solver")) {
+    solver = get_reachability_solver();
+  } else {
+    solver = get_reachability_solver(k);
+  }
+  // Check with the formula
+  std::vector<expr::term_ref> assumptions(1, f);
+  smt::solver::result result = solver->check(assumptions, f_class);
+  switch (result) {
+  case smt::solver::SAT:
+  case smt::solver::UNSAT:
+    break;
+  default:
+    throw exception("SMT unknown result.");
+  }
+
   return result;
 }
 
@@ -297,9 +372,7 @@ expr::term_ref solvers::generalize_sat(smt::solver* solver) {
   if (d_ctx.get_options().get_bool("pdkind-minimize-generalizations")) {
     // Add negation of generalization
     smt::solver* minimization_solver = get_minimization_solver();
-    smt::solver_scope scope(minimization_solver);
-    scope.push();
-    minimization_solver->add(d_tm.mk_not(d_tm.mk_and(generalization_facts)), smt::solver::CLASS_A);
+    std::vector<expr::term_ref> assumptions(1, d_tm.mk_not(d_tm.mk_and(generalization_facts)));
     // Get all the conjuncts
     std::set<expr::term_ref> conjuncts;
     for (size_t i = 0; i < generalization_facts.size(); ++ i) {
@@ -307,7 +380,7 @@ expr::term_ref solvers::generalize_sat(smt::solver* solver) {
     }
     std::vector<expr::term_ref> conjuncts_vec(conjuncts.begin(), conjuncts.end()), minimized_vec;
     // Minimize
-    quickxplain_generalization(minimization_solver, conjuncts_vec, 0, conjuncts_vec.size(), minimized_vec);
+    quickxplain_generalization(minimization_solver, conjuncts_vec, 0, conjuncts_vec.size(), assumptions, minimized_vec);
     TRACE("pdkind::mingen") << "min: old_size = " << conjuncts_vec.size() << ", new_size = " << minimized_vec.size() << std::endl;
     generalization_facts.swap(minimized_vec);
   }
@@ -324,9 +397,7 @@ expr::term_ref solvers::generalize_sat(smt::solver* solver, expr::model::ref m)
   if (d_ctx.get_options().get_bool("pdkind-minimize-generalizations")) {
     // Add negation of generalization
     smt::solver* minimization_solver = get_minimization_solver();
-    smt::solver_scope scope(minimization_solver);
-    scope.push();
-    minimization_solver->add(d_tm.mk_not(d_tm.mk_and(generalization_facts)), smt::solver::CLASS_A);
+    std::vector<expr::term_ref> assumptions(1, d_tm.mk_not(d_tm.mk_and(generalization_facts)));
     // Get all the conjuncts
     std::set<expr::term_ref> conjuncts;
     for (size_t i = 0; i < generalization_facts.size(); ++ i) {
@@ -334,7 +405,7 @@ expr::term_ref solvers::generalize_sat(smt::solver* solver, expr::model::ref m)
     }
     // Minimize
     std::vector<expr::term_ref> conjuncts_vec(conjuncts.begin(), conjuncts.end()), minimized_vec;
-    quickxplain_generalization(minimization_solver, conjuncts_vec, 0, conjuncts_vec.size(), minimized_vec);
+    quickxplain_generalization(minimization_solver, conjuncts_vec, 0, conjuncts_vec.size(), assumptions, minimized_vec);
     TRACE("pdkind::mingen") << "min: old_size = " << conjuncts_vec.size() << ", new_size = " << minimized_vec.size() << std::endl;
     generalization_facts.swap(minimized_vec);
   }
@@ -344,18 +415,15 @@ expr::term_ref solvers::generalize_sat(smt::solver* solver, expr::model::ref m)
   return G;
 }
 
-void solvers::quickxplain_interpolant(bool negate, smt::solver* I_solver, smt::solver* T_solver, const std::vector<expr::term_ref>& formulas, size_t begin, size_t end, std::vector<expr::term_ref>& out) {
+void solvers::quickxplain_interpolant(bool negate, smt::solver* I_solver, smt::solver* T_solver, const std::vector<expr::term_ref>& formulas, size_t begin, size_t end, std::vector<expr::term_ref>& I_assumptions, std::vector<expr::term_ref>& T_assumptions, std::vector<expr::term_ref>& out) {
 
   // TRACE("pdkind::min") << "min: begin = " << begin << ", end = " << end << std::endl;
 
-  smt::solver_scope I_solver_scope(I_solver);
-  smt::solver_scope T_solver_scope(T_solver);
-
   smt::solver::result I_solver_result = smt::solver::UNSAT;
   smt::solver::result T_solver_result = smt::solver::UNSAT;
 
-  if (I_solver) { I_solver_result = I_solver->check(); }
-  if (T_solver) { T_solver_result = T_solver->check(); }
+  if (I_solver) { I_solver_result = I_solver->check(I_assumptions, smt::solver::CLASS_A); }
+  if (T_solver) { T_solver_result = T_solver->check(T_assumptions, smt::solver::CLASS_A); }
 
   if (I_solver_result == smt::solver::UNSAT && T_solver_result == smt::solver::UNSAT) {
     // Solver state already unsat, done
@@ -377,52 +445,49 @@ void solvers::quickxplain_interpolant(bool negate, smt::solver* I_solver, smt::s
   // Split: how many in first half?
   size_t n = (end - begin) / 2;
 
-  // Assert first half and minimize the second
-  if (I_solver) I_solver_scope.push();
-  if (T_solver) T_solver_scope.push();
+  // Assume first half and minimize the second
+  size_t I_assumptions_size = I_assumptions.size();
+  size_t T_assumptions_size = T_assumptions.size();
   for (size_t i = begin; i < begin + n; ++ i) {
     expr::term_ref to_assert = negate ? d_tm.mk_term(expr::TERM_NOT, formulas[i])  : formulas[i];
     // Add to initial solver
     if (I_solver) {
-      I_solver->add(to_assert, smt::solver::CLASS_A);
+      I_assumptions.push_back(to_assert);
     }
     // Add to transition solver
     if (T_solver) {
       to_assert = d_transition_system->get_state_type()->change_formula_vars(system::state_type::STATE_CURRENT, system::state_type::STATE_NEXT, to_assert);
-      T_solver->add(to_assert, smt::solver::CLASS_A);
+      T_assumptions.push_back(to_assert);
     }
   }
   size_t old_out_size = out.size();
-  quickxplain_interpolant(negate, I_solver, T_solver, formulas, begin + n, end, out);
-  if (I_solver) I_solver_scope.pop();
-  if (T_solver) T_solver_scope.pop();
+  quickxplain_interpolant(negate, I_solver, T_solver, formulas, begin + n, end, I_assumptions, T_assumptions, out);
+  I_assumptions.resize(I_assumptions_size);
+  T_assumptions.resize(T_assumptions_size);
 
-  // Now, assert the minimized second half, and minimize the first half
-  if (I_solver) I_solver_scope.push();
-  if (T_solver) T_solver_scope.push();
+  // Now, assume the minimized second half, and minimize the first half
   for (size_t i = old_out_size; i < out.size(); ++ i) {
     expr::term_ref to_assert = negate ? d_tm.mk_term(expr::TERM_NOT, out[i]) : out[i];
     // Add to initial solver
     if (I_solver) {
-      I_solver->add(to_assert, smt::solver::CLASS_A);
+      I_assumptions.push_back(to_assert);
     }
     // Add to transition solver
     if (T_solver) {
       to_assert = d_transition_system->get_state_type()->change_formula_vars(system::state_type::STATE_CURRENT, system::state_type::STATE_NEXT, to_assert);
-      T_solver->add(to_assert, smt::solver::CLASS_A);
+      T_assumptions.push_back(to_assert);
     }
   }
-  quickxplain_interpolant(negate, I_solver, T_solver, formulas, begin, begin + n, out);
-  if (I_solver) I_solver_scope.pop();
-  if (T_solver) T_solver_scope.pop();
+  quickxplain_interpolant(negate, I_solver, T_solver, formulas, begin, begin + n, I_assumptions, T_assumptions, out);
+  I_assumptions.resize(I_assumptions_size);
+  T_assumptions.resize(T_assumptions_size);
 }
 
-void solvers::quickxplain_generalization(smt::solver* solver, const std::vector<expr::term_ref>& conjuncts, size_t begin, size_t end, std::vector<expr::term_ref>& out) {
+void solvers::quickxplain_generalization(smt::solver* solver, const std::vector<expr::term_ref>& conjuncts, size_t begin, size_t end, std::vector<expr::term_ref>& assumptions, std::vector<expr::term_ref>& out) {
 
   // TRACE("pdkind::min") << "min: begin = " << begin << ", end = " << end << std::endl;
 
-  smt::solver_scope solver_scope(solver);
-  smt::solver::result solver_result = solver->check();
+  smt::solver::result solver_result = solver->check(assumptions, smt::solver::CLASS_A);
 
   if (solver_result == smt::solver::UNSAT) {
     // Solver state already unsat, done
@@ -440,22 +505,21 @@ void solvers::quickxplain_generalization(smt::solver* solver, const std::vector<
   // Split: how many in first half?
   size_t n = (end - begin) / 2;
 
-  // Assert first half and minimize the second
-  solver_scope.push();
+  // Assume first half and minimize the second
+  size_t assumptions_size = assumptions.size();
   for (size_t i = begin; i < begin + n; ++ i) {
-    solver->add(conjuncts[i], smt::solver::CLASS_A);
+    assumptions.push_back(conjuncts[i]);
   }
   size_t old_out_size = out.size();
-  quickxplain_generalization(solver, conjuncts, begin + n, end, out);
-  solver_scope.pop();
+  quickxplain_generalization(solver, conjuncts, begin + n, end, assumptions, out);
+  assumptions.resize(assumptions_size);
 
-  // Now, assert the minimized second half, and minimize the first half
-  solver_scope.push();
+  // Now, assume the minimized second half, and minimize the first half
   for (size_t i = old_out_size; i < out.size(); ++ i) {
-    solver->add(out[i], smt::solver::CLASS_A);
+    assumptions.push_back(out[i]);
   }
-  quickxplain_generalization(solver, conjuncts, begin, begin + n, out);
-  solver_scope.pop();
+  quickxplain_generalization(solver, conjuncts, begin, begin + n, assumptions, out);
+  assumptions.resize(assumptions_size);
 }
 
 struct interpolant_cmp {
@@ -487,7 +551,8 @@ expr::term_ref solvers::learn_forward(size_t k, expr::term_ref G) {
     d_tm.get_conjuncts(G, G_conjuncts);
     interpolant_cmp cmp(d_tm);
     std::sort(G_conjuncts.begin(), G_conjuncts.end(), cmp);
-    quickxplain_interpolant(false, I_solver, T_solver, G_conjuncts, 0, G_conjuncts.size(), G_conjuncts_min);
+    std::vector<expr::term_ref> I_assumptions, T_assumptions;
+    quickxplain_interpolant(false, I_solver, T_solver, G_conjuncts, 0, G_conjuncts.size(), I_assumptions, T_assumptions, G_conjuncts_min);
     G = d_tm.mk_and(G_conjuncts_min);
   }
 
@@ -526,7 +591,8 @@ expr::term_ref solvers::learn_forward(size_t k, expr::term_ref G) {
     std::vector<expr::term_ref> disjuncts_vec(disjuncts.begin(), disjuncts.end()), minimized_vec;
     interpolant_cmp cmp(d_tm);
     std::sort(disjuncts_vec.begin(), disjuncts_vec.end(), cmp);
-    quickxplain_interpolant(true, I_solver, T_solver, disjuncts_vec, 0, disjuncts_vec.size(), minimized_vec);
+    std::vector<expr::term_ref> I_assumptions, T_assumptions;
+    quickxplain_interpolant(true, I_solver, T_solver, disjuncts_vec, 0, disjuncts_vec.size(), I_assumptions, T_assumptions, minimized_vec);
     TRACE("pdkind::min") << "min: old_size = " << disjuncts_vec.size() << ", new_size = " << minimized_vec.size() << std::endl;
     learnt = d_tm.mk_or(minimized_vec);
   } else {
@@ -545,6 +611,8 @@ expr::term_ref solvers::learn_forward(size_t k, expr::term_ref G) {
 
 
 void solvers::gc_collect(const expr::gc_relocator& gc_reloc) {
+  // Cached queries refer to terms that might be gone
+  cache_clear();
 }
 
 void solvers::add_to_reachability_solver(size_t k, expr::term_ref f)  {
@@ -554,6 +622,9 @@ void solvers::add_to_reachability_solver(size_t k, expr::term_ref f)  {
 
   smt::solver* solver = get_reachability_solver(k);
   solver->add(f, smt::solver::CLASS_A);
+  if (k < d_reachability_cache.size()) {
+    d_reachability_cache[k].clear();
+  }
   if (d_ctx.get_options().get_bool("pdkind-check-deadlock")) {
     smt::solver::result result = solver->check();
     if (result != smt::solver::SAT) {
@@ -566,59 +637,22 @@ void solvers::add_to_reachability_solver(size_t k, expr::term_ref f)  {
 
 void solvers::reset_induction_solver(size_t depth) {
   // Reset the induction solver
-  delete d_induction_solver;
-  delete d_induction_generalizer;
+  d_pool->release(d_induction_solver);
+  d_pool->release(d_induction_generalizer);
+  d_induction_cache.clear();
 
-  // Transition relation
-  d_transition_relation = d_transition_system->get_transition_relation();
-
-  // The solver
-  d_induction_solver = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
-  d_induction_generalizer = smt::factory::mk_default_solver(d_tm, d_ctx.get_options(), d_ctx.get_statistics());
+  // The solvers, with the variables and the transition relation unrolled to depth
+  d_induction_solver = d_pool->acquire(solver_pool::INDUCTION, depth);
+  d_induction_generalizer = d_pool->acquire(solver_pool::INDUCTION, depth);
   d_induction_solver_depth = depth;
-
-  // Add variables and transition relation
-  for (size_t k = 0; k <= depth; ++ k) {
-
-    // The variables
-    const std::vector<expr::term_ref>& x = d_trace->get_state_variables(k);
-
-    // Add state variables
-    if (k == 0) {
-      // First frame is A
-      const std::vector<expr::term_ref>& x_state = d_transition_system->get_state_type()->get_variables(system::state_type::STATE_CURRENT);
-      d_induction_solver->add_variables(x_state.begin(), x_state.end(), smt::solver::CLASS_A);
-      d_induction_generalizer->add_variables(x_state.begin(), x_state.end(), smt::solver::CLASS_A);
-    } else if (k < depth) {
-      // Intermediate frames are T
-      d_induction_solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_T);
-      d_induction_generalizer->add_variables(x.begin(), x.end(), smt::solver::CLASS_T);
-    } else {
-      // Last frame is B
-      d_induction_solver->add_variables(x.begin(), x.end(), smt::solver::CLASS_B);
-      d_induction_generalizer->add_variables(x.begin(), x.end(), smt::solver::CLASS_B);
-    }
-
-    // Add input variables
-    if (k > 0) {
-      const std::vector<expr::term_ref>& input = d_trace->get_input_variables(k-1);
-      d_induction_solver->add_variables(input.begin(), input.end(), smt::solver::CLASS_T);
-      d_induction_generalizer->add_variables(input.begin(), input.end(), smt::solver::CLASS_T);
-      // Formula T(x_{k-1}, x_k)
-      expr::term_ref T = d_trace->get_transition_formula(d_transition_relation, k-1);
-      // If transitioning from initial state, move to state vars
-      if (k == 1) {
-        T = d_trace->get_state_formula(0, T);
-      }
-      d_induction_solver->add(T, smt::solver::CLASS_T);
-      d_induction_generalizer->add(T, smt::solver::CLASS_T);
-    }
-  }
+  d_induction_solver_version ++;
 }
 
 void solvers::add_to_induction_solver(expr::term_ref f, induction_assertion_type type) {
   assert(d_induction_solver != 0);
   assert(d_induction_generalizer != 0);
+  d_induction_cache.clear();
+  d_induction_solver_version ++;
   switch (type) {
   case INDUCTION_FIRST:
     d_induction_solver->add(f, smt::solver::CLASS_A);
@@ -649,17 +683,20 @@ solvers::query_result solvers::check_inductive(expr::term_ref f) {
 
   query_result result;
 
-  // Push the scope
+  // Check the cache first
+  query_key key(f, smt::solver::CLASS_B);
+  if (cache_lookup(d_induction_cache, key, result)) {
+    return result;
+  }
+
+  // The scope is only used if the solver can't assume the formula
   smt::solver_scope scope(d_induction_solver);
-  scope.push();
 
-  // Add the formula (moving current -> next)
+  // Check with the formula (moving current -> next)
   expr::term_ref F_not = d_tm.mk_term(expr::TERM_NOT, f);
   expr::term_ref F_not_next = d_trace->get_state_formula(F_not, d_induction_solver_depth);
-  d_induction_solver->add(F_not_next, smt::solver::CLASS_B);
-
-  // Figure out the result
-  result.result = d_induction_solver->check();
+  std::vector<expr::term_ref> assumptions(1, F_not_next);
+  result.result = scope.check(assumptions, smt::solver::CLASS_B);
   switch (result.result) {
   case smt::solver::SAT: {
     // Generalize in the simplified induction
@@ -676,6 +713,7 @@ solvers::query_result solvers::check_inductive(expr::term_ref f) {
     throw exception("SMT unknown result.");
   }
 
+  cache_store(d_induction_cache, key, result);
   return result;
 }
 
@@ -685,8 +723,13 @@ solvers::query_result solvers::check_inductive_model(expr::model::ref m, expr::t
 
   solvers::query_result result;
 
+  // The same formulas are checked against many models, so we compile them
   expr::term_ref f_next = d_trace->get_state_formula(f, d_induction_solver_depth);
-  if (m->is_true(f_next)) {
+  evaluator_map::iterator find = d_induction_evaluators.find(f_next);
+  if (find == d_induction_evaluators.end()) {
+    find = d_induction_evaluators.insert(std::make_pair(f_next, expr::term_evaluator(d_tm, f_next))).first;
+  }
+  if (find->second.is_true(*m)) {
     result.model = m;
     result.result = smt::solver::SAT;
 
@@ -779,8 +822,7 @@ void solvers::output_efsmt(expr::term_ref f, expr::term_ref g) const {
   out << "(check-sat)" << std::endl;
 }
 
-void solvers::quickxplain_frame(smt::solver* solver, const std::vector<induction_obligation>& frame, size_t begin, size_t end, std::vector<induction_obligation>& out) {
-  smt::solver_scope solver_scope(solver);
+void solvers::quickxplain_frame(smt::solver* solver, const std::vector<induction_obligation>& frame, size_t begin, size_t end, std::vector<expr::term_ref>& assumptions, std::vector<induction_obligation>& out) {
 
   assert(begin < end);
 
@@ -795,34 +837,32 @@ void solvers::quickxplain_frame(smt::solver* solver, const std::vector<induction
       return;
     }
     // Only one left, we keep it, check if we need it
-    solver_scope.push();
-    expr::term_ref f_not = d_tm.mk_not(frame[begin].F_fwd);
-    solver->add(f_not, smt::solver::CLASS_A);
-    if (solver->check() != smt::solver::UNSAT) {
+    assumptions.push_back(d_tm.mk_not(frame[begin].F_fwd));
+    if (solver->check(assumptions, smt::solver::CLASS_A) != smt::solver::UNSAT) {
       out.push_back(frame[begin]);
     }
+    assumptions.pop_back();
     return;
   }
 
   // Split: how many in first half?
   size_t n = (end - begin) / 2;
 
-  // Assert first half and minimize the second
-  solver_scope.push();
+  // Assume first half and minimize the second
+  size_t assumptions_size = assumptions.size();
   for (size_t i = begin; i < begin + n; ++ i) {
-    solver->add(frame[i].F_fwd, smt::solver::CLASS_A);
+    assumptions.push_back(frame[i].F_fwd);
   }
   size_t old_out_size = out.size();
-  quickxplain_frame(solver, frame, begin + n, end, out);
-  solver_scope.pop();
+  quickxplain_frame(solver, frame, begin + n, end, assumptions, out);
+  assumptions.resize(assumptions_size);
 
-  // Now, assert the minimized second half, and minimize the first half
-  solver_scope.push();
+  // Now, assume the minimized second half, and minimize the first half
   for (size_t i = old_out_size; i < out.size(); ++ i) {
-    solver->add(out[i].F_fwd, smt::solver::CLASS_A);
+    assumptions.push_back(out[i].F_fwd);
   }
-  quickxplain_frame(solver, frame, begin, begin + n, out);
-  solver_scope.pop();
+  quickxplain_frame(solver, frame, begin, begin + n, assumptions, out);
+  assumptions.resize(assumptions_size);
 
 }
 
@@ -830,7 +870,8 @@ void solvers::minimize_frame(std::vector<induction_obligation>& frame) {
   std::vector<induction_obligation> out;
   smt::solver* solver = get_minimization_solver();
   std::sort(frame.begin(), frame.end(), induction_obligation_cmp_better());
-  quickxplain_frame(solver, frame, 0, frame.size(), out);
+  std::vector<expr::term_ref> assumptions;
+  quickxplain_frame(solver, frame, 0, frame.size(), assumptions, out);
   frame.swap(out);
 }
 
@@ -24,11 +24,16 @@
 #include "../../system/trace_helper.h"
 #include "smt/solver.h"
 #include "expr/term_manager.h"
+#include "expr/term_evaluator.h"
 #include "expr/gc_relocator.h"
 #include "system/transition_system.h"
 #include "system/context.h"
+#include "utils/statistics.h"
 
 #include "induction_obligation.h"
+#include "solver_pool.h"
+
+#include <boost/unordered_map.hpp>
 
 namespace sally {
 namespace pdkind {
@@ -64,6 +69,12 @@ class solvers {
   /** The trace to get the state variables for unrolling */
   system::trace_helper* d_trace;
 
+  /** Pool the solvers come from */
+  solver_pool* d_pool;
+
+  /** Did we create the pool */
+  bool d_own_pool;
+
   /** A solver per frame with transition relation info */
   std::vector<smt::solver*> d_reachability_solvers;
 
@@ -85,8 +96,8 @@ class solvers {
   /** Depth of the induction solver */
   size_t d_induction_solver_depth;
 
-  /** Relation used in the induction solver */
-  expr::term_ref d_transition_relation;
+  /** Number of changes to the induction solver so far */
+  size_t d_induction_solver_version;
 
   /** Returns the induction solver */
   smt::solver* get_initial_solver();
@@ -112,19 +123,19 @@ class solvers {
   /** Whether to generate models for queries */
   bool d_generate_models_for_queries;
 
-  /** Use quickxplain to minimize the interpolant */
-  void quickxplain_interpolant(bool negate, smt::solver* I_solver, smt::solver* T_solver, const std::vector<expr::term_ref>& formulas, size_t begin, size_t end, std::vector<expr::term_ref>& out);
+  /** Use quickxplain to minimize the interpolant (checking under the given assumptions) */
+  void quickxplain_interpolant(bool negate, smt::solver* I_solver, smt::solver* T_solver, const std::vector<expr::term_ref>& formulas, size_t begin, size_t end, std::vector<expr::term_ref>& I_assumptions, std::vector<expr::term_ref>& T_assumptions, std::vector<expr::term_ref>& out);
 
-  /** Use quickxplain to minimize the generalization */
-  void quickxplain_generalization(smt::solver* solver, const std::vector<expr::term_ref>& disjuncts, size_t begin, size_t end, std::vector<expr::term_ref>& out);
+  /** Use quickxplain to minimize the generalization (checking under the given assumptions) */
+  void quickxplain_generalization(smt::solver* solver, const std::vector<expr::term_ref>& disjuncts, size_t begin, size_t end, std::vector<expr::term_ref>& assumptions, std::vector<expr::term_ref>& out);
 
-  /** Use quickxplain to minimize the frame */
-  void quickxplain_frame(smt::solver* solver, const std::vector<induction_obligation>& frame, size_t begin, size_t end, std::vector<induction_obligation>& out);
+  /** Use quickxplain to minimize the frame (checking under the given assumptions) */
+  void quickxplain_frame(smt::solver* solver, const std::vector<induction_obligation>& frame, size_t begin, size_t end, std::vector<expr::term_ref>& assumptions, std::vector<induction_obligation>& out);
 
 public:
 
-  /** Create solvers for the given transition system */
-  solvers(const system::context& ctx, const system::transition_system* transition_system, system::trace_helper* trace);
+  /** Create solvers for the given transition system, taken from the pool (or a private one if null) */
+  solvers(const system::context& ctx, const system::transition_system* transition_system, system::trace_helper* trace, solver_pool* pool = 0);
 
   /** Delete the solvers */
   ~solvers();
@@ -152,12 +163,75 @@ public:
     query_result();
   };
 
+private:
+
+  /** Key of a cached query: the formula and its class */
+  typedef std::pair<expr::term_ref, smt::solver::formula_class> query_key;
+
+  struct query_key_hasher {
+    size_t operator () (const query_key& key) const {
+      return expr::term_ref_hasher()(key.first) ^ key.second;
+    }
+  };
+
+  /**
+   * Cache of query results for one solver. Terms are hash-consed so the key
+   * identifies the query exactly, as long as the solver assertions don't
+   * change. The cache is cleared whenever they do.
+   */
+  typedef boost::unordered_map<query_key, query_result, query_key_hasher> query_cache;
+
+  /** Whether to cache the query results */
+  bool d_use_query_cache;
+
+  /** Cache of reachability queries, per frame */
+  std::vector<query_cache> d_reachability_cache;
+
+  /** Cache of initial state queries */
+  query_cache d_initial_cache;
+
+  /** Cache of induction queries */
+  query_cache d_induction_cache;
+
+  /** Query cache statistics (null if not reported) */
+  utils::stat_int* d_cache_hits;
+  utils::stat_int* d_cache_misses;
+
+  /** Look for the query in the cache, returns true and sets result if found */
+  bool cache_lookup(const query_cache& cache, const query_key& key, query_result& result) const;
+
+  /** Store the query result into the cache */
+  void cache_store(query_cache& cache, const query_key& key, const query_result& result);
+
+  /** Clear all the query caches */
+  void cache_clear();
+
+  /** Map from formulas to their compiled evaluators */
+  typedef boost::unordered_map<expr::term_ref, expr::term_evaluator, expr::term_ref_hasher> evaluator_map;
+
+  /** Evaluators of the induction formulas checked against models (cleared with the caches) */
+  evaluator_map d_induction_evaluators;
+
+public:
+
+  /** Report the query cache hits and misses into the given statistics */
+  void set_query_cache_stats(utils::stat_int* hits, utils::stat_int* misses);
+
   /** Checks formula f for satisfiability at frame k using the reachability solvers and returns the generalization. */
   query_result query_with_transition_at(size_t k, expr::term_ref f, smt::solver::formula_class f_class);
 
+  /** Checks formula f for satisfiability at frame k as above, but only returns the result. */
+  smt::solver::result check_with_transition_at(size_t k, expr::term_ref f, smt::solver::formula_class f_class);
+
   /** Checks formula f for satisfiability at initial frame. */
   smt::solver::result query_at_init(expr::term_ref f);
 
+  /**
+   * Check if f is an invariant on its own, i.e. it holds in the initial
+   * states and it is inductive relative to the given invariants.
+   */
+  bool is_invariant(expr::term_ref f, const std::vector<expr::term_ref>& invariants);
+
   /**
    * Reset induction solver so that it has given depth. Depth is the number of
    * transitions. So, if you'd like to try k-induction, you need to do depth k + 1.
@@ -181,6 +255,13 @@ public:
    */
   void add_to_induction_solver(expr::term_ref f, induction_assertion_type type);
 
+  /**
+   * Version of the induction solver, changes whenever the induction solver is
+   * reset or strengthened. Results of check_inductive() are valid as long as
+   * the version stays the same.
+   */
+  size_t get_induction_solver_version() const { return d_induction_solver_version; }
+
   /**
    * Check if f is inductive, i.e. !f is added at frame depth and check for
    * satisfiability.
@@ -0,0 +1,273 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/portfolio/portfolio_engine.h"
+
+#include "engine/factory.h"
+#include "smt/factory.h"
+#include "system/system_copy.h"
+#include "system/lemma_bus.h"
+#include "utils/trace.h"
+#include "utils/budget.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <sstream>
+#include <iostream>
+#include <cassert>
+
+namespace sally {
+namespace portfolio {
+
+/** Shared state of the workers of one query */
+struct portfolio_status {
+  /** Lock for the status */
+  boost::mutex mutex;
+  /** Notified every time a worker finishes */
+  boost::condition_variable worker_done;
+  /** Number of finished workers */
+  size_t finished;
+  portfolio_status(): finished(0) {}
+};
+
+struct portfolio_engine::worker {
+
+  /** Id of the engine */
+  std::string engine_id;
+
+  /** Private copy of the problem */
+  system::system_copy copy;
+
+  /** The engine */
+  engine* e;
+
+  /** Result of the query */
+  engine::result result;
+
+  /** Error message if the engine failed */
+  std::string error;
+
+  /** The thread running the engine */
+  boost::thread* thread;
+
+  worker(std::string engine_id, const system::context& main_ctx, const system::transition_system* ts, const system::state_formula* sf)
+  : engine_id(engine_id)
+  , copy(main_ctx, ts, sf)
+  , e(0)
+  , result(engine::UNKNOWN)
+  , thread(0)
+  {}
+
+  ~worker() {
+    delete thread;
+    delete e;
+  }
+
+  /** Run the query and notify the status when done */
+  void run(portfolio_status* status);
+
+  /** Is the result definitive */
+  bool decided() const {
+    return result == engine::VALID || result == engine::INVALID;
+  }
+};
+
+void portfolio_engine::worker::run(portfolio_status* status) {
+
+  engine::result r = engine::UNKNOWN;
+  try {
+    r = e->query(copy.get_transition_system(), copy.get_property());
+  } catch (boost::thread_interrupted&) {
+    r = engine::INTERRUPTED;
+  } catch (const sally::exception& ex) {
+    error = ex.get_message();
+  } catch (...) {
+    error = "unknown error";
+  }
+
+  boost::lock_guard<boost::mutex> lock(status->mutex);
+  result = r;
+  status->finished ++;
+  status->worker_done.notify_all();
+}
+
+/** Split the comma-separated list */
+static void split_list(std::string list, std::vector<std::string>& out) {
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.size() > 0) {
+      out.push_back(item);
+    }
+  }
+}
+
+portfolio_engine::portfolio_engine(const system::context& ctx)
+: engine(ctx)
+, d_winner(0)
+, d_trace(0)
+, d_lemma_bus(0)
+{
+}
+
+portfolio_engine::~portfolio_engine() {
+  clear_workers();
+}
+
+void portfolio_engine::clear_workers() {
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    delete d_workers[i];
+  }
+  d_workers.clear();
+  delete d_lemma_bus;
+  d_lemma_bus = 0;
+}
+
+void portfolio_engine::mk_workers(const system::transition_system* ts, const system::state_formula* sf) {
+
+  const options& opts = ctx().get_options();
+
+  // The engines and the solvers to use
+  std::vector<std::string> engines;
+  std::vector<std::string> solvers;
+  split_list(opts.get_string("portfolio-engines"), engines);
+  if (opts.has_option("portfolio-solvers")) {
+    split_list(opts.get_string("portfolio-solvers"), solvers);
+    if (solvers.size() != engines.size()) {
+      throw exception("portfolio: the number of solvers doesn't match the number of engines");
+    }
+  }
+  if (engines.size() == 0) {
+    throw exception("portfolio: no engines to run");
+  }
+
+  // The bus for sharing lemmas
+  if (opts.has_option("portfolio-share-lemmas")) {
+    d_lemma_bus = new system::lemma_bus(ts->get_state_type());
+  }
+
+  for (size_t i = 0; i < engines.size(); ++ i) {
+
+    if (engines[i] == "portfolio") {
+      throw exception("portfolio: can't run a portfolio within a portfolio");
+    }
+
+    // Copy the problem
+    worker* w = new worker(engines[i], ctx(), ts, sf);
+    d_workers.push_back(w);
+    if (solvers.size() > 0) {
+      w->copy.get_options().set_string("solver", solvers[i]);
+    }
+    w->copy.ctx().set_lemma_bus(d_lemma_bus);
+    if (engines.size() > 1) {
+      smt::factory::check_thread_safe(w->copy.get_options(), "portfolio");
+    }
+
+    // The engine itself
+    w->e = engine_factory::mk_engine(engines[i], w->copy.ctx());
+  }
+}
+
+engine::result portfolio_engine::query(const system::transition_system* ts, const system::state_formula* sf) {
+
+  // Reset from previous queries
+  clear_workers();
+  d_trace = 0;
+  d_winner = 0;
+
+  // Make the workers (sequentially, all terms are created here)
+  mk_workers(ts, sf);
+
+  // Start the workers
+  portfolio_status status;
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    worker* w = d_workers[i];
+    MSG(1) << "portfolio: starting " << w->engine_id << std::endl;
+    w->thread = new boost::thread(&worker::run, w, &status);
+  }
+
+  // Wait for a decision, or for everyone to finish
+  worker* winner = 0;
+  {
+    boost::unique_lock<boost::mutex> lock(status.mutex);
+    while (winner == 0 && status.finished < d_workers.size()) {
+      status.worker_done.wait(lock);
+      for (size_t i = 0; winner == 0 && i < d_workers.size(); ++ i) {
+        if (d_workers[i]->decided()) {
+          winner = d_workers[i];
+        }
+      }
+    }
+  }
+
+  // Stop everyone else, including the checks in progress, and wait for them
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    d_workers[i]->thread->interrupt();
+  }
+  for (size_t i = 0; i < d_workers.size(); ++ i) {
+    worker* w = d_workers[i];
+    while (!w->thread->timed_join(boost::posix_time::milliseconds(10))) {
+      smt::solver::interrupt_all(&w->copy.tm());
+    }
+  }
+
+  // No decision
+  if (winner == 0) {
+    for (size_t i = 0; i < d_workers.size(); ++ i) {
+      if (d_workers[i]->error.size() > 0) {
+        throw exception(d_workers[i]->engine_id + ": " + d_workers[i]->error);
+      }
+    }
+    return utils::budget::exhausted() ? INTERRUPTED : UNKNOWN;
+  }
+
+  MSG(1) << "portfolio: " << winner->engine_id << " got " << winner->result << std::endl;
+
+  // Translate the trace back (invariant is translated on demand)
+  d_winner = winner;
+  if (winner->result == INVALID) {
+    d_trace = ts->get_trace_helper();
+    get_worker_trace(winner);
+  }
+
+  return winner->result;
+}
+
+void portfolio_engine::get_worker_trace(worker* w) {
+  // Engines might construct the trace on demand
+  w->e->get_trace();
+  w->copy.copy_trace_to_main(d_trace);
+}
+
+const system::trace_helper* portfolio_engine::get_trace() {
+  return d_trace;
+}
+
+engine::invariant portfolio_engine::get_invariant() {
+  if (d_winner == 0 || d_winner->result != VALID) {
+    throw exception("portfolio: no invariant available.");
+  }
+  engine::invariant inv = d_winner->e->get_invariant();
+  expr::term_ref F = d_winner->copy.to_main(inv.F);
+  return invariant(F, inv.depth);
+}
+
+}
+}
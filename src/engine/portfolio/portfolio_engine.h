@@ -0,0 +1,87 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "engine/engine.h"
+#include "expr/term.h"
+
+#include <vector>
+#include <string>
+
+namespace sally {
+namespace portfolio {
+
+/**
+ * Portfolio engine. Runs several engines concurrently, each in its own
+ * thread, with its own term manager, statistics and a copy of the problem.
+ * The first engine to decide the property (valid or invalid) wins, and the
+ * other engines are interrupted. The result (trace or invariant) is then
+ * translated back into the main term manager.
+ *
+ * Option portfolio-engines sets the engines to use, and option
+ * portfolio-solvers optionally sets the solver for each of them. With option
+ * portfolio-share-lemmas, the engines exchange the invariants they prove
+ * through a lemma bus.
+ */
+class portfolio_engine : public engine {
+
+  /** An engine working on a private copy of the problem */
+  struct worker;
+
+  /** The workers of the last query */
+  std::vector<worker*> d_workers;
+
+  /** The worker that decided the last query */
+  worker* d_winner;
+
+  /** The trace we're building */
+  system::trace_helper* d_trace;
+
+  /** Lemmas shared between the workers (null if not sharing) */
+  system::lemma_bus* d_lemma_bus;
+
+  /** Remove all the workers */
+  void clear_workers();
+
+  /** Create the workers for the given problem */
+  void mk_workers(const system::transition_system* ts, const system::state_formula* sf);
+
+  /** Get the trace of the worker into d_trace */
+  void get_worker_trace(worker* w);
+
+public:
+
+  portfolio_engine(const system::context& ctx);
+  ~portfolio_engine();
+
+  /** Query */
+  result query(const system::transition_system* ts, const system::state_formula* sf);
+
+  /** Trace */
+  const system::trace_helper* get_trace();
+
+  /** Invariant */
+  invariant get_invariant();
+
+  /** Nothing to collect (workers have their own term managers) */
+  void gc_collect(const expr::gc_relocator& gc_reloc) {}
+};
+
+}
+}
@@ -0,0 +1,52 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "engine/portfolio/portfolio_engine.h"
+
+#include <boost/program_options.hpp>
+
+#include <string>
+
+namespace sally {
+namespace portfolio {
+
+struct portfolio_engine_info {
+
+  static void setup_options(boost::program_options::options_description& options) {
+    using namespace boost::program_options;
+    options.add_options()
+        ("portfolio-engines", value<std::string>()->default_value("bmc,kind,pdkind"), "Comma-separated list of engines to run in parallel.")
+        ("portfolio-solvers", value<std::string>(), "Comma-separated list of solvers to use, one for each of the portfolio engines (default solver if not given).")
+        ("portfolio-share-lemmas", "Share the invariants proven by the engines with the other engines.")
+        ;
+  }
+
+  static std::string get_id() {
+    return "portfolio";
+  }
+
+  static engine* new_instance(const system::context& ctx) {
+    return new portfolio_engine(ctx);
+  }
+
+};
+
+}
+}
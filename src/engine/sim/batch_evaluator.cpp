@@ -0,0 +1,563 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/sim/batch_evaluator.h"
+
+#include "expr/term_evaluator.h"
+#include "expr/term_visitor.h"
+#include "utils/exception.h"
+
+#include <boost/unordered_map.hpp>
+#include <sstream>
+#include <cassert>
+
+namespace sally {
+namespace sim {
+
+using namespace expr;
+
+void lanes::resize(size_t n) {
+  switch (k) {
+  case BOOL:
+    b.resize(n);
+    break;
+  case RATIONAL:
+    q.resize(n);
+    break;
+  case BITVECTOR:
+    bv.resize(n);
+    break;
+  }
+}
+
+value lanes::get(size_t i) const {
+  switch (k) {
+  case BOOL:
+    return value(b[i] != 0);
+  case RATIONAL:
+    return value(q[i]);
+  case BITVECTOR:
+    return value(bv[i]);
+  }
+  assert(false);
+  return value();
+}
+
+void lanes::set(size_t i, const value& v) {
+  switch (k) {
+  case BOOL:
+    b[i] = v.get_bool();
+    break;
+  case RATIONAL:
+    q[i] = v.get_rational();
+    break;
+  case BITVECTOR:
+    bv[i] = v.get_bitvector();
+    break;
+  }
+}
+
+void lanes::copy(size_t j, const lanes& other, size_t i) {
+  assert(k == other.k);
+  switch (k) {
+  case BOOL:
+    b[j] = other.b[i];
+    break;
+  case RATIONAL:
+    q[j] = other.q[i];
+    break;
+  case BITVECTOR:
+    bv[j] = other.bv[i];
+    break;
+  }
+}
+
+/** Bit-vector operation */
+typedef bitvector (bitvector::*bv_operation)(const bitvector& rhs) const;
+
+/** Bit-vector predicate */
+typedef bool (bitvector::*bv_predicate)(const bitvector& rhs) const;
+
+/** Get the bit-vector operation for op (0 if not a binary operation) */
+static bv_operation get_bv_operation(term_op op) {
+  switch (op) {
+  case TERM_BV_ADD: return &bitvector::add;
+  case TERM_BV_SUB: return &bitvector::sub;
+  case TERM_BV_MUL: return &bitvector::mul;
+  case TERM_BV_UDIV: return &bitvector::udiv;
+  case TERM_BV_SDIV: return &bitvector::sdiv;
+  case TERM_BV_UREM: return &bitvector::urem;
+  case TERM_BV_SREM: return &bitvector::srem;
+  case TERM_BV_SMOD: return &bitvector::smod;
+  case TERM_BV_XOR: return &bitvector::bvxor;
+  case TERM_BV_SHL: return &bitvector::shl;
+  case TERM_BV_LSHR: return &bitvector::lshr;
+  case TERM_BV_ASHR: return &bitvector::ashr;
+  case TERM_BV_AND: return &bitvector::bvand;
+  case TERM_BV_OR: return &bitvector::bvor;
+  case TERM_BV_CONCAT: return &bitvector::concat;
+  default:
+    return 0;
+  }
+}
+
+/** Get the bit-vector predicate for op (0 if not a predicate) */
+static bv_predicate get_bv_predicate(term_op op) {
+  switch (op) {
+  case TERM_BV_ULEQ: return &bitvector::uleq;
+  case TERM_BV_SLEQ: return &bitvector::sleq;
+  case TERM_BV_ULT: return &bitvector::ult;
+  case TERM_BV_SLT: return &bitvector::slt;
+  case TERM_BV_UGEQ: return &bitvector::ugeq;
+  case TERM_BV_SGEQ: return &bitvector::sgeq;
+  case TERM_BV_UGT: return &bitvector::ugt;
+  case TERM_BV_SGT: return &bitvector::sgt;
+  default:
+    return 0;
+  }
+}
+
+/** Is the operation supported by the evaluator */
+static bool is_supported(term_op op) {
+  switch (op) {
+  case CONST_BOOL:
+  case CONST_RATIONAL:
+  case CONST_BITVECTOR:
+  case TERM_ITE:
+  case TERM_EQ:
+  case TERM_AND:
+  case TERM_OR:
+  case TERM_NOT:
+  case TERM_IMPLIES:
+  case TERM_XOR:
+  case TERM_ADD:
+  case TERM_SUB:
+  case TERM_MUL:
+  case TERM_DIV:
+  case TERM_LEQ:
+  case TERM_LT:
+  case TERM_GEQ:
+  case TERM_GT:
+  case TERM_TO_INT:
+  case TERM_TO_REAL:
+  case TERM_IS_INT:
+  case TERM_BV_NOT:
+  case TERM_BV_EXTRACT:
+    return true;
+  default:
+    return get_bv_operation(op) != 0 || get_bv_predicate(op) != 0;
+  }
+}
+
+/** Visitor that emits the instructions in topological order */
+class batch_evaluator::compiler {
+
+  typedef boost::unordered_map<term_ref, size_t, term_ref_hasher> slot_map;
+
+  batch_evaluator& d_evaluator;
+  term_manager& d_tm;
+
+  /** Map from terms to their slots */
+  slot_map d_slots;
+
+  /** Add an instruction for t, returns the slot */
+  size_t add(term_ref t, term_op op, size_t begin, size_t size) {
+    size_t slot = d_evaluator.d_instructions.size();
+    d_evaluator.d_instructions.push_back(instruction(t, op, begin, size));
+    d_evaluator.d_values.push_back(lanes());
+    d_evaluator.d_constants.push_back(value());
+    d_slots[t] = slot;
+
+    // Get the kind of values from the type
+    term_ref type = d_tm.type_of(t);
+    switch (d_tm.term_of(type).op()) {
+    case TYPE_BOOL:
+      d_evaluator.d_values[slot].k = lanes::BOOL;
+      break;
+    case TYPE_INTEGER:
+    case TYPE_REAL:
+      d_evaluator.d_values[slot].k = lanes::RATIONAL;
+      break;
+    case TYPE_BITVECTOR:
+      d_evaluator.d_values[slot].k = lanes::BITVECTOR;
+      break;
+    default: {
+      std::stringstream ss;
+      ss << set_tm(d_tm) << "sim: unsupported type " << type << " of " << t;
+      throw exception(ss.str());
+    }
+    }
+
+    return slot;
+  }
+
+public:
+
+  compiler(batch_evaluator& evaluator, const std::vector<term_ref>& vars)
+  : d_evaluator(evaluator)
+  , d_tm(evaluator.d_tm)
+  {
+    for (size_t i = 0; i < vars.size(); ++ i) {
+      add(vars[i], VARIABLE, 0, 0);
+    }
+  }
+
+  /** Get the slot of the compiled term */
+  size_t get_slot(term_ref t) const {
+    slot_map::const_iterator find = d_slots.find(t);
+    assert(find != d_slots.end());
+    return find->second;
+  }
+
+  // Non-null terms are good
+  bool is_good_term(term_ref t) const {
+    return !t.is_null();
+  }
+
+  // Get the children of t
+  void get_children(term_ref t, std::vector<term_ref>& children) {
+    const term& t_term = d_tm.term_of(t);
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      children.push_back(t_term[i]);
+    }
+  }
+
+  // Skip the terms compiled already (including the variables)
+  visitor_match_result match(term_ref t) {
+    if (d_slots.find(t) != d_slots.end()) {
+      return DONT_VISIT_AND_BREAK;
+    }
+    term_op op = d_tm.term_of(t).op();
+    if (!is_supported(op)) {
+      std::stringstream ss;
+      ss << set_tm(d_tm) << "sim: can't evaluate " << t;
+      throw exception(ss.str());
+    }
+    return VISIT_AND_CONTINUE;
+  }
+
+  void visit(term_ref t) {
+    const term& t_term = d_tm.term_of(t);
+    term_op op = t_term.op();
+
+    size_t begin = d_evaluator.d_children.size();
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      d_evaluator.d_children.push_back(get_slot(t_term[i]));
+    }
+
+    size_t slot = add(t, op, begin, t_term.size());
+
+    // Constants are evaluated once and for all
+    switch (op) {
+    case CONST_BOOL:
+      d_evaluator.d_constants[slot] = value(d_tm.get_boolean_constant(t_term));
+      break;
+    case CONST_RATIONAL:
+      d_evaluator.d_constants[slot] = value(d_tm.get_rational_constant(t_term));
+      break;
+    case CONST_BITVECTOR:
+      d_evaluator.d_constants[slot] = value(d_tm.get_bitvector_constant(t_term));
+      break;
+    default:
+      break;
+    }
+  }
+};
+
+batch_evaluator::batch_evaluator(term_manager& tm, const std::vector<term_ref>& vars, const std::vector<term_ref>& roots)
+: d_tm(tm)
+, d_size(0)
+{
+  // Compile all the roots together, so that they share the subterms
+  compiler c(*this, vars);
+  term_visit_topological<compiler, term_ref, term_ref_hasher> visit_topological(c);
+  for (size_t i = 0; i < roots.size(); ++ i) {
+    visit_topological.run(roots[i]);
+    d_roots.push_back(c.get_slot(roots[i]));
+  }
+
+  // Each root only executes the instructions it depends on
+  d_programs.resize(roots.size());
+  std::vector<bool> needed;
+  for (size_t i = 0; i < roots.size(); ++ i) {
+    needed.assign(d_instructions.size(), false);
+    needed[d_roots[i]] = true;
+    for (size_t j = d_roots[i] + 1; j > 0; -- j) {
+      const instruction& I = d_instructions[j - 1];
+      if (needed[j - 1]) {
+        for (size_t k = 0; k < I.children_size; ++ k) {
+          needed[d_children[I.children_begin + k]] = true;
+        }
+      }
+    }
+    for (size_t j = 0; j <= d_roots[i]; ++ j) {
+      if (needed[j] && d_instructions[j].op != VARIABLE && d_constants[j].is_null()) {
+        d_programs[i].push_back(j);
+      }
+    }
+  }
+}
+
+void batch_evaluator::resize(size_t n) {
+  d_size = n;
+  for (size_t i = 0; i < d_values.size(); ++ i) {
+    d_values[i].resize(n);
+    if (!d_constants[i].is_null()) {
+      for (size_t j = 0; j < n; ++ j) {
+        d_values[i].set(j, d_constants[i]);
+      }
+    }
+  }
+}
+
+const lanes& batch_evaluator::evaluate(size_t i) {
+  const std::vector<size_t>& program = d_programs[i];
+  for (size_t k = 0; k < program.size(); ++ k) {
+    execute(program[k]);
+  }
+  return d_values[d_roots[i]];
+}
+
+void batch_evaluator::execute(size_t i) {
+
+  const instruction& I = d_instructions[i];
+  lanes& out = d_values[i];
+  size_t n = d_size;
+
+  switch (I.op) {
+  case TERM_ITE: {
+    const std::vector<char>& c = child(I, 0).b;
+    const lanes& t = child(I, 1);
+    const lanes& e = child(I, 2);
+    switch (out.k) {
+    case lanes::BOOL:
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] = c[j] ? t.b[j] : e.b[j];
+      }
+      break;
+    case lanes::RATIONAL:
+      for (size_t j = 0; j < n; ++ j) {
+        out.q[j] = c[j] ? t.q[j] : e.q[j];
+      }
+      break;
+    case lanes::BITVECTOR:
+      for (size_t j = 0; j < n; ++ j) {
+        out.bv[j] = c[j] ? t.bv[j] : e.bv[j];
+      }
+      break;
+    }
+    break;
+  }
+  case TERM_EQ: {
+    const lanes& a = child(I, 0);
+    const lanes& b = child(I, 1);
+    switch (a.k) {
+    case lanes::BOOL:
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] = a.b[j] == b.b[j];
+      }
+      break;
+    case lanes::RATIONAL:
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] = a.q[j] == b.q[j];
+      }
+      break;
+    case lanes::BITVECTOR:
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] = a.bv[j] == b.bv[j];
+      }
+      break;
+    }
+    break;
+  }
+  case TERM_AND:
+    out.b = child(I, 0).b;
+    for (size_t k = 1; k < I.children_size; ++ k) {
+      const std::vector<char>& c = child(I, k).b;
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] &= c[j];
+      }
+    }
+    break;
+  case TERM_OR:
+    out.b = child(I, 0).b;
+    for (size_t k = 1; k < I.children_size; ++ k) {
+      const std::vector<char>& c = child(I, k).b;
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] |= c[j];
+      }
+    }
+    break;
+  case TERM_XOR:
+    out.b = child(I, 0).b;
+    for (size_t k = 1; k < I.children_size; ++ k) {
+      const std::vector<char>& c = child(I, k).b;
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] ^= c[j];
+      }
+    }
+    break;
+  case TERM_NOT: {
+    const std::vector<char>& c = child(I, 0).b;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = !c[j];
+    }
+    break;
+  }
+  case TERM_IMPLIES: {
+    const std::vector<char>& a = child(I, 0).b;
+    const std::vector<char>& b = child(I, 1).b;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = (!a[j]) | b[j];
+    }
+    break;
+  }
+  case TERM_ADD:
+    out.q = child(I, 0).q;
+    for (size_t k = 1; k < I.children_size; ++ k) {
+      const std::vector<rational>& c = child(I, k).q;
+      for (size_t j = 0; j < n; ++ j) {
+        out.q[j] += c[j];
+      }
+    }
+    break;
+  case TERM_SUB:
+    if (I.children_size == 1) {
+      const std::vector<rational>& c = child(I, 0).q;
+      for (size_t j = 0; j < n; ++ j) {
+        out.q[j] = -c[j];
+      }
+    } else {
+      const std::vector<rational>& a = child(I, 0).q;
+      const std::vector<rational>& b = child(I, 1).q;
+      for (size_t j = 0; j < n; ++ j) {
+        out.q[j] = a[j] - b[j];
+      }
+    }
+    break;
+  case TERM_MUL:
+    out.q = child(I, 0).q;
+    for (size_t k = 1; k < I.children_size; ++ k) {
+      const std::vector<rational>& c = child(I, k).q;
+      for (size_t j = 0; j < n; ++ j) {
+        out.q[j] *= c[j];
+      }
+    }
+    break;
+  case TERM_DIV: {
+    // Same as the term evaluator for division by 0
+    const std::vector<rational>& a = child(I, 0).q;
+    const std::vector<rational>& b = child(I, 1).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.q[j] = term_evaluator::div(a[j], b[j]);
+    }
+    break;
+  }
+  case TERM_LEQ: {
+    const std::vector<rational>& a = child(I, 0).q;
+    const std::vector<rational>& b = child(I, 1).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = a[j] <= b[j];
+    }
+    break;
+  }
+  case TERM_LT: {
+    const std::vector<rational>& a = child(I, 0).q;
+    const std::vector<rational>& b = child(I, 1).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = a[j] < b[j];
+    }
+    break;
+  }
+  case TERM_GEQ: {
+    const std::vector<rational>& a = child(I, 0).q;
+    const std::vector<rational>& b = child(I, 1).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = b[j] <= a[j];
+    }
+    break;
+  }
+  case TERM_GT: {
+    const std::vector<rational>& a = child(I, 0).q;
+    const std::vector<rational>& b = child(I, 1).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = b[j] < a[j];
+    }
+    break;
+  }
+  case TERM_TO_INT: {
+    const std::vector<rational>& c = child(I, 0).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.q[j] = c[j].floor();
+    }
+    break;
+  }
+  case TERM_TO_REAL:
+    out.q = child(I, 0).q;
+    break;
+  case TERM_IS_INT: {
+    const std::vector<rational>& c = child(I, 0).q;
+    for (size_t j = 0; j < n; ++ j) {
+      out.b[j] = c[j].is_integer();
+    }
+    break;
+  }
+  case TERM_BV_NOT: {
+    const std::vector<bitvector>& c = child(I, 0).bv;
+    for (size_t j = 0; j < n; ++ j) {
+      out.bv[j] = c[j].bvnot();
+    }
+    break;
+  }
+  case TERM_BV_EXTRACT: {
+    bitvector_extract extract = d_tm.get_bitvector_extract(d_tm.term_of(I.t));
+    const std::vector<bitvector>& c = child(I, 0).bv;
+    for (size_t j = 0; j < n; ++ j) {
+      out.bv[j] = c[j].extract(extract.low, extract.high);
+    }
+    break;
+  }
+  default:
+    if (I.op == TERM_BV_SUB && I.children_size == 1) {
+      const std::vector<bitvector>& c = child(I, 0).bv;
+      for (size_t j = 0; j < n; ++ j) {
+        out.bv[j] = c[j].neg();
+      }
+    } else if (bv_operation op = get_bv_operation(I.op)) {
+      // Binary, or folded from the left
+      out.bv = child(I, 0).bv;
+      for (size_t k = 1; k < I.children_size; ++ k) {
+        const std::vector<bitvector>& c = child(I, k).bv;
+        for (size_t j = 0; j < n; ++ j) {
+          out.bv[j] = (out.bv[j].*op)(c[j]);
+        }
+      }
+    } else if (bv_predicate p = get_bv_predicate(I.op)) {
+      const std::vector<bitvector>& a = child(I, 0).bv;
+      const std::vector<bitvector>& b = child(I, 1).bv;
+      for (size_t j = 0; j < n; ++ j) {
+        out.b[j] = (a[j].*p)(b[j]);
+      }
+    } else {
+      assert(false);
+    }
+  }
+}
+
+}
+}
@@ -0,0 +1,150 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "expr/term_manager.h"
+#include "expr/value.h"
+
+#include <vector>
+
+namespace sally {
+namespace sim {
+
+/**
+ * Values of a term in all the lanes (simulated traces), stored as a plain
+ * array of the term type. Booleans take a byte per lane.
+ */
+struct lanes {
+
+  enum kind {
+    BOOL,
+    RATIONAL,
+    BITVECTOR
+  };
+
+  /** Type of the values */
+  kind k;
+
+  /** Boolean values (if BOOL) */
+  std::vector<char> b;
+
+  /** Arithmetic values (if RATIONAL) */
+  std::vector<expr::rational> q;
+
+  /** Bit-vector values (if BITVECTOR) */
+  std::vector<expr::bitvector> bv;
+
+  lanes(): k(BOOL) {}
+
+  /** Resize to n lanes */
+  void resize(size_t n);
+
+  /** Get the value in lane i */
+  expr::value get(size_t i) const;
+
+  /** Set the value in lane i */
+  void set(size_t i, const expr::value& v);
+
+  /** Copy lane i of other into lane j */
+  void copy(size_t j, const lanes& other, size_t i);
+};
+
+/**
+ * Evaluator of several terms over many assignments at once. The terms are
+ * compiled into a single topologically ordered instruction array, as in
+ * expr::term_evaluator, but every slot holds the values of all lanes, so
+ * each instruction is a tight loop over the lanes. The variables are given
+ * upfront and their lanes are set directly by the user.
+ */
+class batch_evaluator {
+
+  /** A single evaluation step, the result goes to the slot of the same index */
+  struct instruction {
+    /** The term being evaluated */
+    expr::term_ref t;
+    /** The operation */
+    expr::term_op op;
+    /** Index of the first child slot in d_children */
+    size_t children_begin;
+    /** Number of children */
+    size_t children_size;
+
+    instruction(expr::term_ref t, expr::term_op op, size_t children_begin, size_t children_size)
+    : t(t), op(op), children_begin(children_begin), children_size(children_size)
+    {}
+  };
+
+  /** The term manager */
+  expr::term_manager& d_tm;
+
+  /** The instructions in topological order */
+  std::vector<instruction> d_instructions;
+
+  /** Slots of the children of the instructions */
+  std::vector<size_t> d_children;
+
+  /** Values of the instructions */
+  std::vector<lanes> d_values;
+
+  /** Values of the constants (null for other instructions) */
+  std::vector<expr::value> d_constants;
+
+  /** Slots of the roots */
+  std::vector<size_t> d_roots;
+
+  /** Instructions to execute for each root, in order */
+  std::vector< std::vector<size_t> > d_programs;
+
+  /** Number of lanes */
+  size_t d_size;
+
+  class compiler;
+  friend class compiler;
+
+  /** Get the k-th child of the instruction */
+  const lanes& child(const instruction& I, size_t k) const {
+    return d_values[d_children[I.children_begin + k]];
+  }
+
+  /** Execute the i-th instruction, assuming children are evaluated */
+  void execute(size_t i);
+
+public:
+
+  /**
+   * Compile the roots, over the given variables. Throws an exception if the
+   * roots contain other variables or unsupported operations.
+   */
+  batch_evaluator(expr::term_manager& tm, const std::vector<expr::term_ref>& vars, const std::vector<expr::term_ref>& roots);
+
+  /** Set the number of lanes */
+  void resize(size_t n);
+
+  /** Number of lanes */
+  size_t size() const { return d_size; }
+
+  /** Lanes of the i-th variable, to be set before evaluation */
+  lanes& variable(size_t i) { return d_values[i]; }
+
+  /** Evaluate the i-th root in all the lanes */
+  const lanes& evaluate(size_t i);
+};
+
+}
+}
@@ -0,0 +1,481 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine/sim/sim_engine.h"
+
+#include "system/state_type.h"
+#include "utils/exception.h"
+#include "utils/trace.h"
+#include "utils/budget.h"
+
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <sstream>
+
+namespace sally {
+namespace sim {
+
+/** Next random number of a lane (xorshift64*) */
+static boost::uint64_t next_random(boost::uint64_t& state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+/** Initial random state of a lane, so that a lane can be replayed alone (splitmix64) */
+static boost::uint64_t lane_seed(boost::uint64_t seed, boost::uint64_t round, boost::uint64_t lane) {
+  boost::uint64_t z = (seed << 40) ^ (round << 20) ^ lane;
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  // Xorshift state can't be 0
+  return z ? z : 1;
+}
+
+sim_engine::sim_engine(const system::context& ctx)
+: engine(ctx)
+, d_trace(0)
+, d_state_size(0)
+, d_input_size(0)
+{
+  d_stats.traces = new utils::stat_int("sim::traces", 0);
+  d_stats.steps = new utils::stat_int("sim::steps", 0);
+  ctx.get_statistics().add(new utils::stat_delimiter());
+  ctx.get_statistics().add(d_stats.traces);
+  ctx.get_statistics().add(d_stats.steps);
+}
+
+sim_engine::~sim_engine() {
+}
+
+sim_engine::definition sim_engine::mk_random(const std::vector<expr::term_ref>& conjuncts, size_t var) {
+
+  definition def(var, null_root);
+
+  // Collect the constant bounds var >= c, var <= c (possibly strict)
+  bool has_lower = false, has_upper = false;
+  expr::rational lower, upper;
+  for (size_t i = 0; i < conjuncts.size(); ++ i) {
+    const expr::term& c = tm().term_of(conjuncts[i]);
+    expr::term_op op = c.op();
+    if (op != expr::TERM_LEQ && op != expr::TERM_LT && op != expr::TERM_GEQ && op != expr::TERM_GT) {
+      continue;
+    }
+    // Normalize to var op constant
+    expr::term_ref constant;
+    if (c[0] == d_vars[var] && tm().term_of(c[1]).op() == expr::CONST_RATIONAL) {
+      constant = c[1];
+    } else if (c[1] == d_vars[var] && tm().term_of(c[0]).op() == expr::CONST_RATIONAL) {
+      constant = c[0];
+      switch (op) {
+      case expr::TERM_LEQ: op = expr::TERM_GEQ; break;
+      case expr::TERM_LT: op = expr::TERM_GT; break;
+      case expr::TERM_GEQ: op = expr::TERM_LEQ; break;
+      case expr::TERM_GT: op = expr::TERM_LT; break;
+      default: assert(false);
+      }
+    } else {
+      continue;
+    }
+    expr::rational q = tm().get_rational_constant(tm().term_of(constant));
+    switch (op) {
+    case expr::TERM_LEQ:
+    case expr::TERM_LT: {
+      expr::rational bound = q.floor();
+      if (op == expr::TERM_LT && bound == q) {
+        bound -= expr::rational(1, 1);
+      }
+      if (!has_upper || bound < upper) {
+        upper = bound;
+      }
+      has_upper = true;
+      break;
+    }
+    default: {
+      expr::rational bound = q.ceiling();
+      if (op == expr::TERM_GT && bound == q) {
+        bound += expr::rational(1, 1);
+      }
+      if (!has_lower || lower < bound) {
+        lower = bound;
+      }
+      has_lower = true;
+      break;
+    }
+    }
+  }
+
+  // Keep the range where the bounds are missing (or too big)
+  long range = ctx().get_options().get_unsigned("sim-range");
+  expr::rational max(LONG_MAX / 4, 1), min(-(LONG_MAX / 4), 1);
+  has_lower = has_lower && min <= lower && lower <= max;
+  has_upper = has_upper && min <= upper && upper <= max;
+  if (has_lower && has_upper && upper < lower) {
+    // Empty, we'll let the evaluation reject it
+    has_upper = false;
+  }
+  def.lower = has_lower ? lower.get_numerator().get_signed() : (has_upper ? upper.get_numerator().get_signed() - 2 * range : -range);
+  def.upper = has_upper ? upper.get_numerator().get_signed() : def.lower + 2 * range;
+  def.real = tm().type_of(d_vars[var]) == tm().real_type();
+
+  return def;
+}
+
+void sim_engine::add_definitions(const std::vector<expr::term_ref>& conjuncts, size_t begin, size_t end, std::set<expr::term_ref>& known, std::vector<definition>& out) {
+
+  // Candidate definitions x = e, from (= x e), (= e x), x and (not x)
+  std::vector< std::pair<expr::term_ref, expr::term_ref> > candidates;
+  for (size_t i = 0; i < conjuncts.size(); ++ i) {
+    expr::term_ref c = conjuncts[i];
+    const expr::term& c_term = tm().term_of(c);
+    switch (c_term.op()) {
+    case expr::VARIABLE:
+      candidates.push_back(std::make_pair(c, tm().mk_boolean_constant(true)));
+      break;
+    case expr::TERM_NOT:
+      if (tm().term_of(c_term[0]).op() == expr::VARIABLE) {
+        candidates.push_back(std::make_pair(c_term[0], tm().mk_boolean_constant(false)));
+      }
+      break;
+    case expr::TERM_EQ:
+      if (tm().term_of(c_term[0]).op() == expr::VARIABLE) {
+        candidates.push_back(std::make_pair(c_term[0], c_term[1]));
+      }
+      if (tm().term_of(c_term[1]).op() == expr::VARIABLE) {
+        candidates.push_back(std::make_pair(c_term[1], c_term[0]));
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // Variables of the candidate definitions
+  std::vector< std::vector<expr::term_ref> > candidate_vars(candidates.size());
+  for (size_t i = 0; i < candidates.size(); ++ i) {
+    tm().get_variables(candidates[i].second, candidate_vars[i]);
+  }
+
+  // Define the variables in order: use a definition if it only depends on
+  // known variables, otherwise pick a variable to be random and retry
+  std::vector<bool> defined(end - begin, false);
+  for (size_t remaining = end - begin; remaining > 0; -- remaining) {
+    bool found = false;
+    for (size_t i = 0; !found && i < candidates.size(); ++ i) {
+      for (size_t var = begin; !found && var < end; ++ var) {
+        if (defined[var - begin] || d_vars[var] != candidates[i].first) {
+          continue;
+        }
+        bool ready = true;
+        for (size_t k = 0; ready && k < candidate_vars[i].size(); ++ k) {
+          ready = known.count(candidate_vars[i][k]) > 0;
+        }
+        if (ready) {
+          out.push_back(definition(var, d_roots.size()));
+          d_roots.push_back(candidates[i].second);
+          defined[var - begin] = true;
+          known.insert(d_vars[var]);
+          found = true;
+        }
+      }
+    }
+    if (found) {
+      continue;
+    }
+    // Make a variable random, preferring the ones with no definitions at all
+    size_t random = end;
+    for (size_t var = begin; var < end; ++ var) {
+      if (!defined[var - begin]) {
+        bool has_candidate = false;
+        for (size_t i = 0; !has_candidate && i < candidates.size(); ++ i) {
+          has_candidate = d_vars[var] == candidates[i].first;
+        }
+        if (random == end || !has_candidate) {
+          random = var;
+        }
+        if (!has_candidate) {
+          break;
+        }
+      }
+    }
+    out.push_back(mk_random(conjuncts, random));
+    defined[random - begin] = true;
+    known.insert(d_vars[random]);
+  }
+}
+
+void sim_engine::assign_random(batch_evaluator& eval, const definition& def, std::vector<boost::uint64_t>& rng) {
+  lanes& x = eval.variable(def.var);
+  long den = def.real ? 2 : 1;
+  boost::uint64_t range = den * (def.upper - def.lower) + 1;
+  for (size_t j = 0; j < rng.size(); ++ j) {
+    switch (x.k) {
+    case lanes::BOOL:
+      x.b[j] = next_random(rng[j]) >> 63;
+      break;
+    case lanes::RATIONAL:
+      x.q[j] = expr::rational(den * def.lower + (long) (next_random(rng[j]) % range), den);
+      break;
+    case lanes::BITVECTOR: {
+      // Put together from 32 bit chunks
+      size_t size = d_bv_sizes[def.var];
+      size_t chunk = size % 32 ? size % 32 : 32;
+      expr::bitvector bv(chunk, (long) (next_random(rng[j]) >> 32));
+      for (size = size - chunk; size > 0; size -= 32) {
+        bv = bv.concat(expr::bitvector(32, (long) (next_random(rng[j]) >> 32)));
+      }
+      x.bv[j] = bv;
+      break;
+    }
+    }
+  }
+}
+
+void sim_engine::assign(batch_evaluator& eval, const std::vector<definition>& defs, std::vector<boost::uint64_t>& rng) {
+  for (size_t i = 0; i < defs.size(); ++ i) {
+    if (defs[i].root == null_root) {
+      assign_random(eval, defs[i], rng);
+    } else {
+      const lanes& value = eval.evaluate(defs[i].root);
+      lanes& x = eval.variable(defs[i].var);
+      assert(x.k == value.k);
+      x = value;
+    }
+  }
+}
+
+bool sim_engine::simulate(batch_evaluator& eval, std::vector<boost::uint64_t>& rng, size_t depth, size_t& cex_lane, size_t& cex_step, expr::model::ref m) {
+
+  size_t n = rng.size();
+  eval.resize(n);
+
+  // Next states picked in each lane
+  std::vector<lanes> next(d_state_size);
+  std::vector<size_t> enabled(n);
+
+  // Initial states, lanes that don't satisfy them are dead
+  assign(eval, d_initial_states, rng);
+  std::vector<char> alive = eval.evaluate(0).b;
+  size_t alive_count = 0;
+  for (size_t j = 0; j < n; ++ j) {
+    alive_count += alive[j];
+  }
+
+  for (size_t k = 0; alive_count > 0; ++ k) {
+
+    // Stop here if we've been interrupted (e.g. in a portfolio) or ran out of budget
+    utils::budget::interruption_point();
+
+    if (m) {
+      const std::vector<expr::term_ref>& x = d_trace->get_state_variables(k);
+      for (size_t i = 0; i < d_state_size; ++ i) {
+        m->set_variable_value(x[i], eval.variable(i).get(0));
+      }
+    }
+
+    // Check the property
+    const std::vector<char>& property = eval.evaluate(1).b;
+    for (size_t j = 0; j < n; ++ j) {
+      if (alive[j] && !property[j]) {
+        cex_lane = j;
+        cex_step = k;
+        return true;
+      }
+    }
+
+    if (k == depth) {
+      break;
+    }
+
+    // Random inputs
+    assign(eval, d_inputs, rng);
+    if (m) {
+      const std::vector<expr::term_ref>& input = d_trace->get_input_variables(k);
+      for (size_t i = 0; i < d_input_size; ++ i) {
+        m->set_variable_value(input[i], eval.variable(d_state_size + i).get(0));
+      }
+    }
+
+    // Try all the branches, each lane keeps a random enabled one (dead
+    // lanes keep the current state, so that all values stay well-formed)
+    for (size_t i = 0; i < d_state_size; ++ i) {
+      next[i] = eval.variable(i);
+    }
+    enabled.assign(n, 0);
+    for (size_t b = 0; b < d_branches.size(); ++ b) {
+      assign(eval, d_branches[b], rng);
+      const std::vector<char>& transition = eval.evaluate(2).b;
+      for (size_t j = 0; j < n; ++ j) {
+        if (alive[j] && transition[j] && next_random(rng[j]) % (++ enabled[j]) == 0) {
+          for (size_t i = 0; i < d_state_size; ++ i) {
+            next[i].copy(j, eval.variable(d_state_size + d_input_size + i), j);
+          }
+        }
+      }
+    }
+
+    // Move to the next states
+    for (size_t j = 0; j < n; ++ j) {
+      if (alive[j] && enabled[j] == 0) {
+        alive[j] = false;
+        alive_count --;
+      }
+    }
+    for (size_t i = 0; i < d_state_size; ++ i) {
+      std::swap(eval.variable(i), next[i]);
+    }
+
+    d_stats.steps->get_value() += alive_count;
+  }
+
+  return false;
+}
+
+engine::result sim_engine::query(const system::transition_system* ts, const system::state_formula* sf) {
+
+  // The trace we are building
+  d_trace = ts->get_trace_helper();
+  d_trace->clear_model();
+
+  // Variables of the evaluator are the current, input and next variables
+  const system::state_type* state_type = ts->get_state_type();
+  const std::vector<expr::term_ref>& x = state_type->get_variables(system::state_type::STATE_CURRENT);
+  const std::vector<expr::term_ref>& input = state_type->get_variables(system::state_type::STATE_INPUT);
+  const std::vector<expr::term_ref>& x_next = state_type->get_variables(system::state_type::STATE_NEXT);
+  d_state_size = x.size();
+  d_input_size = input.size();
+  d_vars.clear();
+  d_vars.insert(d_vars.end(), x.begin(), x.end());
+  d_vars.insert(d_vars.end(), input.begin(), input.end());
+  d_vars.insert(d_vars.end(), x_next.begin(), x_next.end());
+  d_bv_sizes.clear();
+  for (size_t i = 0; i < d_vars.size(); ++ i) {
+    expr::term_ref type = tm().type_of(d_vars[i]);
+    d_bv_sizes.push_back(tm().term_of(type).op() == expr::TYPE_BITVECTOR ? tm().get_bitvector_type_size(type) : 0);
+  }
+
+  // The formulas
+  expr::term_ref initial_states = ts->get_initial_states();
+  expr::term_ref transition = ts->get_transition_relation();
+  d_roots.clear();
+  d_roots.push_back(initial_states);
+  d_roots.push_back(sf->get_formula());
+  d_roots.push_back(transition);
+
+  // Definitions of the initial states
+  std::set<expr::term_ref> known;
+  std::vector<expr::term_ref> conjuncts;
+  tm().get_conjuncts(initial_states, conjuncts);
+  d_initial_states.clear();
+  add_definitions(conjuncts, 0, d_state_size, known, d_initial_states);
+
+  // Branches of the transition relation, on a top-level disjunction
+  conjuncts.clear();
+  tm().get_conjuncts(transition, conjuncts);
+  std::vector< std::vector<expr::term_ref> > branches;
+  size_t disjunction = 0, disjunctions = 0;
+  for (size_t i = 0; i < conjuncts.size(); ++ i) {
+    if (tm().term_of(conjuncts[i]).op() == expr::TERM_OR) {
+      disjunction = i;
+      disjunctions ++;
+    }
+  }
+  // Inputs are picked before the branches, so only common bounds apply
+  d_inputs.clear();
+  for (size_t i = 0; i < d_input_size; ++ i) {
+    d_inputs.push_back(mk_random(conjuncts, d_state_size + i));
+  }
+
+  if (disjunctions == 1) {
+    std::set<expr::term_ref> disjuncts;
+    tm().get_disjuncts(conjuncts[disjunction], disjuncts);
+    std::set<expr::term_ref>::const_iterator it = disjuncts.begin();
+    for (; it != disjuncts.end(); ++ it) {
+      branches.push_back(std::vector<expr::term_ref>());
+      for (size_t i = 0; i < conjuncts.size(); ++ i) {
+        if (i != disjunction) {
+          branches.back().push_back(conjuncts[i]);
+        }
+      }
+      tm().get_conjuncts(*it, branches.back());
+    }
+  } else {
+    branches.push_back(conjuncts);
+  }
+  d_branches.clear();
+  d_branches.resize(branches.size());
+  for (size_t b = 0; b < branches.size(); ++ b) {
+    known.clear();
+    known.insert(x.begin(), x.end());
+    known.insert(input.begin(), input.end());
+    add_definitions(branches[b], d_state_size + d_input_size, d_vars.size(), known, d_branches[b]);
+  }
+
+  // Compile everything
+  batch_evaluator eval(tm(), d_vars, d_roots);
+
+  MSG(1) << "sim: " << d_branches.size() << " branches" << std::endl;
+
+  size_t traces = ctx().get_options().get_unsigned("sim-traces");
+  size_t depth = ctx().get_options().get_unsigned("sim-depth");
+  size_t rounds = ctx().get_options().get_unsigned("sim-rounds");
+  size_t seed = ctx().get_options().get_unsigned("sim-seed");
+
+  std::vector<boost::uint64_t> rng(traces);
+  for (size_t round = 0; round < rounds; ++ round) {
+
+    MSG(1) << "sim: round " << round << std::endl;
+
+    for (size_t j = 0; j < traces; ++ j) {
+      rng[j] = lane_seed(seed, round, j);
+    }
+    d_stats.traces->get_value() += traces;
+
+    size_t cex_lane = 0, cex_step = 0;
+    if (simulate(eval, rng, depth, cex_lane, cex_step, expr::model::ref())) {
+
+      MSG(1) << "sim: trace " << cex_lane << " falsifies the property at step " << cex_step << std::endl;
+
+      // Replay the lane alone to get the counter-example
+      expr::model::ref m = new expr::model(tm(), true);
+      std::vector<boost::uint64_t> replay(1, lane_seed(seed, round, cex_lane));
+      size_t replay_lane = 0, replay_step = 0;
+      bool falsified = simulate(eval, replay, cex_step, replay_lane, replay_step, m);
+      assert(falsified && replay_step == cex_step);
+      (void) falsified;
+      d_trace->set_model(m, 0, cex_step);
+      return INVALID;
+    }
+  }
+
+  return UNKNOWN;
+}
+
+const system::trace_helper* sim_engine::get_trace() {
+  return d_trace;
+}
+
+engine::invariant sim_engine::get_invariant() {
+  throw exception("Not supported.");
+}
+
+}
+}
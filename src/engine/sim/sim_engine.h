@@ -0,0 +1,139 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "engine/engine.h"
+#include "engine/sim/batch_evaluator.h"
+#include "system/context.h"
+#include "system/trace_helper.h"
+#include "expr/term.h"
+#include "utils/statistics.h"
+
+#include <set>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace sally {
+namespace sim {
+
+/**
+ * Random simulation engine for fast falsification. Many traces (lanes) are
+ * simulated at once, by a batch evaluator over the initial states, the
+ * transition relation and the property. Initial and next states are built
+ * from the definitions (x = e) found in the formulas, and the variables
+ * without definitions, as well as the inputs, are sampled at random. A step
+ * is only taken if the transition relation holds, so the traces are real,
+ * and the first trace that falsifies the property is replayed alone to
+ * report the counter-example.
+ *
+ * The transition relation is split into branches on a top-level disjunction
+ * (e.g. guarded transitions), and each lane takes a random enabled branch.
+ * Lanes with no enabled branch (deadlock) stop until the next round.
+ */
+class sim_engine : public engine {
+
+  /** The trace we're building */
+  system::trace_helper* d_trace;
+
+  /** Number of state variables */
+  size_t d_state_size;
+
+  /** Number of input variables */
+  size_t d_input_size;
+
+  /** All the variables, current state, input, and next state */
+  std::vector<expr::term_ref> d_vars;
+
+  /** Sizes of the bit-vector variables (0 for other variables) */
+  std::vector<size_t> d_bv_sizes;
+
+  /** Roots of the evaluator: initial states, property, transition, definitions */
+  std::vector<expr::term_ref> d_roots;
+
+  /** Value of a variable: root of the evaluator, or random */
+  struct definition {
+    /** Index of the variable */
+    size_t var;
+    /** Index of the root defining it, or random if null_root */
+    size_t root;
+    /** Range of random integer and real values */
+    long lower, upper;
+    /** Random real values also take the halves in the range */
+    bool real;
+
+    definition(size_t var, size_t root)
+    : var(var), root(root), lower(0), upper(0), real(false) {}
+  };
+
+  /** Root index for random values */
+  static const size_t null_root = (size_t) -1;
+
+  /** Definitions of the initial state */
+  std::vector<definition> d_initial_states;
+
+  /** Definitions of the next state, per branch of the transition relation */
+  std::vector< std::vector<definition> > d_branches;
+
+  /** Random inputs */
+  std::vector<definition> d_inputs;
+
+  /** Make a random definition of var, in the range of constant bounds from the conjuncts */
+  definition mk_random(const std::vector<expr::term_ref>& conjuncts, size_t var);
+
+  /** Add definitions of the variables [begin, end) from the conjuncts, assuming known */
+  void add_definitions(const std::vector<expr::term_ref>& conjuncts, size_t begin, size_t end, std::set<expr::term_ref>& known, std::vector<definition>& out);
+
+  /** Set the variable values of the definitions in all lanes */
+  void assign(batch_evaluator& eval, const std::vector<definition>& defs, std::vector<boost::uint64_t>& rng);
+
+  /** Set the variable to random values in all lanes */
+  void assign_random(batch_evaluator& eval, const definition& def, std::vector<boost::uint64_t>& rng);
+
+  /**
+   * Simulate the lanes (one per random generator) up to depth steps. Returns
+   * true if the property is falsified, with the first lane and the step. If
+   * m is not null, the trace of lane 0 is recorded in m.
+   */
+  bool simulate(batch_evaluator& eval, std::vector<boost::uint64_t>& rng, size_t depth, size_t& cex_lane, size_t& cex_step, expr::model::ref m);
+
+  struct stats {
+    utils::stat_int* traces;
+    utils::stat_int* steps;
+  } d_stats;
+
+public:
+
+  sim_engine(const system::context& ctx);
+  ~sim_engine();
+
+  /** Query */
+  result query(const system::transition_system* ts, const system::state_formula* sf);
+
+  /** Trace */
+  const system::trace_helper* get_trace();
+
+  /** Invariant (not supported) */
+  invariant get_invariant();
+
+  /** Nothing to collect */
+  void gc_collect(const expr::gc_relocator& gc_reloc) {}
+};
+
+}
+}
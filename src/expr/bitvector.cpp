@@ -27,70 +27,124 @@ namespace expr {
 
 bitvector::bitvector(size_t size)
 : d_size(size)
+, d_bits(0)
 {
   assert(size > 0);
 }
 
+void bitvector::truncate() {
+  if (is_narrow()) {
+    d_bits &= mask(d_size);
+  } else if (is_small()) {
+    // Non-negative small values have at most 63 bits, and we're wider
+  } else if (mpz_sizeinbase(d_gmp_int->get_mpz_t(), 2) > d_size) {
+    mpz_fdiv_r_2exp(d_gmp_int->get_mpz_t(), d_gmp_int->get_mpz_t(), d_size);
+    shrink();
+  }
+}
+
+integer bitvector::to_integer() const {
+  if (is_narrow()) {
+    if (d_bits <= (uint64_t) LONG_MAX) {
+      return integer((long) d_bits);
+    }
+    return integer(mpz_class((unsigned long) d_bits));
+  }
+  return *this;
+}
+
+mpz_class bitvector::mpz() const {
+  if (is_narrow()) {
+    return mpz_class((unsigned long) d_bits);
+  }
+  return integer::mpz();
+}
+
 bitvector::bitvector(const bitvector& other)
 : integer(other)
 , d_size(other.d_size)
+, d_bits(other.d_bits)
 {
 }
 
 /** Construct from integer */
 bitvector::bitvector(size_t size, const integer& z)
-: integer(z)
-, d_size(size)
+: d_size(size)
+, d_bits(0)
 {
   assert(size > 0);
   assert(z.sgn() >= 0);
-  if (mpz_sizeinbase(d_gmp_int.get_mpz_t(), 2) > size) {
-    mpz_fdiv_r_2exp(d_gmp_int.get_mpz_t(), d_gmp_int.get_mpz_t(), size);
+  if (is_narrow()) {
+    // Low 64 bits of the non-negative integer
+    d_bits = z.get_unsigned();
+  } else {
+    integer::operator = (z);
   }
+  truncate();
 }
 
 bitvector::bitvector(size_t size, long x)
-: integer(x)
-, d_size(size)
+: d_size(size)
+, d_bits(0)
 {
   assert(size > 0);
   assert(x >= 0);
-  if (mpz_sizeinbase(d_gmp_int.get_mpz_t(), 2) > size) {
-    mpz_fdiv_r_2exp(d_gmp_int.get_mpz_t(), d_gmp_int.get_mpz_t(), size);
+  if (is_narrow()) {
+    d_bits = x;
+  } else {
+    integer::operator = (integer(x));
   }
+  truncate();
 }
 
 bitvector bitvector::one(size_t size) {
   assert(size > 0);
+  if (size <= 64) {
+    bitvector result(size);
+    result.d_bits = mask(size);
+    return result;
+  }
   return bitvector(size, integer((mpz_class(1) << size) - 1));
 }
 
 size_t bitvector::hash() const {
   utils::sequence_hash hasher;
-  hasher.add(d_gmp_int.get_ui());
+  hasher.add(is_narrow() ? d_bits : get_unsigned());
   hasher.add(d_size);
   return hasher.get();
 }
 
 bitvector::bitvector(const char* bits)
-: integer(bits, 2)
-, d_size(strlen(bits))
+: d_size(strlen(bits))
+, d_bits(0)
 {
   assert(d_size > 0);
-  assert(sgn() >= 0);
-  if (mpz_sizeinbase(d_gmp_int.get_mpz_t(), 2) > d_size) {
-    mpz_fdiv_r_2exp(d_gmp_int.get_mpz_t(), d_gmp_int.get_mpz_t(), d_size);
+  if (is_narrow()) {
+    for (size_t i = 0; i < d_size; ++ i) {
+      assert(bits[i] == '0' || bits[i] == '1');
+      d_bits = (d_bits << 1) | (bits[i] == '1');
+    }
+  } else {
+    integer::operator = (integer(bits, 2));
+    assert(sgn() >= 0);
+    truncate();
   }
 }
 
 bitvector::bitvector(std::string bits)
-: integer(bits, 2)
-, d_size(bits.size())
+: d_size(bits.size())
+, d_bits(0)
 {
   assert(d_size > 0);
-  assert(sgn() >= 0);
-  if (mpz_sizeinbase(d_gmp_int.get_mpz_t(), 2) > d_size) {
-    mpz_fdiv_r_2exp(d_gmp_int.get_mpz_t(), d_gmp_int.get_mpz_t(), d_size);
+  if (is_narrow()) {
+    for (size_t i = 0; i < d_size; ++ i) {
+      assert(bits[i] == '0' || bits[i] == '1');
+      d_bits = (d_bits << 1) | (bits[i] == '1');
+    }
+  } else {
+    integer::operator = (integer(bits, 2));
+    assert(sgn() >= 0);
+    truncate();
   }
 }
 
@@ -101,12 +155,16 @@ void bitvector::to_stream(std::ostream& out) const {
   case output::HORN:
   {
     out << "(_ bv";
-    integer::to_stream(out);
+    if (is_narrow()) {
+      out << d_bits;
+    } else {
+      integer::to_stream(out);
+    }
     out  << " " << size() << ")";
     break;
   }
   case output::NUXMV:
-    out << "0d" << d_size << d_gmp_int.get_str();
+    out << "0d" << d_size << mpz().get_str();
     break;
   default:
     assert(false);
@@ -140,32 +198,61 @@ std::ostream& operator << (std::ostream& out, const bitvector& bv) {
 
 bitvector& bitvector::set_bit(size_t i, bool value) {
   assert(i < d_size);
-  if (value) {
-    mpz_setbit(d_gmp_int.get_mpz_t(), i);
+  if (is_narrow()) {
+    if (value) {
+      d_bits |= ((uint64_t) 1) << i;
+    } else {
+      d_bits &= ~(((uint64_t) 1) << i);
+    }
+  } else if (is_small() && i < 63) {
+    if (value) {
+      d_small |= 1l << i;
+    } else {
+      d_small &= ~(1l << i);
+    }
   } else {
-    mpz_clrbit(d_gmp_int.get_mpz_t(), i);
+    if (value) {
+      mpz_setbit(gmp().get_mpz_t(), i);
+    } else {
+      mpz_clrbit(gmp().get_mpz_t(), i);
+    }
+    shrink();
   }
   return *this;
 }
 
 bool bitvector::get_bit(size_t i) const {
   assert(i < d_size);
-  return mpz_tstbit(d_gmp_int.get_mpz_t(), i);
+  if (is_narrow()) {
+    return (d_bits >> i) & 1;
+  }
+  if (is_small()) {
+    return i < 63 && ((d_small >> i) & 1);
+  }
+  return mpz_tstbit(d_gmp_int->get_mpz_t(), i);
 }
 
 integer bitvector::get_signed() const {
-  if (mpz_sizeinbase(d_gmp_int.get_mpz_t(), 2) == d_size) {
-    // The subtraction is integer here
-    return bitvector(d_size-1, d_gmp_int) - bitvector(d_size).set_bit(d_size-1, true);
+  if (is_narrow()) {
+    return integer((long) signed_bits());
+  }
+  if (msb()) {
+    // Value - 2^size
+    return to_integer() - integer(2).pow(d_size);
   } else {
     // No first bit
-    return d_gmp_int;
+    return to_integer();
   }
 }
 
 bitvector bitvector::concat(const bitvector& rhs) const {
   size_t size = d_size + rhs.d_size;
-  integer value((d_gmp_int << rhs.d_size) + rhs.d_gmp_int);
+  if (size <= 64) {
+    bitvector result(size);
+    result.d_bits = (d_bits << rhs.d_size) | rhs.d_bits;
+    return result;
+  }
+  integer value((mpz() << rhs.d_size) + rhs.mpz());
   return bitvector(size, value);
 }
 
@@ -173,77 +260,115 @@ bitvector bitvector::extract(size_t low, size_t high) const {
   assert(low <= high);
   assert(high < d_size);
   size_t size = high-low+1;
-  integer value(d_gmp_int >> low);
+  if (is_narrow()) {
+    bitvector result(size);
+    result.d_bits = (d_bits >> low) & mask(size);
+    return result;
+  }
+  integer value(mpz() >> low);
   return bitvector(size, value);
 }
 
 bool bitvector::uleq(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return *this <= rhs;
+  if (is_narrow()) {
+    return d_bits <= rhs.d_bits;
+  }
+  return to_integer() <= rhs.to_integer();
 }
 
 bool bitvector::sleq(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
+  if (is_narrow()) {
+    return signed_bits() <= rhs.signed_bits();
+  }
   return get_signed() <= rhs.get_signed();
 }
 
 bool bitvector::ult(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return *this < rhs;
+  if (is_narrow()) {
+    return d_bits < rhs.d_bits;
+  }
+  return to_integer() < rhs.to_integer();
 }
 
 bool bitvector::slt(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
+  if (is_narrow()) {
+    return signed_bits() < rhs.signed_bits();
+  }
   return get_signed() < rhs.get_signed();
 }
 
 bool bitvector::ugeq(const bitvector& rhs) const {
-  assert(d_size == rhs.d_size);
-  return *this >= rhs;
+  return rhs.uleq(*this);
 }
 
 bool bitvector::sgeq(const bitvector& rhs) const {
-  assert(d_size == rhs.d_size);
-  return get_signed() >= rhs.get_signed();
+  return rhs.sleq(*this);
 }
 
 bool bitvector::ugt(const bitvector& rhs) const {
-  assert(d_size == rhs.d_size);
-  return *this > rhs;
+  return rhs.ult(*this);
 }
 
 bool bitvector::sgt(const bitvector& rhs) const {
-  assert(d_size == rhs.d_size);
-  return get_signed() > rhs.get_signed();
+  return rhs.slt(*this);
 }
 
 bitvector bitvector::add(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return bitvector(d_size, *this + rhs);
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = (d_bits + rhs.d_bits) & mask(d_size);
+    return result;
+  }
+  return bitvector(d_size, to_integer() + rhs.to_integer());
 }
 
 bitvector bitvector::sub(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = (d_bits - rhs.d_bits) & mask(d_size);
+    return result;
+  }
   // x + (-y)
   return add(rhs.neg());
 }
 
 bitvector bitvector::neg() const {
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = (0 - d_bits) & mask(d_size);
+    return result;
+  }
   return bvnot().add(bitvector(d_size, 1));
 }
 
 bitvector bitvector::mul(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return bitvector(d_size, *this * rhs);
+  if (is_narrow()) {
+    // Multiplication modulo 2^64 is correct modulo 2^size
+    bitvector result(d_size);
+    result.d_bits = (d_bits * rhs.d_bits) & mask(d_size);
+    return result;
+  }
+  return bitvector(d_size, to_integer() * rhs.to_integer());
 }
 
 bitvector bitvector::udiv(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
   // unsigned division, truncating towards 0. x/0 = 1...1
-  if (rhs.sgn() == 0) {
+  if (rhs.is_zero()) {
     return one(d_size);
+  } else if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = d_bits / rhs.d_bits;
+    return result;
   } else {
-    return bitvector(d_size, integer(d_gmp_int / rhs.d_gmp_int));
+    return bitvector(d_size, integer(mpz() / rhs.mpz()));
   }
 }
 
@@ -277,13 +402,16 @@ bitvector bitvector::sdiv(const bitvector& rhs) const {
 bitvector bitvector::urem(const bitvector& rhs) const {
   // unsigned remainder from truncating division. x = 1...1*0 + y = rem = x
   assert(d_size == rhs.d_size);
-  if (rhs.sgn() == 0) {
+  if (rhs.is_zero()) {
     return *this;
+  } else if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = d_bits % rhs.d_bits;
+    return result;
   } else {
-    return bitvector(d_size, integer(d_gmp_int % rhs.d_gmp_int));
+    return bitvector(d_size, integer(mpz() % rhs.mpz()));
   }
 }
-
 bitvector bitvector::srem(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
 //  (bvsrem s t) abbreviates
@@ -332,14 +460,14 @@ bitvector bitvector::smod(const bitvector& rhs) const {
   // get absolute value
   bitvector abs(*this), rhs_abs(rhs);
   if (msb()) {
-    abs.neg();
+    abs = abs.neg();
   }
   if (rhs.msb()) {
-    rhs.neg();
+    rhs_abs = rhs_abs.neg();
   }
 
-  bitvector u = abs.udiv(rhs_abs);
-  if (u == bitvector(d_size)) {
+  bitvector u = abs.urem(rhs_abs);
+  if (u.is_zero()) {
     return u;
   } else {
     if (msb()) {
@@ -360,37 +488,58 @@ bitvector bitvector::smod(const bitvector& rhs) const {
 
 bitvector bitvector::shl(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  if (rhs.d_gmp_int >= d_size) {
+  if (is_narrow()) {
+    bitvector result(d_size);
+    if (rhs.d_bits < d_size) {
+      result.d_bits = (d_bits << rhs.d_bits) & mask(d_size);
+    }
+    return result;
+  }
+  if (rhs.cmp(integer((long) d_size)) >= 0) {
     // shift more than size => 0
     return bitvector(d_size);
   } else {
     // concat shift size of zeroes to the right
     size_t shift_size = rhs.get_unsigned();
     if (shift_size == 0) {
-      return rhs;
+      return *this;
     }
-    return bitvector(d_size, concat(bitvector(shift_size)));
+    return bitvector(d_size, concat(bitvector(shift_size)).to_integer());
   }
 }
 
 bitvector bitvector::lshr(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  if (d_size <= rhs.d_gmp_int) {
+  if (is_narrow()) {
+    bitvector result(d_size);
+    if (rhs.d_bits < d_size) {
+      result.d_bits = d_bits >> rhs.d_bits;
+    }
+    return result;
+  }
+  if (rhs.cmp(integer((long) d_size)) >= 0) {
     // Shift more than size => 0
     return bitvector(d_size);
   } else {
     size_t shift_size = rhs.get_unsigned();
     if (shift_size == 0) {
-      return rhs;
+      return *this;
     }
     // concat shift size of zeroes to thje left
-    return bitvector(d_size, bitvector(shift_size).concat(extract(shift_size, d_size - 1)));
+    return bitvector(d_size, bitvector(shift_size).concat(extract(shift_size, d_size - 1)).to_integer());
   }
 }
 
 bitvector bitvector::ashr(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  if (d_size <= rhs.d_gmp_int) {
+  if (is_narrow()) {
+    // Arithmetic shift of the sign-extended bits
+    bitvector result(d_size);
+    size_t shift_size = rhs.d_bits < d_size ? rhs.d_bits : 63;
+    result.d_bits = (uint64_t)(signed_bits() >> shift_size) & mask(d_size);
+    return result;
+  }
+  if (rhs.cmp(integer((long) d_size)) >= 0) {
     // Shift more than size => 0 or 1 depending on top bit
     if (get_bit(d_size-1)) {
       return one(d_size);
@@ -400,7 +549,7 @@ bitvector bitvector::ashr(const bitvector& rhs) const {
   } else {
     size_t shift_size = rhs.get_unsigned();
     if (shift_size == 0) {
-      return rhs;
+      return *this;
     }
     // What to pad with
     bitvector pad(d_size);
@@ -408,26 +557,46 @@ bitvector bitvector::ashr(const bitvector& rhs) const {
       pad = one(d_size);
     }
     // concat shift size of zeroes to thje left
-    return bitvector(d_size, pad.concat(extract(shift_size, d_size - 1)));
+    return bitvector(d_size, pad.concat(extract(shift_size, d_size - 1)).to_integer());
   }
 }
 
 bitvector bitvector::bvxor(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return bitvector(d_size, integer(d_gmp_int ^ rhs.d_gmp_int));
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = d_bits ^ rhs.d_bits;
+    return result;
+  }
+  return bitvector(d_size, integer(mpz() ^ rhs.mpz()));
 }
 
 bitvector bitvector::bvand(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return bitvector(d_size, integer(d_gmp_int & rhs.d_gmp_int));
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = d_bits & rhs.d_bits;
+    return result;
+  }
+  return bitvector(d_size, integer(mpz() & rhs.mpz()));
 }
 
 bitvector bitvector::bvor(const bitvector& rhs) const {
   assert(d_size == rhs.d_size);
-  return bitvector(d_size, integer(d_gmp_int | rhs.d_gmp_int));
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = d_bits | rhs.d_bits;
+    return result;
+  }
+  return bitvector(d_size, integer(mpz() | rhs.mpz()));
 }
 
 bitvector bitvector::bvnot() const {
+  if (is_narrow()) {
+    bitvector result(d_size);
+    result.d_bits = ~d_bits & mask(d_size);
+    return result;
+  }
   return bvxor(one(d_size));
 }
 
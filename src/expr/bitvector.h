@@ -19,21 +19,53 @@
 #pragma once
 
 #include <iosfwd>
+#include <stdint.h>
 #include "expr/integer.h"
 #include "utils/hash.h"
 
 namespace sally {
 namespace expr {
 
+/**
+ * Bitvector of a given size. Bitvectors of up to 64 bits are kept in a
+ * machine word and use native operations, wider ones use the integer.
+ */
 class bitvector : protected integer {
 
   /** The size in bits */
   size_t d_size;
 
+  /** The bits, if narrow (the integer is unused) */
+  uint64_t d_bits;
+
+  /** Is the bitvector stored in d_bits */
+  bool is_narrow() const { return d_size <= 64; }
+
+  /** Mask of the given number of bits (at most 64) */
+  static uint64_t mask(size_t size) {
+    return size >= 64 ? ~(uint64_t)0 : (((uint64_t)1) << size) - 1;
+  }
+
+  /** Sign extension of the narrow bits to 64 bits */
+  int64_t signed_bits() const {
+    return msb() ? (int64_t)(d_bits | ~mask(d_size)) : (int64_t)d_bits;
+  }
+
+  /** Is the value 0 */
+  bool is_zero() const {
+    return is_narrow() ? d_bits == 0 : sgn() == 0;
+  }
+
+  /** Truncate the value to d_size bits */
+  void truncate();
+
+  /** The unsigned value as an integer */
+  integer to_integer() const;
+
 public:
 
   /** Construct 0 of size 1 */
-  bitvector(): d_size(1) {}
+  bitvector(): d_size(1), d_bits(0) {}
 
   /** Copy constructor */
   bitvector(const bitvector& other);
@@ -60,16 +92,14 @@ public:
   static bitvector one(size_t size);
 
   /** Get the integer */
-  const mpz_class& mpz() const {
-    return d_gmp_int;
-  }
+  mpz_class mpz() const;
 
   /** Hash */
   size_t hash() const;
 
   /** Compare */
   bool operator == (const bitvector& other) const {
-    return d_size == other.d_size && cmp(other) == 0;
+    return d_size == other.d_size && (is_narrow() ? d_bits == other.d_bits : cmp(other) == 0);
   }
 
   /** Output to stream */
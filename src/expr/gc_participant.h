@@ -48,6 +48,13 @@ public:
   /** Called for the participant to collect unused terms and reallocate used terms */
   virtual void gc_collect(const gc_relocator& gc_reloc) = 0;
 
+  /**
+   * Called when the term manager is destructed while the participant is
+   * still registered. The participant can't use the manager anymore, and can
+   * delete itself.
+   */
+  virtual void gc_tm_destroyed() {}
+
 };
 
 }
@@ -27,18 +27,89 @@
 namespace sally {
 namespace expr {
 
+void integer::set(mpz_srcptr z) {
+  if (mpz_fits_slong_p(z) && mpz_get_si(z) != long_min) {
+    // Get the value first, z might be our own
+    d_small = mpz_get_si(z);
+    delete d_gmp_int;
+    d_gmp_int = 0;
+  } else if (d_gmp_int) {
+    mpz_set(d_gmp_int->get_mpz_t(), z);
+  } else {
+    d_gmp_int = new mpz_class(z);
+  }
+}
+
+mpz_class& integer::gmp() {
+  if (!d_gmp_int) {
+    d_gmp_int = new mpz_class(d_small);
+  }
+  return *d_gmp_int;
+}
+
+void integer::shrink() {
+  if (d_gmp_int) {
+    set(d_gmp_int->get_mpz_t());
+  }
+}
+
+integer::integer(const char* s, size_t base)
+: d_small(0)
+, d_gmp_int(0)
+{
+  set(mpz_class(s, base).get_mpz_t());
+}
+
+integer::integer(std::string s, size_t base)
+: d_small(0)
+, d_gmp_int(0)
+{
+  set(mpz_class(s, base).get_mpz_t());
+}
+
 integer::integer(const rational& q, bool round_up)
-: d_gmp_int(0)
+: d_small(0)
+, d_gmp_int(0)
 {
+  if (q.is_small()) {
+    long num = q.d_num, den = q.d_den;
+    d_small = num / den;
+    if (num % den != 0) {
+      // Division truncates, adjust as mpz_fdiv_q/mpz_cdiv_q below
+      if (round_up && num < 0) {
+        d_small --;
+      }
+      if (!round_up && num > 0) {
+        d_small ++;
+      }
+    }
+    return;
+  }
+  mpz_class result;
+  mpq_class q_gmp = q.mpq();
   if (round_up) {
-    mpz_fdiv_q(d_gmp_int.get_mpz_t(),
-        q.mpq().get_num_mpz_t(),
-        q.mpq().get_den_mpz_t());
+    mpz_fdiv_q(result.get_mpz_t(),
+        q_gmp.get_num_mpz_t(),
+        q_gmp.get_den_mpz_t());
   } else {
-    mpz_cdiv_q(d_gmp_int.get_mpz_t(),
-        q.mpq().get_num_mpz_t(),
-        q.mpq().get_den_mpz_t());
+    mpz_cdiv_q(result.get_mpz_t(),
+        q_gmp.get_num_mpz_t(),
+        q_gmp.get_den_mpz_t());
+  }
+  set(result.get_mpz_t());
+}
+
+integer& integer::operator = (const integer& z) {
+  if (this != &z) {
+    if (z.d_gmp_int) {
+      set(z.d_gmp_int->get_mpz_t());
+    } else {
+      delete d_gmp_int;
+      d_gmp_int = 0;
+      d_small = z.d_small;
+    }
   }
+  return *this;
 }
 
 void integer::to_stream(std::ostream& out) const {
@@ -47,22 +118,34 @@ void integer::to_stream(std::ostream& out) const {
   case output::MCMT:
   case output::HORN:
   {
-    int sgn = mpz_sgn(d_gmp_int.get_mpz_t());
+    if (is_small()) {
+      if (d_small < 0) {
+        out << "(- " << -d_small << ")";
+      } else {
+        out << d_small;
+      }
+      break;
+    }
+    int sgn = mpz_sgn(d_gmp_int->get_mpz_t());
     if (sgn == 0) {
       out << "0";
     } else {
       if (sgn < 0) {
         // when printing gmp numerator skip the -, but wrap into (- )
-        out << "(- " << (d_gmp_int.get_str().c_str() + 1) << ")";
+        out << "(- " << (d_gmp_int->get_str().c_str() + 1) << ")";
       } else {
         // just regular print
-        out << d_gmp_int.get_str();
+        out << d_gmp_int->get_str();
       }
     }
     break;
   }
   case output::NUXMV:
-    out << d_gmp_int.get_str();
+    if (is_small()) {
+      out << d_small;
+    } else {
+      out << d_gmp_int->get_str();
+    }
     break;
   default:
     assert(false);
@@ -75,69 +158,93 @@ std::ostream& operator << (std::ostream& out, const integer& z) {
 }
 
 int integer::sgn() const {
-  return mpz_sgn(d_gmp_int.get_mpz_t());
+  if (is_small()) {
+    return (d_small > 0) - (d_small < 0);
+  }
+  return mpz_sgn(d_gmp_int->get_mpz_t());
 }
 
 unsigned long integer::get_unsigned() const {
-  return d_gmp_int.get_ui();
+  if (is_small()) {
+    // As mpz_get_ui, the absolute value
+    return d_small < 0 ? 0ul - (unsigned long) d_small : d_small;
+  }
+  return d_gmp_int->get_ui();
 }
 
 signed long integer::get_signed() const {
-  return d_gmp_int.get_si();
+  if (is_small()) {
+    return d_small;
+  }
+  return d_gmp_int->get_si();
+}
+
+int integer::cmp(const integer& other) const {
+  if (is_small() && other.is_small()) {
+    return (d_small > other.d_small) - (d_small < other.d_small);
+  }
+  return mpz_cmp(mpz().get_mpz_t(), other.mpz().get_mpz_t());
 }
 
 integer integer::operator + (const integer& other) const {
-  return integer(d_gmp_int + other.d_gmp_int);
+  long result;
+  if (is_small() && other.is_small() && add_small(d_small, other.d_small, result)) {
+    return integer(result);
+  }
+  return integer(mpz() + other.mpz());
 }
 
 integer& integer::operator += (const integer& other) {
-  d_gmp_int += other.d_gmp_int;
+  *this = *this + other;
   return *this;
 }
 
 integer integer::operator - () const {
-  return integer(-d_gmp_int);
+  if (is_small()) {
+    return integer(-d_small);
+  }
+  return integer(-*d_gmp_int);
 }
 
 integer integer::operator - (const integer& other) const {
-  return integer(d_gmp_int - other.d_gmp_int);
+  long result;
+  if (is_small() && other.is_small() && add_small(d_small, -other.d_small, result)) {
+    return integer(result);
+  }
+  return integer(mpz() - other.mpz());
 }
 
 integer& integer::operator -= (const integer& other) {
-  d_gmp_int -= other.d_gmp_int;
+  *this = *this - other;
   return *this;
 }
 
 integer integer::operator * (const integer& other) const {
-  return integer(d_gmp_int * other.d_gmp_int);
+  long result;
+  if (is_small() && other.is_small() && mul_small(d_small, other.d_small, result)) {
+    return integer(result);
+  }
+  return integer(mpz() * other.mpz());
 }
 
 integer& integer::operator *= (const integer& other) {
-  d_gmp_int *= other.d_gmp_int;
+  *this = *this * other;
   return *this;
 }
 
 integer integer::pow(unsigned long n) const {
+  if (is_small()) {
+    long result = 1;
+    unsigned long i = 0;
+    for (; i < n && mul_small(result, d_small, result); ++ i) {}
+    if (i == n) {
+      return integer(result);
+    }
+  }
   mpz_class result;
-  mpz_pow_ui(result.get_mpz_t(), d_gmp_int.get_mpz_t(), n);
+  mpz_pow_ui(result.get_mpz_t(), mpz().get_mpz_t(), n);
   return integer(result);
 }
 
-bool integer::operator < (const integer& other) const {
-  return d_gmp_int < other.d_gmp_int;
-}
-
-bool integer::operator <= (const integer& other) const {
-  return d_gmp_int <= other.d_gmp_int;
-}
-
-bool integer::operator > (const integer& other) const {
-  return d_gmp_int > other.d_gmp_int;
-}
-
-bool integer::operator >= (const integer& other) const {
-  return d_gmp_int >= other.d_gmp_int;
-}
-
 }
 }
@@ -20,6 +20,7 @@
 
 #include <iosfwd>
 #include <cstddef>
+#include <climits>
 #include <gmpxx.h>
 
 #include "utils/hash.h"
@@ -32,32 +33,61 @@ class term_manager;
 
 class rational;
 
+/**
+ * Arbitrary precision integer. Values that fit in a long are kept inline and
+ * GMP is only used (and allocated) when the value doesn't fit. The value is
+ * always kept in the small form when possible, so the representation is
+ * unique.
+ */
 class integer {
 
 protected:
 
-  /** Gmp object */
-  mpz_class d_gmp_int;
+  /** The value, if small (d_gmp_int is null) */
+  long d_small;
+
+  /** GMP object, only allocated if the value doesn't fit in d_small */
+  mpz_class* d_gmp_int;
+
+  /** Is the value in the small form */
+  bool is_small() const { return d_gmp_int == 0; }
+
+  /** Set the value from GMP */
+  void set(mpz_srcptr z);
+
+  /** Put the value in GMP form (for in-place GMP operations, call shrink() after) */
+  mpz_class& gmp();
+
+  /** Move back to the small form if the value fits */
+  void shrink();
+
+  /** Rationals construct from the small form */
+  friend class rational;
 
 public:
 
   /** Default construct a 0 */
-  integer(): d_gmp_int(0) {}
+  integer(): d_small(0), d_gmp_int(0) {}
   /** Copy construct */
-  integer(const integer& z): d_gmp_int(z.d_gmp_int) {}
+  integer(const integer& z): d_small(z.d_small), d_gmp_int(z.d_gmp_int ? new mpz_class(*z.d_gmp_int) : 0) {}
   /** Construct from GMP */
-  integer(const mpz_class& z) : d_gmp_int(z) {}
+  integer(const mpz_class& z) : d_small(0), d_gmp_int(0) { set(z.get_mpz_t()); }
   /** Construct from GMP */
-  integer(mpz_t z) : d_gmp_int(z) {}
+  integer(mpz_t z) : d_small(0), d_gmp_int(0) { set(z); }
   /** Construct from long */
-  integer(long z) : d_gmp_int(z) {}
+  integer(long z) : d_small(z), d_gmp_int(z == long_min ? new mpz_class(z) : 0) {}
   /** Construct from string representation */
-  integer(const char* s, size_t base): d_gmp_int(s, base) {}
+  integer(const char* s, size_t base);
   /** Construct from string representation */
-  integer(std::string s, size_t base): d_gmp_int(s, base) {}
+  integer(std::string s, size_t base);
   /** Construct from rational: round_up ? ceil : floor */
   integer(const rational& q, bool round_up = false);
 
+  ~integer() { delete d_gmp_int; }
+
+  /** Assignment */
+  integer& operator = (const integer& z);
+
   // Arithmetic
 
   integer operator + (const integer& other) const;
@@ -70,10 +100,10 @@ public:
   integer operator * (const integer& other) const;
   integer& operator *= (const integer& other);
 
-  bool operator < (const integer& other) const;
-  bool operator <= (const integer& other) const;
-  bool operator > (const integer& other) const;
-  bool operator >= (const integer& other) const;
+  bool operator < (const integer& other) const { return cmp(other) < 0; }
+  bool operator <= (const integer& other) const { return cmp(other) <= 0; }
+  bool operator > (const integer& other) const { return cmp(other) > 0; }
+  bool operator >= (const integer& other) const { return cmp(other) >= 0; }
 
   integer pow(unsigned long n) const;
 
@@ -87,10 +117,10 @@ public:
   signed long get_signed() const;
 
   /** Returns the hash of the integer */
-  size_t hash() const { return d_gmp_int.get_si(); }
+  size_t hash() const { return get_signed(); }
 
   /** Compare the two numbers */
-  int cmp(const integer& other) const { return mpz_cmp(d_gmp_int.get_mpz_t(), other.d_gmp_int.get_mpz_t()); }
+  int cmp(const integer& other) const;
 
   /** Compare */
   bool operator == (const integer& other) const { return cmp(other) == 0; }
@@ -98,8 +128,25 @@ public:
   /** Output ot stream */
   void to_stream(std::ostream& out) const;
 
-  const mpz_class& mpz() const {
-    return d_gmp_int;
+  /** Get the GMP value */
+  mpz_class mpz() const {
+    return d_gmp_int ? *d_gmp_int : mpz_class(d_small);
+  }
+
+  /**
+   * LONG_MIN is never kept in the small form, so that negation and absolute
+   * value of small values can't overflow.
+   */
+  static const long long_min = LONG_MIN;
+
+  /** Checked r = a + b on small values, returns false on overflow */
+  static bool add_small(long a, long b, long& r) {
+    return !__builtin_add_overflow(a, b, &r) && r != long_min;
+  }
+
+  /** Checked r = a * b on small values, returns false on overflow */
+  static bool mul_small(long a, long b, long& r) {
+    return !__builtin_mul_overflow(a, b, &r) && r != long_min;
   }
 };
 
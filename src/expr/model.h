@@ -115,9 +115,6 @@ private:
 
   /** False value */
   value d_false;
-
-  /** Actual computation */
-  value get_term_value_internal(expr::term_ref t, const expr::term_manager::substitution_map& var_renaming, term_to_value_map& cache) const;
 };
 
 std::ostream& operator << (std::ostream& out, const model& m);
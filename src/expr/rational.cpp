@@ -29,21 +29,139 @@
 namespace sally {
 namespace expr {
 
+namespace {
+
+/** Greatest common divisor of non-negative a and b */
+long gcd(long a, long b) {
+  while (b != 0) {
+    long r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+}
+
+void rational::set(long num, long den) {
+  assert(den != 0);
+  assert(num != integer::long_min && den != integer::long_min);
+  delete d_gmp_rat;
+  d_gmp_rat = 0;
+  if (den < 0) {
+    num = -num;
+    den = -den;
+  }
+  long g = gcd(num < 0 ? -num : num, den);
+  d_num = num / g;
+  d_den = den / g;
+}
+
+void rational::set(mpq_srcptr q) {
+  mpz_srcptr num = mpq_numref(q);
+  mpz_srcptr den = mpq_denref(q);
+  if (mpz_fits_slong_p(num) && mpz_fits_slong_p(den) && mpz_sgn(den) != 0) {
+    long num_si = mpz_get_si(num), den_si = mpz_get_si(den);
+    if (num_si != integer::long_min && den_si != integer::long_min) {
+      set(num_si, den_si);
+      return;
+    }
+  }
+  if (d_gmp_rat) {
+    mpq_set(d_gmp_rat->get_mpq_t(), q);
+  } else {
+    d_gmp_rat = new mpq_class(q);
+  }
+  d_gmp_rat->canonicalize();
+  // Canonicalization might make it small
+  if (mpz_fits_slong_p(d_gmp_rat->get_num_mpz_t()) && mpz_fits_slong_p(d_gmp_rat->get_den_mpz_t())) {
+    long num_si = mpz_get_si(d_gmp_rat->get_num_mpz_t()), den_si = mpz_get_si(d_gmp_rat->get_den_mpz_t());
+    if (num_si != integer::long_min && den_si != integer::long_min) {
+      set(num_si, den_si);
+    }
+  }
+}
+
+rational::rational(mpz_t gmp_z)
+: d_num(0), d_den(1), d_gmp_rat(0)
+{
+  if (mpz_fits_slong_p(gmp_z) && mpz_get_si(gmp_z) != integer::long_min) {
+    d_num = mpz_get_si(gmp_z);
+  } else {
+    d_gmp_rat = new mpq_class(mpz_class(gmp_z));
+  }
+}
+
+rational::rational(const integer& p, const integer& q)
+: d_num(0), d_den(1), d_gmp_rat(0)
+{
+  if (p.is_small() && q.is_small() && q.sgn() != 0) {
+    set(p.get_signed(), q.get_signed());
+  } else {
+    set(mpq_class(p.mpz(), q.mpz()).get_mpq_t());
+  }
+}
+
+rational::rational(long p, unsigned long q)
+: d_num(0), d_den(1), d_gmp_rat(0)
+{
+  if (p != integer::long_min && q != 0 && q <= (unsigned long) LONG_MAX) {
+    set(p, (long) q);
+  } else {
+    set(mpq_class(p, q).get_mpq_t());
+  }
+}
+
+rational::rational(std::string integer_part, std::string fractional_part)
+: d_num(0), d_den(1), d_gmp_rat(0)
+{
+  *this = rational(integer(integer_part + fractional_part, 10), integer(10).pow(fractional_part.size()));
+}
+
+rational& rational::operator = (const rational& q) {
+  if (this != &q) {
+    if (q.d_gmp_rat) {
+      set(q.d_gmp_rat->get_mpq_t());
+    } else {
+      delete d_gmp_rat;
+      d_gmp_rat = 0;
+      d_num = q.d_num;
+      d_den = q.d_den;
+    }
+  }
+  return *this;
+}
+
 size_t rational::hash() const {
   utils::sequence_hash hasher;
-  hasher.add(mpz_get_si(d_gmp_rat.get_den_mpz_t()));
-  hasher.add(mpz_get_si(d_gmp_rat.get_num_mpz_t()));
+  if (is_small()) {
+    hasher.add(d_den);
+    hasher.add(d_num);
+  } else {
+    hasher.add(mpz_get_si(d_gmp_rat->get_den_mpz_t()));
+    hasher.add(mpz_get_si(d_gmp_rat->get_num_mpz_t()));
+  }
   return hasher.get();
 }
 
+int rational::cmp(const rational& q) const {
+  if (is_small() && q.is_small()) {
+    long lhs = d_num, rhs = q.d_num;
+    // Denominators are positive so a/b < c/d iff ad < cb
+    if (d_den == q.d_den || (integer::mul_small(d_num, q.d_den, lhs) && integer::mul_small(q.d_num, d_den, rhs))) {
+      return (lhs > rhs) - (lhs < rhs);
+    }
+  }
+  return mpq_cmp(mpq().get_mpq_t(), q.mpq().get_mpq_t());
+}
+
 void rational::to_stream(std::ostream& out) const {
   output::language lang = output::get_output_language(out);
   switch (lang) {
   case output::MCMT:
   case output::HORN:
   {
-    const mpz_class& num = d_gmp_rat.get_num();
-    int sgn = mpz_sgn(num.get_mpz_t());
+    int sgn = this->sgn();
     if (sgn == 0) {
       out << "0";
     } else {
@@ -51,15 +169,21 @@ void rational::to_stream(std::ostream& out) const {
       if (is_rational) {
         out << "(/ ";
       }
-      if (sgn < 0) {
+      if (is_small()) {
+        if (sgn < 0) {
+          out << "(- " << -d_num << ")";
+        } else {
+          out << d_num;
+        }
+      } else if (sgn < 0) {
         // when printing gmp numerator skip the -, but wrap into (- )
-        out << "(- " << (d_gmp_rat.get_num().get_str().c_str() + 1) << ")";
+        out << "(- " << (d_gmp_rat->get_num().get_str().c_str() + 1) << ")";
       } else {
         // just regular print
-        out << d_gmp_rat.get_num().get_str();
+        out << d_gmp_rat->get_num().get_str();
       }
       if (is_rational) {
-        out << " " << d_gmp_rat.get_den().get_str(10) << ")";
+        out << " " << get_denominator() << ")";
       }
     }
     break;
@@ -71,10 +195,10 @@ void rational::to_stream(std::ostream& out) const {
     } else if (sign > 0) {
       if (is_integer()) {
         // Integer output
-        out << "f'" << d_gmp_rat.get_str(10) << "/1";
+        out << "f'" << get_numerator() << "/1";
       } else {
         // Rational output
-        out << "f'" << d_gmp_rat.get_str(10);
+        out << "f'" << get_numerator() << "/" << get_denominator();
       }
     } else {
       out << "-" << negate();
@@ -92,16 +216,23 @@ std::ostream& operator << (std::ostream& out, const rational& q) {
 }
 
 bool rational::is_integer() const {
-  const mpz_class& den = d_gmp_rat.get_den();
-  return den == 1;
+  if (is_small()) {
+    return d_den == 1;
+  }
+  return d_gmp_rat->get_den() == 1;
 }
 
 rational rational::invert() const {
-  return rational(1 / d_gmp_rat);
+  if (is_small() && d_num != 0) {
+    rational result;
+    result.set(d_den, d_num);
+    return result;
+  }
+  return rational(1 / mpq());
 }
 
 rational rational::negate() const {
-  return rational(-d_gmp_rat);
+  return -*this;
 }
 
 rational rational::floor() const {
@@ -113,126 +244,155 @@ rational rational::ceiling() const {
 }
 
 int rational::sgn() const {
-  return mpq_sgn(d_gmp_rat.get_mpq_t());
+  if (is_small()) {
+    return (d_num > 0) - (d_num < 0);
+  }
+  return mpq_sgn(d_gmp_rat->get_mpq_t());
 }
 
 integer rational::get_numerator() const {
-  return integer(d_gmp_rat.get_num());
+  if (is_small()) {
+    return integer(d_num);
+  }
+  return integer(d_gmp_rat->get_num());
 }
 
 integer rational::get_denominator() const {
-  return integer(d_gmp_rat.get_den());
+  if (is_small()) {
+    return integer(d_den);
+  }
+  return integer(d_gmp_rat->get_den());
 }
 
-
 rational& rational::operator = (const integer& z) {
-  d_gmp_rat = z.mpz();
-  d_gmp_rat.canonicalize();
+  if (z.is_small()) {
+    set(z.get_signed(), 1);
+  } else {
+    set(mpq_class(z.mpz()).get_mpq_t());
+  }
   return *this;
 }
 
 rational rational::operator + (const rational& other) const {
-  return rational(d_gmp_rat + other.d_gmp_rat);
+  if (is_small() && other.is_small()) {
+    long num, den, lhs, rhs;
+    if (d_den == 1 && other.d_den == 1) {
+      if (integer::add_small(d_num, other.d_num, num)) {
+        return rational(num, 1);
+      }
+    } else {
+      // a/b + c/d = (a(d/g) + c(b/g))/(b(d/g)) with g = gcd(b, d)
+      long g = gcd(d_den, other.d_den);
+      if (integer::mul_small(d_num, other.d_den / g, lhs) &&
+          integer::mul_small(other.d_num, d_den / g, rhs) &&
+          integer::add_small(lhs, rhs, num) &&
+          integer::mul_small(d_den, other.d_den / g, den)) {
+        rational result;
+        result.set(num, den);
+        return result;
+      }
+    }
+  }
+  return rational(mpq() + other.mpq());
 }
 
 rational rational::operator + (const integer& other) const {
-  return rational(d_gmp_rat + other.mpz());
+  return *this + rational(other, integer(1));
 }
 
 rational& rational::operator += (const rational& other) {
-  d_gmp_rat += other.d_gmp_rat;
-  d_gmp_rat.canonicalize();
+  *this = *this + other;
   return *this;
 }
 
 rational& rational::operator += (const integer& other) {
-  d_gmp_rat += other.mpz();
-  d_gmp_rat.canonicalize();
+  *this = *this + other;
   return *this;
 }
 
 rational rational::operator - () const {
-  return rational(-d_gmp_rat);
+  if (is_small()) {
+    rational result;
+    result.d_num = -d_num;
+    result.d_den = d_den;
+    return result;
+  }
+  return rational(-*d_gmp_rat);
 }
 
 rational rational::operator - (const rational& other) const {
-  return rational(d_gmp_rat - other.d_gmp_rat);
+  return *this + (-other);
 }
 
 rational rational::operator - (const integer& other) const {
-  return rational(d_gmp_rat - other.mpz());
+  return *this - rational(other, integer(1));
 }
 
 rational& rational::operator -= (const rational& other) {
-  d_gmp_rat -= other.d_gmp_rat;
-  d_gmp_rat.canonicalize();
+  *this = *this - other;
   return *this;
 }
 
 rational& rational::operator -= (const integer& other) {
-  d_gmp_rat -= other.mpz();
-  d_gmp_rat.canonicalize();
+  *this = *this - other;
   return *this;
 }
 
 rational rational::operator * (const rational& other) const {
-  return rational(d_gmp_rat * other.d_gmp_rat);
+  if (is_small() && other.is_small()) {
+    // a/b * c/d = (a/g1)(c/g2) / (b/g2)(d/g1) with g1 = gcd(a, d), g2 = gcd(c, b)
+    long g1 = gcd(d_num < 0 ? -d_num : d_num, other.d_den);
+    long g2 = gcd(other.d_num < 0 ? -other.d_num : other.d_num, d_den);
+    long num, den;
+    if (integer::mul_small(d_num / g1, other.d_num / g2, num) &&
+        integer::mul_small(d_den / g2, other.d_den / g1, den)) {
+      rational result;
+      result.d_num = num;
+      result.d_den = den;
+      return result;
+    }
+  }
+  return rational(mpq() * other.mpq());
 }
 
 rational rational::operator * (const integer& other) const {
-  return rational(d_gmp_rat * other.mpz());
+  return *this * rational(other, integer(1));
 }
 
 rational& rational::operator *= (const rational& other) {
-  d_gmp_rat *= other.d_gmp_rat;
-  d_gmp_rat.canonicalize();
+  *this = *this * other;
   return *this;
 }
 
 rational& rational::operator *= (const integer& other) {
-  d_gmp_rat *= other.mpz();
-  d_gmp_rat.canonicalize();
+  *this = *this * other;
   return *this;
 }
 
-
 rational rational::operator / (const rational& other) const {
-  return rational(d_gmp_rat / other.d_gmp_rat);
+  if (other.is_small() && other.d_num != 0) {
+    return *this * other.invert();
+  }
+  return rational(mpq() / other.mpq());
 }
 
 rational rational::operator / (const integer& other) const {
-  return rational(d_gmp_rat / other.mpz());
+  return *this / rational(other, integer(1));
 }
 
 rational& rational::operator /= (const rational& other) {
-  d_gmp_rat /= other.d_gmp_rat;
-  d_gmp_rat.canonicalize();
+  *this = *this / other;
   return *this;
 }
 
 rational& rational::operator /= (const integer& other) {
-  d_gmp_rat /= other.mpz();
-  d_gmp_rat.canonicalize();
+  *this = *this / other;
   return *this;
 }
 
-bool rational::operator < (const rational& other) const {
-  return d_gmp_rat < other.d_gmp_rat;
-}
-
-bool rational::operator <= (const rational& other) const {
-  return d_gmp_rat <= other.d_gmp_rat;
-}
-
-bool rational::operator > (const rational& other) const {
-  return d_gmp_rat > other.d_gmp_rat;
-}
-
-bool rational::operator >= (const rational& other) const {
-  return d_gmp_rat >= other.d_gmp_rat;
-}
-
-rational::rational(const term_manager& tm, term_ref t) {
+rational::rational(const term_manager& tm, term_ref t)
+: d_num(0), d_den(1), d_gmp_rat(0)
+{
   const term& t_term = tm.term_of(t);
   *this = tm.get_rational_constant(t_term);
 }
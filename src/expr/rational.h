@@ -33,36 +33,59 @@ class term_ref;
 class term_manager;
 
 /**
- * Wrapper around the GMP rational.
+ * Wrapper around the GMP rational. As with integers, values with numerator
+ * and denominator that fit in a long are kept inline (canonical, positive
+ * denominator) and GMP is only used for the values that don't fit.
  */
 class rational {
-  /** The GMP object */
-  mpq_class d_gmp_rat;
+
+  /** Numerator, if small (d_gmp_rat is null) */
+  long d_num;
+  /** Denominator, if small, positive and coprime with d_num */
+  long d_den;
+  /** The GMP object, only allocated if the value doesn't fit */
+  mpq_class* d_gmp_rat;
+
+  /** Is the value in the small form */
+  bool is_small() const { return d_gmp_rat == 0; }
+
+  /** Set the value to num/den (den != 0), both different from LONG_MIN */
+  void set(long num, long den);
+
+  /** Set the value from GMP, canonicalizing */
+  void set(mpq_srcptr q);
+
+  /** Integers construct from the small form */
+  friend class integer;
+
 public:
   /** Default construct a 0 */
-  rational(): d_gmp_rat(0) { d_gmp_rat.canonicalize(); }
+  rational(): d_num(0), d_den(1), d_gmp_rat(0) {}
   /** Copy construct */
-  rational(const rational& q): d_gmp_rat(q.d_gmp_rat) { d_gmp_rat.canonicalize(); }
+  rational(const rational& q): d_num(q.d_num), d_den(q.d_den), d_gmp_rat(q.d_gmp_rat ? new mpq_class(*q.d_gmp_rat) : 0) {}
   /** Construct from GMP */
-  rational(const mpq_class& gmp_rat) : d_gmp_rat(gmp_rat) { d_gmp_rat.canonicalize(); }
+  rational(const mpq_class& gmp_rat) : d_num(0), d_den(1), d_gmp_rat(0) { set(gmp_rat.get_mpq_t()); }
   /** Construct from GMP */
-  rational(mpq_t gmp_rat): d_gmp_rat(gmp_rat) { d_gmp_rat.canonicalize(); }
+  rational(mpq_t gmp_rat): d_num(0), d_den(1), d_gmp_rat(0) { set(gmp_rat); }
   /** Construct from GMP integer */
-  rational(mpz_t gmp_z): d_gmp_rat(mpz_class(gmp_z)) { d_gmp_rat.canonicalize(); }
+  rational(mpz_t gmp_z);
   /** Construct p/q */
-  rational(const integer& p, const integer& q): d_gmp_rat(p.mpz(), q.mpz()) { d_gmp_rat.canonicalize(); }
+  rational(const integer& p, const integer& q);
   /** Construct p/q */
-  rational(long p, unsigned long q) : d_gmp_rat(p, q) { d_gmp_rat.canonicalize(); }
+  rational(long p, unsigned long q);
   /** Construct form float */
-  explicit rational(double q): d_gmp_rat(q) { d_gmp_rat.canonicalize(); }
+  explicit rational(double q): d_num(0), d_den(1), d_gmp_rat(0) { set(mpq_class(q).get_mpq_t()); }
   /** Construct from string representation */
-  explicit rational(const char* s): d_gmp_rat(s, 10) { d_gmp_rat.canonicalize(); }
+  explicit rational(const char* s): d_num(0), d_den(1), d_gmp_rat(0) { set(mpq_class(s, 10).get_mpq_t()); }
   /** Construct from string representation */
-  explicit rational(std::string s): d_gmp_rat(s, 10) { d_gmp_rat.canonicalize(); }
+  explicit rational(std::string s): d_num(0), d_den(1), d_gmp_rat(0) { set(mpq_class(s, 10).get_mpq_t()); }
   /** Construct from string representation "1" "2" = 1.2 = 3/2 */
-  rational(std::string integer_part, std::string fractional_part)
-  : d_gmp_rat(integer(integer_part + fractional_part, 10).mpz(), integer(10).pow(fractional_part.size()).mpz())
-  { d_gmp_rat.canonicalize(); }
+  rational(std::string integer_part, std::string fractional_part);
+
+  ~rational() { delete d_gmp_rat; }
+
+  /** Assignment */
+  rational& operator = (const rational& q);
 
   /** Cosntruct from constant integer or rational term */
   rational(const term_manager& tm, term_ref t);
@@ -70,7 +93,7 @@ public:
   /** Hash of the rational */
   size_t hash() const;
   /** Compare the two numbers */
-  int cmp(const rational& q) const { return mpq_cmp(d_gmp_rat.get_mpq_t(), q.d_gmp_rat.get_mpq_t()); }
+  int cmp(const rational& q) const;
 
   /** Output to stream */
   void to_stream(std::ostream& out) const;
@@ -101,10 +124,10 @@ public:
   rational& operator /= (const rational& other);
   rational& operator /= (const integer& other);
 
-  bool operator < (const rational& other) const;
-  bool operator <= (const rational& other) const;
-  bool operator > (const rational& other) const;
-  bool operator >= (const rational& other) const;
+  bool operator < (const rational& other) const { return cmp(other) < 0; }
+  bool operator <= (const rational& other) const { return cmp(other) <= 0; }
+  bool operator > (const rational& other) const { return cmp(other) > 0; }
+  bool operator >= (const rational& other) const { return cmp(other) >= 0; }
 
   /** Assignment for integers */
   rational& operator = (const integer& z);
@@ -137,8 +160,9 @@ public:
   static
   rational value_between(const rational& a, const rational& b);
 
-  const mpq_class& mpq() const {
-    return d_gmp_rat;
+  /** Get the GMP value */
+  mpq_class mpq() const {
+    return d_gmp_rat ? *d_gmp_rat : mpq_class(d_num, (unsigned long) d_den);
   }
 };
 
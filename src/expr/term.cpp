@@ -31,21 +31,6 @@
 namespace sally {
 namespace expr {
 
-/**
- * Term references are compared directly, unless one of them is null. Null is
- * a marker that this is a term constructor, in which case the comparison is
- * done by hand.
- */
-bool term_ref_fat::operator == (const term_ref_fat& other) const {
-  if (this->is_null()) {
-    return cmp(other);
-  }
-  if (other.is_null()) {
-    return other.cmp(*this);
-  }
-  return cmp(other);
-}
-
 void term_ref::to_stream(std::ostream& out) const {
   if (is_null()) {
     out << "null";
@@ -932,41 +917,45 @@ void term::to_stream_nuxmv_without_let(std::ostream& out, term_manager& tm, cons
 term_ref_strong::term_ref_strong(const term_ref_strong& other)
 : term_ref(other)
 , d_tm(other.d_tm)
+, d_id(other.d_id)
 {
   if (d_tm != 0) {
-    d_tm->attach(id());
+    d_tm->attach(d_id);
   }
 }
 
 term_ref_strong::term_ref_strong(term_manager_internal& tm, term_ref ref)
 : term_ref(ref)
 , d_tm(&tm)
+, d_id(tm.id_of(ref))
 {
-  d_tm->attach(id());
+  d_tm->attach(d_id);
 }
 
 term_ref_strong::term_ref_strong(term_manager& tm, term_ref ref)
 : term_ref(ref)
 , d_tm(tm.get_internal())
+, d_id(d_tm->id_of(ref))
 {
-  d_tm->attach(id());
+  d_tm->attach(d_id);
 }
 
 term_ref_strong::~term_ref_strong() {
   if (d_tm != 0) {
-    d_tm->detach(id());
+    d_tm->detach(d_id);
   }
 }
 
 term_ref_strong& term_ref_strong::operator =(const term_ref_strong& other) {
   if (this != &other) {
     if (d_tm != 0) {
-      d_tm->detach(id());
+      d_tm->detach(d_id);
     }
     d_tm = other.d_tm;
+    d_id = other.d_id;
     term_ref::operator=(other);
     if (d_tm != 0) {
-      d_tm->attach(id());
+      d_tm->attach(d_id);
     }
   }
   return *this;
@@ -981,11 +970,7 @@ size_t term_ref_strong::hash() const {
 }
 
 size_t term_ref_strong::id() const {
-  if (d_tm == 0) {
-    return 0;
-  } else {
-    return d_tm->id_of(*this);
-  }
+  return d_id;
 }
 
 /** Number of children, if any */
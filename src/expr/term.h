@@ -77,13 +77,16 @@ class term_ref_strong : public term_ref {
     /** Responsible term manager */
     term_manager_internal* d_tm;
 
+    /** Id of the term (ids are kept by the manager through garbage collection) */
+    size_t d_id;
+
     friend class term_manager;
 
   public:
 
     /** Construct null reference */
     term_ref_strong()
-    : term_ref(), d_tm(0) {}
+    : term_ref(), d_tm(0), d_id(0) {}
 
     /** Construct a copy */
     term_ref_strong(const term_ref_strong& other);
@@ -122,15 +125,18 @@ class term {
   /** The term kind */
   term_op d_op;
 
+  /** Id of the term in the term manager (fits next to the kind) */
+  uint32_t d_id;
+
   /** The hash of the term (independent of reference) */
   size_t d_hash;
 
   /** Default constructor */
-  term(): d_op(OP_LAST), d_hash(0) {}
+  term(): d_op(OP_LAST), d_id(0), d_hash(0) {}
 
   /** Construct the term with all the attributes */
-  term(term_op op, size_t hash)
-  : d_op(op), d_hash(hash) {}
+  term(term_op op, size_t id, size_t hash)
+  : d_op(op), d_id(id), d_hash(hash) {}
 
   friend class term_manager_internal;
 
@@ -0,0 +1,481 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "expr/term_evaluator.h"
+#include "expr/term_visitor.h"
+#include "expr/model.h"
+#include "utils/trace.h"
+
+#include <boost/unordered_map.hpp>
+#include <cassert>
+
+namespace sally {
+namespace expr {
+
+/** Visitor that emits the instructions in topological order */
+class term_evaluator::compiler {
+
+  typedef boost::unordered_map<term_ref, size_t, term_ref_hasher> slot_map;
+
+  term_evaluator& d_evaluator;
+  const term_manager& d_tm;
+
+  /** Map from terms to their slots */
+  slot_map d_slots;
+
+public:
+
+  compiler(term_evaluator& evaluator)
+  : d_evaluator(evaluator)
+  , d_tm(evaluator.d_tm)
+  {}
+
+  // Non-null terms are good
+  bool is_good_term(term_ref t) const {
+    return !t.is_null();
+  }
+
+  // Get the children of t
+  void get_children(term_ref t, std::vector<term_ref>& children) {
+    const term& t_term = d_tm.term_of(t);
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      children.push_back(t_term[i]);
+    }
+  }
+
+  // Don't go into the variable children (types)
+  visitor_match_result match(term_ref t) {
+    if (d_tm.term_of(t).op() == VARIABLE) {
+      return VISIT_AND_BREAK;
+    } else {
+      return VISIT_AND_CONTINUE;
+    }
+  }
+
+  void visit(term_ref t) {
+    const term& t_term = d_tm.term_of(t);
+    term_op op = t_term.op();
+
+    size_t begin = d_evaluator.d_children.size();
+    size_t size = op == VARIABLE ? 0 : t_term.size();
+    for (size_t i = 0; i < size; ++ i) {
+      slot_map::const_iterator find = d_slots.find(t_term[i]);
+      assert(find != d_slots.end());
+      d_evaluator.d_children.push_back(find->second);
+    }
+
+    size_t slot = d_evaluator.d_instructions.size();
+    d_evaluator.d_instructions.push_back(instruction(t, op, begin, size));
+    d_evaluator.d_values.push_back(value());
+    d_slots[t] = slot;
+
+    // Constants are evaluated once and for all
+    switch (op) {
+    case CONST_BOOL:
+    case CONST_RATIONAL:
+    case CONST_BITVECTOR:
+      d_evaluator.d_values[slot] = d_evaluator.compute(d_evaluator.d_instructions[slot]);
+      break;
+    default:
+      break;
+    }
+  }
+};
+
+term_evaluator::term_evaluator(const term_manager& tm, term_ref t)
+: d_tm(tm)
+, d_term(t)
+, d_true(true)
+, d_false(false)
+{
+  compiler c(*this);
+  term_visit_topological<compiler, term_ref, term_ref_hasher> visit_topological(c);
+  visit_topological.run(t);
+  assert(!d_instructions.empty() && d_instructions.back().t == t);
+}
+
+value term_evaluator::evaluate(const model& m) {
+  term_manager::substitution_map renaming;
+  return evaluate(m, renaming);
+}
+
+value term_evaluator::evaluate(const model& m, const term_manager::substitution_map& var_renaming) {
+  for (size_t i = 0; i < d_instructions.size(); ++ i) {
+    const instruction& I = d_instructions[i];
+    switch (I.op) {
+    case VARIABLE:
+      d_values[i] = m.get_variable_value(I.t, var_renaming);
+      break;
+    case CONST_BOOL:
+    case CONST_RATIONAL:
+    case CONST_BITVECTOR:
+      // Already evaluated
+      break;
+    default:
+      d_values[i] = compute(I);
+      TRACE("expr::term_evaluator") << "evaluate(" << I.t << ") => " << d_values[i] << std::endl;
+    }
+  }
+  return d_values.back();
+}
+
+bool term_evaluator::is_true(const model& m) {
+  return evaluate(m) == d_true;
+}
+
+bool term_evaluator::is_false(const model& m) {
+  return evaluate(m) == d_false;
+}
+
+bool term_evaluator::is_true(const model& m, const term_manager::substitution_map& var_renaming) {
+  return evaluate(m, var_renaming) == d_true;
+}
+
+bool term_evaluator::is_false(const model& m, const term_manager::substitution_map& var_renaming) {
+  return evaluate(m, var_renaming) == d_false;
+}
+
+rational term_evaluator::div(const rational& a, const rational& b) {
+  return b.sgn() == 0 ? rational() : a / b;
+}
+
+value term_evaluator::compute(const instruction& I) const {
+
+  const term& t_term = d_tm.term_of(I.t);
+
+  value v;
+  switch (I.op) {
+  // ITE
+  case TERM_ITE:
+    if (child(I, 0) == d_true) {
+      v = child(I, 1);
+    } else {
+      assert(child(I, 0) == d_false);
+      v = child(I, 2);
+    }
+    break;
+  // Equality
+  case TERM_EQ:
+    if (!child(I, 0).is_null() && !child(I, 1).is_null()) {
+      v = value(child(I, 0) == child(I, 1));
+    }
+    break;
+  // Boolean terms
+  case CONST_BOOL:
+    v = d_tm.get_boolean_constant(t_term);
+    break;
+  case TERM_AND:
+    v = d_true;
+    for (size_t i = 0; i < I.children_size; ++ i) {
+      if (child(I, i) == d_false) {
+        v = d_false;
+        break;
+      }
+    }
+    break;
+  case TERM_OR:
+    v = d_false;
+    for (size_t i = 0; i < I.children_size; ++ i) {
+      if (child(I, i) == d_true) {
+        v = d_true;
+        break;
+      }
+    }
+    break;
+  case TERM_NOT:
+    v = child(I, 0) == d_true ? d_false : d_true;
+    break;
+  case TERM_IMPLIES:
+    if (child(I, 0) == d_true && child(I, 1) == d_false) {
+      v = d_false;
+    } else {
+      v = d_true;
+    }
+    break;
+  case TERM_XOR: {
+    size_t true_count = 0;
+    for (size_t i = 0; i < I.children_size; ++ i) {
+      if (child(I, i) == d_true) {
+        true_count ++;
+      }
+    }
+    if (true_count % 2) {
+      v = d_true;
+    } else {
+      v = d_false;
+    }
+  }
+  break;
+  case CONST_RATIONAL:
+    v = d_tm.get_rational_constant(t_term);
+    break;
+  case TERM_ADD: {
+    rational sum;
+    for (size_t i = 0; i < I.children_size; ++ i) {
+      sum += child(I, i).get_rational();
+    }
+    v = value(sum);
+    break;
+  }
+  case TERM_SUB:
+    if (I.children_size == 1) {
+      v = value(-child(I, 0).get_rational());
+    } else {
+      v = value(child(I, 0).get_rational() - child(I, 1).get_rational());
+    }
+    break;
+  case TERM_MUL: {
+    rational mul(1, 1);
+    for (size_t i = 0; i < I.children_size; ++ i) {
+      mul *= child(I, i).get_rational();
+    }
+    v = value(mul);
+    break;
+  }
+  case TERM_DIV:
+    v = value(div(child(I, 0).get_rational(), child(I, 1).get_rational()));
+    break;
+  case TERM_LEQ:
+    v = (child(I, 0).get_rational() <= child(I, 1).get_rational() ? d_true : d_false);
+    break;
+  case TERM_LT:
+    v = (child(I, 0).get_rational() < child(I, 1).get_rational() ? d_true : d_false);
+    break;
+  case TERM_GEQ:
+    v = (child(I, 0).get_rational() >= child(I, 1).get_rational() ? d_true : d_false);
+    break;
+  case TERM_GT:
+    v = (child(I, 0).get_rational() > child(I, 1).get_rational() ? d_true : d_false);
+    break;
+  case TERM_TO_INT:
+    v = value(child(I, 0).get_rational().floor());
+    break;
+  case TERM_TO_REAL:
+    v = child(I, 0);
+    break;
+  case TERM_IS_INT:
+    v = child(I, 0).get_rational().is_integer() ? d_true : d_false;
+    break;
+
+  // Bit-vector terms
+  case CONST_BITVECTOR:
+    v = d_tm.get_bitvector_constant(t_term);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  case TERM_BV_ADD: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.add(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_SUB: {
+    if (I.children_size == 1) {
+      v = child(I, 0).get_bitvector().neg();
+    } else if (I.children_size == 2) {
+      const bitvector& lhs = child(I, 0).get_bitvector();
+      const bitvector& rhs = child(I, 1).get_bitvector();
+      v = lhs.sub(rhs);
+      assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    } else {
+      assert(false);
+    }
+    break;
+  }
+  case TERM_BV_MUL: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.mul(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_UDIV: { // NOTE: semantics of division is x/0 = 111...111
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.udiv(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_SDIV: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.sdiv(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_UREM: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.urem(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_SREM: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.srem(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_SMOD: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.smod(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_XOR: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.bvxor(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_SHL: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.shl(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_LSHR: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.lshr(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_ASHR: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.ashr(rhs);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_NOT:
+    v = child(I, 0).get_bitvector().bvnot();
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  case TERM_BV_AND: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.bvand(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_OR: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.bvor(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_NAND:
+    assert(false);
+    break;
+  case TERM_BV_NOR:
+    assert(false);
+    break;
+  case TERM_BV_XNOR:
+    assert(false);
+    break;
+  case TERM_BV_CONCAT: {
+    bitvector bv = child(I, 0).get_bitvector();
+    for (size_t i = 1; i < I.children_size; ++ i) {
+      bv = bv.concat(child(I, i).get_bitvector());
+    }
+    v = bv;
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_EXTRACT: {
+    size_t low = d_tm.get_bitvector_extract(t_term).low;
+    size_t high = d_tm.get_bitvector_extract(t_term).high;
+    v = child(I, 0).get_bitvector().extract(low, high);
+    assert(v.get_bitvector().size() == d_tm.get_bitvector_size(I.t));
+    break;
+  }
+  case TERM_BV_ULEQ: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.uleq(rhs);
+    break;
+  }
+  case TERM_BV_SLEQ: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.sleq(rhs);
+    break;
+  }
+  case TERM_BV_ULT: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.ult(rhs);
+    break;
+  }
+  case TERM_BV_SLT: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.slt(rhs);
+    break;
+  }
+  case TERM_BV_UGEQ: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.ugeq(rhs);
+    break;
+  }
+  case TERM_BV_SGEQ: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.sgeq(rhs);
+    break;
+  }
+  case TERM_BV_UGT: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.ugt(rhs);
+    break;
+  }
+  case TERM_BV_SGT: {
+    const bitvector& lhs = child(I, 0).get_bitvector();
+    const bitvector& rhs = child(I, 1).get_bitvector();
+    v = lhs.sgt(rhs);
+    break;
+  }
+  default:
+    assert(false);
+  }
+
+  assert(!v.is_null());
+
+  return v;
+}
+
+}
+}
@@ -0,0 +1,123 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "expr/term_manager.h"
+#include "expr/value.h"
+
+#include <vector>
+
+namespace sally {
+namespace expr {
+
+class model;
+
+/**
+ * A term compiled for repeated evaluation. The term DAG is flattened once
+ * into a topologically ordered array of instructions, each writing to its own
+ * value slot, so that evaluating in a new model is a single linear pass with
+ * no lookups except for the variable values. Constants are evaluated at
+ * compile time. The evaluator keeps plain term references, so it is only
+ * valid until the next garbage collection.
+ */
+class term_evaluator {
+
+  /** A single evaluation step, the result goes to the slot of the same index */
+  struct instruction {
+    /** The term being evaluated */
+    term_ref t;
+    /** The operation */
+    term_op op;
+    /** Index of the first child slot in d_children */
+    size_t children_begin;
+    /** Number of children */
+    size_t children_size;
+
+    instruction(term_ref t, term_op op, size_t children_begin, size_t children_size)
+    : t(t), op(op), children_begin(children_begin), children_size(children_size)
+    {}
+  };
+
+  /** The term manager */
+  const term_manager& d_tm;
+
+  /** The term we are evaluating */
+  term_ref d_term;
+
+  /** The instructions in topological order (term is the last one) */
+  std::vector<instruction> d_instructions;
+
+  /** Slots of the children of the instructions */
+  std::vector<size_t> d_children;
+
+  /** Values of the instructions */
+  std::vector<value> d_values;
+
+  /** True value */
+  value d_true;
+
+  /** False value */
+  value d_false;
+
+  class compiler;
+  friend class compiler;
+
+  /** Get the value of k-th child of the i-th instruction */
+  const value& child(const instruction& I, size_t k) const {
+    return d_values[d_children[I.children_begin + k]];
+  }
+
+  /** Compute the value of the instruction, assuming children are evaluated */
+  value compute(const instruction& I) const;
+
+public:
+
+  /** Compile the term t */
+  term_evaluator(const term_manager& tm, term_ref t);
+
+  /** The term being evaluated */
+  term_ref get_term() const { return d_term; }
+
+  /** Number of instructions */
+  size_t size() const { return d_instructions.size(); }
+
+  /** Evaluate the term in the model */
+  value evaluate(const model& m);
+
+  /** Evaluate the term in the model, modulo the renaming (x_t -> x_model) */
+  value evaluate(const model& m, const term_manager::substitution_map& var_renaming);
+
+  /** Is the formula true in the model */
+  bool is_true(const model& m);
+
+  /** Is the formula true in the model, modulo the renaming (x_t -> x_model) */
+  bool is_true(const model& m, const term_manager::substitution_map& var_renaming);
+
+  /** Is the formula false in the model */
+  bool is_false(const model& m);
+
+  /** Is the formula false in the model, modulo the renaming (x_t -> x_model) */
+  bool is_false(const model& m, const term_manager::substitution_map& var_renaming);
+
+  /** Real division a/b. Division by 0 is unspecified, we pick a/0 = 0. */
+  static rational div(const rational& a, const rational& b);
+};
+
+}
+}
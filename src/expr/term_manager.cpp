@@ -32,15 +32,26 @@ namespace expr {
 
 size_t term_manager::s_instances = 0;
 
-term_manager::term_manager(utils::statistics& stats)
-: d_tm(new term_manager_internal(stats))
+term_manager::term_manager(utils::statistics& stats, bool concurrent)
+: d_tm(new term_manager_internal(stats, concurrent))
 , d_id(s_instances ++)
 , d_tmp_var_id(0)
+, d_mutex(new boost::mutex())
 {
 }
 
 term_manager::~term_manager() {
+  // Notify the participants that are still around (they might delete themselves)
+  std::vector<gc_participant*> participants(d_gc_participants.begin(), d_gc_participants.end());
+  for (size_t i = 0; i < participants.size(); ++ i) {
+    participants[i]->gc_tm_destroyed();
+  }
   delete d_tm;
+  delete d_mutex;
+}
+
+bool term_manager::is_concurrent() const {
+  return d_tm->is_concurrent();
 }
 
 void term_manager::to_stream(std::ostream& out) const {
@@ -118,17 +129,19 @@ term_ref term_manager::mk_term(term_op op, term_ref c1, term_ref c2, term_ref c3
 }
 
 term_ref term_manager::mk_variable(term_ref type) {
-  static size_t id = 0;
+  static boost::atomic<size_t> id(0);
   std::stringstream ss;
-  ss << "_" << (id ++);
-  d_variable_names.insert(ss.str());
+  ss << "_" << id.fetch_add(1);
   term_ref result = mk_variable(ss.str(), type);
   d_tm->typecheck(result);
   return result;
 }
 
 term_ref term_manager::mk_variable(std::string name, term_ref type) {
-  d_variable_names.insert(name);
+  {
+    concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
+    d_variable_names.insert(name);
+  }
   term_ref result;
   if (term_of(type).op() == TYPE_STRUCT) {
     // Size of the struct
@@ -157,6 +170,7 @@ term_ref term_manager::mk_variable(std::string name, term_ref type) {
 }
 
 std::string term_manager::get_fresh_variable_name() {
+  concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
   for (;;) {
     std::stringstream ss;
     ss << "l" << (d_tmp_var_id ++);
@@ -169,6 +183,7 @@ std::string term_manager::get_fresh_variable_name() {
 }
 
 void term_manager::reset_fresh_variables() {
+  concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
   d_tmp_var_id = 0;
 }
 
@@ -695,12 +710,24 @@ void term_manager::get_subterms(term_ref ref, std::vector<term_ref>& out) const
 }
 
 term_ref term_manager::substitute(term_ref t, const substitution_map& subst) {
-  substitution_map subst_copy(subst);
-  return d_tm->substitute(t, subst_copy);
+  return d_tm->substitute(t, subst);
 }
 
 term_ref term_manager::substitute_and_cache(term_ref t, substitution_map& subst) {
-  return d_tm->substitute(t, subst);
+  return d_tm->substitute_and_cache(t, subst);
+}
+
+term_ref term_manager::translate(const term_manager& from, term_ref t, substitution_map& cache) {
+  term_ref result = d_tm->translate(*from.d_tm, t, cache);
+  d_tm->typecheck(result);
+  // Remember the names of the variables we have created
+  std::vector<term_ref> vars;
+  get_variables(result, vars);
+  concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    d_variable_names.insert(d_tm->payload_of<utils::string>(vars[i]).c_str());
+  }
+  return result;
 }
 
 term_ref term_manager::mk_not(term_ref f) {
@@ -899,11 +926,13 @@ void term_manager::gc() {
 }
 
 void term_manager::gc_register(gc_participant* o) {
+  concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
   assert(d_gc_participants.find(o) == d_gc_participants.end());
   d_gc_participants.insert(o);
 }
 
 void term_manager::gc_deregister(gc_participant* o) {
+  concurrent_lock<boost::mutex> lock(*d_mutex, d_tm->is_concurrent());
   assert(d_gc_participants.find(o) != d_gc_participants.end());
   d_gc_participants.erase(o);
 }
@@ -29,6 +29,10 @@
 
 #include <iosfwd>
 
+namespace boost {
+  class mutex;
+}
+
 namespace sally {
 namespace expr {
 
@@ -57,10 +61,20 @@ class term_manager {
   /** Ids of temp variables */
   size_t d_tmp_var_id;
 
+  /** Mutex for the variable names and gc participants (concurrent mode) */
+  boost::mutex* d_mutex;
+
 public:
 
-  /** Construct them manager */
-  term_manager(utils::statistics& stats);
+  /**
+   * Construct them manager. A concurrent manager can be used to construct
+   * terms from several threads at once, but doesn't support garbage
+   * collection.
+   */
+  term_manager(utils::statistics& stats, bool concurrent = false);
+
+  /** Is the manager concurrent */
+  bool is_concurrent() const;
 
   /** Destruct the manager, and destruct all payloads that the manager owns */
   ~term_manager();
@@ -381,7 +395,10 @@ public:
   /** Get a reference for the term */
   term_ref ref_of(const term& term) const;
 
-  /** Get a term of the reference */
+  /**
+   * Get a term of the reference. Terms never move, so the term can be kept
+   * by address until the next garbage collection.
+   */
   const term& term_of(term_ref ref) const;
 
   /** Get the number of children this term has. */
@@ -483,6 +500,14 @@ public:
   /** Replaces terms from t that appear in the map. */
   term_ref substitute_and_cache(term_ref t, substitution_map& subst);
 
+  /**
+   * Copy the term t from another term manager into this one. The cache maps
+   * terms of from to terms of this manager and is updated with the new terms.
+   * Variables not in the cache are copied to fresh variables, so to map
+   * variables to existing ones, add them to the cache first.
+   */
+  term_ref translate(const term_manager& from, term_ref t, substitution_map& cache);
+
   /** Get the current name transformer */
   const utils::name_transformer* get_name_transformer() const;
 
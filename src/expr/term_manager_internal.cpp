@@ -25,27 +25,55 @@
 #include "utils/trace.h"
 
 #include <stack>
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
 using namespace sally;
 using namespace expr;
 
-term_manager_internal::term_manager_internal(utils::statistics& stats)
-: d_name_transformer(0)
+term_manager_internal::term_manager_internal(utils::statistics& stats, bool concurrent)
+: d_concurrent(concurrent)
+, d_pool_shards(0)
+, d_term_refcount_pages(0)
+, d_term_ids_next(0)
+, d_name_transformer(0)
 , d_stat_terms(0)
+, d_stat_terms_collected(0)
+, d_stat_pool_load(0)
+, d_stat_pool_probe_avg(0)
+, d_stat_pool_probe_max(0)
 {
-  // The null id
-  new_term_id();
-
   // Initialize all payload memories to 0
   for (unsigned i = 0; i < OP_LAST; ++ i) {
     d_payload_memory[i] = 0;
   }
 
+  // Setup the concurrent structures
+  if (d_concurrent) {
+    d_memory.make_concurrent();
+    mk_payload_memory();
+    d_pool_shards = new pool_shard[s_pool_shards];
+    d_term_refcount_pages = new boost::atomic<refcount_page*>[s_refcount_pages];
+    for (size_t i = 0; i < s_refcount_pages; ++ i) {
+      d_term_refcount_pages[i].store(0);
+    }
+  }
+
+  // The null id
+  new_term_id();
+
   // Statistic for size of term table
   d_stat_terms = new utils::stat_int("sally::expr::term_manager_internal::memory_size", 0);
   stats.add(d_stat_terms);
+  d_stat_terms_collected = new utils::stat_int("sally::expr::term_manager_internal::gc_collected", 0);
+  stats.add(d_stat_terms_collected);
+  d_stat_pool_load = new utils::stat_double("sally::expr::term_manager_internal::pool_load", 0);
+  stats.add(d_stat_pool_load);
+  d_stat_pool_probe_avg = new utils::stat_double("sally::expr::term_manager_internal::pool_probe_avg", 0);
+  stats.add(d_stat_pool_probe_avg);
+  d_stat_pool_probe_max = new utils::stat_int("sally::expr::term_manager_internal::pool_probe_max", 0);
+  stats.add(d_stat_pool_probe_max);
 
   // Create the types
   d_typeType = term_ref_strong(*this, mk_term<TYPE_TYPE>(alloc::empty_type()));
@@ -56,12 +84,75 @@ term_manager_internal::term_manager_internal(utils::statistics& stats)
 }
 
 term_manager_internal::~term_manager_internal() {
+  // Release our own references while the reference counts are still around
+  d_typeType = term_ref_strong();
+  d_booleanType = term_ref_strong();
+  d_integerType = term_ref_strong();
+  d_realType = term_ref_strong();
+  d_stringType = term_ref_strong();
+  d_bitvectorType.clear();
+
   for (unsigned i = 0; i < OP_LAST; ++ i) {
     delete d_payload_memory[i];
   }
+  if (d_concurrent) {
+    delete[] d_pool_shards;
+    for (size_t i = 0; i < s_refcount_pages; ++ i) {
+      delete d_term_refcount_pages[i].load();
+    }
+    delete[] d_term_refcount_pages;
+  }
+}
+
+template <typename payload_type>
+static alloc::allocator_base* mk_concurrent_payload_allocator() {
+  alloc::allocator_base* palloc = new alloc::allocator<payload_type, alloc::empty_type>();
+  palloc->make_concurrent();
+  return palloc;
+}
+
+void term_manager_internal::mk_payload_memory() {
+
+#define SWITCH_TO_ALLOCATOR(OP) d_payload_memory[OP] = mk_concurrent_payload_allocator<term_op_traits<OP>::payload_type>();
+
+  // Only the kinds that have a payload
+  SWITCH_TO_ALLOCATOR(TYPE_BITVECTOR)
+  SWITCH_TO_ALLOCATOR(TERM_BV_EXTRACT)
+  SWITCH_TO_ALLOCATOR(TERM_BV_SGN_EXTEND)
+  SWITCH_TO_ALLOCATOR(CONST_BOOL)
+  SWITCH_TO_ALLOCATOR(CONST_RATIONAL)
+  SWITCH_TO_ALLOCATOR(CONST_BITVECTOR)
+  SWITCH_TO_ALLOCATOR(CONST_ENUM)
+  SWITCH_TO_ALLOCATOR(VARIABLE)
+  SWITCH_TO_ALLOCATOR(TERM_TUPLE_READ)
+  SWITCH_TO_ALLOCATOR(TERM_TUPLE_WRITE)
+  SWITCH_TO_ALLOCATOR(CONST_STRING)
+
+#undef SWITCH_TO_ALLOCATOR
+}
+
+size_t term_manager_internal::new_term_id_concurrent() {
+  size_t id = d_term_ids_next.fetch_add(1);
+  size_t page = id >> 16;
+  if (page >= s_refcount_pages) {
+    throw exception("Out of term ids");
+  }
+  // Make sure the page of reference counts is there
+  if (d_term_refcount_pages[page].load(boost::memory_order_acquire) == 0) {
+    boost::lock_guard<boost::mutex> lock(d_term_refcount_pages_mutex);
+    if (d_term_refcount_pages[page].load(boost::memory_order_relaxed) == 0) {
+      refcount_page* new_page = new refcount_page();
+      for (size_t i = 0; i < (1 << 16); ++ i) {
+        new_page->counts[i].store(0, boost::memory_order_relaxed);
+      }
+      d_term_refcount_pages[page].store(new_page, boost::memory_order_release);
+    }
+  }
+  return id;
 }
 
 term_ref term_manager_internal::tcc_of(const term& t) const {
+  concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
   term_to_term_map::const_iterator find = d_tcc_map.find(ref_of(t));
   if (find == d_tcc_map.end()) {
     return term_ref();
@@ -71,6 +162,7 @@ term_ref term_manager_internal::tcc_of(const term& t) const {
 }
 
 void term_manager_internal::compute_type(term_ref t) {
+  concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
   if (d_type_cache.find(t) == d_type_cache.end()) {
     type_computation_visitor visitor(*this, d_type_cache, d_base_type_cache);
     term_visit_topological<type_computation_visitor, term_ref, term_ref_hasher> visit_topological(visitor);
@@ -96,12 +188,28 @@ void term_manager_internal::to_stream(std::ostream& out) const {
   }
 
   out << "Terms:" << std::endl;
-  for (term_ref_hash_set::const_iterator it = d_pool.begin(); it != d_pool.end(); ++ it) {
-    out << "[id: " << it->id() << ", ref_count = " << d_term_refcount[it->id()] << "] : " << *it << std::endl;
+  if (d_concurrent) {
+    for (size_t i = 0; i < s_pool_shards; ++ i) {
+      const term_table& pool = d_pool_shards[i].pool;
+      for (term_table::const_iterator it = pool.begin(); it != pool.end(); ++ it) {
+        if (!it->ref.is_null()) {
+          size_t id = term_of(it->ref).d_id;
+          out << "[id: " << id << ", ref_count = " << refcount_of(id) << "] : " << it->ref << std::endl;
+        }
+      }
+    }
+    return;
+  }
+  for (term_table::const_iterator it = d_pool.begin(); it != d_pool.end(); ++ it) {
+    if (!it->ref.is_null()) {
+      size_t id = term_of(it->ref).d_id;
+      out << "[id: " << id << ", ref_count = " << d_term_refcount[id] << "] : " << it->ref << std::endl;
+    }
   }
 }
 
 term_ref term_manager_internal::type_of(const term& t) {
+  concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
   term_ref t_ref = ref_of(t);
   compute_type(t_ref);
   term_to_term_map::const_iterator find = d_type_cache.find(t_ref);
@@ -110,6 +218,7 @@ term_ref term_manager_internal::type_of(const term& t) {
 }
 
 term_ref term_manager_internal::type_of_if_exists(const term& t) const {
+  concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
   term_ref t_ref = ref_of(t);
   term_to_term_map::const_iterator find = d_type_cache.find(t_ref);
   if (find == d_type_cache.end()) {
@@ -141,6 +250,7 @@ term_ref term_manager_internal::base_type_of(const term& t) {
       }
     }
     // Otherwise, compute the type, and get the base type
+    concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
     term_ref t_ref = ref_of(t);
     compute_type(t_ref);
     term_to_term_map::const_iterator find = d_base_type_cache.find(t_ref);
@@ -176,6 +286,7 @@ term_ref term_manager_internal::base_type_of_if_exists(const term& t) const {
       }
     }
     // Otherwise, compute the type, and get the base type
+    concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
     term_ref t_ref = ref_of(t);
     term_to_term_map::const_iterator find = d_base_type_cache.find(t_ref);
     if (find != d_base_type_cache.end()) {
@@ -215,61 +326,273 @@ std::string term_manager_internal::name_normalize(std::string id) const {
   }
 }
 
-// TODO: non-recursive
-term_ref term_manager_internal::substitute(term_ref t, substitution_map& subst) {
+term_ref term_manager_internal::substitute(term_ref t, const substitution_map& subst) {
+  if (d_concurrent) {
+    substitution_scratch scratch;
+    return substitute(t, subst, 0, scratch);
+  } else {
+    return substitute(t, subst, 0, d_substitution_scratch);
+  }
+}
 
-  // Check if already there
-  substitution_map::const_iterator it = subst.find(t);
-  if (it != subst.end()) {
-    return it->second;
+term_ref term_manager_internal::substitute_and_cache(term_ref t, substitution_map& subst) {
+  if (d_concurrent) {
+    substitution_scratch scratch;
+    return substitute(t, subst, &subst, scratch);
+  } else {
+    return substitute(t, subst, &subst, d_substitution_scratch);
   }
+}
 
-  bool child_changed = false;
-  std::vector<term_ref> children;
+term_ref term_manager_internal::substitute(term_ref t, const substitution_map& subst, substitution_map* cache, substitution_scratch& scratch) {
 
-  for (size_t i = 0; i < term_of(t).size(); ++ i) {
-    // Substitute in the child
-    term_ref child = term_of(t)[i];
-    term_ref child_subst = substitute(child, subst);
-    if (child_subst != child) {
-      child_changed = true;
+  // New stamp invalidates the memo from previous calls
+  scratch.stamp ++;
+  scratch.to_process.clear();
+  scratch.rewritten.clear();
+
+  std::vector<term_ref>& memo = scratch.memo;
+  std::vector<size_t>& memo_stamp = scratch.memo_stamp;
+  std::vector<term_ref>& children = scratch.children;
+  std::vector<std::pair<term_ref, bool> >& to_process = scratch.to_process;
+  const size_t stamp = scratch.stamp;
+
+  // Returns true if the result for the term is known (in memo or subst)
+#define SUBSTITUTE_KNOWN(id) ((id) < memo_stamp.size() && memo_stamp[(id)] == stamp)
+
+  to_process.push_back(std::make_pair(t, false));
+  while (!to_process.empty()) {
+
+    term_ref current = to_process.back().first;
+    const term& current_term = term_of(current);
+    size_t current_id = current_term.d_id;
+
+    // Already processed (shared subterm)
+    if (SUBSTITUTE_KNOWN(current_id)) {
+      to_process.pop_back();
+      continue;
+    }
+
+    if (!to_process.back().second) {
+      // Make room in the memo
+      if (current_id >= memo_stamp.size()) {
+        size_t new_size = memo_stamp.size() < 1024 ? 1024 : memo_stamp.size();
+        while (new_size <= current_id) { new_size *= 2; }
+        memo.resize(new_size);
+        memo_stamp.resize(new_size, 0);
+      }
+      // Substituted directly
+      substitution_map::const_iterator find = subst.find(current);
+      if (find != subst.end()) {
+        memo[current_id] = find->second;
+        memo_stamp[current_id] = stamp;
+        to_process.pop_back();
+        continue;
+      }
+      // Process the children first
+      to_process.back().second = true;
+      for (size_t i = current_term.size(); i > 0; -- i) {
+        term_ref child = current_term[i-1];
+        if (!SUBSTITUTE_KNOWN(id_of(child))) {
+          to_process.push_back(std::make_pair(child, false));
+        }
+      }
+      continue;
+    }
+
+    // All children done
+    to_process.pop_back();
+    bool child_changed = false;
+    children.clear();
+    for (size_t i = 0; i < current_term.size(); ++ i) {
+      term_ref child = current_term[i];
+      term_ref child_subst = memo[id_of(child)];
+      if (child_subst != child) {
+        child_changed = true;
+      }
+      children.push_back(child_subst);
+    }
+
+    term_ref current_new = current;
+    if (child_changed) {
+      term_op op = current_term.op();
+      // Need special cases for operators with payload
+      switch (op) {
+      case TERM_BV_EXTRACT: {
+        // Make a copy, in case we resize on construction
+        bitvector_extract extract = payload_of<bitvector_extract>(current_term);
+        current_new = mk_term<TERM_BV_EXTRACT>(extract, children[0]);
+        break;
+      }
+      case TERM_BV_SGN_EXTEND: {
+        // Make a copy, in case we resize on construction
+        bitvector_sgn_extend extend = payload_of<bitvector_sgn_extend>(current_term);
+        current_new = mk_term<TERM_BV_SGN_EXTEND>(extend, children[0]);
+        break;
+      }
+      default:
+        current_new = mk_term(op, children.begin(), children.end());
+      }
     }
-    children.push_back(child_subst);
-  }
 
-  // Check if anything changed
-  if (!child_changed) {
-    subst[t] = t;
-    return t;
+    memo[current_id] = current_new;
+    memo_stamp[current_id] = stamp;
+    if (cache) {
+      scratch.rewritten.push_back(current);
+    }
   }
 
-  // Something changed
-  term_ref t_new;
-  term_op op = term_of(t).op();
-  // Need special cases for operators with payload
-  switch (op) {
-  case TERM_BV_EXTRACT: {
-    // Make a copy, in case we resize on construction
-    bitvector_extract extract = payload_of<bitvector_extract>(t);
-    t_new = mk_term<TERM_BV_EXTRACT>(extract, children[0]);
-    break;
+#undef SUBSTITUTE_KNOWN
+
+  // Remember all the results
+  if (cache) {
+    for (size_t i = 0; i < scratch.rewritten.size(); ++ i) {
+      term_ref rewritten = scratch.rewritten[i];
+      (*cache)[rewritten] = memo[id_of(rewritten)];
+    }
   }
-  case TERM_BV_SGN_EXTEND: {
-    // Make a copy, in case we resize on construction
-    bitvector_sgn_extend extend = payload_of<bitvector_sgn_extend>(t);
-    t_new = mk_term<TERM_BV_SGN_EXTEND>(extend, children[0]);
+
+  return memo[id_of(t)];
+}
+
+term_ref term_manager_internal::translate(const term_manager_internal& from, term_ref t, substitution_map& cache) {
+
+  std::vector<term_ref> to_process;
+  std::vector<term_ref> children;
+
+  to_process.push_back(t);
+  while (!to_process.empty()) {
+
+    term_ref current = to_process.back();
+
+    // Already translated
+    if (cache.find(current) != cache.end()) {
+      to_process.pop_back();
+      continue;
+    }
+
+    // Translate the children first
+    const term& current_term = from.term_of(current);
+    bool children_done = true;
+    for (size_t i = 0; i < current_term.size(); ++ i) {
+      if (cache.find(current_term[i]) == cache.end()) {
+        to_process.push_back(current_term[i]);
+        children_done = false;
+      }
+    }
+    if (!children_done) {
+      continue;
+    }
+
+    // All children translated, so construct the term
+    children.clear();
+    for (size_t i = 0; i < current_term.size(); ++ i) {
+      children.push_back(cache[current_term[i]]);
+    }
+
+    term_ref current_new;
+
+#define SWITCH_TO_TRANSLATE(OP) \
+  case OP: \
+    current_new = mk_term<OP>(from.payload_of<term_op_traits<OP>::payload_type>(current_term), children.begin(), children.end()); \
     break;
+
+    switch (current_term.op()) {
+    SWITCH_TO_TRANSLATE(TYPE_TYPE)
+    SWITCH_TO_TRANSLATE(TYPE_BOOL)
+    SWITCH_TO_TRANSLATE(TYPE_INTEGER)
+    SWITCH_TO_TRANSLATE(TYPE_REAL)
+    SWITCH_TO_TRANSLATE(TYPE_STRING)
+    SWITCH_TO_TRANSLATE(TYPE_BITVECTOR)
+    SWITCH_TO_TRANSLATE(TYPE_STRUCT)
+    SWITCH_TO_TRANSLATE(TYPE_TUPLE)
+    SWITCH_TO_TRANSLATE(TYPE_ENUM)
+    SWITCH_TO_TRANSLATE(TYPE_RECORD)
+    SWITCH_TO_TRANSLATE(TYPE_FUNCTION)
+    SWITCH_TO_TRANSLATE(TYPE_ARRAY)
+    SWITCH_TO_TRANSLATE(TYPE_PREDICATE_SUBTYPE)
+    SWITCH_TO_TRANSLATE(VARIABLE)
+    SWITCH_TO_TRANSLATE(TERM_ITE)
+    SWITCH_TO_TRANSLATE(TERM_EQ)
+    SWITCH_TO_TRANSLATE(CONST_BOOL)
+    SWITCH_TO_TRANSLATE(TERM_AND)
+    SWITCH_TO_TRANSLATE(TERM_OR)
+    SWITCH_TO_TRANSLATE(TERM_NOT)
+    SWITCH_TO_TRANSLATE(TERM_IMPLIES)
+    SWITCH_TO_TRANSLATE(TERM_XOR)
+    SWITCH_TO_TRANSLATE(CONST_RATIONAL)
+    SWITCH_TO_TRANSLATE(TERM_ADD)
+    SWITCH_TO_TRANSLATE(TERM_SUB)
+    SWITCH_TO_TRANSLATE(TERM_MUL)
+    SWITCH_TO_TRANSLATE(TERM_DIV)
+    SWITCH_TO_TRANSLATE(TERM_MOD)
+    SWITCH_TO_TRANSLATE(TERM_LEQ)
+    SWITCH_TO_TRANSLATE(TERM_LT)
+    SWITCH_TO_TRANSLATE(TERM_GEQ)
+    SWITCH_TO_TRANSLATE(TERM_GT)
+    SWITCH_TO_TRANSLATE(TERM_TO_INT)
+    SWITCH_TO_TRANSLATE(TERM_TO_REAL)
+    SWITCH_TO_TRANSLATE(TERM_IS_INT)
+    SWITCH_TO_TRANSLATE(CONST_BITVECTOR)
+    SWITCH_TO_TRANSLATE(TERM_BV_ADD)
+    SWITCH_TO_TRANSLATE(TERM_BV_SUB)
+    SWITCH_TO_TRANSLATE(TERM_BV_MUL)
+    SWITCH_TO_TRANSLATE(TERM_BV_UDIV)
+    SWITCH_TO_TRANSLATE(TERM_BV_SDIV)
+    SWITCH_TO_TRANSLATE(TERM_BV_UREM)
+    SWITCH_TO_TRANSLATE(TERM_BV_SREM)
+    SWITCH_TO_TRANSLATE(TERM_BV_SMOD)
+    SWITCH_TO_TRANSLATE(TERM_BV_XOR)
+    SWITCH_TO_TRANSLATE(TERM_BV_SHL)
+    SWITCH_TO_TRANSLATE(TERM_BV_LSHR)
+    SWITCH_TO_TRANSLATE(TERM_BV_ASHR)
+    SWITCH_TO_TRANSLATE(TERM_BV_NOT)
+    SWITCH_TO_TRANSLATE(TERM_BV_AND)
+    SWITCH_TO_TRANSLATE(TERM_BV_OR)
+    SWITCH_TO_TRANSLATE(TERM_BV_NAND)
+    SWITCH_TO_TRANSLATE(TERM_BV_NOR)
+    SWITCH_TO_TRANSLATE(TERM_BV_XNOR)
+    SWITCH_TO_TRANSLATE(TERM_BV_CONCAT)
+    SWITCH_TO_TRANSLATE(TERM_BV_EXTRACT)
+    SWITCH_TO_TRANSLATE(TERM_BV_ULEQ)
+    SWITCH_TO_TRANSLATE(TERM_BV_SLEQ)
+    SWITCH_TO_TRANSLATE(TERM_BV_ULT)
+    SWITCH_TO_TRANSLATE(TERM_BV_SLT)
+    SWITCH_TO_TRANSLATE(TERM_BV_UGEQ)
+    SWITCH_TO_TRANSLATE(TERM_BV_SGEQ)
+    SWITCH_TO_TRANSLATE(TERM_BV_UGT)
+    SWITCH_TO_TRANSLATE(TERM_BV_SGT)
+    SWITCH_TO_TRANSLATE(TERM_BV_SGN_EXTEND)
+    SWITCH_TO_TRANSLATE(TERM_ARRAY_READ)
+    SWITCH_TO_TRANSLATE(TERM_ARRAY_WRITE)
+    SWITCH_TO_TRANSLATE(TERM_ARRAY_LAMBDA)
+    SWITCH_TO_TRANSLATE(TERM_TUPLE_CONSTRUCT)
+    SWITCH_TO_TRANSLATE(TERM_TUPLE_READ)
+    SWITCH_TO_TRANSLATE(TERM_TUPLE_WRITE)
+    SWITCH_TO_TRANSLATE(CONST_ENUM)
+    SWITCH_TO_TRANSLATE(TERM_RECORD_CONSTRUCT)
+    SWITCH_TO_TRANSLATE(TERM_RECORD_READ)
+    SWITCH_TO_TRANSLATE(TERM_RECORD_WRITE)
+    SWITCH_TO_TRANSLATE(TERM_LAMBDA)
+    SWITCH_TO_TRANSLATE(TERM_EXISTS)
+    SWITCH_TO_TRANSLATE(TERM_FORALL)
+    SWITCH_TO_TRANSLATE(TERM_FUN_APP)
+    SWITCH_TO_TRANSLATE(CONST_STRING)
+    default:
+      assert(false);
+    }
+
+#undef SWITCH_TO_TRANSLATE
+
+    cache[current] = current_new;
+    to_process.pop_back();
   }
-  default:
-    t_new = mk_term(op, children.begin(), children.end());
-  }
-  subst[t] = t_new;
 
-  // Return the result
-  return t_new;
+  return cache[t];
 }
 
 term_ref term_manager_internal::bitvector_type(size_t size) {
+   concurrent_lock<boost::recursive_mutex> lock(d_cache_mutex, d_concurrent);
    bitvector_type_map::const_iterator find = d_bitvectorType.find(size);
    if (find!= d_bitvectorType.end()) return find->second;
    term_ref new_type = mk_term<TYPE_BITVECTOR>(size);
@@ -475,9 +798,73 @@ const utils::name_transformer* term_manager_internal::get_name_transformer() con
   return d_name_transformer;
 }
 
+template <typename payload_type>
+term_manager_internal::payload_ref term_manager_internal::gc_copy_payload(term_op op, payload_ref p_ref, alloc::allocator_base* new_payload_memory[]) {
+  typedef alloc::allocator<payload_type, alloc::empty_type> payload_allocator;
+  if (new_payload_memory[op] == 0) {
+    new_payload_memory[op] = new payload_allocator();
+  }
+  const payload_type& payload = ((payload_allocator*) d_payload_memory[op])->object_of(p_ref);
+  payload_allocator* palloc = ((payload_allocator*) new_payload_memory[op]);
+  return palloc->template allocate<alloc::empty_type*>(payload, 0, 0, 0);
+}
+
+term_manager_internal::payload_ref term_manager_internal::gc_copy_payload(term_op op, payload_ref p_ref, alloc::allocator_base* new_payload_memory[]) {
+
+#define SWITCH_TO_COPY(OP) case OP: return gc_copy_payload<term_op_traits<OP>::payload_type>(op, p_ref, new_payload_memory);
+
+  // Only the kinds that have a payload
+  switch (op) {
+    SWITCH_TO_COPY(TYPE_BITVECTOR)
+    SWITCH_TO_COPY(TERM_BV_EXTRACT)
+    SWITCH_TO_COPY(TERM_BV_SGN_EXTEND)
+    SWITCH_TO_COPY(CONST_BOOL)
+    SWITCH_TO_COPY(CONST_RATIONAL)
+    SWITCH_TO_COPY(CONST_BITVECTOR)
+    SWITCH_TO_COPY(CONST_ENUM)
+    SWITCH_TO_COPY(VARIABLE)
+    SWITCH_TO_COPY(TERM_TUPLE_READ)
+    SWITCH_TO_COPY(TERM_TUPLE_WRITE)
+    SWITCH_TO_COPY(CONST_STRING)
+  default:
+    assert(false);
+  }
+
+#undef SWITCH_TO_COPY
+
+  return payload_ref();
+}
+
+void term_manager_internal::gc_relocate(term_to_term_map& map, const std::map<expr::term_ref, expr::term_ref>& reloc_map) {
+  term_to_term_map new_map;
+  term_to_term_map::const_iterator it = map.begin(), it_end = map.end();
+  for (; it != it_end; ++ it) {
+    std::map<expr::term_ref, expr::term_ref>::const_iterator key_find = reloc_map.find(it->first);
+    if (key_find != reloc_map.end()) {
+      // Values of live keys are kept alive by marking
+      std::map<expr::term_ref, expr::term_ref>::const_iterator value_find = reloc_map.find(it->second);
+      assert(it->second.is_null() || value_find != reloc_map.end());
+      new_map[key_find->second] = value_find == reloc_map.end() ? it->second : value_find->second;
+    }
+  }
+  map.swap(new_map);
+}
+
+void term_manager_internal::gc_relocate(term_ref_strong& t, const std::map<expr::term_ref, expr::term_ref>& reloc_map) {
+  if (!t.is_null()) {
+    std::map<expr::term_ref, expr::term_ref>::const_iterator find = reloc_map.find(t);
+    assert(find != reloc_map.end());
+    t = term_ref_strong(*this, find->second);
+  }
+}
+
 void term_manager_internal::gc(std::map<expr::term_ref, expr::term_ref>& reloc_map) {
   assert(reloc_map.empty());
 
+  if (d_concurrent) {
+    throw exception("Garbage collection is not supported by concurrent term managers");
+  }
+
   TRACE("gc") << "term_manager_internal::gc(): begin" << std::endl;
 
   typedef boost::unordered_set<term_ref, term_ref_hasher> visited_set;
@@ -488,21 +875,22 @@ void term_manager_internal::gc(std::map<expr::term_ref, expr::term_ref>& reloc_m
   // Terms we've visited already
   visited_set visited_terms;
 
-  // Payloads that we've visited one set per term_op
-  visited_set visited_payloads[OP_LAST];
-
-  // Go though all ids and get the terms with refcount > 0
-  tref_id_map::const_iterator terms_it = d_term_ids.begin(), terms_it_end = d_term_ids.end();
+  // Go though all terms and get the ones with refcount > 0
+  term_table::const_iterator terms_it = d_pool.begin(), terms_it_end = d_pool.end();
   for (; terms_it != terms_it_end; ++ terms_it) {
-    assert(terms_it->second < d_term_refcount.size());
-    if (d_term_refcount[terms_it->second] > 0) {
-      term_ref t = terms_it->first;
+    if (terms_it->ref.is_null()) {
+      continue;
+    }
+    size_t id = term_of(terms_it->ref).d_id;
+    assert(id < d_term_refcount.size());
+    if (d_term_refcount[id] > 0) {
+      term_ref t = terms_it->ref;
       queue.push(t);
       visited_terms.insert(t);
     }
   }
 
-  // Traverse the terms and collect all subterms and payloads
+  // Traverse the terms and collect all subterms, types and TCCs
   while (!queue.empty()) {
 
     // Process current
@@ -518,16 +906,108 @@ void term_manager_internal::gc(std::map<expr::term_ref, expr::term_ref>& reloc_m
       }
     }
 
-    // Add payload if any
-    term_op op = current_term.op();
-    if (d_payload_memory[op]) {
-      visited_payloads[op].insert(*current_term.end());
+    // Add the cached information, if any
+    const term_to_term_map* caches[3] = { &d_type_cache, &d_base_type_cache, &d_tcc_map };
+    for (size_t i = 0; i < 3; ++ i) {
+      term_to_term_map::const_iterator find = caches[i]->find(current);
+      if (find != caches[i]->end() && !find->second.is_null()) {
+        if (visited_terms.find(find->second) == visited_terms.end()) {
+          queue.push(find->second);
+          visited_terms.insert(find->second);
+        }
+      }
+    }
+  }
+
+  // Children are always allocated before parents, so copying the live terms
+  // in allocation order relocates the children before the parents
+  std::vector<term_ref> live_terms(visited_terms.begin(), visited_terms.end());
+  std::sort(live_terms.begin(), live_terms.end());
+
+  // New memory for terms and payloads
+  alloc::allocator<term, term_ref> new_memory;
+  alloc::allocator_base* new_payload_memory[OP_LAST];
+  for (unsigned i = 0; i < OP_LAST; ++ i) {
+    new_payload_memory[i] = 0;
+  }
+
+  // Copy the live terms to the new memory and rebuild the pool
+  term_table new_pool;
+  std::vector<term_ref> children;
+  for (size_t k = 0; k < live_terms.size(); ++ k) {
+    term_ref t_ref = live_terms[k];
+    const term& t = term_of(t_ref);
+    term_op op = t.op();
+
+    // Relocated children
+    children.clear();
+    for (size_t i = 0; i < t.size(); ++ i) {
+      assert(reloc_map.find(t[i]) != reloc_map.end());
+      children.push_back(reloc_map.find(t[i])->second);
     }
+
+    // Copy the term and the payload, ids don't change
+    term_ref new_ref;
+    if (d_payload_memory[op] == 0) {
+      new_ref = new_memory.allocate(term(op, t.d_id, t.hash()), children.begin(), children.end(), 0);
+    } else {
+      payload_ref p_ref = gc_copy_payload(op, *t.end(), new_payload_memory);
+      new_ref = new_memory.allocate(term(op, t.d_id, t.hash()), children.begin(), children.end(), 1);
+      *alloc::allocator<term, term_ref>::object_end(new_memory.object_of(new_ref)) = p_ref;
+    }
+    reloc_map[t_ref] = new_ref;
+    new_pool.insert(t.hash(), new_ref);
   }
 
+  // Free the ids of the collected terms
+  for (terms_it = d_pool.begin(); terms_it != terms_it_end; ++ terms_it) {
+    if (!terms_it->ref.is_null() && visited_terms.find(terms_it->ref) == visited_terms.end()) {
+      size_t id = term_of(terms_it->ref).d_id;
+      assert(d_term_refcount[id] == 0);
+      d_term_ids_free.push_back(id);
+    }
+  }
+
+  TRACE("gc") << "term_manager_internal::gc(): kept " << live_terms.size() << " out of " << d_pool.size() << " terms" << std::endl;
+  d_stat_terms_collected->get_value() += d_pool.size() - live_terms.size();
+
+  // Relocate the caches
+  gc_relocate(d_type_cache, reloc_map);
+  gc_relocate(d_base_type_cache, reloc_map);
+  gc_relocate(d_tcc_map, reloc_map);
+
+  // Switch to the new memory, the old memory is destructed on exit
+  d_memory.swap(new_memory);
+  d_pool.swap(new_pool);
+  for (unsigned i = 0; i < OP_LAST; ++ i) {
+    delete d_payload_memory[i];
+    d_payload_memory[i] = new_payload_memory[i];
+  }
+
+  // Relocate our own references
+  gc_relocate(d_typeType, reloc_map);
+  gc_relocate(d_booleanType, reloc_map);
+  gc_relocate(d_integerType, reloc_map);
+  gc_relocate(d_realType, reloc_map);
+  gc_relocate(d_stringType, reloc_map);
+  bitvector_type_map::iterator bv_it = d_bitvectorType.begin();
+  for (; bv_it != d_bitvectorType.end(); ++ bv_it) {
+    gc_relocate(bv_it->second, reloc_map);
+  }
+
+  // Update the statistics
+  d_stat_terms->get_value() = d_memory.size();
+  update_pool_stats();
+
   TRACE("gc") << "term_manager_internal::gc(): end" << std::endl;
 }
 
+void term_manager_internal::update_pool_stats() {
+  d_stat_pool_load->get_value() = d_pool.load();
+  d_stat_pool_probe_avg->get_value() = d_pool.average_probe();
+  d_stat_pool_probe_max->get_value() = d_pool.max_probe();
+}
+
 term_ref term_manager_internal::mk_abstraction(term_op op, const std::vector<term_ref>& vars, term_ref body) {
 
   std::vector<term_ref> children(vars.begin(), vars.end());
@@ -19,12 +19,17 @@
 #pragma once
 
 #include "expr/term.h"
+#include "expr/term_table.h"
 #include "utils/allocator.h"
 #include "utils/name_transformer.h"
 #include "utils/statistics.h"
 
+#include <boost/atomic.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 #include <map>
 #include <queue>
@@ -34,60 +39,27 @@ namespace sally {
 namespace expr {
 
 /**
- * References with additional data, mainly for internal term manager use.
+ * Lock guard that only locks the mutex if the owner is concurrent.
  */
-class term_ref_fat : public term_ref {
-
-protected:
-
-  /** Id of the term in the expression manager */
-  size_t d_id;
-
-  /** Hash of the term */
-  size_t d_hash;
-
-  friend class term_manager_internal;
-
-  term_ref_fat(const term_ref& ref, size_t id, size_t hash)
-  : term_ref(ref), d_id(id), d_hash(hash) {}
-
+template <typename mutex_type>
+class concurrent_lock {
+  mutex_type* d_mutex;
 public:
-
-  /** Construct null reference */
-  term_ref_fat()
-  : term_ref(), d_id(0), d_hash(0) {}
-  /** Construct a copy, while finalizing the other reference if needed */
-  term_ref_fat(const term_ref_fat& other) {
-    *this = other.finalize();
-  }
-
-  virtual ~term_ref_fat() {}
-
-  /** Return the "real" version of self. Default, just self. */
-  virtual term_ref_fat finalize() const {
-    return term_ref_fat(*this, d_id, d_hash);
-  }
-
-  /** The ID of the term. Doesn't change during lifetime */
-  size_t id() const { return d_id; }
-
-  /** Returns the hash of the reference */
-  size_t hash() const { return d_hash; }
-
-  /** By default we compare with references */
-  virtual bool cmp(const term_ref_fat& other) const {
-    assert(index() != 0);
-    assert(other.index() != 0);
-    return index() == other.index();
-  }
-
-  /** Comparison with cmp. If any is null, we use it for this->cmp */
-  bool operator == (const term_ref_fat& ref) const;
+  concurrent_lock(mutex_type& mutex, bool concurrent)
+  : d_mutex(concurrent ? &mutex : 0)
+  { if (d_mutex) d_mutex->lock(); }
+  ~concurrent_lock()
+  { if (d_mutex) d_mutex->unlock(); }
 };
 
 /**
  * Term manager controls the terms, allocation and garbage collection. All
  * terms are defined in term_ops.h.
+ *
+ * A concurrent term manager can be used from several threads at once: the
+ * term memory never moves, the hash-consing pool is split into independently
+ * locked shards, and reference counts are atomic. Garbage collection is not
+ * supported in concurrent mode.
  */
 class term_manager_internal {
 
@@ -99,47 +71,44 @@ public:
   /** Payload references */
   typedef base_ref payload_ref;
 
-  struct term_ref_fat_hasher {
-    size_t operator () (const term_ref_fat& ref) const {
-      return ref.hash();
-    }
-  };
+  /** Map of substitutions */
+  typedef boost::unordered_map<term_ref, term_ref, term_ref_hasher> substitution_map;
 
   /**
-   * A term with all the information in the package.
+   * Matcher for the term table: compares a candidate to the term parts, and
+   * constructs the term if there is no match.
    */
   template <term_op op, typename iterator_type>
-  class term_ref_constructor : public term_ref_fat {
+  class term_matcher {
 
     typedef typename term_op_traits<op>::payload_type payload_type;
 
+    term_manager_internal& d_tm;
+
     /** The payload */
     const payload_type& d_payload;
     /** The first child */
     iterator_type d_begin;
     /** One past last child */
     iterator_type d_end;
-
-    term_manager_internal& d_tm;
+    /** Hash of the parts */
+    size_t d_hash;
 
   public:
 
-    term_ref_constructor(term_manager_internal& tm, const payload_type& payload, iterator_type begin, iterator_type end)
-    : term_ref_fat(term_ref(), 0, tm.term_hash<op, iterator_type>(payload, begin, end))
+    term_matcher(term_manager_internal& tm, const payload_type& payload, iterator_type begin, iterator_type end, size_t hash)
+    : d_tm(tm)
     , d_payload(payload)
     , d_begin(begin)
     , d_end(end)
-    , d_tm(tm)
+    , d_hash(hash)
     {}
 
-    /** Compare to a term op without using the hash. */
-    bool cmp(const term_ref_fat& other_ref) const;
+    /** Does the existing term match the parts */
+    bool matches(term_ref other_ref) const;
 
-    /**
-     * Actually construct the reference. This is remembered and guarded from
-     * calling more than once.
-     */
-    virtual term_ref_fat finalize() const {
+    /** Construct the term */
+    term_ref make() const {
       return d_tm.mk_term_internal<op, iterator_type>(d_payload, d_begin, d_end, d_hash);
     }
 
@@ -155,13 +124,31 @@ private:
 
   /** Generic term constructor */
   template <term_op op, typename iterator_type>
-  term_ref_fat mk_term_internal(const typename term_op_traits<op>::payload_type& payload, iterator_type children_begin, iterator_type children_end, size_t hash);
-
-  /** The underlying hash set */
-  typedef boost::unordered_set<term_ref_fat, term_ref_fat_hasher> term_ref_hash_set;
+  term_ref mk_term_internal(const typename term_op_traits<op>::payload_type& payload, iterator_type children_begin, iterator_type children_end, size_t hash);
 
   /** The pool of existing terms */
-  term_ref_hash_set d_pool;
+  term_table d_pool;
+
+  /** Is the manager concurrent */
+  bool d_concurrent;
+
+  /** A shard of the pool (concurrent mode) */
+  struct pool_shard {
+    boost::mutex mutex;
+    term_table pool;
+  };
+
+  /** Number of pool shards (concurrent mode) */
+  static const size_t s_pool_shards = 64;
+
+  /** The pool of existing terms, split by hash (concurrent mode) */
+  pool_shard* d_pool_shards;
+
+  /** Mutex for the type caches and type construction (concurrent mode) */
+  mutable boost::recursive_mutex d_cache_mutex;
+
+  /** Create the payload allocators upfront (concurrent mode) */
+  void mk_payload_memory();
 
   typedef boost::unordered_map<term_ref, term_ref, term_ref_hasher> term_to_term_map;
 
@@ -181,32 +168,108 @@ private:
   template <term_op op, typename iterator_type>
   size_t term_hash(const typename term_op_traits<op>::payload_type& payload, iterator_type begin, iterator_type end);
 
-  typedef boost::unordered_map<term_ref, size_t, term_ref_hasher> tref_id_map;
-
-  /** Map from term references to their ids */
-  tref_id_map d_term_ids;
-
   /** Reference counts */
   std::vector<size_t> d_term_refcount;
 
+  /** A page of reference counts (concurrent mode) */
+  struct refcount_page {
+    boost::atomic<size_t> counts[1 << 16];
+  };
+
+  /** Number of reference count pages (enough for all 32-bit ids) */
+  static const size_t s_refcount_pages = 1 << 16;
+
+  /** Reference counts, in pages that never move (concurrent mode) */
+  boost::atomic<refcount_page*>* d_term_refcount_pages;
+
+  /** Mutex for allocating the reference count pages */
+  boost::mutex d_term_refcount_pages_mutex;
+
+  /** Next fresh term id (concurrent mode) */
+  boost::atomic<size_t> d_term_ids_next;
+
+  /** Get the reference count of the given id (concurrent mode) */
+  boost::atomic<size_t>& refcount_of(size_t id) const {
+    refcount_page* page = d_term_refcount_pages[id >> 16].load(boost::memory_order_acquire);
+    return page->counts[id & 0xffff];
+  }
+
   friend class term_ref_strong;
 
   void attach(size_t id) {
-    d_term_refcount[id] ++;
+    if (d_concurrent) {
+      refcount_of(id).fetch_add(1, boost::memory_order_relaxed);
+    } else {
+      d_term_refcount[id] ++;
+    }
   }
 
   void detach(size_t id) {
-    assert(d_term_refcount[id] > 0);
-    d_term_refcount[id] --;
+    if (d_concurrent) {
+      assert(refcount_of(id).load() > 0);
+      refcount_of(id).fetch_sub(1, boost::memory_order_relaxed);
+    } else {
+      assert(d_term_refcount[id] > 0);
+      d_term_refcount[id] --;
+    }
   }
 
+  /** Ids of collected terms, available for reuse */
+  std::vector<size_t> d_term_ids_free;
+
   /** Get a new id of the term */
   size_t new_term_id() {
+    if (d_concurrent) {
+      return new_term_id_concurrent();
+    }
+    if (!d_term_ids_free.empty()) {
+      size_t id = d_term_ids_free.back();
+      d_term_ids_free.pop_back();
+      assert(d_term_refcount[id] == 0);
+      return id;
+    }
     size_t id = d_term_refcount.size();
     d_term_refcount.push_back(0);
     return id;
   }
 
+  /** Get a new id of the term (concurrent mode, ids are never reused) */
+  size_t new_term_id_concurrent();
+
+  /** Copy the payload of an op into the new payload memory (for gc) */
+  payload_ref gc_copy_payload(term_op op, payload_ref p_ref, alloc::allocator_base* new_payload_memory[]);
+
+  /** Copy the payload of given type into the new payload memory (for gc) */
+  template <typename payload_type>
+  payload_ref gc_copy_payload(term_op op, payload_ref p_ref, alloc::allocator_base* new_payload_memory[]);
+
+  /** Relocate the values of the map, and drop entries with collected keys (for gc) */
+  void gc_relocate(term_to_term_map& map, const std::map<expr::term_ref, expr::term_ref>& reloc_map);
+
+  /** Relocate the strong reference (for gc) */
+  void gc_relocate(term_ref_strong& t, const std::map<expr::term_ref, expr::term_ref>& reloc_map);
+
+  /**
+   * Scratch space for substitution: a memo indexed by term ids (valid for the
+   * current stamp only), the explicit post-order stack, and a children buffer.
+   * Reused across calls so that substitution doesn't allocate in steady state.
+   */
+  struct substitution_scratch {
+    std::vector<term_ref> memo;
+    std::vector<size_t> memo_stamp;
+    size_t stamp;
+    std::vector<std::pair<term_ref, bool> > to_process;
+    std::vector<term_ref> children;
+    std::vector<term_ref> rewritten;
+    substitution_scratch(): stamp(0) {}
+  };
+
+  /** Scratch space for substitution (not used in concurrent mode) */
+  substitution_scratch d_substitution_scratch;
+
+  /** Substitute, and add all the rewritten subterms to cache if not null */
+  term_ref substitute(term_ref t, const substitution_map& subst, substitution_map* cache, substitution_scratch& scratch);
+
   //
   // These below should be last, so that they are destructed first
   //
@@ -239,13 +302,31 @@ private:
 
   utils::stat_int* d_stat_terms;
 
+  /** Number of terms collected by gc */
+  utils::stat_int* d_stat_terms_collected;
+
+  /** Load of the term table */
+  utils::stat_double* d_stat_pool_load;
+
+  /** Average number of probes per term table lookup */
+  utils::stat_double* d_stat_pool_probe_avg;
+
+  /** Longest term table probe */
+  utils::stat_int* d_stat_pool_probe_max;
+
+  /** Update the term table statistics (only when it grows, not per lookup) */
+  void update_pool_stats();
+
   /** Compute the type of t and all subterms */
   void compute_type(term_ref t);
 
 public:
 
-  /** Construct them manager */
-  term_manager_internal(utils::statistics& stats);
+  /** Construct them manager (concurrent if requested) */
+  term_manager_internal(utils::statistics& stats, bool concurrent = false);
+
+  /** Is the manager concurrent */
+  bool is_concurrent() const { return d_concurrent; }
 
   /** Destruct the manager, and destruct all payloads that the manager owns */
   ~term_manager_internal();
@@ -493,8 +574,7 @@ public:
   /** Get the id of the term */
   size_t id_of(term_ref ref) const {
     if (ref.is_null()) return 0;
-    assert(d_term_ids.find(ref) != d_term_ids.end());
-    return d_term_ids.find(ref)->second;
+    return term_of(ref).d_id;
   }
 
   /** Get the hash of the term */
@@ -549,11 +629,18 @@ public:
   /** Returns the default value for the given type */
   term_ref get_default_value(term_ref type);
 
-  /** Map of substitutions */
-  typedef boost::unordered_map<term_ref, term_ref, term_ref_hasher> substitution_map;
-
   /** Return t with subst applied */
-  term_ref substitute(term_ref t, substitution_map& subst);
+  term_ref substitute(term_ref t, const substitution_map& subst);
+
+  /** Return t with subst applied, and add all the rewritten subterms to subst */
+  term_ref substitute_and_cache(term_ref t, substitution_map& subst);
+
+  /**
+   * Copy the term t from the manager from into this manager. Terms already
+   * translated are kept in the cache (from-term -> this-term). Variables not
+   * in the cache are copied to fresh variables of the same name and type.
+   */
+  term_ref translate(const term_manager_internal& from, term_ref t, substitution_map& cache);
 
   /** Set a transformer for variable names (set 0 to unset) */
   void set_name_transformer(const utils::name_transformer* transformer);
@@ -566,7 +653,11 @@ public:
 
   /**
    * Collect the non-used terms, and compact the term database. The relocation
-   * map is added to the given map.
+   * map is added to the given map. Terms reachable from terms with positive
+   * reference count (including their types and TCCs) are kept and moved to
+   * fresh memory, keeping their relative order and their ids. Everything else
+   * is destructed. All weak references must be relocated by the caller.
+   * Not supported in concurrent mode.
    */
   void gc(std::map<expr::term_ref, expr::term_ref>& reloc_map);
 
@@ -621,8 +712,8 @@ size_t term_manager_internal::term_hash(const typename term_op_traits<op>::paylo
 
   typedef typename term_op_traits<op>::payload_type payload_type;
 
-  // Compute the hash of the term
-  utils::sequence_hash hasher;
+  // Compute the hash of the term (the table uses the low bits directly)
+  utils::mixing_hash hasher;
   hasher.add(op);
 
   // If there are children, add to the hash
@@ -639,7 +730,7 @@ size_t term_manager_internal::term_hash(const typename term_op_traits<op>::paylo
 }
 
 template <term_op op, typename iterator_type>
-term_ref_fat term_manager_internal::mk_term_internal(const typename term_op_traits<op>::payload_type& payload, iterator_type begin, iterator_type end, size_t hash) {
+term_ref term_manager_internal::mk_term_internal(const typename term_op_traits<op>::payload_type& payload, iterator_type begin, iterator_type end, size_t hash) {
 
   typedef typename term_op_traits<op>::payload_type payload_type;
   typedef alloc::allocator<payload_type, alloc::empty_type> payload_allocator;
@@ -647,7 +738,7 @@ term_ref_fat term_manager_internal::mk_term_internal(const typename term_op_trai
   // Construct the payload if any
   payload_ref p_ref;
   if (!alloc::type_traits<payload_type>::is_empty) {
-    // If no payload allocator, construct it
+    // If no payload allocator, construct it (always there in concurrent mode)
     if (d_payload_memory[op] == 0) {
       d_payload_memory[op] = new payload_allocator();
     }
@@ -656,59 +747,67 @@ term_ref_fat term_manager_internal::mk_term_internal(const typename term_op_trai
     p_ref = palloc->template allocate<alloc::empty_type*>(payload, 0, 0, 0);
   }
 
+  // Get the id of the term
+  size_t id = new_term_id();
+
   // Construct the term
   term_ref t_ref;
   if (alloc::type_traits<payload_type>::is_empty) {
     // No payload, 0 for extras
-    t_ref = d_memory.allocate(term(op, hash), begin, end, 0);
+    t_ref = d_memory.allocate(term(op, id, hash), begin, end, 0);
   } else {
     // Pyaload active, add a child
-    t_ref = d_memory.allocate(term(op, hash), begin, end, 1);
+    t_ref = d_memory.allocate(term(op, id, hash), begin, end, 1);
     *alloc::allocator<term, term_ref>::object_end(d_memory.object_of(t_ref)) = p_ref;
   }
 
-  // Update the statistic
-  d_stat_terms->get_value() = d_memory.size();
-
-  // Set the id of the term and add to terms
-  size_t id = new_term_id();
-  d_term_ids[t_ref] = id;
+  // Update the statistic (not kept up to date in concurrent mode)
+  if (!d_concurrent) {
+    d_stat_terms->get_value() = d_memory.size();
+  }
 
-  // Get the reference
-  return term_ref_fat(t_ref, id, hash);
+  return t_ref;
 }
 
 template <term_op op, typename iterator_type>
 term_ref term_manager_internal::mk_term(const typename term_op_traits<op>::payload_type& payload, iterator_type begin, iterator_type end) {
-  // Insert and return the actual term_ref
-  term_ref_fat fat_ref = *d_pool.insert(term_ref_constructor<op, iterator_type>(*this, payload, begin, end)).first;
-  return fat_ref;
+  size_t hash = term_hash<op, iterator_type>(payload, begin, end);
+  term_matcher<op, iterator_type> matcher(*this, payload, begin, end, hash);
+  if (d_concurrent) {
+    // Insert into the shard of the hash, under the shard lock (the shard is
+    // picked by the high bits, the table in the shard uses the low bits)
+    pool_shard& shard = d_pool_shards[(hash >> 32) % s_pool_shards];
+    boost::lock_guard<boost::mutex> lock(shard.mutex);
+    return shard.pool.find_or_insert(hash, matcher);
+  }
+  // Find or insert, and return the actual term_ref
+  size_t capacity = d_pool.capacity();
+  term_ref result = d_pool.find_or_insert(hash, matcher);
+  if (d_pool.capacity() != capacity) {
+    update_pool_stats();
+  }
+  return result;
 }
 
 /** Compare to a term op without using the hash. */
 template <term_op op, typename iterator_type>
-bool term_manager_internal::term_ref_constructor<op, iterator_type>::cmp(const term_ref_fat& other_ref) const {
-
-  // If the other reference is null, we're comparing to default => not equal
-  if (other_ref.is_null()) {
-    return false;
-  }
+bool term_manager_internal::term_matcher<op, iterator_type>::matches(term_ref other_ref) const {
 
-  // Compare hashes first
-  if (hash() != other_ref.hash()) {
+  // Variables are always different, even variables with the same name
+  if (op == VARIABLE) {
     return false;
   }
 
   // The actual term we are comparing with
   const term& other = d_tm.term_of(other_ref);
 
-  // Different ops => not equal
-  if (op != d_tm.term_of(other_ref).op()) {
+  // Compare the full hashes first
+  if (d_hash != other.hash()) {
     return false;
   }
 
-  // Variables are always different, even variables with the same name
-  if (op == VARIABLE) {
+  // Different ops => not equal
+  if (op != other.op()) {
     return false;
   }
 
@@ -0,0 +1,166 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "expr/term.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace sally {
+namespace expr {
+
+/**
+ * Open-addressing hash table of term references, used by the term manager
+ * for hash-consing. Each slot keeps the low bits of the term hash next to the
+ * reference, so probing and growing never touch the term memory. Slots are
+ * probed linearly in a power-of-two array. There is no removal, garbage
+ * collection builds a new table instead.
+ */
+class term_table {
+
+public:
+
+  /** A slot of the table, empty if the reference is null */
+  struct entry {
+    uint32_t hash;
+    term_ref ref;
+    entry(): hash(0), ref() {}
+  };
+
+  typedef std::vector<entry>::const_iterator const_iterator;
+
+  term_table()
+  : d_entries(s_initial_capacity)
+  , d_size(0)
+  , d_lookups(0)
+  , d_probes(0)
+  , d_max_probe(0)
+  {}
+
+  /**
+   * Find the reference that matches, or insert the newly made one. The
+   * matcher provides bool matches(term_ref) for candidates with the same
+   * hash and term_ref make() to construct the term when none matches.
+   */
+  template <typename matcher>
+  term_ref find_or_insert(size_t hash, matcher& m) {
+    size_t mask = d_entries.size() - 1;
+    size_t i = hash & mask;
+    size_t probe = 1;
+    for (; !d_entries[i].ref.is_null(); i = (i + 1) & mask, ++ probe) {
+      const entry& e = d_entries[i];
+      if (e.hash == (uint32_t) hash && m.matches(e.ref)) {
+        record_probe(probe);
+        return e.ref;
+      }
+    }
+    record_probe(probe);
+    term_ref ref = m.make();
+    d_entries[i].hash = hash;
+    d_entries[i].ref = ref;
+    if (++ d_size * 10 > d_entries.size() * 7) {
+      grow();
+    }
+    return ref;
+  }
+
+  /** Insert a reference that is known not to be in the table */
+  void insert(size_t hash, term_ref ref) {
+    if ((d_size + 1) * 10 > d_entries.size() * 7) {
+      grow();
+    }
+    insert_unique(d_entries, hash, ref);
+    ++ d_size;
+  }
+
+  /** Number of references in the table */
+  size_t size() const { return d_size; }
+
+  /** Number of slots in the table */
+  size_t capacity() const { return d_entries.size(); }
+
+  /** Fraction of the slots in use */
+  double load() const { return (double) d_size / d_entries.size(); }
+
+  /** Average number of slots visited per lookup */
+  double average_probe() const { return d_lookups ? (double) d_probes / d_lookups : 0; }
+
+  /** Longest probe sequence of a lookup */
+  size_t max_probe() const { return d_max_probe; }
+
+  /** Iteration over all the slots, including the empty ones */
+  const_iterator begin() const { return d_entries.begin(); }
+  const_iterator end() const { return d_entries.end(); }
+
+  /** Swap the contents (statistics are kept) */
+  void swap(term_table& other) {
+    d_entries.swap(other.d_entries);
+    std::swap(d_size, other.d_size);
+  }
+
+private:
+
+  /** Initial number of slots (a power of two) */
+  static const size_t s_initial_capacity = 1024;
+
+  /** The slots */
+  std::vector<entry> d_entries;
+
+  /** Number of used slots */
+  size_t d_size;
+
+  /** Probe statistics */
+  uint64_t d_lookups;
+  uint64_t d_probes;
+  size_t d_max_probe;
+
+  void record_probe(size_t probe) {
+    ++ d_lookups;
+    d_probes += probe;
+    if (probe > d_max_probe) {
+      d_max_probe = probe;
+    }
+  }
+
+  static void insert_unique(std::vector<entry>& entries, size_t hash, term_ref ref) {
+    size_t mask = entries.size() - 1;
+    size_t i = hash & mask;
+    while (!entries[i].ref.is_null()) {
+      i = (i + 1) & mask;
+    }
+    entries[i].hash = hash;
+    entries[i].ref = ref;
+  }
+
+  /** Double the number of slots and reinsert */
+  void grow() {
+    std::vector<entry> new_entries(2*d_entries.size());
+    for (const_iterator it = d_entries.begin(); it != d_entries.end(); ++ it) {
+      if (!it->ref.is_null()) {
+        insert_unique(new_entries, it->hash, it->ref);
+      }
+    }
+    d_entries.swap(new_entries);
+  }
+
+};
+
+}
+}
@@ -25,11 +25,13 @@
 #include "utils/output.h"
 #include "system/context.h"
 #include "parser/parser.h"
+#include "command/sequence.h"
 #include "engine/factory.h"
 #include "ai/factory.h"
 #include "smt/factory.h"
 #include "utils/trace.h"
 #include "utils/statistics.h"
+#include "utils/budget.h"
 
 using namespace std;
 using namespace boost::program_options;
@@ -42,6 +44,9 @@ void parse_options(int argc, char* argv[], variables_map& variables);
 /** Prints statistics to the given output and given time slice */
 void live_stats(const utils::statistics* stats, std::string file, unsigned time);
 
+/** Interrupts all solvers once out of budget, checking at the given time slice */
+void budget_watchdog(unsigned time);
+
 int main(int argc, char* argv[]) {
 
   try {
@@ -76,6 +81,13 @@ int main(int argc, char* argv[]) {
       }
     }
 
+    // Start the clock for the budget, and watch it to stop the solvers in the middle of a check
+    utils::budget::set_limits(opts.get_unsigned("time-limit"), opts.get_unsigned("memory-limit"));
+    boost::thread *budget_worker = 0;
+    if (utils::budget::has_limits()) {
+      budget_worker = new boost::thread(budget_watchdog, 50);
+    }
+
     // Create the statistics */
     utils::statistics stats;
     stats.add(new utils::stat_timer("sally::time", true));
@@ -119,13 +131,35 @@ int main(int argc, char* argv[]) {
       parser::input_language language = parser::parser::guess_language(files[i]);
       parser::parser p(ctx, language, files[i].c_str());
 
+      // Queries waiting to be checked together (with multi-property)
+      cmd::sequence* queries = 0;
+
       // Parse an process each command
       for (cmd::command* cmd = p.parse_command(); cmd != 0; delete cmd, cmd = p.parse_command()) {
 
         MSG(2) << "Got command " << *cmd << endl;
+        // Collect the queries, they don't change the context
+        if (opts.has_option("multi-property") && cmd->get_type() == cmd::QUERY) {
+          if (queries == 0) { queries = new cmd::sequence(); }
+          queries->push_back(cmd);
+          cmd = 0;
+          continue;
+        }
+        // Run the queries so far
+        if (queries != 0) {
+          queries->run(&ctx, engine_to_use);
+          delete queries;
+          queries = 0;
+        }
         // Run the command
         cmd->run(&ctx, engine_to_use);
       }
+
+      // Run the remaining queries
+      if (queries != 0) {
+        queries->run(&ctx, engine_to_use);
+        delete queries;
+      }
     }
 
     // Delete the engine
@@ -138,6 +172,12 @@ int main(int argc, char* argv[]) {
       stats_worker->interrupt();
       stats_worker->join();
     }
+
+    // Stop the budget thread
+    if (budget_worker) {
+      budget_worker->interrupt();
+      budget_worker->join();
+    }
   } catch (sally::exception& e) {
     cerr << e << endl;
     exit(1);
@@ -209,6 +249,7 @@ void parse_options(int argc, char* argv[], variables_map& variables)
 #endif
       ("show-trace", "Show the counterexample trace if found.")
       ("show-invariant", "Show the invariant if property is proved.")
+      ("multi-property", "Check consecutive queries of the same system together, sharing the work between them.")
       ("parse-only", "Just parse, don't solve.")
       ("engine", value<string>(), get_engines_list().c_str())
       ("ai", value<string>(), get_ai_list().c_str())
@@ -219,6 +260,8 @@ void parse_options(int argc, char* argv[], variables_map& variables)
       ("no-input-namespace", "Don't use input namespace in the the MCMT language")
       ("live-stats", value<string>(), "Output live statistic to the given file (- for stdout).")
       ("live-stats-time", value<unsigned>()->default_value(100), "Time period for statistics output (in miliseconds)")
+      ("time-limit", value<unsigned>()->default_value(0), "Wall-clock time limit (in seconds), after which queries are interrupted (0 for no limit).")
+      ("memory-limit", value<unsigned>()->default_value(0), "Memory limit (in megabytes), after which queries are interrupted (0 for no limit).")
       ("smt2-output", value<string>(), "Generate smt2 logs of solver queries with given prefix.")
       ("no-lets", "Don't use let expressions in printouts.");
       ;
@@ -286,3 +329,15 @@ void live_stats(const utils::statistics* stats, std::string file, unsigned time)
     delete of_out;
   }
 }
+
+void budget_watchdog(unsigned time) {
+  try {
+    // Keep interrupting, a check might have started after the last time
+    for (;;) {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(time));
+      if (utils::budget::exhausted()) {
+        smt::solver::interrupt_all();
+      }
+    }
+  } catch (boost::thread_interrupted&) {}
+}
@@ -0,0 +1,132 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "smt/async_check.h"
+
+namespace sally {
+namespace smt {
+
+async_check::async_check(solver* s)
+: d_solver(s)
+, d_assumptions_class(solver::CLASS_A)
+, d_done(false)
+, d_cancelled(false)
+, d_result(solver::UNKNOWN)
+, d_thread(0)
+{
+  d_thread = new boost::thread(&async_check::run, this);
+}
+
+async_check::async_check(solver* s, const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class)
+: d_solver(s)
+, d_assumptions(assumptions)
+, d_assumptions_class(f_class)
+, d_done(false)
+, d_cancelled(false)
+, d_result(solver::UNKNOWN)
+, d_thread(0)
+{
+  d_thread = new boost::thread(&async_check::run, this);
+}
+
+async_check::~async_check() {
+  cancel();
+  delete d_thread;
+}
+
+void async_check::run() {
+
+  solver::result result = solver::UNKNOWN;
+  std::string error;
+
+  try {
+    if (!cancelled()) {
+      if (d_assumptions.size() > 0) {
+        result = d_solver->check(d_assumptions, d_assumptions_class);
+      } else {
+        result = d_solver->check();
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    // Cancelled
+  } catch (const sally::exception& e) {
+    error = e.get_message();
+  } catch (...) {
+    error = "unknown error";
+  }
+
+  boost::lock_guard<boost::mutex> lock(d_mutex);
+  d_result = d_cancelled ? solver::UNKNOWN : result;
+  d_error = error;
+  d_done = true;
+  d_done_cv.notify_all();
+}
+
+bool async_check::done() {
+  boost::lock_guard<boost::mutex> lock(d_mutex);
+  return d_done;
+}
+
+bool async_check::cancelled() {
+  boost::lock_guard<boost::mutex> lock(d_mutex);
+  return d_cancelled;
+}
+
+bool async_check::wait_until(const boost::posix_time::ptime& deadline) {
+  boost::unique_lock<boost::mutex> lock(d_mutex);
+  while (!d_done) {
+    if (!d_done_cv.timed_wait(lock, deadline)) {
+      return d_done;
+    }
+  }
+  return true;
+}
+
+bool async_check::wait_for(unsigned time) {
+  boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+  return wait_until(now + boost::posix_time::milliseconds(time));
+}
+
+solver::result async_check::get() {
+  boost::unique_lock<boost::mutex> lock(d_mutex);
+  while (!d_done) {
+    d_done_cv.wait(lock);
+  }
+  if (d_error.size() > 0) {
+    throw exception(d_error);
+  }
+  return d_result;
+}
+
+void async_check::cancel() {
+  {
+    boost::lock_guard<boost::mutex> lock(d_mutex);
+    if (!d_done) {
+      d_cancelled = true;
+    }
+  }
+  // Keep interrupting, the check might not have started yet
+  while (!done()) {
+    d_solver->interrupt();
+    wait_for(10);
+  }
+  d_thread->join();
+}
+
+}
+}
@@ -0,0 +1,102 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "smt/solver.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace sally {
+namespace smt {
+
+/**
+ * A satisfiability check running in its own thread. The result can be polled
+ * or waited for with a deadline, and the check can be cancelled. The solver
+ * and its term manager must not be used until the check is done.
+ */
+class async_check {
+
+  /** The solver */
+  solver* d_solver;
+
+  /** Assumptions, if any */
+  std::vector<expr::term_ref> d_assumptions;
+
+  /** Class of the assumptions */
+  solver::formula_class d_assumptions_class;
+
+  /** Lock for the status */
+  boost::mutex d_mutex;
+
+  /** Notified when the check is done */
+  boost::condition_variable d_done_cv;
+
+  /** Is the check done */
+  bool d_done;
+
+  /** Was the check cancelled */
+  bool d_cancelled;
+
+  /** The result */
+  solver::result d_result;
+
+  /** Error message if the check failed */
+  std::string d_error;
+
+  /** The thread running the check */
+  boost::thread* d_thread;
+
+  /** Run the check */
+  void run();
+
+public:
+
+  /** Start checking the assertions of the solver */
+  async_check(solver* s);
+
+  /** Start checking the assertions of the solver under the assumptions */
+  async_check(solver* s, const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class);
+
+  /** Cancels the check if still running */
+  ~async_check();
+
+  /** Is the check done */
+  bool done();
+
+  /** Wait until the check is done or the deadline passes, returns true if done */
+  bool wait_until(const boost::posix_time::ptime& deadline);
+
+  /** Wait for at most the given number of milliseconds, returns true if done */
+  bool wait_for(unsigned time);
+
+  /** Wait for the check and return the result (UNKNOWN if cancelled) */
+  solver::result get();
+
+  /** Stop the check and wait for it (solvers that can't be interrupted finish the check) */
+  void cancel();
+
+  /** Was the check cancelled */
+  bool cancelled();
+};
+
+}
+}
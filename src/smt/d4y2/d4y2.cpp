@@ -130,6 +130,11 @@ bool d4y2::supports(feature f) const {
   return false;
 }
 
+void d4y2::interrupt() {
+  d_dreal4->interrupt();
+  d_yices2->interrupt();
+}
+
 void d4y2::gc() {
   d_yices2->gc();
   d_dreal4->gc();
@@ -82,6 +82,9 @@ public:
   /** Term collection (nothing to do) */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Collect garbage */
   void gc();
 };
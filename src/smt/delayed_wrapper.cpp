@@ -43,7 +43,8 @@ void delayed_wrapper::add(expr::term_ref f, formula_class f_class) {
 
 void delayed_wrapper::flush() {
   for (; d_index < d_assertions.size(); ++ d_index) {
-    if (d_scope < d_assertions_size.size() && d_index == d_assertions_size[d_scope]) {
+    // There might be several (empty) scopes at this point
+    while (d_scope < d_assertions_size.size() && d_index == d_assertions_size[d_scope]) {
       d_scope ++;
       d_solver->push();
     }
@@ -56,6 +57,11 @@ solver::result delayed_wrapper::check() {
   return d_solver->check();
 }
 
+solver::result delayed_wrapper::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  flush();
+  return d_solver->check(assumptions, f_class, core);
+}
+
 void delayed_wrapper::check_model() {
   d_solver->check_model();
 }
@@ -80,12 +86,16 @@ void delayed_wrapper::pop() {
     d_index = d_assertions.size();
   }
   // If scope went below currently processed, also update
-  if (d_assertions_size.size() < d_scope) {
-    d_scope = d_assertions_size.size();
+  while (d_assertions_size.size() < d_scope) {
+    d_scope --;
     d_solver->pop();
   }
 }
 
+size_t delayed_wrapper::get_scope() const {
+  return d_assertions_size.size();
+}
+
 void delayed_wrapper::generalize(generalization_type type, std::vector<expr::term_ref>& out) {
   d_solver->generalize(type, out);
 }
@@ -102,6 +112,10 @@ void delayed_wrapper::add_variable(expr::term_ref var, variable_class f_class) {
   d_solver->add_variable(var, f_class);
 }
 
+void delayed_wrapper::interrupt() {
+  d_solver->interrupt();
+}
+
 void delayed_wrapper::gc_collect(const expr::gc_relocator& gc_reloc) {
   solver::gc_collect(gc_reloc);
 }
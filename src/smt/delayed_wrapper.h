@@ -65,15 +65,21 @@ public:
   bool supports(feature f) const;
   void add(expr::term_ref f, formula_class f_class);
   result check();
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
   void check_model();
   expr::model::ref get_model() const;
   void push();
   void pop();
+
+  /** Number of open push scopes */
+  size_t get_scope() const;
+
   void generalize(generalization_type type, std::vector<expr::term_ref>& projection_out);
   void interpolate(std::vector<expr::term_ref>& out);
   void get_unsat_core(std::vector<expr::term_ref>& out);
   void add_variable(expr::term_ref var, variable_class f_class);
   void set_hint(expr::model::ref m);
+  void interrupt();
   void gc_collect(const expr::gc_relocator& gc_reloc);
 };
 
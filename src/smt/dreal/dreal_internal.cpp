@@ -26,6 +26,7 @@
 #include "expr/term_manager.h"
 #include "expr/term_visitor.h"
 #include "utils/output.h"
+#include "smt/factory.h"
 
 #ifdef WITH_LIBPOLY
 #include "poly/rational.h"
@@ -54,6 +55,8 @@ dreal_internal::dreal_internal(expr::term_manager& tm, const options& opts)
 , d_instance(s_instances)
 , d_options(opts)
 {
+  backend_lock lock;
+
   // Initialize
   TRACE("dreal") << "dreal: created dreal[" << s_instances << "]." << std::endl;      
 
@@ -111,6 +114,7 @@ dreal_internal::~dreal_internal() {
   }
 
   // Cleanup if the last one
+  backend_lock lock;
   s_instances--;
   if (s_instances == 0) {
     // Clear the cache
@@ -18,6 +18,7 @@
 #ifdef WITH_DREAL
 
 #include "smt/dreal/dreal_term_cache.h"
+#include "smt/factory.h"
 #include "expr/gc_relocator.h"
 
 #include <iomanip>
@@ -154,6 +155,8 @@ dreal_term_cache::tm_to_cache_map::~tm_to_cache_map() {
 }
 
 dreal_term_cache* dreal_term_cache::get_cache(expr::term_manager& tm) {
+
+  backend_lock lock;
   dreal_term_cache* cache = 0;
 
   // Try to find an existing one
@@ -186,6 +189,12 @@ void dreal_term_cache::gc_collect(const expr::gc_relocator& gc_reloc) {
   gc_reloc.reloc(d_permanent_terms);
 }
 
+void dreal_term_cache::gc_tm_destroyed() {
+  backend_lock lock;
+  s_tm_to_cache_map.map.erase(d_tm.id());
+  delete this;
+}
+
 
 }
 }
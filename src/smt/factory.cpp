@@ -23,6 +23,8 @@
 #include <iostream>
 #include <iomanip>
 
+#include <boost/thread/recursive_mutex.hpp>
+
 namespace sally {
 namespace smt {
 
@@ -43,18 +45,46 @@ bool factory::s_generate_smt = false;
 
 std::string factory::s_smt2_prefix;
 
+/** Solver backends keep global state, so we create solvers one at a time */
+static boost::recursive_mutex s_backend_mutex;
+
+backend_lock::backend_lock() {
+  s_backend_mutex.lock();
+}
+
+backend_lock::~backend_lock() {
+  s_backend_mutex.unlock();
+}
+
 void factory::set_default_solver(std::string id) {
   s_default_solver = id;
 }
 
+/** Solver given in the options takes precedence (e.g. portfolio workers) */
+static std::string get_solver_id(const options& opts, std::string default_solver) {
+  if (opts.has_option("solver")) {
+    return opts.get_string("solver");
+  }
+  return default_solver;
+}
+
 solver* factory::mk_default_solver(expr::term_manager& tm, const options& opts, utils::statistics& stats) {
-  if (s_default_solver.size() == 0) {
+  std::string id = get_solver_id(opts, s_default_solver);
+  if (id.size() == 0) {
     throw exception("No default solver set.");
   }
-  return mk_solver(s_default_solver, tm, opts, stats);
+  return mk_solver(id, tm, opts, stats);
+}
+
+void factory::check_thread_safe(const options& opts, std::string mode) {
+  std::string id = get_solver_id(opts, s_default_solver);
+  if (id.size() > 0 && !is_thread_safe(id)) {
+    throw exception("Solver " + id + " can't be used from several threads (needed by " + mode + ").");
+  }
 }
 
 solver* factory::mk_solver(std::string id, expr::term_manager& tm, const options& opts, utils::statistics& stats) {
+  backend_lock lock;
   solver_context ctx(tm, opts, stats);
   if (output::get_verbosity(std::cout) > 2) {
     std::cout << "Creating an instance of " + id + " solver." << std::endl;
@@ -67,6 +67,31 @@ public:
   static
   void enable_smt2_output(std::string prefix);
 
+  /** Can instances of the solver be used from several threads at once */
+  static
+  bool is_thread_safe(std::string id);
+
+  /**
+   * Throw an exception if the solver selected by the options can't be used
+   * from several threads at once (mode is reported in the message).
+   */
+  static
+  void check_thread_safe(const options& opts, std::string mode);
+
+};
+
+/**
+ * Lock on the global state of the solver backends (library setup, instance
+ * counts, term caches). The factory holds it while creating solvers, and the
+ * backends take it when they set up or tear down an instance. The lock is
+ * recursive.
+ */
+class backend_lock {
+  backend_lock(const backend_lock&);
+  backend_lock& operator = (const backend_lock&);
+public:
+  backend_lock();
+  ~backend_lock();
 };
 
 }
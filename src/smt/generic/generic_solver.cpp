@@ -24,11 +24,15 @@
 #include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/tee.hpp>
 
+#include <cctype>
+#include <cstdio>
+
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include <unistd.h>
+#include <sys/wait.h>
 
 namespace sally {
 namespace smt {
@@ -41,6 +45,49 @@ typedef boost::iostreams::stream<boost::iostreams::file_descriptor_source> fd_re
 typedef boost::iostreams::tee_device<fd_write_stream, std::ofstream> tee_device;
 typedef boost::iostreams::stream<tee_device> fd_write_stream_tee;
 
+/**
+ * An S-expression as read from the solver output. Atoms are kept as strings
+ * (string literals and quoted symbols without the delimiters).
+ */
+struct sexpr {
+  /** The atom, if not a list */
+  std::string atom;
+  /** The children, if a list */
+  std::vector<sexpr> children;
+  /** Is this a list */
+  bool is_list;
+
+  sexpr(): is_list(false) {}
+
+  /** Is this the given atom */
+  bool is_atom(const char* a) const {
+    return !is_list && atom == a;
+  }
+
+  /** Is this a list starting with the given atom, of the given size */
+  bool is_app(const char* head, size_t size) const {
+    return is_list && children.size() == size && children[0].is_atom(head);
+  }
+
+  void to_stream(std::ostream& out) const {
+    if (is_list) {
+      out << "(";
+      for (size_t i = 0; i < children.size(); ++ i) {
+        if (i) out << " ";
+        children[i].to_stream(out);
+      }
+      out << ")";
+    } else {
+      out << atom;
+    }
+  }
+};
+
+std::ostream& operator << (std::ostream& out, const sexpr& e) {
+  e.to_stream(out);
+  return out;
+}
+
 /**
  * Internal class that does all the work.
  */
@@ -76,6 +123,15 @@ class generic_solver_internal {
   /** Number of declared variables per push */
   std::vector<size_t> d_vars_list_size;
 
+  /** Declarations survive pops (solver supports :global-declarations) */
+  bool d_global_declarations;
+
+  /** Result of the last check */
+  solver::result d_last_result;
+
+  /** Process id of the solver */
+  pid_t d_solver_pid;
+
   /** Returns true if a variable is already declared */
   bool is_declared(expr::term_ref var) const {
     return d_vars_set.find(var) != d_vars_set.end();
@@ -90,6 +146,177 @@ class generic_solver_internal {
     d_vars_set.insert(var);
   }
 
+  /** Skip whitespace and comments in the solver output */
+  void skip_whitespace() {
+    std::istream& in = *d_solver_response;
+    for (;;) {
+      int c = in.peek();
+      if (c == ';') {
+        while (c != EOF && c != '\n') {
+          c = in.get();
+        }
+      } else if (c != EOF && std::isspace(c)) {
+        in.get();
+      } else {
+        break;
+      }
+    }
+  }
+
+  /** Read one S-expression from the solver output */
+  void read(sexpr& e) {
+    std::istream& in = *d_solver_response;
+    skip_whitespace();
+    int c = in.get();
+    switch (c) {
+    case EOF:
+      throw exception("generic solver: unexpected end of solver output");
+    case ')':
+      throw exception("generic solver: unbalanced parenthesis in solver output");
+    case '(':
+      e.is_list = true;
+      for (;;) {
+        skip_whitespace();
+        if (in.peek() == ')') {
+          in.get();
+          break;
+        }
+        e.children.push_back(sexpr());
+        read(e.children.back());
+      }
+      break;
+    case '"':
+      // String literal, "" is an escaped quote
+      for (;;) {
+        c = in.get();
+        if (c == EOF) {
+          throw exception("generic solver: unterminated string in solver output");
+        }
+        if (c == '"') {
+          if (in.peek() != '"') break;
+          c = in.get();
+        }
+        e.atom += (char) c;
+      }
+      break;
+    case '|':
+      // Quoted symbol
+      while ((c = in.get()) != '|') {
+        if (c == EOF) {
+          throw exception("generic solver: unterminated symbol in solver output");
+        }
+        e.atom += (char) c;
+      }
+      break;
+    default:
+      // Regular atom, don't read past the delimiter (might block)
+      e.atom += (char) c;
+      for (;;) {
+        c = in.peek();
+        if (c == EOF || c == '(' || c == ')' || std::isspace(c)) {
+          break;
+        }
+        e.atom += (char) in.get();
+      }
+    }
+  }
+
+  /** Read a response to a command, skipping any notices and reporting errors */
+  void read_response(sexpr& e) {
+    for (;;) {
+      e = sexpr();
+      read(e);
+      if (e.is_atom("success") || e.is_atom("unsupported")) {
+        continue;
+      }
+      if (e.is_app("error", 2)) {
+        throw exception("generic solver error: " + e.children[1].atom);
+      }
+      return;
+    }
+  }
+
+  /** Convert a numeric constant (integer, decimal, negation or division) to a rational */
+  expr::rational to_rational(const sexpr& e) const {
+    if (!e.is_list && !e.atom.empty()) {
+      size_t dot = e.atom.find('.');
+      if (dot == std::string::npos) {
+        return expr::rational(e.atom);
+      }
+      // Decimal d.f is df/10^|f|
+      std::string fraction = e.atom.substr(dot + 1);
+      std::string denominator = "1" + std::string(fraction.size(), '0');
+      return expr::rational(e.atom.substr(0, dot) + fraction) / expr::rational(denominator);
+    }
+    if (e.is_app("-", 2)) {
+      return -to_rational(e.children[1]);
+    }
+    if (e.is_app("/", 3)) {
+      return to_rational(e.children[1]) / to_rational(e.children[2]);
+    }
+    if (e.is_app("to_real", 2)) {
+      return to_rational(e.children[1]);
+    }
+    std::stringstream ss;
+    ss << "generic solver: can't parse numeric value " << e;
+    throw exception(ss.str());
+  }
+
+  /** Convert a bitvector constant (#b, #x, or (_ bvN size)) to a bitvector */
+  expr::bitvector to_bitvector(size_t size, const sexpr& e) const {
+    if (!e.is_list && e.atom.size() > 2 && e.atom[0] == '#') {
+      if (e.atom[1] == 'b') {
+        return expr::bitvector(e.atom.substr(2));
+      }
+      if (e.atom[1] == 'x') {
+        return expr::bitvector(size, expr::integer(e.atom.substr(2), 16));
+      }
+    }
+    if (e.is_app("_", 3) && e.children[1].atom.compare(0, 2, "bv") == 0) {
+      return expr::bitvector(size, expr::integer(e.children[1].atom.substr(2), 10));
+    }
+    std::stringstream ss;
+    ss << "generic solver: can't parse bitvector value " << e;
+    throw exception(ss.str());
+  }
+
+  /** Convert the solver value of the variable to a value */
+  expr::value to_value(expr::term_ref var, const sexpr& e) const {
+    expr::term_ref var_type = d_tm.type_of(var);
+    switch (d_tm.term_of(var_type).op()) {
+    case expr::TYPE_BOOL:
+      if (e.is_atom("true")) return expr::value(true);
+      if (e.is_atom("false")) return expr::value(false);
+      break;
+    case expr::TYPE_INTEGER:
+    case expr::TYPE_REAL:
+      return expr::value(to_rational(e));
+    case expr::TYPE_BITVECTOR:
+      return expr::value(to_bitvector(d_tm.get_bitvector_size(var), e));
+    default:
+      break;
+    }
+    std::stringstream ss;
+    ss << "generic solver: can't parse value " << e << " of " << var;
+    throw exception(ss.str());
+  }
+
+  /** Default value for variables that the solver doesn't know about */
+  expr::value default_value(expr::term_ref var) const {
+    expr::term_ref var_type = d_tm.type_of(var);
+    switch (d_tm.term_of(var_type).op()) {
+    case expr::TYPE_BOOL:
+      return expr::value(false);
+    case expr::TYPE_INTEGER:
+    case expr::TYPE_REAL:
+      return expr::value(expr::rational());
+    case expr::TYPE_BITVECTOR:
+      return expr::value(expr::bitvector(d_tm.get_bitvector_size(var), 0));
+    default:
+      throw exception("generic solver: unsupported variable type");
+    }
+  }
+
   /** Number of solver instances */
   static unsigned s_instances;
 
@@ -109,6 +336,9 @@ public:
   , d_solver_input_tee(0)
   , d_copy_out(0)
   , d_solver_input(0)
+  , d_global_declarations(opts.get_bool("generic-solver-global-declarations"))
+  , d_last_result(solver::UNKNOWN)
+  , d_solver_pid(0)
   , d_options(opts)
   {
     // The solver to run
@@ -172,6 +402,7 @@ public:
     }
 
     // Parent, sal side
+    d_solver_pid = pid;
     close(sal_to_solver_fds[0]);
     close(solver_to_sal_fds[1]);
 
@@ -201,6 +432,10 @@ public:
 
     // SMT2 preamble
     *d_solver_input << "(set-info :smt-lib-version 2.0)" << std::endl;
+    *d_solver_input << "(set-option :produce-models true)" << std::endl;
+    if (d_global_declarations) {
+      *d_solver_input << "(set-option :global-declarations true)" << std::endl;
+    }
     *d_solver_input << "(set-logic " << solver_logic << ")" << std::endl;
   }
 
@@ -213,6 +448,8 @@ public:
     delete d_solver_input_tee_device;
     delete d_solver_input_fd;
     delete d_copy_out;
+    // Wait for the solver to exit, it has no more input
+    waitpid(d_solver_pid, 0, 0);
   }
 
   void add(expr::term_ref f) {
@@ -226,28 +463,77 @@ public:
     }
 
     *d_solver_input << "(assert " << f << ")" << std::endl;
+    d_last_result = solver::UNKNOWN;
   }
 
   solver::result check() {
     *d_solver_input << "(check-sat)" << std::endl;
-    std::string solver_out;
-    *d_solver_response >> solver_out;
-    if (solver_out == "sat") {
-      return solver::SAT;
+    d_last_result = solver::UNKNOWN;
+    sexpr solver_out;
+    read_response(solver_out);
+    if (solver_out.is_atom("sat")) {
+      d_last_result = solver::SAT;
+    } else if (solver_out.is_atom("unsat")) {
+      d_last_result = solver::UNSAT;
+    } else if (!solver_out.is_atom("unknown")) {
+      std::stringstream ss;
+      ss << "unknown solver response: " << solver_out;
+      throw exception(ss.str());
     }
-    if (solver_out == "unsat") {
-      return solver::UNSAT;
+    return d_last_result;
+  }
+
+  expr::model::ref get_model(const std::set<expr::term_ref>& variables) {
+    if (d_last_result != solver::SAT) {
+      throw exception("generic solver: model requested but last check was not sat");
     }
-    if (solver_out == "unknown") {
-      return solver::UNKNOWN;
+
+    expr::model::ref m = new expr::model(d_tm, false);
+
+    // Variables the solver hasn't seen are unconstrained
+    std::vector<expr::term_ref> declared;
+    std::set<expr::term_ref>::const_iterator it = variables.begin();
+    for (; it != variables.end(); ++ it) {
+      if (is_declared(*it)) {
+        declared.push_back(*it);
+      } else {
+        m->set_variable_value(*it, default_value(*it));
+      }
     }
-    throw exception("unknown solver response: " + solver_out);
-    return solver::UNKNOWN;
+
+    if (declared.size() > 0) {
+      *d_solver_input << "(get-value (";
+      for (size_t i = 0; i < declared.size(); ++ i) {
+        *d_solver_input << (i ? " " : "") << declared[i];
+      }
+      *d_solver_input << "))" << std::endl;
+
+      // Response is ((var value) ...) in the order of the query
+      sexpr response;
+      read_response(response);
+      if (!response.is_list || response.children.size() != declared.size()) {
+        std::stringstream ss;
+        ss << "generic solver: unexpected get-value response: " << response;
+        throw exception(ss.str());
+      }
+      for (size_t i = 0; i < declared.size(); ++ i) {
+        const sexpr& pair = response.children[i];
+        if (!pair.is_list || pair.children.size() != 2) {
+          std::stringstream ss;
+          ss << "generic solver: unexpected get-value response: " << pair;
+          throw exception(ss.str());
+        }
+        m->set_variable_value(declared[i], to_value(declared[i], pair.children[1]));
+      }
+    }
+
+    return m;
   }
 
   void push() {
     // Push the solver
     *d_solver_input << "(push 1)" << std::endl;
+    d_last_result = solver::UNKNOWN;
     // Remember the declared variables
     d_vars_list_size.push_back(d_vars_list.size());
   }
@@ -255,10 +541,16 @@ public:
   void pop() {
     // Pop the solver
     *d_solver_input << "(pop 1)" << std::endl;
+    d_last_result = solver::UNKNOWN;
     // Forget all the variables declared since last push
     if (d_vars_list_size.size() == 0) {
       throw exception("Calls to push/pop don't match.");
     }
+    // With global declarations they are declared once and for all
+    if (d_global_declarations) {
+      d_vars_list_size.pop_back();
+      return;
+    }
     size_t size = d_vars_list_size.back();
     d_vars_list_size.pop_back();
     while (d_vars_list.size() > size) {
@@ -295,6 +587,14 @@ solver::result generic_solver::check() {
   return d_internal->check();
 }
 
+expr::model::ref generic_solver::get_model() const {
+  std::set<expr::term_ref> variables;
+  variables.insert(d_A_variables.begin(), d_A_variables.end());
+  variables.insert(d_T_variables.begin(), d_T_variables.end());
+  variables.insert(d_B_variables.begin(), d_B_variables.end());
+  return d_internal->get_model(variables);
+}
+
 void generic_solver::push() {
   d_internal->push();
 }
@@ -28,7 +28,9 @@ namespace smt {
 class generic_solver_internal;
 
 /**
- * A generic solver that we interact through SMT2 file interface.
+ * A generic solver that we interact through SMT2 file interface. The solver
+ * is a single long-lived child process that we talk to incrementally over
+ * pipes. Models are obtained with (get-value ...) on the declared variables.
  */
 class generic_solver : public solver {
 
@@ -49,6 +51,9 @@ public:
   /** Check the assertions for satisfiability */
   result check();
 
+  /** Get the model */
+  expr::model::ref get_model() const;
+
   /** Push the solving context */
   void push();
 
@@ -48,6 +48,7 @@ struct generic_solver_info {
         ("generic-solver-logic", value<std::string>(), "The SMT logic to use (e.g. QF_LRA).")
         ("generic-solver-log", value<std::string>(), "Prefix of a file where the SMT2 output will be logged. Given 'output', the files generated will be 'output.1.smt2', ...")
         ("generic-solver-flatten", "Run the solver in non-incremental mode.")
+        ("generic-solver-global-declarations", "Declare each variable once, using the :global-declarations option of the solver.")
         ;
   }
 
@@ -69,6 +69,10 @@ public:
   expr::model::ref get_model() const;
   void push();
   void pop();
+
+  /** Number of open push scopes */
+  size_t get_scope() const;
+
   void generalize(generalization_type type, std::vector<expr::term_ref>& projection_out);
   void interpolate(std::vector<expr::term_ref>& out);
   void get_unsat_core(std::vector<expr::term_ref>& out);
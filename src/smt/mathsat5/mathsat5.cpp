@@ -22,6 +22,8 @@
 #include <mathsat.h>
 #include <msatexistelim.h>
 #include <boost/unordered_map.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/exceptions.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -35,6 +37,7 @@
 #include "smt/mathsat5/mathsat5.h"
 #include "smt/mathsat5/mathsat5_term_cache.h"
 #include "utils/trace.h"
+#include "smt/factory.h"
 
 #define unused_var(x) { (void)x; }
 
@@ -76,6 +79,41 @@ class mathsat5_internal {
   /** The assertions size per push/pop */
   std::vector<size_t> d_assertions_size;
 
+  /** Number of assumptions at the end of d_assertions (from last check) */
+  size_t d_assumptions_size;
+
+  typedef boost::unordered_map<msat_term, msat_term, mathsat5_hasher, mathsat5_eq> msat_to_msat_map;
+
+  /**
+   * Map from assumed formulas f to literals p, with (p => f) asserted, one
+   * map per interpolation group (0 for A, 1 for B) since the implication is
+   * asserted in the group of the assumption.
+   */
+  msat_to_msat_map d_assumption_literals[2];
+
+  /** Interpolation group of the assumptions of the given class (0 for A, 1 for B) */
+  static size_t assumption_group(solver::formula_class f_class) {
+    return f_class == solver::CLASS_B ? 1 : 0;
+  }
+
+  /** The asserted implications (p => f), to be skipped when checking models */
+  msat_to_msat_map d_assumption_implications;
+
+  /** Implications with their groups in the order they were asserted, for backtracking */
+  std::vector< std::pair<msat_term, size_t> > d_assumption_literals_trail;
+
+  /** The assumption literals trail size per push/pop */
+  std::vector<size_t> d_assumption_literals_trail_size;
+
+  /** Counter for fresh assumption literal names */
+  size_t d_assumption_literals_count;
+
+  /** Get the literal implying f to be used as an assumption */
+  msat_term get_assumption_literal(msat_term f, solver::formula_class f_class);
+
+  /** Remove the assumptions of the last check from the assertions */
+  void clear_assumptions();
+
   /** Bitvector 1 */
   expr::term_ref_strong d_bv1;
 
@@ -106,6 +144,15 @@ class mathsat5_internal {
   /** ITP group B */
   int d_itp_B;
 
+  /** Set to stop the running check */
+  boost::atomic<bool> d_interrupted;
+
+  /** Termination test for MathSAT, stops the search when interrupted */
+  static int termination_test(void* data);
+
+  /** Throw boost::thread_interrupted if the last check was interrupted */
+  void check_interrupted();
+
 public:
 
   /** Construct an instance of mathsat5 with the given temr manager and options */
@@ -135,6 +182,9 @@ public:
   /** Check satisfiability */
   solver::result check();
 
+  /** Check satisfiability under assumptions */
+  solver::result check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Check the model when sat */
   void check_model();
 
@@ -156,6 +206,9 @@ public:
   /** Return the unsat core */
   void get_unsat_core(std::vector<expr::term_ref>& out);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Returns the instance id */
   size_t instance() const { return d_instance; }
 
@@ -168,6 +221,8 @@ public:
       return d_opts.get_bool("mathsat5-unsat-cores");
     case solver::GENERALIZATION:
       return d_opts.get_bool("mathsat5-generalize-trivial") || d_opts.get_bool("mathsat5-generalize-qe");
+    case solver::ASSUMPTIONS:
+      return true;
     default:
       return false;
     }
@@ -186,12 +241,16 @@ int mathsat5_internal::s_instances = 0;
 mathsat5_internal::mathsat5_internal(expr::term_manager& tm, const options& opts)
 : d_tm(tm)
 , d_opts(opts)
+, d_assumptions_size(0)
+, d_assumption_literals_count(0)
 , d_last_check_status(MSAT_UNKNOWN)
 , d_instance(s_instances)
 , d_term_cache(mathsat5_term_cache::get_cache(tm))
 , d_itp_A(0)
 , d_itp_B(0)
+, d_interrupted(false)
 {
+  backend_lock lock;
 
   s_instances ++;
 
@@ -242,9 +301,13 @@ mathsat5_internal::mathsat5_internal(expr::term_manager& tm, const options& opts
 
   d_itp_A = msat_create_itp_group(d_env);
   d_itp_B = msat_create_itp_group(d_env);
+
+  msat_set_termination_test(d_env, termination_test, this);
 }
 
 mathsat5_internal::~mathsat5_internal() {
+  backend_lock lock;
+
   msat_destroy_env(d_env);
   msat_destroy_config(d_cfg);
 
@@ -845,6 +908,8 @@ expr::term_ref mathsat5_internal::to_term(msat_term t) {
 
 void mathsat5_internal::add(expr::term_ref ref, solver::formula_class f_class) {
 
+  clear_assumptions();
+
   // The mathsat version
   msat_term m_term = to_mathsat5_term(ref);
   if (d_assertion_map.find(m_term) != d_assertion_map.end()) {
@@ -880,11 +945,30 @@ void mathsat5_internal::add(expr::term_ref ref, solver::formula_class f_class) {
   d_last_check_status = MSAT_UNKNOWN;
 }
 
+int mathsat5_internal::termination_test(void* data) {
+  mathsat5_internal* internal = static_cast<mathsat5_internal*>(data);
+  return internal->d_interrupted ? 1 : 0;
+}
+
+void mathsat5_internal::interrupt() {
+  d_interrupted = true;
+}
+
+void mathsat5_internal::check_interrupted() {
+  if (d_interrupted) {
+    d_interrupted = false;
+    throw boost::thread_interrupted();
+  }
+}
+
 solver::result mathsat5_internal::check() {
+  clear_assumptions();
+  d_interrupted = false;
   d_last_check_status = msat_solve(d_env);
 
   switch (d_last_check_status) {
   case MSAT_UNKNOWN:
+    check_interrupted();
     return solver::UNKNOWN;
   case MSAT_UNSAT:
     return solver::UNSAT;
@@ -897,6 +981,91 @@ solver::result mathsat5_internal::check() {
   return solver::UNKNOWN;
 }
 
+void mathsat5_internal::clear_assumptions() {
+  while (d_assumptions_size > 0) {
+    d_assertions.pop_back();
+    d_assertion_classes.pop_back();
+    d_assumptions_size --;
+  }
+}
+
+msat_term mathsat5_internal::get_assumption_literal(msat_term f, solver::formula_class f_class) {
+  size_t group = assumption_group(f_class);
+  msat_to_msat_map::const_iterator find = d_assumption_literals[group].find(f);
+  if (find != d_assumption_literals[group].end()) {
+    return find->second;
+  }
+
+  // MathSAT only assumes atoms, so we make a fresh p and assert (p => f)
+  std::stringstream ss;
+  ss << "sally_assumption_" << d_instance << "_" << d_assumption_literals_count ++;
+  msat_decl p_decl = msat_declare_function(d_env, ss.str().c_str(), msat_get_bool_type(d_env));
+  msat_term p = msat_make_constant(d_env, p_decl);
+  msat_term implication = msat_make_or(d_env, msat_make_not(d_env, p), f);
+  if (MSAT_ERROR_TERM(p) || MSAT_ERROR_TERM(implication)) {
+    throw exception("MathSAT error (assumption).");
+  }
+  msat_set_itp_group(d_env, group == 1 ? d_itp_B : d_itp_A);
+  int ret = msat_assert_formula(d_env, implication);
+  if (ret != 0) {
+    throw exception("MathSAT error (assumption).");
+  }
+
+  d_assumption_literals[group][f] = p;
+  d_assumption_implications[implication] = f;
+  d_assumption_literals_trail.push_back(std::make_pair(implication, group));
+  return p;
+}
+
+solver::result mathsat5_internal::check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core) {
+
+  clear_assumptions();
+
+  // Keep them with the assertions so that the model and generalization account for them
+  std::vector<msat_term> literals;
+  for (size_t i = 0; i < assumptions.size(); ++ i) {
+    msat_term f = to_mathsat5_term(assumptions[i]);
+    literals.push_back(get_assumption_literal(f, f_class));
+    d_assertions.push_back(expr::term_ref_strong(d_tm, assumptions[i]));
+    d_assertion_classes.push_back(f_class);
+    d_assumptions_size ++;
+  }
+
+  d_interrupted = false;
+  d_last_check_status = msat_solve_with_assumptions(d_env, literals.empty() ? 0 : &literals[0], literals.size());
+
+  switch (d_last_check_status) {
+  case MSAT_UNKNOWN:
+    check_interrupted();
+    return solver::UNKNOWN;
+  case MSAT_UNSAT:
+    if (core) {
+      size_t core_size = 0;
+      msat_term* literals_core = msat_get_unsat_assumptions(d_env, &core_size);
+      if (literals_core == 0) {
+        throw exception("MathSAT unsat core error.");
+      }
+      core->clear();
+      for (size_t i = 0; i < literals.size(); ++ i) {
+        for (size_t j = 0; j < core_size; ++ j) {
+          if (msat_term_id(literals_core[j]) == msat_term_id(literals[i])) {
+            core->push_back(assumptions[i]);
+            break;
+          }
+        }
+      }
+      msat_free(literals_core);
+    }
+    return solver::UNSAT;
+  case MSAT_SAT:
+    return solver::SAT;
+  default:
+    throw exception("MathSAT error (check).");
+  }
+
+  return solver::UNKNOWN;
+}
+
 void mathsat5_internal::check_model() {
   std::cerr << "Checking model" << std::endl;
   assert(d_last_check_status == MSAT_SAT);
@@ -904,8 +1073,12 @@ void mathsat5_internal::check_model() {
   // Check the mathsat model
   size_t num_asserted;
   msat_term* assertions = msat_get_asserted_formulas(d_env, &num_asserted);
-  for (size_t i = 0; i < num_asserted; ++ i) {
-    if (msat_term_id(assertions[i]) != msat_term_id(d_assertions_mathsat[i])) {
+  for (size_t i = 0, j = 0; i < num_asserted; ++ i) {
+    if (d_assumption_implications.find(assertions[i]) != d_assumption_implications.end()) {
+      // Assumption implications are ours
+      continue;
+    }
+    if (msat_term_id(assertions[i]) != msat_term_id(d_assertions_mathsat[j++])) {
       throw exception("Mathsat internal assertions don't match external ones!");
     }
     msat_term value = msat_get_model_value(d_env, assertions[i]);
@@ -1107,14 +1280,17 @@ void mathsat5_internal::generalize(solver::generalization_type type, const std::
 }
 
 void mathsat5_internal::push() {
+  clear_assumptions();
   int ret = msat_push_backtrack_point(d_env);
   if (ret) {
     throw exception("MathSAT error (push).");
   }
   d_assertions_size.push_back(d_assertions.size());
+  d_assumption_literals_trail_size.push_back(d_assumption_literals_trail.size());
 }
 
 void mathsat5_internal::pop() {
+  clear_assumptions();
   int ret = msat_pop_backtrack_point(d_env);
   if (ret) {
     throw exception("MathSAT error (pop).");
@@ -1127,6 +1303,16 @@ void mathsat5_internal::pop() {
     d_assertions_mathsat.pop_back();
     d_assertion_classes.pop_back();
   }
+  // The implications (p => f) are gone too
+  size_t trail_size = d_assumption_literals_trail_size.back();
+  d_assumption_literals_trail_size.pop_back();
+  while (d_assumption_literals_trail.size() > trail_size) {
+    msat_term implication = d_assumption_literals_trail.back().first;
+    size_t group = d_assumption_literals_trail.back().second;
+    d_assumption_literals[group].erase(d_assumption_implications[implication]);
+    d_assumption_implications.erase(implication);
+    d_assumption_literals_trail.pop_back();
+  }
   d_last_check_status = MSAT_UNKNOWN;
 }
 
@@ -1145,9 +1331,11 @@ mathsat5::mathsat5(expr::term_manager& tm, const options& opts, utils::statistic
 : solver("mathsat5", tm, opts, stats)
 {
   d_internal = new mathsat5_internal(tm, opts);
+  set_interruptible(true);
 }
 
 mathsat5::~mathsat5() {
+  set_interruptible(false);
   delete d_internal;
 }
 
@@ -1161,6 +1349,11 @@ solver::result mathsat5::check() {
   return d_internal->check();
 }
 
+solver::result mathsat5::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("mathsat5") << "mathsat5[" << d_internal->instance() << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  return d_internal->check(assumptions, f_class, core);
+}
+
 void mathsat5::check_model() {
   TRACE("mathsat5") << "mathsat5[" << d_internal->instance() << "]: check_model()" << std::endl;
   d_internal->check_model();
@@ -1209,6 +1402,10 @@ bool mathsat5::supports(solver::feature f) const {
   return d_internal->supports(f);
 }
 
+void mathsat5::interrupt() {
+  d_internal->interrupt();
+}
+
 void mathsat5::gc() {
   d_internal->gc();
 }
@@ -52,6 +52,9 @@ public:
   /** Check the assertions for satisfiability */
   result check();
 
+  /** Check the assertions for satisfiability under assumptions */
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Check the model (debug) */
   void check_model();
 
@@ -73,6 +76,9 @@ public:
   /** Unsat core of the last UNSAT result */
   void get_unsat_core(std::vector<expr::term_ref>& out);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Collect terms */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
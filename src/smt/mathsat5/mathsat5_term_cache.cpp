@@ -23,6 +23,7 @@
 #include <iomanip>
 
 #include "smt/solver.h"
+#include "smt/factory.h"
 #include "smt/mathsat5/mathsat5_term_cache.h"
 
 #include "expr/gc_relocator.h"
@@ -172,6 +173,8 @@ void mathsat5_term_cache::clear() {
 
 mathsat5_term_cache* mathsat5_term_cache::get_cache(expr::term_manager& tm) {
 
+  backend_lock lock;
+
   mathsat5_term_cache* cache = 0;
 
   // Try to find an existing one
@@ -217,6 +220,12 @@ void mathsat5_term_cache::gc_collect(const expr::gc_relocator& gc_reloc) {
   gc_reloc.reloc(d_permanent_terms);
 }
 
+void mathsat5_term_cache::gc_tm_destroyed() {
+  backend_lock lock;
+  s_tm_to_cache_map.map.erase(d_tm.id());
+  delete this;
+}
+
 }
 }
 
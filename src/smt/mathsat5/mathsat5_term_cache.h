@@ -112,6 +112,9 @@ public:
   /** Collect terms */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
+  /** The term manager is gone, remove (and delete) the cache */
+  void gc_tm_destroyed();
+
   /** Collect the cache, leaving only the variables */
   void gc();
 
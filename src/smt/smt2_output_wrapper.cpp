@@ -163,6 +163,10 @@ void smt2_output_wrapper::add_variable(expr::term_ref var, variable_class f_clas
   d_vars_added = true;
 }
 
+void smt2_output_wrapper::interrupt() {
+  d_solver->interrupt();
+}
+
 void smt2_output_wrapper::gc_collect(const expr::gc_relocator& gc_reloc) {
   // Collect the solver
   solver::gc_collect(gc_reloc);
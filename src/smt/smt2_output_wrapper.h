@@ -73,6 +73,7 @@ public:
   void interpolate(std::vector<expr::term_ref>& out);
   void get_unsat_core(std::vector<expr::term_ref>& out);
   void add_variable(expr::term_ref var, variable_class f_class);
+  void interrupt();
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
 };
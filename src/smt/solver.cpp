@@ -19,8 +19,11 @@
 #include "smt/solver.h"
 #include "expr/gc_relocator.h"
 
+#include <set>
 #include <cassert>
 #include <iostream>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 namespace sally {
 namespace smt {
@@ -58,6 +61,45 @@ expr::term_ref solver::interpolate() {
   return d_tm.mk_and(interpolation_out);
 }
 
+solver::result solver::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  solver_scope scope(this);
+  scope.push();
+  for (size_t i = 0; i < assumptions.size(); ++ i) {
+    add(assumptions[i], f_class);
+  }
+  result r = check();
+  if (r == UNSAT && core) {
+    // No better core than all of them
+    *core = assumptions;
+  }
+  return r;
+}
+
+/** Solvers registered for interrupt_all() */
+static std::set<solver*> s_interruptible;
+
+/** Lock for the registered solvers */
+static boost::mutex s_interruptible_mutex;
+
+void solver::set_interruptible(bool flag) {
+  boost::lock_guard<boost::mutex> lock(s_interruptible_mutex);
+  if (flag) {
+    s_interruptible.insert(this);
+  } else {
+    s_interruptible.erase(this);
+  }
+}
+
+void solver::interrupt_all(const expr::term_manager* tm) {
+  boost::lock_guard<boost::mutex> lock(s_interruptible_mutex);
+  std::set<solver*>::const_iterator it = s_interruptible.begin();
+  for (; it != s_interruptible.end(); ++ it) {
+    if (tm == 0 || &(*it)->d_tm == tm) {
+      (*it)->interrupt();
+    }
+  }
+}
+
 void solver::add_variable(expr::term_ref var, variable_class f_class) {
 
   assert(d_A_variables.find(var) == d_A_variables.end());
@@ -85,6 +127,18 @@ void solver::gc_collect(const expr::gc_relocator& gc_reloc) {
   gc_reloc.reloc(d_T_variables);
 }
 
+solver::result solver_scope::check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class) {
+  if (d_solver->supports(solver::ASSUMPTIONS)) {
+    return d_solver->check(assumptions, f_class);
+  }
+  // Assert them in the scope to keep the model and generalization available
+  push();
+  for (size_t i = 0; i < assumptions.size(); ++ i) {
+    d_solver->add(assumptions[i], f_class);
+  }
+  return d_solver->check();
+}
+
 std::ostream& operator << (std::ostream& out, solver::formula_class fc) {
   switch(fc) {
   case solver::CLASS_A: out << "CLASS A"; break;
@@ -105,6 +105,7 @@ public:
     GENERALIZATION,
     INTERPOLATION,
     UNSAT_CORE,
+    ASSUMPTIONS,
   };
 
   /**
@@ -164,6 +165,19 @@ public:
   virtual
   result check() = 0;
 
+  /**
+   * Check for satisfiability of the assertions together with the given
+   * assumptions of class f_class, without asserting them. If the result is
+   * UNSAT and core is not null, it is set to a subset of the assumptions that
+   * is inconsistent with the assertions. With native support (ASSUMPTIONS),
+   * the model and generalization account for the assumptions until the next
+   * add(), check(), push() or pop(). Otherwise the check is done in a push/pop
+   * scope and only the result is available, see solver_scope::check().
+   */
+  result check(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core = 0) {
+    return check_assumptions(assumptions, f_class, core);
+  }
+
   /** Check for satisfiability, but it's OK to return unknown */
   virtual
   result check_relaxed() {
@@ -291,6 +305,27 @@ public:
 
   /** Collect base terms */
   void gc_collect(const expr::gc_relocator& gc_reloc);
+
+  /**
+   * Interrupt the check running in another thread, if any, which then throws
+   * boost::thread_interrupted. Can be called from any thread. After an
+   * interrupted check the solver can only be popped or deleted.
+   */
+  virtual
+  void interrupt() {}
+
+  /** Interrupt all the native solvers (of the given term manager if not null) */
+  static
+  void interrupt_all(const expr::term_manager* tm = 0);
+
+protected:
+
+  /** Register with (or unregister from) interrupt_all(), for native solvers */
+  void set_interruptible(bool flag);
+
+  /** Check under assumptions, by default by asserting them in a push/pop scope */
+  virtual
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
 };
 
 
@@ -320,6 +355,8 @@ public:
   void set_solver(solver* solver) { if (d_solver) clear(); d_solver = solver;  }
   solver* get_solver() { return d_solver; }
   void set_destructor_notify(destructor_notify* notify) { d_destructor_notify = notify; }
+  /** Check under assumptions, asserting them in this scope if the solver doesn't support ASSUMPTIONS */
+  solver::result check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class);
 };
 
 std::ostream& operator << (std::ostream& out, solver::formula_class fc);
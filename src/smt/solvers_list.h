@@ -88,3 +88,28 @@ std::string sally::smt::factory::get_default_solver_id() {
 }
 
 
+bool sally::smt::factory::is_thread_safe(std::string id) {
+#ifdef WITH_Z3
+  // Each term manager has its own Z3 context
+  if (id == z3_info::get_id()) {
+    return true;
+  }
+#endif
+#ifdef WITH_YICES2
+  // Yices has global state, only thread-safe builds can share it
+  if (id == yices2_info::get_id()) {
+    return yices2::is_thread_safe();
+  }
+#ifdef WITH_Z3
+  if (id == y2z3_info::get_id()) {
+    return yices2::is_thread_safe();
+  }
+#endif
+#endif
+  // Each instance runs its own process
+  if (id == generic_solver_info::get_id()) {
+    return true;
+  }
+  return false;
+}
+
@@ -24,6 +24,7 @@
 #include "expr/term.h"
 #include "expr/term_manager.h"
 #include "expr/rational.h"
+#include "expr/gc_relocator.h"
 #include "smt/y2m5/y2m5.h"
 #include "smt/yices2/yices2.h"
 #include "smt/mathsat5/mathsat5.h"
@@ -52,6 +53,8 @@ y2m5::y2m5(expr::term_manager& tm, const options& opts, utils::statistics& stats
 : solver("y2m5", tm, opts, stats)
 , d_last_mathsat5_result(UNKNOWN)
 , d_last_yices2_result(UNKNOWN)
+, d_assumptions_class(CLASS_A)
+, d_assumptions_pushed(false)
 {
   d_yices2 = factory::mk_solver("yices2", tm, opts, stats);
   if (opts.get_bool("y2m5-mathsat5-flatten")) {
@@ -71,6 +74,7 @@ y2m5::~y2m5() {
 
 void y2m5::add(expr::term_ref f, formula_class f_class) {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: adding " << f << std::endl;
+  clear_assumptions();
   d_yices2->add(f, f_class);
   d_mathsat5->add(f, f_class);
   d_last_mathsat5_result = UNKNOWN;
@@ -79,11 +83,45 @@ void y2m5::add(expr::term_ref f, formula_class f_class) {
 
 solver::result y2m5::check() {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: check()" << std::endl;
+  clear_assumptions();
   d_last_yices2_result = d_yices2->check();
   d_last_mathsat5_result = UNKNOWN;
   return d_last_yices2_result;
 }
 
+solver::result y2m5::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("y2m5") << "y2m5[" << s_instance << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  clear_assumptions();
+  d_last_yices2_result = d_yices2->check(assumptions, f_class, core);
+  d_last_mathsat5_result = UNKNOWN;
+  d_assumptions = assumptions;
+  d_assumptions_class = f_class;
+  return d_last_yices2_result;
+}
+
+void y2m5::clear_assumptions() {
+  d_assumptions.clear();
+  if (d_assumptions_pushed) {
+    d_mathsat5->pop();
+    d_assumptions_pushed = false;
+  }
+}
+
+void y2m5::check_mathsat5() {
+  if (d_last_mathsat5_result != UNKNOWN) {
+    return;
+  }
+  // Assert the assumptions in a scope that is popped with the assumptions
+  if (d_assumptions.size() > 0 && !d_assumptions_pushed) {
+    d_mathsat5->push();
+    d_assumptions_pushed = true;
+    for (size_t i = 0; i < d_assumptions.size(); ++ i) {
+      d_mathsat5->add(d_assumptions[i], d_assumptions_class);
+    }
+  }
+  d_last_mathsat5_result = d_mathsat5->check();
+}
+
 expr::model::ref y2m5::get_model() const {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: get_model()" << std::endl;
   assert(d_last_yices2_result == SAT);
@@ -92,6 +130,7 @@ expr::model::ref y2m5::get_model() const {
 
 void y2m5::push() {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: push()" << std::endl;
+  clear_assumptions();
   d_yices2->push();
   d_mathsat5->push();
   d_last_mathsat5_result = UNKNOWN;
@@ -100,6 +139,7 @@ void y2m5::push() {
 
 void y2m5::pop() {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: pop()" << std::endl;
+  clear_assumptions();
   d_yices2->pop();
   d_mathsat5->pop();
   d_last_mathsat5_result = UNKNOWN;
@@ -120,17 +160,13 @@ void y2m5::generalize(generalization_type type, expr::model::ref m, std::vector<
 
 void y2m5::interpolate(std::vector<expr::term_ref>& out) {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: interpolating" << std::endl;
-  if (d_last_mathsat5_result == UNKNOWN) {
-    d_last_mathsat5_result = d_mathsat5->check();
-  }
+  check_mathsat5();
   d_mathsat5->interpolate(out);
 }
 
 void y2m5::get_unsat_core(std::vector<expr::term_ref>& out) {
   TRACE("y2m5") << "y2m5[" << s_instance << "]: unsat core" << std::endl;
-  if (d_last_mathsat5_result == UNKNOWN) {
-    d_last_mathsat5_result = d_mathsat5->check();
-  }
+  check_mathsat5();
   assert(d_last_mathsat5_result == UNSAT);
   d_mathsat5->get_unsat_core(out);
 }
@@ -144,6 +180,7 @@ void y2m5::add_variable(expr::term_ref var, variable_class f_class) {
 bool y2m5::supports(feature f) const {
   switch (f) {
   case GENERALIZATION:
+  case ASSUMPTIONS:
     return d_yices2->supports(f);
   case INTERPOLATION:
     return d_mathsat5->supports(f);
@@ -154,13 +191,23 @@ bool y2m5::supports(feature f) const {
   }
 }
 
+void y2m5::interrupt() {
+  d_yices2->interrupt();
+  d_mathsat5->interrupt();
+}
+
 void y2m5::gc() {
   d_yices2->gc();
   d_mathsat5->gc();
 }
 
+const solver* y2m5::get_interpolation_solver() const {
+  return d_mathsat5;
+}
+
 void y2m5::gc_collect(const expr::gc_relocator& gc_reloc) {
   solver::gc_collect(gc_reloc);
+  gc_reloc.reloc(d_assumptions);
 }
 
 }
@@ -28,7 +28,8 @@ namespace smt {
 
 /**
  * Combination solver: Yices for generalization, MathSAT5 for interpolation.
- * Note that all checks are done twice, so expect penalty.
+ * Checks are answered by Yices alone, MathSAT5 only replays the assertions
+ * (up to the current scope) when an interpolant or unsat core is requested.
  */
 class y2m5 : public solver {
 
@@ -43,6 +44,21 @@ class y2m5 : public solver {
   /* Last result of yices */
   result d_last_yices2_result;
 
+  /** Assumptions of the last check, replayed to mathsat5 on demand */
+  std::vector<expr::term_ref> d_assumptions;
+
+  /** Class of the assumptions */
+  formula_class d_assumptions_class;
+
+  /** Are the assumptions asserted to mathsat5 (in a scope of their own) */
+  bool d_assumptions_pushed;
+
+  /** Forget the assumptions of the last check */
+  void clear_assumptions();
+
+  /** Check with mathsat5, if not done already since the last check */
+  void check_mathsat5();
+
 public:
 
   /** Constructor */
@@ -63,6 +79,9 @@ public:
   /** Check the assertions for satisfiability */
   result check();
 
+  /** Check the assertions under assumptions (with Yices) */
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Get the model */
   expr::model::ref get_model() const;
 
@@ -84,11 +103,17 @@ public:
   /** Unsat core of the last UNSAT result */
   void get_unsat_core(std::vector<expr::term_ref>& out);
 
-  /** Term collection (nothing to do) */
+  /** Term collection */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Collect garbage */
   void gc();
+
+  /** The wrapped MathSAT solver, used for interpolation and unsat cores */
+  const solver* get_interpolation_solver() const;
 };
 
 }
@@ -30,6 +30,7 @@
 #include "expr/term.h"
 #include "expr/term_manager.h"
 #include "expr/rational.h"
+#include "expr/gc_relocator.h"
 #include "smt/y2o2/y2o2.h"
 #include "utils/trace.h"
 #include "smt/incremental_wrapper.h"
@@ -56,6 +57,8 @@ y2o2::y2o2(expr::term_manager& tm, const options& opts, utils::statistics& stats
 : solver("y2o2", tm, opts, stats)
 , d_last_opensmt2_result(UNKNOWN)
 , d_last_yices2_result(UNKNOWN)
+, d_assumptions_class(CLASS_A)
+, d_assumptions_pushed(false)
 {
   d_yices2 = factory::mk_solver("yices2", tm, opts, stats);
 //  d_opensmt2 = new delayed_wrapper("opensmt2_delayed", tm, opts, stats, factory::mk_solver("opensmt2", tm, opts, stats));
@@ -71,6 +74,7 @@ y2o2::~y2o2() {
 
 void y2o2::add(expr::term_ref f, formula_class f_class) {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: adding " << f << std::endl;
+  clear_assumptions();
   d_yices2->add(f, f_class);
   d_opensmt2->add(f, f_class);
   d_last_opensmt2_result = UNKNOWN;
@@ -79,11 +83,45 @@ void y2o2::add(expr::term_ref f, formula_class f_class) {
 
 solver::result y2o2::check() {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: check()" << std::endl;
+  clear_assumptions();
   d_last_yices2_result = d_yices2->check();
   d_last_opensmt2_result = UNKNOWN;
   return d_last_yices2_result;
 }
 
+solver::result y2o2::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("y2o2") << "y2o2[" << s_instance << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  clear_assumptions();
+  d_last_yices2_result = d_yices2->check(assumptions, f_class, core);
+  d_last_opensmt2_result = UNKNOWN;
+  d_assumptions = assumptions;
+  d_assumptions_class = f_class;
+  return d_last_yices2_result;
+}
+
+void y2o2::clear_assumptions() {
+  d_assumptions.clear();
+  if (d_assumptions_pushed) {
+    d_opensmt2->pop();
+    d_assumptions_pushed = false;
+  }
+}
+
+void y2o2::check_opensmt2() {
+  if (d_last_opensmt2_result != UNKNOWN) {
+    return;
+  }
+  // Assert the assumptions in a scope that is popped with the assumptions
+  if (d_assumptions.size() > 0 && !d_assumptions_pushed) {
+    d_opensmt2->push();
+    d_assumptions_pushed = true;
+    for (size_t i = 0; i < d_assumptions.size(); ++ i) {
+      d_opensmt2->add(d_assumptions[i], d_assumptions_class);
+    }
+  }
+  d_last_opensmt2_result = d_opensmt2->check();
+}
+
 expr::model::ref y2o2::get_model() const {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: get_model()" << std::endl;
   assert(d_last_yices2_result == SAT);
@@ -92,6 +130,7 @@ expr::model::ref y2o2::get_model() const {
 
 void y2o2::push() {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: push()" << std::endl;
+  clear_assumptions();
   assert(d_last_yices2_result != UNSAT);
   d_yices2->push();
   d_opensmt2->push();
@@ -101,6 +140,7 @@ void y2o2::push() {
 
 void y2o2::pop() {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: pop()" << std::endl;
+  clear_assumptions();
   d_yices2->pop();
   d_opensmt2->pop();
   d_last_opensmt2_result = UNKNOWN;
@@ -121,17 +161,13 @@ void y2o2::generalize(generalization_type type, expr::model::ref m, std::vector<
 
 void y2o2::interpolate(std::vector<expr::term_ref>& out) {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: interpolating" << std::endl;
-  if (d_last_opensmt2_result == UNKNOWN) {
-    d_last_opensmt2_result = d_opensmt2->check();
-  }
+  check_opensmt2();
   d_opensmt2->interpolate(out);
 }
 
 void y2o2::get_unsat_core(std::vector<expr::term_ref>& out) {
   TRACE("y2o2") << "y2o2[" << s_instance << "]: unsat core" << std::endl;
-  if (d_last_opensmt2_result == UNKNOWN) {
-    d_last_opensmt2_result = d_opensmt2->check();
-  }
+  check_opensmt2();
   assert(d_last_opensmt2_result == UNSAT);
   d_opensmt2->get_unsat_core(out);
 }
@@ -145,6 +181,7 @@ void y2o2::add_variable(expr::term_ref var, variable_class f_class) {
 bool y2o2::supports(feature f) const {
   switch (f) {
   case GENERALIZATION:
+  case ASSUMPTIONS:
     return d_yices2->supports(f);
   case INTERPOLATION:
     return d_opensmt2->supports(f);
@@ -155,13 +192,23 @@ bool y2o2::supports(feature f) const {
   }
 }
 
+void y2o2::interrupt() {
+  d_yices2->interrupt();
+  d_opensmt2->interrupt();
+}
+
 void y2o2::gc() {
   d_yices2->gc();
   d_opensmt2->gc();
 }
 
+const solver* y2o2::get_interpolation_solver() const {
+  return d_opensmt2;
+}
+
 void y2o2::gc_collect(const expr::gc_relocator& gc_reloc) {
   solver::gc_collect(gc_reloc);
+  gc_reloc.reloc(d_assumptions);
 }
 
 }
@@ -35,8 +35,9 @@ namespace sally {
 namespace smt {
 
 /**
- * Combination solver: Yices for generalization, MathSAT5 for interpolation.
- * Note that all checks are done twice, so expect penalty.
+ * Combination solver: Yices for generalization, OpenSMT2 for interpolation.
+ * Checks are answered by Yices alone, OpenSMT2 only replays the assertions
+ * (up to the current scope) when an interpolant or unsat core is requested.
  */
 class y2o2 : public solver {
 
@@ -51,6 +52,21 @@ class y2o2 : public solver {
   /* Last result of yices */
   result d_last_yices2_result;
 
+  /** Assumptions of the last check, replayed to opensmt2 on demand */
+  std::vector<expr::term_ref> d_assumptions;
+
+  /** Class of the assumptions */
+  formula_class d_assumptions_class;
+
+  /** Are the assumptions asserted to opensmt2 (in a scope of their own) */
+  bool d_assumptions_pushed;
+
+  /** Forget the assumptions of the last check */
+  void clear_assumptions();
+
+  /** Check with opensmt2, if not done already since the last check */
+  void check_opensmt2();
+
 public:
 
   /** Constructor */
@@ -71,6 +87,9 @@ public:
   /** Check the assertions for satisfiability */
   result check();
 
+  /** Check the assertions under assumptions (with Yices) */
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Get the model */
   expr::model::ref get_model() const;
 
@@ -92,11 +111,17 @@ public:
   /** Unsat core of the last UNSAT result */
   void get_unsat_core(std::vector<expr::term_ref>& out);
 
-  /** Term collection (nothing to do) */
+  /** Term collection */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Collect garbage */
   void gc();
+
+  /** The wrapped OpenSMT solver, used for interpolation and unsat cores */
+  const solver* get_interpolation_solver() const;
 };
 
 }
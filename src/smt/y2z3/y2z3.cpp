@@ -24,6 +24,7 @@
 #include "expr/term.h"
 #include "expr/term_manager.h"
 #include "expr/rational.h"
+#include "expr/gc_relocator.h"
 #include "smt/y2z3/y2z3.h"
 #include "smt/yices2/yices2.h"
 #include "smt/z3/z3.h"
@@ -52,6 +53,8 @@ y2z3::y2z3(expr::term_manager& tm, const options& opts, utils::statistics& stats
 : solver("y2z3", tm, opts, stats)
 , d_last_z3_result(UNKNOWN)
 , d_last_yices2_result(UNKNOWN)
+, d_assumptions_class(CLASS_A)
+, d_assumptions_pushed(false)
 {
   d_yices2 = factory::mk_solver("yices2", tm, opts, stats);
   if (opts.get_bool("y2z3-z3-flatten")) {
@@ -71,6 +74,7 @@ y2z3::~y2z3() {
 
 void y2z3::add(expr::term_ref f, formula_class f_class) {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: adding " << f << std::endl;
+  clear_assumptions();
   d_yices2->add(f, f_class);
   d_z3->add(f, f_class);
   d_last_z3_result = UNKNOWN;
@@ -79,11 +83,45 @@ void y2z3::add(expr::term_ref f, formula_class f_class) {
 
 solver::result y2z3::check() {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: check()" << std::endl;
+  clear_assumptions();
   d_last_yices2_result = d_yices2->check();
   d_last_z3_result = UNKNOWN;
   return d_last_yices2_result;
 }
 
+solver::result y2z3::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("y2z3") << "y2z3[" << s_instance << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  clear_assumptions();
+  d_last_yices2_result = d_yices2->check(assumptions, f_class, core);
+  d_last_z3_result = UNKNOWN;
+  d_assumptions = assumptions;
+  d_assumptions_class = f_class;
+  return d_last_yices2_result;
+}
+
+void y2z3::clear_assumptions() {
+  d_assumptions.clear();
+  if (d_assumptions_pushed) {
+    d_z3->pop();
+    d_assumptions_pushed = false;
+  }
+}
+
+void y2z3::check_z3() {
+  if (d_last_z3_result != UNKNOWN) {
+    return;
+  }
+  // Assert the assumptions in a scope that is popped with the assumptions
+  if (d_assumptions.size() > 0 && !d_assumptions_pushed) {
+    d_z3->push();
+    d_assumptions_pushed = true;
+    for (size_t i = 0; i < d_assumptions.size(); ++ i) {
+      d_z3->add(d_assumptions[i], d_assumptions_class);
+    }
+  }
+  d_last_z3_result = d_z3->check();
+}
+
 expr::model::ref y2z3::get_model() const {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: get_model()" << std::endl;
   assert(d_last_yices2_result == SAT);
@@ -92,6 +130,7 @@ expr::model::ref y2z3::get_model() const {
 
 void y2z3::push() {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: push()" << std::endl;
+  clear_assumptions();
   d_yices2->push();
   d_z3->push();
   d_last_z3_result = UNKNOWN;
@@ -100,6 +139,7 @@ void y2z3::push() {
 
 void y2z3::pop() {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: pop()" << std::endl;
+  clear_assumptions();
   d_yices2->pop();
   d_z3->pop();
   d_last_z3_result = UNKNOWN;
@@ -120,17 +160,13 @@ void y2z3::generalize(generalization_type type, expr::model::ref m, std::vector<
 
 void y2z3::interpolate(std::vector<expr::term_ref>& out) {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: interpolating" << std::endl;
-  if (d_last_z3_result == UNKNOWN) {
-    d_last_z3_result = d_z3->check();
-  }
+  check_z3();
   d_z3->interpolate(out);
 }
 
 void y2z3::get_unsat_core(std::vector<expr::term_ref>& out) {
   TRACE("y2z3") << "y2z3[" << s_instance << "]: unsat core" << std::endl;
-  if (d_last_z3_result == UNKNOWN) {
-    d_last_z3_result = d_z3->check();
-  }
+  check_z3();
   assert(d_last_z3_result == UNSAT);
   d_z3->get_unsat_core(out);
 }
@@ -144,6 +180,7 @@ void y2z3::add_variable(expr::term_ref var, variable_class f_class) {
 bool y2z3::supports(feature f) const {
   switch (f) {
   case GENERALIZATION:
+  case ASSUMPTIONS:
     return d_yices2->supports(f);
   case INTERPOLATION:
     return d_z3->supports(f);
@@ -154,13 +191,23 @@ bool y2z3::supports(feature f) const {
   }
 }
 
+void y2z3::interrupt() {
+  d_yices2->interrupt();
+  d_z3->interrupt();
+}
+
 void y2z3::gc() {
   d_yices2->gc();
   d_z3->gc();
 }
 
+const solver* y2z3::get_interpolation_solver() const {
+  return d_z3;
+}
+
 void y2z3::gc_collect(const expr::gc_relocator& gc_reloc) {
   solver::gc_collect(gc_reloc);
+  gc_reloc.reloc(d_assumptions);
 }
 
 }
@@ -50,12 +50,22 @@ yices2::yices2(expr::term_manager& tm, const options& opts, utils::statistics& s
 : solver("yices2", tm, opts, stats)
 {
   d_internal = new yices2_internal(tm, opts);
+  set_interruptible(true);
 }
 
 yices2::~yices2() {
+  set_interruptible(false);
   delete d_internal;
 }
 
+bool yices2::is_thread_safe() {
+#if __YICES_VERSION > 2 || (__YICES_VERSION == 2 && (__YICES_VERSION_MAJOR > 6 || (__YICES_VERSION_MAJOR == 6 && __YICES_VERSION_PATCHLEVEL >= 2)))
+  return yices_is_thread_safe();
+#else
+  return false;
+#endif
+}
+
 void yices2::add(expr::term_ref f, formula_class f_class) {
   TRACE("yices2") << "yices2[" << d_internal->instance() << "]: adding " << f << std::endl;
   d_internal->add(f, f_class);
@@ -66,6 +76,11 @@ solver::result yices2::check() {
   return d_internal->check();
 }
 
+solver::result yices2::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("yices2") << "yices2[" << d_internal->instance() << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  return d_internal->check(assumptions, f_class, core);
+}
+
 bool yices2::is_consistent() {
   TRACE("yices2") << "yices2[" << d_internal->instance() << "]: is_consistent()" << std::endl;
   return d_internal->is_consistent();
@@ -108,6 +123,9 @@ void yices2::set_hint(expr::model::ref m) {
   d_internal->set_hint(m);
 }
 
+void yices2::interrupt() {
+  d_internal->interrupt();
+}
 
 void yices2::gc() {
   d_internal->gc();
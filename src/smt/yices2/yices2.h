@@ -44,10 +44,14 @@ public:
   /** Destructor */
   ~yices2();
 
+  /** Is the linked Yices built to be used from several threads at once */
+  static bool is_thread_safe();
+
   /** Features */
   bool supports(feature f) const {
     switch (f) {
     case GENERALIZATION:
+    case ASSUMPTIONS:
       return true;
     default:
       return false;
@@ -63,6 +67,9 @@ public:
   /** Check the assertions for satisfiability */
   result check();
 
+  /** Check the assertions for satisfiability under assumptions */
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Consistent? */
   bool is_consistent();
 
@@ -88,6 +95,9 @@ public:
   /** Set the hint */
   void set_hint(expr::model::ref m);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Term collection */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
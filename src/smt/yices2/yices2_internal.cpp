@@ -28,9 +28,11 @@
 #include "expr/gc_relocator.h"
 #include "expr/term_visitor.h"
 #include "utils/output.h"
+#include "smt/factory.h"
 
 #include <iostream>
 #include <fstream>
+#include <boost/thread/exceptions.hpp>
 
 namespace sally {
 namespace smt {
@@ -63,6 +65,8 @@ yices2_internal::yices2_internal(expr::term_manager& tm, const options& opts)
 , d_ctx_mcsat(NULL)
 , d_dpllt_incomplete(false)
 , d_mcsat_incomplete(false)
+, d_assumptions_size(0)
+, d_mcsat_assumptions_pushed(false)
 , d_conversion_cache(0)
 , d_last_check_status_dpllt(STATUS_UNKNOWN)
 , d_last_check_status_mcsat(STATUS_UNKNOWN)
@@ -70,6 +74,8 @@ yices2_internal::yices2_internal(expr::term_manager& tm, const options& opts)
 , d_config_mcsat(NULL)
 , d_instance(s_instances)
 {
+  backend_lock lock;
+
   // Initialize
   if (s_instances == 0) {
     TRACE("yices2") << "yices2: first instance." << std::endl;
@@ -155,13 +161,14 @@ yices2_internal::~yices2_internal() {
   }
 
   // Cleanup if the last one
+  backend_lock lock;
   s_instances--;
   if (s_instances == 0) {
     TRACE("yices2") << "yices2: last instance removed." << std::endl;
     // Delete yices
     yices_exit();
-    // Clear the cache
-    d_conversion_cache->clear();
+    // Clear the caches of all term managers
+    yices2_term_cache::clear_all();
   }
 }
 
@@ -710,13 +717,12 @@ expr::term_ref yices2_internal::mk_term(term_constructor_t constructor, const st
 
 static
 expr::bitvector yices_bv_to_bitvector(size_t size, int32_t* bits) {
-  char* bits_str = new char[size + 1];
-  bits_str[size] = 0;
+  expr::bitvector bv(size);
   for (size_t i = 0; i < size; ++ i) {
-    bits_str[i] = bits[size-i-1] ? '1' : '0';
+    if (bits[i]) {
+      bv.set_bit(i, true);
+    }
   }
-  expr::bitvector bv(bits_str);
-  delete[] bits_str;
   return bv;
 }
 
@@ -1049,6 +1055,8 @@ void yices2_internal::add(expr::term_ref ref, solver::formula_class f_class) {
   int ret_dpllt = 0;
   int ret_mcsat = 0;
 
+  clear_assumptions();
+
   // Remember the assertions
   expr::term_ref_strong ref_strong(d_tm, ref);
   d_assertions.push_back(ref_strong);
@@ -1088,10 +1096,35 @@ void yices2_internal::add(expr::term_ref ref, solver::formula_class f_class) {
   }
 }
 
+void yices2_internal::clear_assumptions() {
+  while (d_assumptions_size > 0) {
+    d_assertions.pop_back();
+    d_assertion_classes.pop_back();
+    d_assumptions_size --;
+  }
+  if (d_mcsat_assumptions_pushed) {
+    int ret = yices_pop(d_ctx_mcsat);
+    check_error(ret, "Yices error (pop)");
+    d_mcsat_assumptions_pushed = false;
+  }
+}
+
+void yices2_internal::interrupt() {
+  // Both contexts, we don't know which one is searching
+  if (d_ctx_dpllt) {
+    yices_stop_search(d_ctx_dpllt);
+  }
+  if (d_ctx_mcsat) {
+    yices_stop_search(d_ctx_mcsat);
+  }
+}
+
 solver::result yices2_internal::check() {
 
   smt_status_t result;
 
+  clear_assumptions();
+
   // Call DPLL(T) first, then MCSAT if unsupported
   if (d_ctx_dpllt) {
     result = d_last_check_status_dpllt = yices_check_context(d_ctx_dpllt, 0);
@@ -1106,6 +1139,8 @@ solver::result yices2_internal::check() {
       }
     case STATUS_UNSAT:
       return solver::UNSAT;
+    case STATUS_INTERRUPTED:
+      throw boost::thread_interrupted();
     case STATUS_UNKNOWN:
       break; // Do MCSAT
     default: {
@@ -1127,6 +1162,120 @@ solver::result yices2_internal::check() {
       }
     case STATUS_UNSAT:
       return solver::UNSAT;
+    case STATUS_INTERRUPTED:
+      throw boost::thread_interrupted();
+    case STATUS_UNKNOWN:
+      return solver::UNKNOWN;
+    default: {
+      std::stringstream ss;
+      ss << "Yices error (check): " << yices_error();
+      throw exception(ss.str());
+    }
+    }
+  }
+
+  return solver::UNKNOWN;
+}
+
+solver::result yices2_internal::check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core) {
+
+  smt_status_t result;
+
+  clear_assumptions();
+
+  // Keep them with the assertions so that the model and generalization account for them
+  std::vector<term_t> yices_assumptions;
+  for (size_t i = 0; i < assumptions.size(); ++ i) {
+    yices_assumptions.push_back(to_yices2_term(assumptions[i]));
+    d_assertions.push_back(expr::term_ref_strong(d_tm, assumptions[i]));
+    d_assertion_classes.push_back(f_class);
+    d_assumptions_size ++;
+  }
+
+  // Call DPLL(T) first, then MCSAT if unsupported
+  if (d_ctx_dpllt) {
+    result = d_last_check_status_dpllt = yices_check_context_with_assumptions(d_ctx_dpllt, 0, yices_assumptions.size(), yices_assumptions.empty() ? 0 : &yices_assumptions[0]);
+    d_last_check_status_mcsat = STATUS_UNKNOWN;
+    switch (result) {
+    case STATUS_SAT:
+      if (!d_dpllt_incomplete) {
+        return solver::SAT;
+      } else {
+        d_last_check_status_dpllt = STATUS_UNKNOWN;
+        break; // Do MCSAT
+      }
+    case STATUS_UNSAT:
+      if (core) {
+        term_vector_t yices_core;
+        yices_init_term_vector(&yices_core);
+        int ret = yices_get_unsat_core(d_ctx_dpllt, &yices_core);
+        check_error(ret, "Yices error (unsat core)");
+        core->clear();
+        for (size_t i = 0; i < yices_assumptions.size(); ++ i) {
+          for (size_t j = 0; j < yices_core.size; ++ j) {
+            if (yices_core.data[j] == yices_assumptions[i]) {
+              core->push_back(assumptions[i]);
+              break;
+            }
+          }
+        }
+        yices_delete_term_vector(&yices_core);
+      }
+      return solver::UNSAT;
+    case STATUS_INTERRUPTED:
+      throw boost::thread_interrupted();
+    case STATUS_UNKNOWN:
+      break; // Do MCSAT
+    default: {
+      error_code_t error = yices_error_code();
+      if (error == CTX_NONLINEAR_ARITH_NOT_SUPPORTED) {
+        // Unsupported assumption -> incomplete
+        yices_clear_error();
+        d_last_check_status_dpllt = STATUS_UNKNOWN;
+        break; // Do MCSAT
+      }
+      std::stringstream ss;
+      ss << "Yices error (check): " << yices_error();
+      throw exception(ss.str());
+    }
+    }
+  }
+  if (d_ctx_mcsat) {
+    // Assert the assumptions in a scope that is popped with the assumptions
+    int ret = yices_push(d_ctx_mcsat);
+    check_error(ret, "Yices error (push)");
+    d_mcsat_assumptions_pushed = true;
+    bool incomplete = d_mcsat_incomplete;
+    for (size_t i = 0; i < yices_assumptions.size(); ++ i) {
+      ret = yices_assert_formula(d_ctx_mcsat, yices_assumptions[i]);
+      if (ret < 0) {
+        error_code_t error = yices_error_code();
+        if (error == MCSAT_ERROR_UNSUPPORTED_THEORY) {
+          // Unsupported -> incomplete
+          yices_clear_error();
+          incomplete = true;
+        } else {
+          check_error(ret, "Yices error (add)");
+        }
+      }
+    }
+    result = d_last_check_status_mcsat = yices_check_context(d_ctx_mcsat, 0);
+    switch (result) {
+    case STATUS_SAT:
+      if (!incomplete) {
+        return solver::SAT;
+      } else {
+        d_last_check_status_mcsat = STATUS_UNKNOWN;
+        break; // Nobody knows
+      }
+    case STATUS_UNSAT:
+      if (core) {
+        // No better core than all of them
+        *core = assumptions;
+      }
+      return solver::UNSAT;
+    case STATUS_INTERRUPTED:
+      throw boost::thread_interrupted();
     case STATUS_UNKNOWN:
       return solver::UNKNOWN;
     default: {
@@ -1156,18 +1305,6 @@ bool yices2_internal::is_consistent() {
   return true;
 }
 
-static
-expr::bitvector bitvector_from_int32(size_t size, int32_t* value) {
-  char* value_str = new char[size+1];
-  for (size_t i = 0; i < size; ++ i) {
-    value_str[size - i - 1] = value[i] ? '1' : '0';
-  }
-  value_str[size] = 0;
-  expr::bitvector bv(value_str);
-  delete[] value_str;
-  return bv;
-}
-
 void yices2_internal::get_variables(std::vector<expr::term_ref>& variables) {
   bool class_A_used = false;
   bool class_B_used = false;
@@ -1304,6 +1441,12 @@ expr::model::ref yices2_internal::get_model() {
       break;
     }
     case expr::TYPE_INTEGER: {
+      // Small values first, no GMP allocation
+      int64_t small_value;
+      if (yices_get_int64_value(yices_model, yices_var, &small_value) == 0) {
+        var_value = expr::value(expr::rational(small_value, 1));
+        break;
+      }
       // The integer mpz_t value
       mpz_t value;
       mpz_init(value);
@@ -1316,6 +1459,13 @@ expr::model::ref yices2_internal::get_model() {
       break;
     }
     case expr::TYPE_REAL: {
+      // Small values first, no GMP allocation
+      int64_t small_num;
+      uint64_t small_den;
+      if (yices_get_rational64_value(yices_model, yices_var, &small_num, &small_den) == 0) {
+        var_value = expr::value(expr::rational(small_num, small_den));
+        break;
+      }
       // The integer mpz_t value
       mpq_t value;
       mpq_init(value);
@@ -1352,7 +1502,7 @@ expr::model::ref yices2_internal::get_model() {
       int32_t* value = new int32_t[size];
       ret = yices_get_bv_value(yices_model, yices_var, value);
       check_error(ret, "Error obtaining bit-vector value from Yices2 model.");
-      expr::bitvector bv = bitvector_from_int32(size, value);
+      expr::bitvector bv = yices_bv_to_bitvector(size, value);
       var_value = expr::value(bv);
       delete[] value;
       break;
@@ -1373,6 +1523,7 @@ expr::model::ref yices2_internal::get_model() {
 
 void yices2_internal::push() {
   int ret = 0;
+  clear_assumptions();
   if (d_ctx_dpllt) {
     ret = yices_push(d_ctx_dpllt);
     check_error(ret, "Yices error (push)");
@@ -1388,6 +1539,7 @@ void yices2_internal::push() {
 
 void yices2_internal::pop() {
   int ret = 0;
+  clear_assumptions();
   if (d_ctx_dpllt) {
     ret = yices_pop(d_ctx_dpllt);
     check_error(ret, "Yices error (pop)");
@@ -79,6 +79,15 @@ class yices2_internal {
   /** The assertions size per push/pop */
   std::vector<size_t> d_assertions_size;
 
+  /** Number of assumptions at the end of d_assertions (from last check) */
+  size_t d_assumptions_size;
+
+  /** Did we push the mcsat context to assert the assumptions */
+  bool d_mcsat_assumptions_pushed;
+
+  /** Remove the assumptions of the last check from the assertions */
+  void clear_assumptions();
+
   /** A variables */
   std::vector<expr::term_ref> d_A_variables;
   std::set<expr::term_ref> d_A_variables_set;
@@ -163,6 +172,9 @@ public:
   /** Check satisfiability */
   solver::result check();
 
+  /** Check satisfiability under assumptions */
+  solver::result check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core);
+
   /** Is the state consistent */
   bool is_consistent();
 
@@ -187,6 +199,9 @@ public:
   /** Set the model hint */
   void set_hint(expr::model::ref m);
 
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Returns the instance id */
   size_t instance() const { return d_instance; }
 
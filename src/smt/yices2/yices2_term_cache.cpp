@@ -18,6 +18,7 @@
 #ifdef WITH_YICES2
 
 #include "smt/yices2/yices2_term_cache.h"
+#include "smt/factory.h"
 #include "expr/gc_relocator.h"
 
 #include <iomanip>
@@ -148,6 +149,14 @@ void yices2_term_cache::clear() {
   d_permanent_terms_yices.clear();
 }
 
+void yices2_term_cache::clear_all() {
+  backend_lock lock;
+  tm_to_cache_map::map_type::iterator it = s_tm_to_cache_map.map.begin();
+  for (; it != s_tm_to_cache_map.map.end(); ++ it) {
+    it->second->clear();
+  }
+}
+
 yices2_term_cache::tm_to_cache_map::~tm_to_cache_map() {
   tm_to_cache_map::map_type::iterator it = s_tm_to_cache_map.map.begin();
   for (; it != s_tm_to_cache_map.map.end(); ++ it) {
@@ -157,6 +166,8 @@ yices2_term_cache::tm_to_cache_map::~tm_to_cache_map() {
 
 yices2_term_cache* yices2_term_cache::get_cache(expr::term_manager& tm) {
 
+  backend_lock lock;
+
   yices2_term_cache* cache = 0;
 
   // Try to find an existing one
@@ -201,6 +212,12 @@ void yices2_term_cache::gc_collect(const expr::gc_relocator& gc_reloc) {
   gc_reloc.reloc(d_permanent_terms);
 }
 
+void yices2_term_cache::gc_tm_destroyed() {
+  backend_lock lock;
+  s_tm_to_cache_map.map.erase(d_tm.id());
+  delete this;
+}
+
 }
 }
 
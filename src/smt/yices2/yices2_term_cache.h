@@ -106,9 +106,16 @@ public:
   /** Clear the cache */
   void clear();
 
+  /** Clear the caches of all term managers (Yices terms are gone) */
+  static
+  void clear_all();
+
   /** Term collection */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
+  /** The term manager is gone, remove (and delete) the cache */
+  void gc_tm_destroyed();
+
   /** Collect the cache, leaving only the variables */
   void gc();
 };
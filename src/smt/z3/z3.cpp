@@ -50,9 +50,11 @@ z3::z3(expr::term_manager& tm, const options& opts, utils::statistics& stats)
 : solver("z3", tm, opts, stats)
 {
   d_internal = new z3_internal(tm, opts);
+  set_interruptible(true);
 }
 
 z3::~z3() {
+  set_interruptible(false);
   delete d_internal;
 }
 
@@ -66,6 +68,11 @@ solver::result z3::check() {
   return d_internal->check();
 }
 
+solver::result z3::check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core) {
+  TRACE("z3") << "z3[" << d_internal->instance() << "]: check() with " << assumptions.size() << " assumptions" << std::endl;
+  return d_internal->check(assumptions, f_class, core);
+}
+
 expr::model::ref z3::get_model() const {
   TRACE("z3") << "z3[" << d_internal->instance() << "]: get_model()" << std::endl;
   return d_internal->get_model(d_A_variables, d_T_variables, d_B_variables);
@@ -86,6 +93,10 @@ void z3::add_variable(expr::term_ref var, variable_class f_class) {
   d_internal->add_variable(var, f_class);
 }
 
+void z3::interrupt() {
+  d_internal->interrupt();
+}
+
 void z3::gc() {
   d_internal->gc();
 }
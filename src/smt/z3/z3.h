@@ -45,7 +45,12 @@ public:
 
   /** Features */
   bool supports(feature f) const {
-    return false;
+    switch (f) {
+    case ASSUMPTIONS:
+      return true;
+    default:
+      return false;
+    }
   }
 
   /** Add an assertion f to the solver */
@@ -66,6 +71,12 @@ public:
   /** Pop the solving context */
   void pop();
 
+  /** Check the assertions for satisfiability under assumptions */
+  result check_assumptions(const std::vector<expr::term_ref>& assumptions, formula_class f_class, std::vector<expr::term_ref>* core);
+
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Term collection */
   void gc_collect(const expr::gc_relocator& gc_reloc);
 
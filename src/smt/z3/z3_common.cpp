@@ -19,6 +19,7 @@
 #ifdef WITH_Z3
 
 #include "z3_common.h"
+#include "smt/factory.h"
 #include "expr/gc_relocator.h"
 #include "utils/trace.h"
 
@@ -66,6 +67,8 @@ void z3_common::set_term_cache(expr::term_ref t, Z3_ast t_z3) {
     d_permanent_terms.push_back(t);
     d_permanent_terms_z3.push_back(t_z3);
     d_z3_to_term_cache[t_z3] = t;
+    // Both caches hold a reference
+    Z3_inc_ref(d_ctx, t_z3);
   } else {
     // Mark cache as dirty
     d_cache_is_clean = false;
@@ -111,6 +114,8 @@ void z3_common::set_term_cache(Z3_ast t_z3, expr::term_ref t) {
     d_permanent_terms.push_back(t);
     d_permanent_terms_z3.push_back(t_z3);
     d_term_to_z3_cache[t] = t_z3;
+    // Both caches hold a reference
+    Z3_inc_ref(d_ctx, t_z3);
   } else {
     // Mark cache as dirty
     d_cache_is_clean = false;
@@ -191,6 +196,8 @@ z3_common::tm_to_cache_map::~tm_to_cache_map() {
 
 z3_common* z3_common::get_cache(expr::term_manager& tm) {
 
+  backend_lock lock;
+
   z3_common* cache = 0;
 
   // Try to find an existing one
@@ -217,6 +224,12 @@ void z3_common::gc_collect(const expr::gc_relocator& gc_reloc) {
   gc_reloc.reloc(d_permanent_terms);
 }
 
+void z3_common::gc_tm_destroyed() {
+  backend_lock lock;
+  s_tm_to_cache_map.map.erase(d_tm.id());
+  delete this;
+}
+
 }
 }
 
@@ -23,9 +23,11 @@
 #include "utils/trace.h"
 #include "expr/gc_relocator.h"
 #include "utils/output.h"
+#include "smt/factory.h"
 
 #include <iostream>
 #include <fstream>
+#include <boost/thread/exceptions.hpp>
 
 namespace sally {
 namespace smt {
@@ -37,10 +39,14 @@ z3_internal::z3_internal(expr::term_manager& tm, const options& opts)
 , d_ctx(0)
 , d_solver(0)
 , d_params(0)
+, d_assumptions_size(0)
 , d_conversion_cache(0)
 , d_last_check_status(Z3_L_UNDEF)
+, d_interrupted(false)
 , d_instance(s_instances)
 {
+  backend_lock lock;
+
   // Initialize
   if (s_instances == 0) {
     TRACE("z3") << "z3: first instance." << std::endl;
@@ -73,6 +79,7 @@ z3_internal::~z3_internal() {
   Z3_params_dec_ref(d_ctx, d_params);
 
   // Cleanup if the last one
+  backend_lock lock;
   s_instances--;
   if (s_instances == 0) {
     TRACE("z3") << "z3: last instance removed." << std::endl;
@@ -842,6 +849,8 @@ expr::term_ref z3_internal::to_term(Z3_ast z3_term) {
 }
 
 void z3_internal::add(expr::term_ref ref, solver::formula_class f_class) {
+  clear_assumptions();
+
   // Remember the assertions
   expr::term_ref_strong ref_strong(d_tm, ref);
   d_assertions.push_back(ref_strong);
@@ -860,13 +869,88 @@ void z3_internal::add(expr::term_ref ref, solver::formula_class f_class) {
   }
 }
 
+void z3_internal::clear_assumptions() {
+  while (d_assumptions_size > 0) {
+    d_assertions.pop_back();
+    d_assertion_classes.pop_back();
+    d_assumptions_size --;
+  }
+}
+
+void z3_internal::interrupt() {
+  d_interrupted = true;
+  Z3_interrupt(d_ctx);
+}
+
+void z3_internal::check_interrupted() {
+  if (d_interrupted) {
+    d_interrupted = false;
+    throw boost::thread_interrupted();
+  }
+}
+
 solver::result z3_internal::check() {
+  clear_assumptions();
+  d_interrupted = false;
   d_last_check_status = Z3_solver_check(d_ctx, d_solver);
 
   switch (d_last_check_status) {
   case Z3_L_FALSE:
     return solver::UNSAT;
   case Z3_L_UNDEF:
+    check_interrupted();
+    return solver::UNKNOWN;
+  case Z3_L_TRUE:
+    return solver::SAT;
+  default:
+    assert(false);
+  }
+
+  return solver::UNKNOWN;
+}
+
+solver::result z3_internal::check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core) {
+  clear_assumptions();
+
+  // Keep them with the assertions so that the model accounts for them
+  std::vector<Z3_ast> z3_assumptions;
+  for (size_t i = 0; i < assumptions.size(); ++ i) {
+    z3_assumptions.push_back(to_z3_term(assumptions[i]));
+    d_assertions.push_back(expr::term_ref_strong(d_tm, assumptions[i]));
+    d_assertion_classes.push_back(f_class);
+    d_assumptions_size ++;
+  }
+
+  d_interrupted = false;
+  d_last_check_status = Z3_solver_check_assumptions(d_ctx, d_solver, z3_assumptions.size(), z3_assumptions.empty() ? 0 : &z3_assumptions[0]);
+  Z3_error_code error = Z3_get_error_code(d_ctx);
+  if (error != Z3_OK) {
+    std::stringstream ss;
+    Z3_string msg = Z3_get_error_msg(d_ctx, error);
+    ss << "Z3 error (check): " << msg << ".";
+    throw exception(ss.str());
+  }
+
+  switch (d_last_check_status) {
+  case Z3_L_FALSE:
+    if (core) {
+      core->clear();
+      Z3_ast_vector z3_core = Z3_solver_get_unsat_core(d_ctx, d_solver);
+      Z3_ast_vector_inc_ref(d_ctx, z3_core);
+      unsigned core_size = Z3_ast_vector_size(d_ctx, z3_core);
+      for (size_t i = 0; i < z3_assumptions.size(); ++ i) {
+        for (unsigned j = 0; j < core_size; ++ j) {
+          if (Z3_is_eq_ast(d_ctx, z3_assumptions[i], Z3_ast_vector_get(d_ctx, z3_core, j))) {
+            core->push_back(assumptions[i]);
+            break;
+          }
+        }
+      }
+      Z3_ast_vector_dec_ref(d_ctx, z3_core);
+    }
+    return solver::UNSAT;
+  case Z3_L_UNDEF:
+    check_interrupted();
     return solver::UNKNOWN;
   case Z3_L_TRUE:
     return solver::SAT;
@@ -949,13 +1033,14 @@ expr::model::ref z3_internal::get_model(const std::set<expr::term_ref>& x_variab
       var_value = expr::value(Z3_get_bool_value(d_ctx, value));
       break;
     }
-    case expr::TYPE_INTEGER: {
-      Z3_string value_string = Z3_get_numeral_string(d_ctx, value);
-      expr::rational q_value(value_string);
-      var_value = expr::value(q_value);
-      break;
-    }
+    case expr::TYPE_INTEGER:
     case expr::TYPE_REAL: {
+      // Small values first, no string conversion
+      int64_t small_num, small_den;
+      if (Z3_get_numeral_rational_int64(d_ctx, value, &small_num, &small_den) && small_den > 0) {
+        var_value = expr::value(expr::rational(small_num, small_den));
+        break;
+      }
       Z3_string value_string = Z3_get_numeral_string(d_ctx, value);
       expr::rational q_value(value_string);
       var_value = expr::value(q_value);
@@ -995,6 +1080,7 @@ expr::model::ref z3_internal::get_model(const std::set<expr::term_ref>& x_variab
 }
 
 void z3_internal::push() {
+  clear_assumptions();
   Z3_solver_push(d_ctx, d_solver);
   Z3_error_code error = Z3_get_error_code(d_ctx);
   if (error != Z3_OK) {
@@ -1007,6 +1093,7 @@ void z3_internal::push() {
 }
 
 void z3_internal::pop() {
+  clear_assumptions();
   Z3_solver_pop(d_ctx, d_solver, 1);
   Z3_error_code error = Z3_get_error_code(d_ctx);
   if (error != Z3_OK) {
@@ -28,6 +28,7 @@
 
 #include <gmp.h>
 #include <vector>
+#include <boost/atomic.hpp>
 
 extern "C"
 {
@@ -68,6 +69,12 @@ class z3_internal {
   /** The assertions size per push/pop */
   std::vector<size_t> d_assertions_size;
 
+  /** Number of assumptions at the end of d_assertions (from last check) */
+  size_t d_assumptions_size;
+
+  /** Remove the assumptions of the last check from the assertions */
+  void clear_assumptions();
+
   /** A variables */
   std::vector<expr::term_ref> d_A_variables;
 
@@ -89,6 +96,12 @@ class z3_internal {
   /** Last check return */
   Z3_lbool d_last_check_status;
 
+  /** Set to stop the running check */
+  boost::atomic<bool> d_interrupted;
+
+  /** Throw boost::thread_interrupted if the last check was interrupted */
+  void check_interrupted();
+
   /** The instance */
   size_t d_instance;
 
@@ -127,6 +140,12 @@ public:
   /** Check satisfiability */
   solver::result check();
 
+  /** Check satisfiability under assumptions */
+  solver::result check(const std::vector<expr::term_ref>& assumptions, solver::formula_class f_class, std::vector<expr::term_ref>* core);
+
+  /** Interrupt the running check */
+  void interrupt();
+
   /** Returns the model */
   expr::model::ref get_model(const std::set<expr::term_ref>& x_variables, const std::set<expr::term_ref>& T_variables, const std::set<expr::term_ref>& y_variables);
 
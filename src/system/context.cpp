@@ -29,6 +29,7 @@ context::context(expr::term_manager& tm, options& opts, utils::statistics& stats
 , d_transition_systems("state transition systems")
 , d_options(opts)
 , d_stats(stats)
+, d_lemma_bus(0)
 {
 }
 
@@ -167,6 +168,14 @@ utils::statistics& context::get_statistics() const {
   return d_stats;
 }
 
+void context::set_lemma_bus(lemma_bus* bus) {
+  d_lemma_bus = bus;
+}
+
+lemma_bus* context::get_lemma_bus() const {
+  return d_lemma_bus;
+}
+
 context::id_set::const_iterator context::state_formulas_begin(const system::state_type* st) const {
   std::map<const state_type*, id_set>::const_iterator it = d_state_types_to_state_formulas.find(st);
   if (it == d_state_types_to_state_formulas.end()) {
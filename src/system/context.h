@@ -33,6 +33,8 @@
 namespace sally {
 namespace system {
 
+class lemma_bus;
+
 /**
  * A context to create and keep track of transition systems, their types,
  * formulas, properties...
@@ -106,6 +108,12 @@ public:
   /** Get the statistics */
   utils::statistics& get_statistics() const;
 
+  /** Set the bus for sharing lemmas between engines (not owned, 0 for none) */
+  void set_lemma_bus(lemma_bus* bus);
+
+  /** Get the bus for sharing lemmas between engines (0 if none) */
+  lemma_bus* get_lemma_bus() const;
+
   /** Set of ids */
   typedef std::set<std::string> id_set;
 
@@ -158,6 +166,9 @@ private:
 
   /** Statistics manager */
   utils::statistics& d_stats;
+
+  /** Bus for sharing lemmas (not owned) */
+  lemma_bus* d_lemma_bus;
 };
 
 
@@ -0,0 +1,177 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system/lemma_bus.h"
+#include "utils/trace.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include <cassert>
+
+namespace sally {
+namespace system {
+
+lemma_bus::lemma_bus(const state_type* st)
+: d_tm(d_stats)
+, d_clients(0)
+{
+  // Copy the state variables
+  expr::term_manager::substitution_map cache;
+  const std::vector<expr::term_ref>& vars = st->get_variables(state_type::STATE_CURRENT);
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    d_variables.push_back(d_tm.translate(st->tm(), vars[i], cache));
+  }
+}
+
+size_t lemma_bus::size() {
+  boost::lock_guard<boost::mutex> lock(d_mutex);
+  return d_lemmas.size();
+}
+
+lemma_bus::client::client(lemma_bus* bus, const state_type* st)
+: d_bus(bus)
+, d_id(0)
+, d_state_type(st)
+, d_next(0)
+, d_frames(0)
+, d_asserted(0)
+, d_asserted_depth(1)
+{
+  if (d_bus) {
+    assert(st->get_variables(state_type::STATE_CURRENT).size() == d_bus->d_variables.size());
+    boost::lock_guard<boost::mutex> lock(d_bus->d_mutex);
+    d_id = d_bus->d_clients ++;
+  }
+}
+
+bool lemma_bus::client::publish(expr::term_ref F, size_t depth) {
+
+  if (d_bus == 0) {
+    return false;
+  }
+
+  expr::term_manager& tm = d_state_type->tm();
+  const std::vector<expr::term_ref>& vars = d_state_type->get_variables(state_type::STATE_CURRENT);
+
+  // Only lemmas over the current state variables
+  std::vector<expr::term_ref> F_vars;
+  tm.get_variables(F, F_vars);
+  for (size_t i = 0; i < F_vars.size(); ++ i) {
+    if (std::find(vars.begin(), vars.end(), F_vars[i]) == vars.end()) {
+      return false;
+    }
+  }
+
+  boost::lock_guard<boost::mutex> lock(d_bus->d_mutex);
+
+  // Translate to the bus
+  expr::term_manager::substitution_map cache;
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    cache[vars[i]] = d_bus->d_variables[i];
+  }
+  expr::term_ref F_bus = d_bus->d_tm.translate(tm, F, cache);
+  if (d_bus->d_lemmas_set.find(F_bus) != d_bus->d_lemmas_set.end()) {
+    return false;
+  }
+
+  MSG(1) << "lemma_bus: client " << d_id << " published lemma " << d_bus->d_lemmas.size() << std::endl;
+
+  d_bus->d_lemmas_set.insert(F_bus);
+  d_bus->d_lemmas.push_back(lemma(expr::term_ref_strong(d_bus->d_tm, F_bus), depth, d_id));
+  return true;
+}
+
+void lemma_bus::client::receive(std::vector<expr::term_ref>& out) {
+  std::vector<size_t> depths;
+  receive(out, depths);
+}
+
+void lemma_bus::client::receive(std::vector<expr::term_ref>& out, std::vector<size_t>& depths) {
+
+  if (d_bus == 0) {
+    return;
+  }
+
+  expr::term_manager& tm = d_state_type->tm();
+  const std::vector<expr::term_ref>& vars = d_state_type->get_variables(state_type::STATE_CURRENT);
+
+  boost::lock_guard<boost::mutex> lock(d_bus->d_mutex);
+  if (d_next == d_bus->d_lemmas.size()) {
+    return;
+  }
+
+  // Translate from the bus
+  expr::term_manager::substitution_map cache;
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    cache[d_bus->d_variables[i]] = vars[i];
+  }
+  for (; d_next < d_bus->d_lemmas.size(); ++ d_next) {
+    const lemma& l = d_bus->d_lemmas[d_next];
+    if (l.source != d_id) {
+      out.push_back(tm.translate(d_bus->d_tm, l.F, cache));
+      depths.push_back(l.depth);
+    }
+  }
+}
+
+void lemma_bus::client::get_asserted(std::vector<expr::term_ref>& out) const {
+  out.insert(out.end(), d_received.begin(), d_received.begin() + d_asserted);
+}
+
+size_t lemma_bus::client::get_asserted_depth() const {
+  return d_asserted_depth;
+}
+
+void lemma_bus::client::assert_lemmas(smt::solver* solver, trace_helper* trace, size_t frames) {
+
+  if (d_bus == 0) {
+    return;
+  }
+
+  // Get the new lemmas
+  std::vector<expr::term_ref> received;
+  std::vector<size_t> depths;
+  receive(received, depths);
+  for (size_t i = 0; i < received.size(); ++ i) {
+    d_received.push_back(expr::term_ref_strong(d_state_type->tm(), received[i]));
+    d_received_depth.push_back(depths[i]);
+  }
+  if (received.size() > 0) {
+    MSG(1) << "lemma_bus: client " << d_id << " received " << received.size() << " lemmas" << std::endl;
+  }
+
+  // Old lemmas at the new frames
+  for (size_t k = d_frames; k < frames; ++ k) {
+    for (size_t i = 0; i < d_asserted; ++ i) {
+      solver->add(trace->get_state_formula(d_received[i], k), smt::solver::CLASS_A);
+    }
+  }
+  d_frames = std::max(d_frames, frames);
+
+  // New lemmas at all the frames
+  for (size_t i = d_asserted; i < d_received.size(); ++ i) {
+    for (size_t k = 0; k < d_frames; ++ k) {
+      solver->add(trace->get_state_formula(d_received[i], k), smt::solver::CLASS_A);
+    }
+    d_asserted_depth = std::max(d_asserted_depth, d_received_depth[i]);
+  }
+  d_asserted = d_received.size();
+}
+
+}
+}
@@ -0,0 +1,158 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "expr/term_manager.h"
+#include "system/state_type.h"
+#include "system/trace_helper.h"
+#include "smt/solver.h"
+#include "utils/statistics.h"
+
+#include <vector>
+#include <boost/unordered_set.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace sally {
+namespace system {
+
+/**
+ * Exchange of proven state invariants (lemmas) between engines, possibly
+ * running in different threads with different term managers. The lemmas are
+ * kept in a private term manager, over a private copy of the state variables
+ * of a state type. Engines connect to the bus with a client over their own
+ * term manager and a state type with the same variables (e.g. a copy of the
+ * original one), publish the lemmas they have proven, and receive the lemmas
+ * published by others.
+ *
+ * Only formulas over the current state variables that hold in all reachable
+ * states should be published. Each lemma comes with the induction depth of
+ * its proof (relative to the lemmas published before it), so that engines
+ * that use it can report invariants of the right depth.
+ */
+class lemma_bus {
+
+  /** Private statistics */
+  utils::statistics d_stats;
+
+  /** Private term manager */
+  expr::term_manager d_tm;
+
+  /** Lock for the bus */
+  boost::mutex d_mutex;
+
+  /** The state variables (in the private term manager) */
+  std::vector<expr::term_ref> d_variables;
+
+  /** A published lemma */
+  struct lemma {
+    /** The formula (in the private term manager) */
+    expr::term_ref_strong F;
+    /** Induction depth of the proof */
+    size_t depth;
+    /** The client that published it */
+    size_t source;
+    lemma(const expr::term_ref_strong& F, size_t depth, size_t source)
+    : F(F), depth(depth), source(source) {}
+  };
+
+  /** All the lemmas, in order of publication */
+  std::vector<lemma> d_lemmas;
+
+  /** Set of all the lemmas (to avoid duplicates) */
+  boost::unordered_set<expr::term_ref, expr::term_ref_hasher> d_lemmas_set;
+
+  /** Number of clients so far */
+  size_t d_clients;
+
+public:
+
+  /** Create a bus for systems with the variables of the given state type */
+  lemma_bus(const state_type* st);
+
+  /** Number of lemmas on the bus */
+  size_t size();
+
+  /**
+   * A connection to the bus over a term manager and a state type. A client
+   * should only be used from one thread at a time. A client without a bus
+   * does nothing, so engines can always use one.
+   */
+  class client {
+
+    /** The bus (0 if none) */
+    lemma_bus* d_bus;
+
+    /** Id of the client */
+    size_t d_id;
+
+    /** The state type of the client */
+    const state_type* d_state_type;
+
+    /** Index of the next lemma to receive */
+    size_t d_next;
+
+    /** Received lemmas (client term manager) */
+    std::vector<expr::term_ref_strong> d_received;
+
+    /** Number of frames where the received lemmas have been asserted */
+    size_t d_frames;
+
+    /** Induction depths of the received lemmas */
+    std::vector<size_t> d_received_depth;
+
+    /** Number of received lemmas asserted at all of the frames */
+    size_t d_asserted;
+
+    /** Largest induction depth of the asserted lemmas (at least 1) */
+    size_t d_asserted_depth;
+
+  public:
+
+    /** Connect to the bus (if not 0) with the variables of the given state type */
+    client(lemma_bus* bus, const state_type* st);
+
+    /**
+     * Publish the lemma, proven with the given induction depth (returns false
+     * if already on the bus or not over state variables).
+     */
+    bool publish(expr::term_ref F, size_t depth);
+
+    /** Receive the lemmas published by others since the last call */
+    void receive(std::vector<expr::term_ref>& out);
+
+    /** Receive the lemmas published by others since the last call, with their depths */
+    void receive(std::vector<expr::term_ref>& out, std::vector<size_t>& depths);
+
+    /** Add the lemmas asserted so far by assert_lemmas() to out */
+    void get_asserted(std::vector<expr::term_ref>& out) const;
+
+    /** Largest induction depth of the lemmas asserted so far (at least 1) */
+    size_t get_asserted_depth() const;
+
+    /**
+     * Receive the new lemmas, and assert all the received lemmas in the solver
+     * at frames 0, ..., frames-1 of the trace (each lemma is asserted at each
+     * frame only once). The solver should not be in a push scope.
+     */
+    void assert_lemmas(smt::solver* solver, trace_helper* trace, size_t frames);
+  };
+};
+
+}
+}
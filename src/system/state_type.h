@@ -55,6 +55,11 @@ public:
   /** Create a new state type of the given type and name */
   state_type(std::string id, expr::term_manager& tm, expr::term_ref state_type_var, expr::term_ref input_type_var);
 
+  /** Get the id of the state type */
+  std::string get_id() const {
+    return d_id;
+  }
+
   /** Print the state type to stream */
   void to_stream(std::ostream& out) const;
 
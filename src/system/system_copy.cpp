@@ -0,0 +1,120 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "system/system_copy.h"
+
+#include <cassert>
+
+namespace sally {
+namespace system {
+
+system_copy::system_copy(const context& main_ctx, const transition_system* ts, const state_formula* sf)
+: d_tm(d_stats)
+, d_opts(main_ctx.get_options())
+, d_ctx(d_tm, d_opts, d_stats)
+, d_main_tm(main_ctx.tm())
+, d_ts(0)
+, d_sf(0)
+{
+  const state_type* st = ts->get_state_type();
+
+  // Copy the state type and map the state variables
+  expr::term_ref state_type_var = from_main(st->get_state_type_var());
+  expr::term_ref input_type_var = from_main(st->get_input_type_var());
+  state_type* copy_st = new state_type(st->get_id(), d_tm, state_type_var, input_type_var);
+  d_ctx.add_state_type(st->get_id(), copy_st);
+  map_variables(st, copy_st, state_type::STATE_CURRENT);
+  map_variables(st, copy_st, state_type::STATE_INPUT);
+  map_variables(st, copy_st, state_type::STATE_NEXT);
+
+  // Copy the system (assumptions are already in I and T)
+  expr::term_ref I = from_main(ts->get_initial_states());
+  expr::term_ref T = from_main(ts->get_transition_relation());
+  state_formula* copy_I = new state_formula(d_tm, copy_st, I);
+  transition_formula* copy_T = new transition_formula(d_tm, copy_st, T);
+  transition_system* copy_ts = new transition_system(copy_st, copy_I, copy_T);
+  d_ctx.add_transition_system("system_copy::system", copy_ts);
+  d_ts = copy_ts;
+
+  // Copy the property
+  if (sf != 0) {
+    expr::term_ref P = from_main(sf->get_formula());
+    state_formula* copy_sf = new state_formula(d_tm, copy_st, P);
+    d_ctx.add_state_formula("system_copy::property", copy_sf);
+    d_sf = copy_sf;
+  }
+}
+
+void system_copy::map_variables(const state_type* st, const state_type* copy_st, state_type::var_class vc) {
+  expr::term_ref x = st->get_vars_struct(vc);
+  expr::term_ref copy_x = copy_st->get_vars_struct(vc);
+  d_from_main[x] = copy_x;
+  d_to_main[copy_x] = x;
+  const std::vector<expr::term_ref>& vars = st->get_variables(vc);
+  const std::vector<expr::term_ref>& copy_vars = copy_st->get_variables(vc);
+  assert(vars.size() == copy_vars.size());
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    d_from_main[vars[i]] = copy_vars[i];
+    d_to_main[copy_vars[i]] = vars[i];
+  }
+}
+
+expr::term_ref system_copy::from_main(expr::term_ref t) {
+  return d_tm.translate(d_main_tm, t, d_from_main);
+}
+
+expr::term_ref system_copy::to_main(expr::term_ref t) {
+  return d_main_tm.translate(d_tm, t, d_to_main);
+}
+
+void system_copy::copy_trace_to_main(trace_helper* trace) const {
+
+  trace->clear_model();
+
+  trace_helper* copy_trace = d_ts->get_trace_helper();
+  size_t size = copy_trace->get_model_size();
+  if (size == 0) {
+    return;
+  }
+
+  // Copy the model frame by frame (trace variables are matched by position)
+  expr::model::ref copy_model = copy_trace->get_model();
+  expr::model::ref model = new expr::model(d_main_tm, true);
+  for (size_t k = 0; k < size; ++ k) {
+    copy_values(copy_trace->get_state_variables(k), copy_model, trace->get_state_variables(k), model);
+    if (k + 1 < size) {
+      copy_values(copy_trace->get_input_variables(k), copy_model, trace->get_input_variables(k), model);
+    }
+  }
+
+  // Set the model in the main trace
+  trace->set_model(model, 0, size - 1);
+}
+
+void system_copy::copy_values(const std::vector<expr::term_ref>& copy_vars, expr::model::ref copy_model,
+    const std::vector<expr::term_ref>& vars, expr::model::ref model) {
+  assert(vars.size() == copy_vars.size());
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    if (copy_model->has_value(copy_vars[i])) {
+      model->set_variable_value(vars[i], copy_model->get_variable_value(copy_vars[i]));
+    }
+  }
+}
+
+}
+}
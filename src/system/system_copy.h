@@ -0,0 +1,110 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system/context.h"
+#include "utils/options.h"
+#include "utils/statistics.h"
+#include "expr/term_manager.h"
+#include "expr/model.h"
+
+#include <vector>
+
+namespace sally {
+namespace system {
+
+/**
+ * A private copy of a transition system and a property, with its own term
+ * manager, options, statistics and context. Work on the copy can then go on
+ * in a separate thread. Terms are translated between the main term manager
+ * and the copy, with the state and input variables mapped to each other.
+ * Translation is not thread-safe, it should be done while neither manager is
+ * in use elsewhere.
+ */
+class system_copy {
+
+  /** Private statistics */
+  utils::statistics d_stats;
+
+  /** Private term manager */
+  expr::term_manager d_tm;
+
+  /** Private copy of the options */
+  options d_opts;
+
+  /** Private context */
+  context d_ctx;
+
+  /** The main term manager */
+  expr::term_manager& d_main_tm;
+
+  /** The system (owned by the context) */
+  const transition_system* d_ts;
+
+  /** The property (owned by the context, if any) */
+  const state_formula* d_sf;
+
+  /** Cache for translation from the main term manager */
+  expr::term_manager::substitution_map d_from_main;
+
+  /** Cache for translation to the main term manager */
+  expr::term_manager::substitution_map d_to_main;
+
+  /** Map the variables of the given class between the main and the copy state type */
+  void map_variables(const state_type* st, const state_type* copy_st, state_type::var_class vc);
+
+public:
+
+  /** Copy the system and the property (if not null) from the main context */
+  system_copy(const context& main_ctx, const transition_system* ts, const state_formula* sf);
+
+  /** Private statistics */
+  utils::statistics& get_statistics() { return d_stats; }
+
+  /** Private term manager */
+  expr::term_manager& tm() { return d_tm; }
+
+  /** Private options (copied from main) */
+  options& get_options() { return d_opts; }
+
+  /** Private context */
+  context& ctx() { return d_ctx; }
+
+  /** The copy of the system */
+  const transition_system* get_transition_system() const { return d_ts; }
+
+  /** The copy of the property (null if none) */
+  const state_formula* get_property() const { return d_sf; }
+
+  /** Translate a main term to the copy */
+  expr::term_ref from_main(expr::term_ref t);
+
+  /** Translate a term of the copy to the main term manager */
+  expr::term_ref to_main(expr::term_ref t);
+
+  /** Copy the model of the trace of the copy into the given trace of the main system */
+  void copy_trace_to_main(trace_helper* trace) const;
+
+  /** Copy the values of the copy variables into the main model (matched by position) */
+  static void copy_values(const std::vector<expr::term_ref>& copy_vars, expr::model::ref copy_model,
+      const std::vector<expr::term_ref>& vars, expr::model::ref model);
+};
+
+}
+}
@@ -39,6 +39,10 @@ size_t trace_helper::size() const {
   return d_state_variables_structs.size();
 }
 
+size_t trace_helper::get_model_size() const {
+  return d_model_size;
+}
+
 void trace_helper::clear_model() {
   d_model_size = 0;
   d_model = new expr::model(tm(), false);
@@ -126,31 +130,162 @@ expr::term_ref trace_helper::get_state_formula(size_t k, expr::term_ref sf) {
   return tm().substitute_and_cache(sf, d_subst_maps_trace_to_state[k]);
 }
 
-expr::term_ref trace_helper::get_transition_formula(expr::term_ref tf, size_t k) {
-  // Setup the substitution map
-  expr::term_manager::substitution_map subst;
-  // Variables in the state type
-  std::vector<expr::term_ref> from_vars;
+void trace_helper::build_skeleton(expr::term_ref tf, transition_skeleton& skeleton) const {
+
+  static const size_t none = (size_t) -1;
+
+  // Variables in the state type, in order current, input, next
+  typedef boost::unordered_map<expr::term_ref, size_t, expr::term_ref_hasher> term_to_index_map;
+  term_to_index_map var_index;
   const std::vector<expr::term_ref>& current_vars = d_state_type->get_variables(state_type::STATE_CURRENT);
   const std::vector<expr::term_ref>& input_vars = d_state_type->get_variables(state_type::STATE_INPUT);
   const std::vector<expr::term_ref>& next_vars = d_state_type->get_variables(state_type::STATE_NEXT);
-  from_vars.insert(from_vars.end(), current_vars.begin(), current_vars.end());
-  from_vars.insert(from_vars.end(), input_vars.begin(), input_vars.end());
-  from_vars.insert(from_vars.end(), next_vars.begin(), next_vars.end());
+  size_t index = 0;
+  for (size_t i = 0; i < current_vars.size(); ++ i) {
+    var_index[current_vars[i]] = index ++;
+  }
+  for (size_t i = 0; i < input_vars.size(); ++ i) {
+    var_index[input_vars[i]] = index ++;
+  }
+  for (size_t i = 0; i < next_vars.size(); ++ i) {
+    var_index[next_vars[i]] = index ++;
+  }
+
+  // Post-order traversal, node_index[t] is the index of t in the skeleton
+  // or none if t doesn't depend on the variables
+  term_to_index_map node_index;
+  std::vector<expr::term_ref> to_visit;
+  to_visit.push_back(tf);
+  while (!to_visit.empty()) {
+    expr::term_ref t = to_visit.back();
+    if (node_index.find(t) != node_index.end()) {
+      to_visit.pop_back();
+      continue;
+    }
 
-  // Variables in from k -> k + 1
-  std::vector<expr::term_ref> to_vars;
-  get_struct_variables(get_state_struct_variable(k), to_vars);
-  get_struct_variables(get_input_struct_variable(k), to_vars);
-  get_struct_variables(get_state_struct_variable(k+1), to_vars);
+    transition_skeleton::node n;
+    n.t = t;
+    n.var_index = none;
+    n.children_begin = n.children_end = skeleton.children.size();
+
+    // Variables
+    term_to_index_map::const_iterator var_find = var_index.find(t);
+    if (var_find != var_index.end()) {
+      n.var_index = var_find->second;
+      node_index[t] = skeleton.nodes.size();
+      skeleton.nodes.push_back(n);
+      to_visit.pop_back();
+      continue;
+    }
 
-  assert(from_vars.size() == to_vars.size());
+    // Visit the children first
+    const expr::term& t_term = tm().term_of(t);
+    bool children_done = true;
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      if (node_index.find(t_term[i]) == node_index.end()) {
+        to_visit.push_back(t_term[i]);
+        children_done = false;
+      }
+    }
+    if (!children_done) {
+      continue;
+    }
 
-  for (size_t i = 0; i < from_vars.size(); ++ i) {
-    subst[from_vars[i]] = to_vars[i];
+    // Record the children that change
+    for (size_t i = 0; i < t_term.size(); ++ i) {
+      size_t child_index = node_index[t_term[i]];
+      if (child_index != none) {
+        skeleton.children.push_back(std::make_pair(i, child_index));
+      }
+    }
+    n.children_end = skeleton.children.size();
+    if (n.children_begin == n.children_end) {
+      node_index[t] = none;
+    } else {
+      node_index[t] = skeleton.nodes.size();
+      skeleton.nodes.push_back(n);
+    }
+    to_visit.pop_back();
   }
-  // Substitute
-  return tm().substitute_and_cache(tf, subst);
+}
+
+expr::term_ref trace_helper::instantiate_skeleton(expr::term_ref tf, const transition_skeleton& skeleton, size_t k) {
+
+  static const size_t none = (size_t) -1;
+
+  // Nothing to instantiate
+  if (skeleton.nodes.empty()) {
+    return tf;
+  }
+
+  // Variables to rename to (from k -> k + 1)
+  ensure_variables(k + 1);
+  const std::vector<expr::term_ref>& current_vars = d_state_variables[k];
+  const std::vector<expr::term_ref>& input_vars = d_input_variables[k];
+  const std::vector<expr::term_ref>& next_vars = d_state_variables[k + 1];
+
+  // Rebuild the nodes, children first
+  std::vector<expr::term_ref> instance(skeleton.nodes.size());
+  std::vector<expr::term_ref> children;
+  for (size_t i = 0; i < skeleton.nodes.size(); ++ i) {
+    const transition_skeleton::node& n = skeleton.nodes[i];
+    if (n.var_index != none) {
+      size_t var_index = n.var_index;
+      if (var_index < current_vars.size()) {
+        instance[i] = current_vars[var_index];
+      } else if ((var_index -= current_vars.size()) < input_vars.size()) {
+        instance[i] = input_vars[var_index];
+      } else {
+        instance[i] = next_vars[var_index - input_vars.size()];
+      }
+      continue;
+    }
+    const expr::term& t = tm().term_of(n.t);
+    children.assign(t.begin(), t.end());
+    for (size_t j = n.children_begin; j < n.children_end; ++ j) {
+      children[skeleton.children[j].first] = instance[skeleton.children[j].second];
+    }
+    // Operators with payload need special care
+    switch (t.op()) {
+    case expr::TERM_BV_EXTRACT: {
+      expr::bitvector_extract extract = tm().get_bitvector_extract(t);
+      instance[i] = tm().mk_bitvector_extract(children[0], extract);
+      break;
+    }
+    case expr::TERM_BV_SGN_EXTEND: {
+      expr::bitvector_sgn_extend extend = tm().get_bitvector_sgn_extend(t);
+      instance[i] = tm().mk_bitvector_sgn_extend(children[0], extend);
+      break;
+    }
+    default:
+      instance[i] = tm().mk_term(t.op(), children);
+    }
+  }
+
+  // The formula is the last one
+  assert(skeleton.nodes.back().t == tf);
+  return instance.back();
+}
+
+expr::term_ref trace_helper::get_transition_formula(expr::term_ref tf, size_t k) {
+
+  // Get the skeleton
+  transition_skeleton_map::iterator find = d_transition_skeletons.find(tf);
+  if (find == d_transition_skeletons.end()) {
+    find = d_transition_skeletons.insert(std::make_pair(tf, transition_skeleton())).first;
+    build_skeleton(tf, find->second);
+  }
+  transition_skeleton& skeleton = find->second;
+
+  // Unroll, if not already there
+  if (skeleton.frames.size() <= k) {
+    skeleton.frames.resize(k + 1);
+  }
+  if (skeleton.frames[k].is_null()) {
+    skeleton.frames[k] = instantiate_skeleton(tf, skeleton, k);
+  }
+
+  return skeleton.frames[k];
 }
 
 expr::model::ref trace_helper::get_model() const {
@@ -233,17 +368,25 @@ void trace_helper::to_stream(std::ostream& out) const {
   d_state_type->tm().pop_namespace();
 }
 
+expr::term_evaluator& trace_helper::get_evaluator(expr::term_ref f) {
+  evaluator_map::iterator find = d_evaluators.find(f);
+  if (find == d_evaluators.end()) {
+    find = d_evaluators.insert(std::make_pair(f, expr::term_evaluator(tm(), f))).first;
+  }
+  return find->second;
+}
+
 bool trace_helper::is_true_in_frame(size_t frame, expr::term_ref f, expr::model::ref model) {
   // Return
   ensure_variables(frame);
-  return model->is_true(f, d_subst_maps_state_to_trace[frame]);
+  return get_evaluator(f).is_true(*model, d_subst_maps_state_to_trace[frame]);
 }
 
 bool trace_helper::is_false_in_frame(size_t frame, expr::term_ref f, expr::model::ref model) {
   // Return
   ensure_variables(frame);
   assert(frame < d_subst_maps_state_to_trace.size());
-  return model->is_false(f, d_subst_maps_state_to_trace[frame]);
+  return get_evaluator(f).is_false(*model, d_subst_maps_state_to_trace[frame]);
 }
 
 std::ostream& operator << (std::ostream& out, const trace_helper& trace) {
@@ -252,7 +395,41 @@ std::ostream& operator << (std::ostream& out, const trace_helper& trace) {
 }
 
 void trace_helper::gc_collect(const expr::gc_relocator& gc_reloc) {
+  // Evaluators refer to terms that might be gone
+  d_evaluators.clear();
+
   gc_reloc.reloc(d_state_variables_structs);
+  gc_reloc.reloc(d_input_variables_structs);
+  for (size_t k = 0; k < d_state_variables.size(); ++ k) {
+    gc_reloc.reloc(d_state_variables[k]);
+    gc_reloc.reloc(d_input_variables[k]);
+    gc_reloc.reloc(d_subst_maps_state_to_trace[k]);
+    gc_reloc.reloc(d_subst_maps_trace_to_state[k]);
+  }
+
+  // Relocate the skeletons, dropping the ones of collected formulas (if the
+  // formula is alive, so are all its nodes)
+  transition_skeleton_map skeletons;
+  transition_skeleton_map::iterator it = d_transition_skeletons.begin();
+  for (; it != d_transition_skeletons.end(); ++ it) {
+    expr::term_ref tf = it->first;
+    if (!gc_reloc.reloc(tf)) {
+      continue;
+    }
+    transition_skeleton& skeleton = skeletons[tf];
+    skeleton.nodes.swap(it->second.nodes);
+    skeleton.children.swap(it->second.children);
+    skeleton.frames.swap(it->second.frames);
+    for (size_t i = 0; i < skeleton.nodes.size(); ++ i) {
+      gc_reloc.reloc(skeleton.nodes[i].t);
+    }
+    for (size_t k = 0; k < skeleton.frames.size(); ++ k) {
+      if (!skeleton.frames[k].is_null()) {
+        gc_reloc.reloc(skeleton.frames[k]);
+      }
+    }
+  }
+  d_transition_skeletons.swap(skeletons);
 }
 
 expr::term_ref trace_helper::mk_equality(expr::term_ref x, expr::model::ref m) {
@@ -19,12 +19,14 @@
 #pragma once
 
 #include "expr/model.h"
+#include "expr/term_evaluator.h"
 #include "expr/gc_participant.h"
 #include "system/state_type.h"
 #include "smt/solver.h"
 
 #include <vector>
 #include <iosfwd>
+#include <boost/unordered_map.hpp>
 
 namespace sally {
 namespace system {
@@ -59,6 +61,55 @@ class trace_helper : public expr::gc_participant {
   /** Renaming from frame variables to state variables */
   std::vector<expr::term_manager::substitution_map> d_subst_maps_trace_to_state;
 
+  /**
+   * Skeleton of a transition formula, for unrolling: the nodes of the
+   * formula that contain state, input or next variables, children before
+   * parents. Instantiating the formula at a frame only rebuilds these nodes,
+   * everything else is shared with the formula.
+   */
+  struct transition_skeleton {
+
+    /** A node of the formula that depends on the variables */
+    struct node {
+      /** The term */
+      expr::term_ref t;
+      /** Index of the variable (current, input, next), if a variable */
+      size_t var_index;
+      /** The changing children are in [children_begin, children_end) */
+      size_t children_begin, children_end;
+    };
+
+    /** The nodes */
+    std::vector<node> nodes;
+
+    /** Changing children: position in the parent and index of the child node */
+    std::vector< std::pair<size_t, size_t> > children;
+
+    /** Unrolled formulas per frame (null if not unrolled yet) */
+    std::vector<expr::term_ref> frames;
+  };
+
+  /** Map from transition formulas to their skeletons */
+  typedef boost::unordered_map<expr::term_ref, transition_skeleton, expr::term_ref_hasher> transition_skeleton_map;
+
+  /** Skeletons of the transition formulas we've unrolled */
+  transition_skeleton_map d_transition_skeletons;
+
+  /** Compute the skeleton of the transition formula */
+  void build_skeleton(expr::term_ref tf, transition_skeleton& skeleton) const;
+
+  /** Instantiate the skeleton from k to k + 1 */
+  expr::term_ref instantiate_skeleton(expr::term_ref tf, const transition_skeleton& skeleton, size_t k);
+
+  /** Map from state formulas to their compiled evaluators */
+  typedef boost::unordered_map<expr::term_ref, expr::term_evaluator, expr::term_ref_hasher> evaluator_map;
+
+  /** Evaluators of the formulas we've checked in frames (cleared on gc) */
+  evaluator_map d_evaluators;
+
+  /** Get the (cached) evaluator for the state formula f */
+  expr::term_evaluator& get_evaluator(expr::term_ref f);
+
   /** Full model of the trace */
   expr::model::ref d_model;
 
@@ -101,6 +152,9 @@ public:
   /** Get the size of the trace */
   size_t size() const;
 
+  /** Get the number of frames with model information */
+  size_t get_model_size() const;
+
   /** Clear the trace helper (remove all model information) */
   void clear_model();
 
@@ -126,7 +180,8 @@ public:
 
   /**
    * Given a transition formula in the state type return a transition formula
-   * from k to k + 1 step.
+   * from k to k + 1 step. The unrolled formulas are cached, so all users of
+   * the trace helper share them.
    */
   expr::term_ref get_transition_formula(expr::term_ref tf, size_t k);
 
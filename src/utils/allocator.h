@@ -23,6 +23,14 @@
 #include <typeinfo>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <map>
+#include <new>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "utils/hash.h"
 #include "utils/allocator_types.h"
@@ -32,57 +40,179 @@ namespace alloc {
 
 /**
  * Base allocator does the basic allocation stuff.
+ *
+ * Memory is allocated in fixed-size pages that never move, and references
+ * encode the page and the offset in the page. Objects stay at the same
+ * address for the lifetime of the allocator, so pointers to them can be
+ * kept. Objects larger than a page get a page of their own.
+ *
+ * In concurrent mode (see make_concurrent()) each thread allocates from its
+ * own page, and only grabbing a new page is synchronized.
  */
 class allocator_base {
 
-  /** The memory */
-  char* d_memory;
+  /** Bits of the reference used for the offset in the page */
+  static const size_t s_page_bits = 20;
+
+  /** Size of a page */
+  static const size_t s_page_size = (size_t) 1 << s_page_bits;
+
+  /** Number of pages (the last one would give the null reference) */
+  static const size_t s_max_pages = ((size_t) 1 << (32 - s_page_bits)) - 1;
+
+  /** The pages */
+  char* d_pages[s_max_pages];
+
+  /** Number of pages in use */
+  boost::atomic<size_t> d_pages_count;
+
+  /** The current page (sequential mode) */
+  size_t d_page;
+
+  /** Used memory of the current page (sequential mode) */
+  size_t d_page_used;
 
   /** Used memory */
   size_t d_size;
 
-  /** Available memory */
-  size_t d_capacity;
+  /** All the allocated objects, so that we can destruct them later */
+  std::vector<ref> d_allocated;
+
+  /** Is this allocator concurrent */
+  bool d_concurrent;
+
+  /** The current page of a thread (concurrent mode) */
+  struct thread_page {
+    /** The page */
+    size_t page;
+    /** Used memory of the page */
+    size_t used;
+    /** Objects allocated by the thread */
+    std::vector<ref> allocated;
+    thread_page(): page(0), used(s_page_size) {}
+  };
+
+  /** Thread pages of the current thread, by allocator id */
+  struct thread_page_map {
+    std::map<size_t, thread_page*> pages;
+    size_t last_id;
+    thread_page* last;
+    thread_page_map(): last_id(0), last(0) {}
+  };
+
+  /** Unique id of this allocator (for finding the thread pages) */
+  size_t d_id;
+
+  /** Number of allocated objects (concurrent mode) */
+  boost::atomic<size_t> d_allocated_count;
+
+  /** All the thread pages (concurrent mode) */
+  std::vector<thread_page*> d_thread_pages;
+
+  /** Mutex for the thread pages */
+  boost::mutex d_thread_pages_mutex;
+
+  /** Get a new unique allocator id */
+  static size_t new_id() {
+    static boost::atomic<size_t> s_next_id(1);
+    return s_next_id.fetch_add(1);
+  }
+
+  /** Get the page of the current thread */
+  thread_page* get_thread_page();
+
+  /** Allocate a new page of at least the given size, returns the page index */
+  size_t new_page(size_t size);
+
+  /** Make a reference to the offset of the page */
+  static ref mk_ref(size_t page, size_t offset) {
+    return ref((page << s_page_bits) | offset);
+  }
+
+protected:
+
+  /** Record an allocated object */
+  void add_allocated(ref o_ref);
+
+  /** Get all the allocated objects (not thread-safe with allocation) */
+  void get_allocated(std::vector<ref>& out) const;
 
 public:
 
   /** Constructor */
-  allocator_base(size_t initial_size = 10000)
-  : d_memory(static_cast<char*>(std::malloc(initial_size)))
+  allocator_base()
+  : d_pages_count(0)
+  , d_page(0)
+  , d_page_used(s_page_size)
   , d_size(0)
-  , d_capacity(initial_size)
+  , d_concurrent(false)
+  , d_id(new_id())
+  , d_allocated_count(0)
   {}
 
   /** Destructor just frees the memory, stuff inside needs to be destructed by hand */
   virtual ~allocator_base() {
-    std::free(d_memory);
+    for (size_t i = 0; i < d_pages_count; ++ i) {
+      std::free(d_pages[i]);
+    }
+    for (size_t i = 0; i < d_thread_pages.size(); ++ i) {
+      delete d_thread_pages[i];
+    }
   }
 
-  /** Allocate at least size bytes and return the pointer */
-  template<typename T>
-  T* allocate(size_t size);
-
-  /** Returns the index in memory of the given object */
-  template<typename T>
-  size_t index_of(const T& o) const {
-    return (const char*)&o - d_memory;
+  /**
+   * Make the allocator concurrent. Must be called before anything has been
+   * allocated. Concurrent allocators can't be swapped.
+   */
+  void make_concurrent() {
+    assert(!d_concurrent);
+    assert(d_pages_count == 0);
+    d_concurrent = true;
   }
 
-  /** Returns the reference of the given object */
+  /** Is the allocator concurrent */
+  bool is_concurrent() const { return d_concurrent; }
+
+  /**
+   * Allocate at least size bytes and return the pointer. The reference of
+   * the memory is stored in o_ref.
+   */
   template<typename T>
-  ref ref_of(const T& o) { return ref(index_of(o)); }
+  T* allocate(size_t size, ref& o_ref);
+
+  /** Returns the number of allocated objects */
+  size_t size() const {
+    return d_concurrent ? d_allocated_count.load() : d_allocated.size();
+  }
 
   /** Returns the object pointed to by the given reference */
   template<typename T>
-  const T& object_of(ref o_ref) const { return *((const T*)(d_memory + o_ref.d_ref)); }
+  const T& object_of(ref o_ref) const {
+    return *((const T*)(d_pages[o_ref.d_ref >> s_page_bits] + (o_ref.d_ref & (s_page_size - 1))));
+  }
 
   /** Returns the object pointed to by the given reference */
   template<typename T>
-  T& object_of(ref o_ref) { return *((T*)(d_memory + o_ref.d_ref)); }
+  T& object_of(ref o_ref) {
+    return *((T*)(d_pages[o_ref.d_ref >> s_page_bits] + (o_ref.d_ref & (s_page_size - 1))));
+  }
+
+  /** Swap the memory with another allocator */
+  void swap(allocator_base& other) {
+    assert(!d_concurrent && !other.d_concurrent);
+    std::swap_ranges(d_pages, d_pages + s_max_pages, other.d_pages);
+    size_t pages_count = d_pages_count;
+    d_pages_count = other.d_pages_count.load();
+    other.d_pages_count = pages_count;
+    std::swap(d_page, other.d_page);
+    std::swap(d_page_used, other.d_page_used);
+    std::swap(d_size, other.d_size);
+    d_allocated.swap(other.d_allocated);
+  }
 
   /** Print out some info */
   virtual void to_stream(std::ostream& out) const {
-    out << "(size = " << d_size << ", capacity = " << d_capacity << ")";
+    out << "(size = " << d_size << ", pages = " << d_pages_count << ")";
   }
 };
 
@@ -92,27 +222,102 @@ std::ostream& operator << (std::ostream& out, const allocator_base& alloc) {
   return out;
 }
 
+inline
+size_t allocator_base::new_page(size_t size) {
+  size_t page = d_pages_count.fetch_add(1);
+  if (page >= s_max_pages) {
+    throw std::bad_alloc();
+  }
+  if (size < s_page_size) {
+    size = s_page_size;
+  }
+  d_pages[page] = static_cast<char*>(std::malloc(size));
+  if (d_pages[page] == 0) {
+    throw std::bad_alloc();
+  }
+  return page;
+}
+
+inline
+allocator_base::thread_page* allocator_base::get_thread_page() {
+  static boost::thread_specific_ptr<thread_page_map> s_thread_pages;
+  thread_page_map* map = s_thread_pages.get();
+  if (map == 0) {
+    map = new thread_page_map();
+    s_thread_pages.reset(map);
+  }
+  if (map->last_id == d_id) {
+    return map->last;
+  }
+  thread_page*& page = map->pages[d_id];
+  if (page == 0) {
+    page = new thread_page();
+    boost::lock_guard<boost::mutex> lock(d_thread_pages_mutex);
+    d_thread_pages.push_back(page);
+  }
+  map->last_id = d_id;
+  map->last = page;
+  return page;
+}
+
+inline
+void allocator_base::add_allocated(ref o_ref) {
+  if (d_concurrent) {
+    get_thread_page()->allocated.push_back(o_ref);
+    d_allocated_count.fetch_add(1, boost::memory_order_relaxed);
+  } else {
+    d_allocated.push_back(o_ref);
+  }
+}
+
+inline
+void allocator_base::get_allocated(std::vector<ref>& out) const {
+  out.insert(out.end(), d_allocated.begin(), d_allocated.end());
+  for (size_t i = 0; i < d_thread_pages.size(); ++ i) {
+    const std::vector<ref>& allocated = d_thread_pages[i]->allocated;
+    out.insert(out.end(), allocated.begin(), allocated.end());
+  }
+}
+
 template<typename T>
-T* allocator_base::allocate(size_t size) {
+T* allocator_base::allocate(size_t size, ref& o_ref) {
 
   // Align the size
   size = (size + 7) & ~((size_t)7);
 
-  // Make sure there is enough memory
-  size_t requested = d_size + size;
-  if (requested > d_capacity) {
-    while (requested > d_capacity) {
-      d_capacity += d_capacity / 2;
+  // The page to use (concurrent mode uses the page of the thread)
+  size_t* page = &d_page;
+  size_t* page_used = &d_page_used;
+  thread_page* t_page = 0;
+  if (d_concurrent) {
+    t_page = get_thread_page();
+    page = &t_page->page;
+    page_used = &t_page->used;
+  }
+
+  if (size > s_page_size) {
+    // Large objects get their own page. Mark the current page as full so that
+    // references keep increasing in allocation order.
+    *page = new_page(size);
+    *page_used = s_page_size;
+    o_ref = mk_ref(*page, 0);
+  } else {
+    // Get a new page if there is not enough memory
+    if (*page_used + size > s_page_size) {
+      *page = new_page(s_page_size);
+      *page_used = 0;
     }
-    d_memory = (char*) std::realloc(d_memory, d_capacity);
+    o_ref = mk_ref(*page, *page_used);
+    *page_used += size;
   }
 
-  // Actually allocate
-  T* o = (T*)(d_memory + d_size);
   // Increase the d_size
-  d_size += size;
-  // Return the clause memory
-  return o;
+  if (!d_concurrent) {
+    d_size += size;
+  }
+
+  // Return the memory
+  return &object_of<T>(o_ref);
 }
 
 /**
@@ -146,7 +351,8 @@ private:
 
   struct data {
     T t_data;
-    size_t e_size;
+    uint32_t e_size;
+    alloc::ref o_ref;
     E e_data[0];
 
     template <typename iterator>
@@ -164,14 +370,8 @@ private:
     }
   };
 
-  /** All the allocated objects, so that we can destruct it later */
-  std::vector<alloc::ref> d_allocated;
-
 public:
 
-  /** Returns the number of allocated objects */
-  size_t size() const { return d_allocated.size(); }
-
   /**
    * Allocate T with children from begin .. end, with potentially extra
    * children. The extras are not destructed automatically so use only for
@@ -180,22 +380,27 @@ public:
   template<typename iterator>
   ref allocate(const T& t, iterator begin, iterator end, size_t extras) {
     data* full;
+    alloc::ref t_ref;
     if (type_traits<E>::is_empty) {
       assert(extras == 0);
-      full = allocator_base::allocate<data>(sizeof(T));
+      full = allocator_base::allocate<data>(sizeof(T), t_ref);
     } else {
       size_t size = std::distance(begin, end);
-      full = allocator_base::allocate<data>(sizeof(data) + (size + extras)*sizeof(E));
+      full = allocator_base::allocate<data>(sizeof(data) + (size + extras)*sizeof(E), t_ref);
       full->e_size = size;
+      full->o_ref = t_ref;
     }
     full->construct(t, begin, end, extras);
-    ref t_ref(allocator_base::index_of(*full));
-    d_allocated.push_back(t_ref);
+    allocator_base::add_allocated(t_ref);
     return t_ref;
   }
 
-  /** Get the reference of the object */
-  ref ref_of(const T& o) const { return ref(allocator_base::index_of(o)); }
+  /** Get the reference of the object (only for objects with elements) */
+  ref ref_of(const T& o) const {
+    assert(!type_traits<E>::is_empty);
+    const data& d = (const data&) o;
+    return d.o_ref;
+  }
 
   /** Get the object given the reference */
   const T& object_of(ref o_ref) const {
@@ -239,10 +444,20 @@ public:
     return d.e_data + d.e_size;
   }
 
+  /**
+   * Swap the content with another allocator. References into this allocator
+   * become references into the other one.
+   */
+  void swap(allocator<T, E>& other) {
+    allocator_base::swap(other);
+  }
+
   /** Destructor, destructs all Ts and Es */
   ~allocator() {
-    for (unsigned i = 0; i < d_allocated.size(); ++ i) {
-      alloc::ref o_ref = d_allocated[i];
+    std::vector<alloc::ref> allocated;
+    allocator_base::get_allocated(allocated);
+    for (size_t i = 0; i < allocated.size(); ++ i) {
+      alloc::ref o_ref = allocated[i];
       data& d = allocator_base::object_of<data>(o_ref);
       // Destruct Es
       if (!type_traits<E>::is_empty) {
@@ -0,0 +1,92 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/budget.h"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace sally {
+namespace utils {
+
+/** Time limit in seconds (0 for none) */
+static unsigned s_time_limit = 0;
+
+/** Memory limit in megabytes (0 for none) */
+static unsigned s_memory_limit = 0;
+
+/** Time when the limits were set */
+static boost::posix_time::ptime s_start = boost::posix_time::microsec_clock::universal_time();
+
+/** Set once the budget has been exhausted */
+static boost::atomic<bool> s_exhausted(false);
+
+void budget::set_limits(unsigned time_limit, unsigned memory_limit) {
+  s_time_limit = time_limit;
+  s_memory_limit = memory_limit;
+  s_start = boost::posix_time::microsec_clock::universal_time();
+  s_exhausted = false;
+}
+
+bool budget::has_limits() {
+  return s_time_limit > 0 || s_memory_limit > 0;
+}
+
+double budget::elapsed_time() {
+  boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - s_start;
+  return elapsed.total_microseconds() / 1000000.0;
+}
+
+size_t budget::memory_usage() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  // In bytes
+  return usage.ru_maxrss / (1024*1024);
+#else
+  // In kilobytes
+  return usage.ru_maxrss / 1024;
+#endif
+}
+
+bool budget::exhausted() {
+  if (s_exhausted) {
+    return true;
+  }
+  if (s_time_limit > 0 && elapsed_time() >= s_time_limit) {
+    s_exhausted = true;
+  }
+  if (s_memory_limit > 0 && memory_usage() >= s_memory_limit) {
+    s_exhausted = true;
+  }
+  return s_exhausted;
+}
+
+void budget::interruption_point() {
+  boost::this_thread::interruption_point();
+  if (exhausted()) {
+    throw boost::thread_interrupted();
+  }
+}
+
+}
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace sally {
+namespace utils {
+
+/**
+ * Wall-clock and memory budget of the process. Once the budget is exhausted
+ * the engines stop at their next interruption point and report INTERRUPTED.
+ */
+class budget {
+public:
+
+  /** Set the limits in seconds and megabytes (0 for none), starting the clock now */
+  static void set_limits(unsigned time_limit, unsigned memory_limit);
+
+  /** Are there any limits set */
+  static bool has_limits();
+
+  /** Is the budget exhausted (stays exhausted once it is) */
+  static bool exhausted();
+
+  /** Seconds elapsed since the limits were set */
+  static double elapsed_time();
+
+  /** Peak memory usage of the process in megabytes */
+  static size_t memory_usage();
+
+  /**
+   * Interruption point for the engines: throws boost::thread_interrupted if
+   * the thread has been interrupted or if the budget is exhausted.
+   */
+  static void interruption_point();
+};
+
+}
+}
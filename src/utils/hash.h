@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>
+#include <stdint.h>
 #include "utils/string.h"
 
 namespace sally {
@@ -55,6 +56,32 @@ public:
   }
 };
 
+/**
+ * Hasher for a sequence of hashes that passes every step through the 64-bit
+ * MurmurHash3 finalizer, so that all bits of the result depend on all the
+ * inputs. Stronger (and slower) than sequence_hash, use it when the low bits
+ * of the hash select a slot directly.
+ */
+class mixing_hash {
+  uint64_t d_hash;
+  static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+public:
+  mixing_hash(): d_hash(0) {}
+
+  template <typename T>
+  void add(const T& t) {
+    d_hash = mix(d_hash + 0x9e3779b97f4a7c15ULL + hash<T>()(t));
+  }
+  size_t get() const { return d_hash; }
+};
+
 /** String hash. */
 template<>
 struct hash<std::string> {
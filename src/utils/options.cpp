@@ -33,6 +33,12 @@ options::options()
   d_options = d_my_options;
 }
 
+options::options(const options& other)
+{
+  d_my_options = new boost::program_options::variables_map(*other.d_options);
+  d_options = d_my_options;
+}
+
 options::~options() {
   delete d_my_options;
 }
@@ -45,6 +51,11 @@ std::string options::get_string(std::string opt) const {
   return d_options->at(opt).as<std::string>();
 }
 
+void options::set_string(std::string opt, std::string value) {
+  d_options->erase(opt);
+  d_options->insert(std::make_pair(opt, boost::program_options::variable_value(value, false)));
+}
+
 unsigned options::get_unsigned(std::string opt) const {
   return d_options->at(opt).as<unsigned>();
 }
@@ -43,6 +43,9 @@ public:
   options();
   options(boost::program_options::variables_map& options);
 
+  /** Make a private copy of the other options */
+  options(const options& other);
+
   ~options();
 
   /** Check whether the option is present */
@@ -51,6 +54,9 @@ public:
   /** Get the value of the string option opt */
   std::string get_string(std::string opt) const;
 
+  /** Set the value of the string option opt */
+  void set_string(std::string opt, std::string value);
+
   /** Get the value of the unsigned option opt */
   unsigned get_unsigned(std::string opt) const;
 
@@ -0,0 +1,226 @@
+#include <boost/test/unit_test.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+#include "expr/term_evaluator.h"
+#include "expr/model.h"
+
+#include "engine/sim/batch_evaluator.h"
+
+#include "utils/statistics.h"
+
+#include <vector>
+#include <iostream>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+
+/** Small deterministic random generator (so that failures reproduce) */
+struct eval_random {
+  unsigned long d_state;
+  eval_random(unsigned long seed): d_state(seed) {}
+  size_t next(size_t n) {
+    d_state = (d_state * 1103515245 + 12345) % 2147483648UL;
+    return (d_state >> 8) % n;
+  }
+};
+
+/**
+ * Random well-typed terms over a few Boolean, real, integer and 8-bit
+ * bit-vector variables, with all the operations of the batch evaluator.
+ */
+struct batch_evaluator_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  eval_random random;
+
+  vector<term_ref> bool_vars;
+  vector<term_ref> real_vars;
+  vector<term_ref> int_vars;
+  vector<term_ref> bv_vars;
+
+  /** All the variables */
+  vector<term_ref> vars;
+
+public:
+
+  batch_evaluator_test_fixture()
+  : tm(stats)
+  , random(42)
+  {
+    bool_vars.push_back(tm.mk_variable("p", tm.boolean_type()));
+    bool_vars.push_back(tm.mk_variable("q", tm.boolean_type()));
+    real_vars.push_back(tm.mk_variable("x", tm.real_type()));
+    real_vars.push_back(tm.mk_variable("y", tm.real_type()));
+    int_vars.push_back(tm.mk_variable("i", tm.integer_type()));
+    int_vars.push_back(tm.mk_variable("j", tm.integer_type()));
+    bv_vars.push_back(tm.mk_variable("a", tm.bitvector_type(8)));
+    bv_vars.push_back(tm.mk_variable("b", tm.bitvector_type(8)));
+    vars.insert(vars.end(), bool_vars.begin(), bool_vars.end());
+    vars.insert(vars.end(), real_vars.begin(), real_vars.end());
+    vars.insert(vars.end(), int_vars.begin(), int_vars.end());
+    vars.insert(vars.end(), bv_vars.begin(), bv_vars.end());
+    cout << set_tm(tm);
+  }
+
+  /** Small values, so that 0 (and division by 0) comes up often */
+  rational random_rational(bool integer) {
+    return rational((long) random.next(5) - 2, integer ? 1 : 1 + random.next(2));
+  }
+
+  term_ref random_bool(size_t depth) {
+    if (depth == 0) {
+      switch (random.next(3)) {
+      case 0: return tm.mk_boolean_constant(random.next(2));
+      default: return bool_vars[random.next(bool_vars.size())];
+      }
+    }
+    switch (random.next(14)) {
+    case 0: return tm.mk_term(TERM_AND, random_bool(depth - 1), random_bool(depth - 1), random_bool(depth - 1));
+    case 1: return tm.mk_term(TERM_OR, random_bool(depth - 1), random_bool(depth - 1));
+    case 2: return tm.mk_term(TERM_XOR, random_bool(depth - 1), random_bool(depth - 1), random_bool(depth - 1));
+    case 3: return tm.mk_term(TERM_NOT, random_bool(depth - 1));
+    case 4: return tm.mk_term(TERM_IMPLIES, random_bool(depth - 1), random_bool(depth - 1));
+    case 5: return tm.mk_term(TERM_ITE, random_bool(depth - 1), random_bool(depth - 1), random_bool(depth - 1));
+    case 6: return tm.mk_term(TERM_EQ, random_bool(depth - 1), random_bool(depth - 1));
+    case 7: return tm.mk_term(TERM_EQ, random_real(depth - 1), random_real(depth - 1));
+    case 8: return tm.mk_term(TERM_EQ, random_bv(depth - 1), random_bv(depth - 1));
+    case 9: {
+      static const term_op ops[] = { TERM_LEQ, TERM_LT, TERM_GEQ, TERM_GT };
+      return tm.mk_term(ops[random.next(4)], random_real(depth - 1), random_real(depth - 1));
+    }
+    case 10: return tm.mk_term(TERM_IS_INT, random_real(depth - 1));
+    default: {
+      static const term_op ops[] = { TERM_BV_ULEQ, TERM_BV_SLEQ, TERM_BV_ULT, TERM_BV_SLT, TERM_BV_UGEQ, TERM_BV_SGEQ, TERM_BV_UGT, TERM_BV_SGT };
+      return tm.mk_term(ops[random.next(8)], random_bv(depth - 1), random_bv(depth - 1));
+    }
+    }
+  }
+
+  term_ref random_real(size_t depth) {
+    if (depth == 0) {
+      switch (random.next(4)) {
+      case 0: return tm.mk_rational_constant(random_rational(false));
+      case 1: return int_vars[random.next(int_vars.size())];
+      default: return real_vars[random.next(real_vars.size())];
+      }
+    }
+    switch (random.next(8)) {
+    case 0: return tm.mk_term(TERM_ADD, random_real(depth - 1), random_real(depth - 1), random_real(depth - 1));
+    case 1: return tm.mk_term(TERM_SUB, random_real(depth - 1), random_real(depth - 1));
+    case 2: return tm.mk_term(TERM_SUB, random_real(depth - 1));
+    case 3: return tm.mk_term(TERM_MUL, random_real(depth - 1), random_real(depth - 1));
+    case 4: return tm.mk_term(TERM_ITE, random_bool(depth - 1), random_real(depth - 1), random_real(depth - 1));
+    case 5: {
+      // Division is real, so it can be converted to an integer and back
+      term_ref div = tm.mk_term(TERM_DIV, random_real(depth - 1), random_real(depth - 1));
+      return tm.mk_term(TERM_TO_REAL, tm.mk_term(TERM_TO_INT, div));
+    }
+    default: return tm.mk_term(TERM_DIV, random_real(depth - 1), random_real(depth - 1));
+    }
+  }
+
+  term_ref random_bv(size_t depth) {
+    if (depth == 0) {
+      switch (random.next(3)) {
+      case 0: return tm.mk_bitvector_constant(bitvector(8, (long) random.next(256)));
+      default: return bv_vars[random.next(bv_vars.size())];
+      }
+    }
+    switch (random.next(6)) {
+    case 0: return tm.mk_term(TERM_BV_NOT, random_bv(depth - 1));
+    case 1: return tm.mk_term(TERM_BV_SUB, random_bv(depth - 1));
+    case 2: return tm.mk_term(TERM_ITE, random_bool(depth - 1), random_bv(depth - 1), random_bv(depth - 1));
+    case 3: {
+      term_ref concat = tm.mk_term(TERM_BV_CONCAT, random_bv(depth - 1), random_bv(depth - 1));
+      return tm.mk_bitvector_extract(concat, bitvector_extract(11, 4));
+    }
+    default: {
+      static const term_op ops[] = {
+          TERM_BV_ADD, TERM_BV_SUB, TERM_BV_MUL, TERM_BV_UDIV, TERM_BV_SDIV, TERM_BV_UREM, TERM_BV_SREM,
+          TERM_BV_SMOD, TERM_BV_XOR, TERM_BV_SHL, TERM_BV_LSHR, TERM_BV_ASHR, TERM_BV_AND, TERM_BV_OR
+      };
+      return tm.mk_term(ops[random.next(14)], random_bv(depth - 1), random_bv(depth - 1));
+    }
+    }
+  }
+
+  /** Random value of the variable */
+  value random_value(term_ref var) {
+    term_ref type = tm.type_of(var);
+    if (type == tm.boolean_type()) {
+      return value(random.next(2) == 1);
+    } else if (type == tm.integer_type()) {
+      return value(random_rational(true));
+    } else if (type == tm.real_type()) {
+      return value(random_rational(false));
+    } else {
+      return value(bitvector(8, (long) random.next(256)));
+    }
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(batch_evaluator_tests, batch_evaluator_test_fixture)
+
+BOOST_AUTO_TEST_CASE(batch_evaluator_division_by_zero) {
+
+  term_ref x = real_vars[0];
+  term_ref div = tm.mk_term(TERM_DIV, x, tm.mk_rational_constant(rational()));
+
+  model m(tm, false);
+  m.set_variable_value(x, value(rational(3, 1)));
+  term_evaluator evaluator(tm, div);
+  BOOST_CHECK(evaluator.evaluate(m) == value(rational()));
+
+  sim::batch_evaluator batch(tm, vars, vector<term_ref>(1, div));
+  batch.resize(1);
+  batch.variable(2).set(0, value(rational(3, 1)));
+  BOOST_CHECK(batch.evaluate(0).get(0) == value(rational()));
+}
+
+BOOST_AUTO_TEST_CASE(batch_evaluator_random) {
+
+  const size_t n_roots = 300;
+  const size_t n_lanes = 32;
+
+  vector<term_ref> roots;
+  for (size_t i = 0; i < n_roots; ++ i) {
+    switch (i % 3) {
+    case 0: roots.push_back(random_bool(1 + i % 4)); break;
+    case 1: roots.push_back(random_real(1 + i % 4)); break;
+    default: roots.push_back(random_bv(1 + i % 4)); break;
+    }
+  }
+
+  // Random models, one per lane
+  sim::batch_evaluator batch(tm, vars, roots);
+  batch.resize(n_lanes);
+  vector<model> models(n_lanes, model(tm, false));
+  for (size_t j = 0; j < n_lanes; ++ j) {
+    for (size_t k = 0; k < vars.size(); ++ k) {
+      value v = random_value(vars[k]);
+      models[j].set_variable_value(vars[k], v);
+      batch.variable(k).set(j, v);
+    }
+  }
+
+  // Each lane agrees with the term evaluator on its model
+  size_t mismatches = 0;
+  for (size_t i = 0; i < roots.size(); ++ i) {
+    const sim::lanes& values = batch.evaluate(i);
+    term_evaluator evaluator(tm, roots[i]);
+    for (size_t j = 0; j < n_lanes; ++ j) {
+      value expected = evaluator.evaluate(models[j]);
+      if (values.get(j) != expected) {
+        if (mismatches ++ < 10) {
+          BOOST_ERROR("lane " << j << " of " << roots[i] << ": " << values.get(j) << " != " << expected);
+        }
+      }
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
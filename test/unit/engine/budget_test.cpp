@@ -0,0 +1,115 @@
+#ifdef WITH_Z3
+
+#include <boost/test/unit_test.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/exceptions.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+
+#include "system/context.h"
+#include "system/state_type.h"
+#include "system/state_formula.h"
+#include "system/transition_system.h"
+
+#include "engine/factory.h"
+#include "engine/bmc/bmc_engine.h"
+
+#include "smt/factory.h"
+
+#include "utils/budget.h"
+#include "utils/options.h"
+#include "utils/statistics.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+
+/**
+ * The counter x' = x + 1 starting from 0, with the property x >= 0. BMC never
+ * finds a counterexample, so it only stops when out of budget.
+ */
+struct budget_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  boost::program_options::variables_map vm;
+  options* opts;
+  system::context* ctx;
+  system::state_type* st;
+  system::transition_system* ts;
+  system::state_formula* property;
+
+public:
+
+  budget_test_fixture()
+  : tm(stats)
+  {
+    // All the engine options with the defaults, z3 as the solver
+    boost::program_options::options_description desc;
+    engine_factory::setup_options(desc);
+    smt::factory::setup_options(desc);
+    desc.add_options()("solver", boost::program_options::value<string>()->default_value("z3"), "");
+    const char* argv[] = { "test", "--bmc-max", "1000000" };
+    boost::program_options::store(boost::program_options::parse_command_line(3, argv, desc), vm);
+    boost::program_options::notify(vm);
+    opts = new options(vm);
+    ctx = new system::context(tm, *opts, stats);
+
+    vector<string> names(1, "x");
+    vector<term_ref> types(1, tm.integer_type());
+    st = new system::state_type("st", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(vector<string>(), vector<term_ref>()));
+    term_ref x = st->get_variables(system::state_type::STATE_CURRENT)[0];
+    term_ref x_next = st->get_variables(system::state_type::STATE_NEXT)[0];
+
+    term_ref zero = tm.mk_rational_constant(rational());
+    term_ref one = tm.mk_rational_constant(rational(1, 1));
+    ts = new system::transition_system(st,
+        new system::state_formula(tm, st, tm.mk_term(TERM_EQ, x, zero)),
+        new system::transition_formula(tm, st, tm.mk_term(TERM_EQ, x_next, tm.mk_term(TERM_ADD, x, one))));
+    property = new system::state_formula(tm, st, tm.mk_term(TERM_GEQ, x, zero));
+
+    cout << set_tm(tm);
+  }
+
+  ~budget_test_fixture() {
+    // Don't leave the limits to the other tests
+    utils::budget::set_limits(0, 0);
+    delete property;
+    delete ts;
+    delete st;
+    delete ctx;
+    delete opts;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(budget_tests, budget_test_fixture)
+
+BOOST_AUTO_TEST_CASE(budget_stops_bmc) {
+
+  // One second
+  utils::budget::set_limits(1, 0);
+  BOOST_CHECK(utils::budget::has_limits());
+  BOOST_CHECK(!utils::budget::exhausted());
+
+  bmc::bmc_engine bmc(*ctx);
+  BOOST_CHECK_THROW(bmc.query(ts, property), boost::thread_interrupted);
+
+  // Stopped once out of time, not much later
+  double elapsed = utils::budget::elapsed_time();
+  cout << "Stopped after " << elapsed << "s" << endl;
+  BOOST_CHECK(elapsed >= 1);
+  BOOST_CHECK(elapsed < 30);
+  BOOST_CHECK(utils::budget::exhausted());
+
+  // New limits start over
+  utils::budget::set_limits(0, 0);
+  BOOST_CHECK(!utils::budget::has_limits());
+  BOOST_CHECK(!utils::budget::exhausted());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,244 @@
+#include <boost/test/unit_test.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+
+#include "system/state_type.h"
+
+#include "engine/pdkind/checkpoint.h"
+
+#include "utils/statistics.h"
+#include "utils/exception.h"
+
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+
+struct checkpoint_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  system::state_type* st;
+
+  /** Name of the file for the checkpoint */
+  string filename;
+
+public:
+
+  checkpoint_test_fixture()
+  : tm(stats)
+  , filename("checkpoint_test.ckpt")
+  {
+    // State variables of all types
+    vector<string> enum_values;
+    enum_values.push_back("a");
+    enum_values.push_back("b");
+    vector<term_ref> tuple_elements;
+    tuple_elements.push_back(tm.integer_type());
+    tuple_elements.push_back(tm.boolean_type());
+
+    vector<string> names;
+    vector<term_ref> types;
+    names.push_back("b"); types.push_back(tm.boolean_type());
+    names.push_back("i"); types.push_back(tm.integer_type());
+    names.push_back("r"); types.push_back(tm.real_type());
+    names.push_back("bv"); types.push_back(tm.bitvector_type(8));
+    names.push_back("e"); types.push_back(tm.enum_type(enum_values));
+    names.push_back("t"); types.push_back(tm.tuple_type(tuple_elements));
+    term_manager::id_to_term_map fields;
+    fields["f"] = tm.integer_type();
+    fields["g"] = tm.boolean_type();
+    names.push_back("a"); types.push_back(tm.array_type(tm.integer_type(), tm.real_type()));
+    names.push_back("rec"); types.push_back(tm.record_type(fields));
+    vector<string> input_names;
+    vector<term_ref> input_types;
+    input_names.push_back("in"); input_types.push_back(tm.real_type());
+    st = new system::state_type("st", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(input_names, input_types));
+
+    cout << set_tm(tm);
+  }
+
+  ~checkpoint_test_fixture() {
+    std::remove(filename.c_str());
+    delete st;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(checkpoint_tests, checkpoint_test_fixture)
+
+BOOST_AUTO_TEST_CASE(checkpoint_term_table_round_trip) {
+
+  const vector<term_ref>& x = st->get_variables(system::state_type::STATE_CURRENT);
+  const vector<term_ref>& x_next = st->get_variables(system::state_type::STATE_NEXT);
+  const vector<term_ref>& input = st->get_variables(system::state_type::STATE_INPUT);
+
+  term_ref b = x[0], i = x[1], r = x[2], bv = x[3], e = x[4], t = x[5];
+
+  // Terms with every kind of payload (terms are hash-consed, so loading in
+  // the same term manager must give back the same terms)
+  vector<term_ref> terms;
+  // Variables of all classes
+  terms.push_back(tm.mk_term(TERM_LEQ, tm.mk_term(TERM_ADD, r, x_next[2]), input[0]));
+  // Boolean constants
+  terms.push_back(tm.mk_term(TERM_OR, b, tm.mk_boolean_constant(true), tm.mk_boolean_constant(false)));
+  // Rational constants (negative and fractional)
+  terms.push_back(tm.mk_term(TERM_EQ, r, tm.mk_rational_constant(rational(-22, 7))));
+  terms.push_back(tm.mk_term(TERM_LT, i, tm.mk_rational_constant(rational(1000000007, 1))));
+  // Bitvector constants, types, extract and sign extend
+  terms.push_back(tm.mk_term(TERM_EQ, bv, tm.mk_bitvector_constant(bitvector(8, 0xa5))));
+  terms.push_back(tm.mk_term(TERM_EQ, tm.mk_bitvector_extract(bv, bitvector_extract(6, 2)), tm.mk_bitvector_constant(bitvector(5, 3))));
+  terms.push_back(tm.mk_term(TERM_EQ, tm.mk_bitvector_sgn_extend(bv, bitvector_sgn_extend(4)), tm.mk_bitvector_constant(bitvector(12, 0xfff))));
+  terms.push_back(tm.bitvector_type(16));
+  // Enum constants and types
+  terms.push_back(tm.mk_term(TERM_EQ, e, tm.mk_enum_constant("b", tm.type_of(e))));
+  // Tuple reads and writes
+  terms.push_back(tm.mk_term(TERM_EQ, tm.mk_tuple_read(t, 1), b));
+  terms.push_back(tm.mk_term(TERM_EQ, tm.mk_tuple_write(t, 0, tm.mk_rational_constant(rational(3, 1))), t));
+  // Strings and the basic types
+  terms.push_back(tm.mk_string_constant("hello world"));
+  terms.push_back(tm.boolean_type());
+  terms.push_back(tm.integer_type());
+  terms.push_back(tm.real_type());
+
+  pdkind::checkpoint cp;
+  cp.frame_index = 5;
+  cp.frame_depth = 2;
+  cp.frame_next_index = 7;
+  cp.properties.push_back(terms[0]);
+  cp.frame.push_back(pdkind::induction_obligation(tm, terms[1], tm.mk_not(terms[1]), 3, 0.75, 2));
+  cp.frame_pending.push_back(true);
+  cp.frame.push_back(pdkind::induction_obligation(tm, terms[2], tm.mk_not(terms[2]), 1, 1.5));
+  cp.frame_pending.push_back(false);
+  cp.frame_next.push_back(pdkind::induction_obligation(tm, terms[3], tm.mk_not(terms[3]), 0, 1));
+  cp.reachability_frames.resize(3);
+  cp.reachability_frames[1].push_back(terms[4]);
+  cp.reachability_frames[2].push_back(terms[5]);
+  cp.reachability_frames[2].push_back(terms[6]);
+  cp.cex_edges_from.push_back(terms[8]);
+  cp.cex_edges.push_back(pdkind::cex_manager::cex_edge(terms[9], 2, 0));
+  cp.cex_roots.push_back(terms[10]);
+  cp.cex_roots_property.push_back(1);
+  cp.lemmas = terms;
+  cp.lemmas_depth = 4;
+
+  cp.save(st, filename);
+
+  pdkind::checkpoint loaded;
+  loaded.load(st, filename);
+
+  BOOST_CHECK_EQUAL(loaded.frame_index, cp.frame_index);
+  BOOST_CHECK_EQUAL(loaded.frame_depth, cp.frame_depth);
+  BOOST_CHECK_EQUAL(loaded.frame_next_index, cp.frame_next_index);
+  BOOST_CHECK(loaded.properties == cp.properties);
+
+  BOOST_CHECK_EQUAL(loaded.frame.size(), cp.frame.size());
+  for (size_t k = 0; k < loaded.frame.size() && k < cp.frame.size(); ++ k) {
+    BOOST_CHECK(loaded.frame[k].F_fwd == cp.frame[k].F_fwd);
+    BOOST_CHECK(loaded.frame[k].F_cex == cp.frame[k].F_cex);
+    BOOST_CHECK_EQUAL(loaded.frame[k].d, cp.frame[k].d);
+    BOOST_CHECK_EQUAL(loaded.frame[k].score, cp.frame[k].score);
+    BOOST_CHECK_EQUAL(loaded.frame[k].refined, cp.frame[k].refined);
+  }
+  BOOST_CHECK(loaded.frame_pending == cp.frame_pending);
+  BOOST_CHECK_EQUAL(loaded.frame_next.size(), 1);
+  if (loaded.frame_next.size() == 1) {
+    BOOST_CHECK(loaded.frame_next[0].F_fwd == terms[3]);
+  }
+
+  BOOST_CHECK(loaded.reachability_frames == cp.reachability_frames);
+
+  BOOST_CHECK(loaded.cex_edges_from == cp.cex_edges_from);
+  BOOST_CHECK_EQUAL(loaded.cex_edges.size(), 1);
+  if (loaded.cex_edges.size() == 1) {
+    BOOST_CHECK(loaded.cex_edges[0].B == terms[9]);
+    BOOST_CHECK_EQUAL(loaded.cex_edges[0].edge_length, 2);
+    BOOST_CHECK_EQUAL(loaded.cex_edges[0].property_id, 0);
+  }
+  BOOST_CHECK(loaded.cex_roots == cp.cex_roots);
+  BOOST_CHECK(loaded.cex_roots_property == cp.cex_roots_property);
+
+  // All the terms
+  BOOST_CHECK_EQUAL(loaded.lemmas_depth, 4);
+  BOOST_CHECK_EQUAL(loaded.lemmas.size(), terms.size());
+  for (size_t k = 0; k < loaded.lemmas.size() && k < terms.size(); ++ k) {
+    BOOST_CHECK_MESSAGE(loaded.lemmas[k] == terms[k], "term " << terms[k] << " loaded as " << loaded.lemmas[k]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_arrays_and_records) {
+
+  const vector<term_ref>& x = st->get_variables(system::state_type::STATE_CURRENT);
+  const vector<term_ref>& x_next = st->get_variables(system::state_type::STATE_NEXT);
+
+  term_ref i = x[1], r = x[2], b = x[0], a = x[6], rec = x[7];
+  term_ref zero = tm.mk_rational_constant(rational());
+  term_ref f = tm.mk_string_constant("f");
+  term_ref g = tm.mk_string_constant("g");
+
+  // A frame with array and record terms
+  vector<term_ref> terms;
+  terms.push_back(tm.mk_term(TERM_LEQ, tm.mk_array_read(a, i), r));
+  terms.push_back(tm.mk_term(TERM_EQ, x_next[6], tm.mk_array_write(a, i, zero)));
+  terms.push_back(tm.mk_term(TERM_EQ, tm.mk_record_read(rec, f), i));
+  terms.push_back(tm.mk_term(TERM_EQ, x_next[7], tm.mk_record_write(rec, g, b)));
+  term_manager::id_to_term_map elements;
+  elements["f"] = zero;
+  elements["g"] = b;
+  terms.push_back(tm.mk_term(TERM_EQ, rec, tm.mk_record(elements)));
+  vector<term_ref> tuple_elements;
+  tuple_elements.push_back(i);
+  tuple_elements.push_back(b);
+  terms.push_back(tm.mk_term(TERM_EQ, x[5], tm.mk_tuple(tuple_elements)));
+  vector<term_ref> fun_types;
+  fun_types.push_back(tm.integer_type());
+  fun_types.push_back(tm.boolean_type());
+  terms.push_back(tm.function_type(fun_types));
+
+  pdkind::checkpoint cp;
+  for (size_t k = 0; k + 1 < terms.size(); ++ k) {
+    cp.frame.push_back(pdkind::induction_obligation(tm, terms[k], tm.mk_not(terms[k]), 1, 1));
+    cp.frame_pending.push_back(true);
+  }
+  cp.lemmas = terms;
+  cp.save(st, filename);
+
+  pdkind::checkpoint loaded;
+  loaded.load(st, filename);
+  BOOST_CHECK_EQUAL(loaded.frame.size(), cp.frame.size());
+  for (size_t k = 0; k < loaded.frame.size() && k < cp.frame.size(); ++ k) {
+    BOOST_CHECK(loaded.frame[k].F_fwd == cp.frame[k].F_fwd);
+    BOOST_CHECK(loaded.frame[k].F_cex == cp.frame[k].F_cex);
+  }
+  BOOST_CHECK_EQUAL(loaded.lemmas.size(), terms.size());
+  for (size_t k = 0; k < loaded.lemmas.size() && k < terms.size(); ++ k) {
+    BOOST_CHECK_MESSAGE(loaded.lemmas[k] == terms[k], "term " << terms[k] << " loaded as " << loaded.lemmas[k]);
+  }
+
+  // Terms with bound variables can't be saved
+  term_ref y = tm.mk_variable("y", tm.integer_type());
+  pdkind::checkpoint quantified;
+  quantified.lemmas.push_back(tm.mk_exists(vector<term_ref>(1, y), tm.mk_term(TERM_EQ, tm.mk_array_read(a, y), r)));
+  BOOST_CHECK_THROW(quantified.save(st, filename), sally::exception);
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_different_system) {
+
+  pdkind::checkpoint cp;
+  cp.lemmas.push_back(tm.mk_boolean_constant(true));
+  cp.save(st, filename);
+
+  // A system with different variables can't load it
+  vector<string> names(1, "x");
+  vector<term_ref> types(1, tm.real_type());
+  system::state_type other("other", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(vector<string>(), vector<term_ref>()));
+  pdkind::checkpoint loaded;
+  BOOST_CHECK_THROW(loaded.load(&other, filename), sally::exception);
+
+  // Not a checkpoint
+  BOOST_CHECK_THROW(loaded.load(st, "checkpoint_test_missing.ckpt"), sally::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/exceptions.hpp>
+#include <boost/program_options.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+
+#include "system/context.h"
+#include "system/state_type.h"
+#include "system/state_formula.h"
+#include "system/transition_system.h"
+
+#include "engine/engine.h"
+#include "engine/factory.h"
+#include "engine/aig/aig_engine.h"
+
+#include "utils/options.h"
+#include "utils/statistics.h"
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+
+/**
+ * Engine that proves its first query, and is interrupted on the next one.
+ */
+class interrupted_engine : public engine {
+
+  size_t d_queries;
+
+public:
+
+  interrupted_engine(const system::context& ctx)
+  : engine(ctx), d_queries(0) {}
+
+  result query(const system::transition_system* ts, const system::state_formula* sf) {
+    if (d_queries ++ > 0) {
+      throw boost::thread_interrupted();
+    }
+    return VALID;
+  }
+
+  const system::trace_helper* get_trace() {
+    return 0;
+  }
+
+  invariant get_invariant() {
+    return invariant(tm().mk_boolean_constant(true), 1);
+  }
+
+  void gc_collect(const gc_relocator& gc_reloc) {}
+};
+
+struct engine_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  options opts;
+  system::context ctx;
+
+public:
+
+  engine_test_fixture()
+  : tm(stats)
+  , ctx(tm, opts, stats)
+  {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(engine_tests, engine_test_fixture)
+
+BOOST_AUTO_TEST_CASE(engine_interrupted_query_all) {
+
+  vector<string> names(1, "x");
+  vector<term_ref> types(1, tm.boolean_type());
+  system::state_type st("st", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(vector<string>(), vector<term_ref>()));
+  term_ref x = st.get_variables(system::state_type::STATE_CURRENT)[0];
+  system::transition_system ts(&st,
+      new system::state_formula(tm, &st, x),
+      new system::transition_formula(tm, &st, tm.mk_boolean_constant(true)));
+
+  system::state_formula p0(tm, &st, x), p1(tm, &st, x), p2(tm, &st, x);
+  vector<const system::state_formula*> properties;
+  properties.push_back(&p0);
+  properties.push_back(&p1);
+  properties.push_back(&p2);
+
+  interrupted_engine e(ctx);
+  vector<engine::result> results;
+  BOOST_CHECK_THROW(e.query_all(&ts, properties, results), boost::thread_interrupted);
+
+  // The first property was decided before the interruption
+  BOOST_CHECK_EQUAL(e.get_property_result(0), engine::VALID);
+  BOOST_CHECK_EQUAL(e.get_property_result(1), engine::INTERRUPTED);
+  BOOST_CHECK_EQUAL(e.get_property_result(2), engine::INTERRUPTED);
+  BOOST_CHECK_EQUAL(e.get_property_result(3), engine::INTERRUPTED);
+}
+
+BOOST_AUTO_TEST_CASE(engine_aig_constant_counterexample) {
+
+  // Initial states and the property are constants, so nothing is encoded
+  vector<string> names(1, "x");
+  vector<term_ref> types(1, tm.boolean_type());
+  vector<string> input_names(1, "i");
+  system::state_type st("st", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(input_names, types));
+  system::transition_system ts(&st,
+      new system::state_formula(tm, &st, tm.mk_boolean_constant(true)),
+      new system::transition_formula(tm, &st, tm.mk_boolean_constant(true)));
+  system::state_formula property(tm, &st, tm.mk_boolean_constant(false));
+
+  boost::program_options::options_description desc;
+  engine_factory::setup_options(desc);
+  boost::program_options::variables_map vm;
+  const char* argv[] = { "test" };
+  boost::program_options::store(boost::program_options::parse_command_line(1, argv, desc), vm);
+  boost::program_options::notify(vm);
+  options aig_opts(vm);
+  system::context aig_ctx(tm, aig_opts, stats);
+
+  aig::aig_engine e(aig_ctx);
+  BOOST_CHECK_EQUAL(e.query(&ts, &property), engine::INVALID);
+
+  // The counterexample still has the values of frame 0
+  system::trace_helper* trace = ts.get_trace_helper();
+  BOOST_CHECK_EQUAL(trace->get_model_size(), 1);
+  model::ref m = trace->get_model();
+  term_ref x0 = trace->get_state_variables(0)[0];
+  BOOST_CHECK(m->has_value(x0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
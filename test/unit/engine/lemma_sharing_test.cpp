@@ -0,0 +1,173 @@
+#ifdef WITH_Z3
+
+#include <boost/test/unit_test.hpp>
+#include <boost/program_options.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+
+#include "system/context.h"
+#include "system/lemma_bus.h"
+#include "system/state_type.h"
+#include "system/state_formula.h"
+#include "system/transition_system.h"
+
+#include "engine/factory.h"
+#include "engine/kind/kind_engine.h"
+#include "engine/pdkind/pdkind_engine.h"
+#include "engine/pdkind/solvers.h"
+
+#include "smt/factory.h"
+
+#include "utils/options.h"
+#include "utils/statistics.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+
+/**
+ * The system x' = x + y, y' = y, starting from x = y = 0. The property x >= 0
+ * is not k-inductive for any k, but it's 1-inductive given the invariant
+ * y >= 0.
+ */
+struct lemma_sharing_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  boost::program_options::variables_map vm;
+  options* opts;
+  system::context* ctx;
+  system::state_type* st;
+  system::transition_system* ts;
+  term_ref x_pos;
+  term_ref y_pos;
+
+public:
+
+  lemma_sharing_test_fixture()
+  : tm(stats)
+  {
+    // All the engine options with the defaults, z3 as the solver
+    boost::program_options::options_description desc;
+    engine_factory::setup_options(desc);
+    smt::factory::setup_options(desc);
+    desc.add_options()("solver", boost::program_options::value<string>()->default_value("z3"), "");
+    const char* argv[] = { "test", "--kind-max", "5" };
+    boost::program_options::store(boost::program_options::parse_command_line(3, argv, desc), vm);
+    boost::program_options::notify(vm);
+    opts = new options(vm);
+    ctx = new system::context(tm, *opts, stats);
+
+    vector<string> names;
+    vector<term_ref> types;
+    names.push_back("x"); types.push_back(tm.real_type());
+    names.push_back("y"); types.push_back(tm.real_type());
+    st = new system::state_type("st", tm, tm.mk_struct_type(names, types), tm.mk_struct_type(vector<string>(), vector<term_ref>()));
+    const vector<term_ref>& x = st->get_variables(system::state_type::STATE_CURRENT);
+    const vector<term_ref>& x_next = st->get_variables(system::state_type::STATE_NEXT);
+
+    term_ref zero = tm.mk_rational_constant(rational());
+    vector<term_ref> init, trans;
+    init.push_back(tm.mk_term(TERM_EQ, x[0], zero));
+    init.push_back(tm.mk_term(TERM_EQ, x[1], zero));
+    trans.push_back(tm.mk_term(TERM_EQ, x_next[0], tm.mk_term(TERM_ADD, x[0], x[1])));
+    trans.push_back(tm.mk_term(TERM_EQ, x_next[1], x[1]));
+    ts = new system::transition_system(st,
+        new system::state_formula(tm, st, tm.mk_and(init)),
+        new system::transition_formula(tm, st, tm.mk_and(trans)));
+
+    x_pos = tm.mk_term(TERM_GEQ, x[0], zero);
+    y_pos = tm.mk_term(TERM_GEQ, x[1], zero);
+
+    cout << set_tm(tm);
+  }
+
+  ~lemma_sharing_test_fixture() {
+    delete ts;
+    delete st;
+    delete ctx;
+    delete opts;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(lemma_sharing_tests, lemma_sharing_test_fixture)
+
+BOOST_AUTO_TEST_CASE(lemma_sharing_is_invariant) {
+
+  pdkind::solvers smt(*ctx, ts, ts->get_trace_helper());
+  vector<term_ref> none, with_y_pos(1, y_pos);
+
+  // Invariant on its own
+  BOOST_CHECK(smt.is_invariant(y_pos, none));
+  // Invariant, but not inductive on its own
+  BOOST_CHECK(!smt.is_invariant(x_pos, none));
+  // Inductive relative to the other invariant
+  BOOST_CHECK(smt.is_invariant(x_pos, with_y_pos));
+  // Doesn't hold initially
+  BOOST_CHECK(!smt.is_invariant(tm.mk_term(TERM_NOT, y_pos), none));
+}
+
+BOOST_AUTO_TEST_CASE(lemma_sharing_kind_receives) {
+
+  system::state_formula property(tm, st, x_pos);
+
+  // On its own, k-induction can't prove the property
+  {
+    kind::kind_engine kind(*ctx);
+    BOOST_CHECK_EQUAL(kind.query(ts, &property), engine::UNKNOWN);
+  }
+
+  // Another engine publishes y >= 0 on the bus, proven 3-inductive
+  system::lemma_bus bus(st);
+  ctx->set_lemma_bus(&bus);
+  system::lemma_bus::client other(&bus, st);
+  BOOST_CHECK(other.publish(y_pos, 3));
+  BOOST_CHECK_EQUAL(bus.size(), 1);
+
+  // Now k-induction gets the lemma and proves it, the invariant includes the
+  // lemma so it's as deep as the lemma
+  {
+    kind::kind_engine kind(*ctx);
+    BOOST_CHECK_EQUAL(kind.query(ts, &property), engine::VALID);
+    BOOST_CHECK_EQUAL(kind.get_invariant().depth, 3);
+  }
+
+  // The proof is published back, and received by the other engine
+  vector<term_ref> received;
+  vector<size_t> depths;
+  other.receive(received, depths);
+  BOOST_CHECK_EQUAL(received.size(), 1);
+  if (received.size() == 1) {
+    BOOST_CHECK(received[0] == x_pos);
+    BOOST_CHECK_EQUAL(depths[0], 3);
+  }
+
+  ctx->set_lemma_bus(0);
+}
+
+BOOST_AUTO_TEST_CASE(lemma_sharing_pdkind_depth) {
+
+  system::state_formula property(tm, st, x_pos);
+
+  // Another engine publishes y >= 0 on the bus, proven 4-inductive
+  system::lemma_bus bus(st);
+  ctx->set_lemma_bus(&bus);
+  system::lemma_bus::client other(&bus, st);
+  BOOST_CHECK(other.publish(y_pos, 4));
+
+  // The invariant of pdkind includes the lemma, so it's as deep as the lemma
+  {
+    pdkind::pdkind_engine pdkind(*ctx);
+    BOOST_CHECK_EQUAL(pdkind.query(ts, &property), engine::VALID);
+    BOOST_CHECK(pdkind.get_invariant().depth >= 4);
+  }
+
+  ctx->set_lemma_bus(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,207 @@
+#include <boost/test/unit_test.hpp>
+
+#include "engine/aig/sat_solver.h"
+
+#include <vector>
+
+using namespace std;
+using namespace sally;
+using namespace aig;
+
+typedef sat_solver::lit lit;
+typedef vector<lit> clause;
+
+/** Small deterministic random generator (so that failures reproduce) */
+struct sat_random {
+  unsigned long d_state;
+  sat_random(unsigned long seed): d_state(seed) {}
+  size_t next(size_t n) {
+    d_state = (d_state * 1103515245 + 12345) % 2147483648UL;
+    return (d_state >> 8) % n;
+  }
+};
+
+/** Is the clause satisfied by the assignment (bit i is the value of var i) */
+static bool is_satisfied(const clause& c, unsigned long assignment) {
+  for (size_t i = 0; i < c.size(); ++ i) {
+    bool value = (assignment >> sat_solver::var_of(c[i])) & 1;
+    if (value != sat_solver::is_negated(c[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Check all assignments of n vars for one that satisfies the clauses */
+static bool brute_force_sat(const vector<clause>& clauses, size_t n) {
+  for (unsigned long assignment = 0; assignment < (1UL << n); ++ assignment) {
+    bool all = true;
+    for (size_t i = 0; all && i < clauses.size(); ++ i) {
+      all = is_satisfied(clauses[i], assignment);
+    }
+    if (all) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Check that the model of the solver satisfies all the clauses */
+static bool model_satisfies(const sat_solver& solver, const vector<clause>& clauses) {
+  for (size_t i = 0; i < clauses.size(); ++ i) {
+    bool sat = false;
+    for (size_t j = 0; !sat && j < clauses[i].size(); ++ j) {
+      sat = solver.get_model_value(clauses[i][j]);
+    }
+    if (!sat) {
+      return false;
+    }
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_SUITE(sat_solver_tests)
+
+BOOST_AUTO_TEST_CASE(sat_solver_pigeonhole) {
+
+  // n + 1 pigeons in n holes, p[i][j] = pigeon i in hole j
+  for (size_t n = 1; n <= 6; ++ n) {
+    sat_solver solver;
+    vector< vector<lit> > p(n + 1);
+    for (size_t i = 0; i <= n; ++ i) {
+      for (size_t j = 0; j < n; ++ j) {
+        p[i].push_back(sat_solver::mk_lit(solver.new_var(), false));
+      }
+    }
+    // Each pigeon in some hole
+    for (size_t i = 0; i <= n; ++ i) {
+      solver.add_clause(p[i]);
+    }
+    // No two pigeons in the same hole
+    for (size_t j = 0; j < n; ++ j) {
+      for (size_t i1 = 0; i1 <= n; ++ i1) {
+        for (size_t i2 = i1 + 1; i2 <= n; ++ i2) {
+          solver.add_clause(sat_solver::neg(p[i1][j]), sat_solver::neg(p[i2][j]));
+        }
+      }
+    }
+    vector<lit> no_assumptions;
+    BOOST_CHECK_EQUAL(solver.check(no_assumptions), smt::solver::UNSAT);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(sat_solver_random_3sat) {
+
+  // Random 3-SAT around the threshold, so we get both results
+  sat_random random(42);
+  size_t n = 12;
+  size_t sat_count = 0, unsat_count = 0;
+  for (size_t instance = 0; instance < 200; ++ instance) {
+    sat_solver solver;
+    for (size_t i = 0; i < n; ++ i) {
+      solver.new_var();
+    }
+    vector<clause> clauses;
+    size_t m = 45 + random.next(15);
+    for (size_t i = 0; i < m; ++ i) {
+      clause c;
+      for (size_t j = 0; j < 3; ++ j) {
+        c.push_back(sat_solver::mk_lit(random.next(n), random.next(2)));
+      }
+      clauses.push_back(c);
+      solver.add_clause(c);
+    }
+    vector<lit> no_assumptions;
+    smt::solver::result result = solver.check(no_assumptions);
+    bool expected = brute_force_sat(clauses, n);
+    BOOST_CHECK_EQUAL(result, expected ? smt::solver::SAT : smt::solver::UNSAT);
+    if (result == smt::solver::SAT) {
+      BOOST_CHECK(model_satisfies(solver, clauses));
+      sat_count ++;
+    } else {
+      unsat_count ++;
+    }
+  }
+  BOOST_CHECK(sat_count > 0);
+  BOOST_CHECK(unsat_count > 0);
+}
+
+BOOST_AUTO_TEST_CASE(sat_solver_assumptions) {
+
+  sat_solver solver;
+  lit x = sat_solver::mk_lit(solver.new_var(), false);
+  lit y = sat_solver::mk_lit(solver.new_var(), false);
+  lit z = sat_solver::mk_lit(solver.new_var(), false);
+
+  // x or y, x => z
+  solver.add_clause(x, y);
+  solver.add_clause(sat_solver::neg(x), z);
+
+  vector<lit> assumptions;
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::SAT);
+
+  // not x: y must be true
+  assumptions.push_back(sat_solver::neg(x));
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::SAT);
+  BOOST_CHECK(solver.get_model_value(y));
+  BOOST_CHECK(!solver.get_model_value(x));
+
+  // not x, not y: unsat
+  assumptions.push_back(sat_solver::neg(y));
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::UNSAT);
+
+  // The assumptions are not kept
+  assumptions.clear();
+  assumptions.push_back(sat_solver::neg(z));
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::SAT);
+  BOOST_CHECK(!solver.get_model_value(x));
+  BOOST_CHECK(solver.get_model_value(y));
+
+  // More clauses after the checks: not y
+  solver.add_clause(sat_solver::neg(y));
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::UNSAT);
+  assumptions.clear();
+  BOOST_CHECK_EQUAL(solver.check(assumptions), smt::solver::SAT);
+  BOOST_CHECK(solver.get_model_value(x));
+  BOOST_CHECK(solver.get_model_value(z));
+}
+
+BOOST_AUTO_TEST_CASE(sat_solver_random_assumptions) {
+
+  // One incremental solver, clauses added in rounds, checked under random
+  // assumptions against brute force
+  sat_random random(7);
+  size_t n = 10;
+  sat_solver solver;
+  for (size_t i = 0; i < n; ++ i) {
+    solver.new_var();
+  }
+  vector<clause> clauses;
+  for (size_t round = 0; round < 40; ++ round) {
+    clause c;
+    for (size_t j = 0; j < 3; ++ j) {
+      c.push_back(sat_solver::mk_lit(random.next(n), random.next(2)));
+    }
+    clauses.push_back(c);
+    solver.add_clause(c);
+    for (size_t check = 0; check < 5; ++ check) {
+      // Assumptions as unit clauses for the brute force check
+      vector<lit> assumptions;
+      vector<clause> with_assumptions(clauses);
+      size_t count = random.next(4);
+      for (size_t i = 0; i < count; ++ i) {
+        lit l = sat_solver::mk_lit(random.next(n), random.next(2));
+        assumptions.push_back(l);
+        with_assumptions.push_back(clause(1, l));
+      }
+      smt::solver::result result = solver.check(assumptions);
+      bool expected = brute_force_sat(with_assumptions, n);
+      BOOST_CHECK_EQUAL(result, expected ? smt::solver::SAT : smt::solver::UNSAT);
+      if (result == smt::solver::SAT) {
+        BOOST_CHECK(model_satisfies(solver, with_assumptions));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
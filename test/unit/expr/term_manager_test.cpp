@@ -2,10 +2,18 @@
 
 #include "expr/term.h"
 #include "expr/term_manager.h"
+#include "expr/gc_participant.h"
+#include "expr/gc_relocator.h"
+#include "expr/model.h"
+#include "expr/term_evaluator.h"
 
 #include "utils/statistics.h"
+#include "utils/exception.h"
 
 #include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <boost/thread/thread.hpp>
 
 using namespace std;
 using namespace sally;
@@ -300,8 +308,498 @@ BOOST_AUTO_TEST_CASE(term_manager_hashconsing) {
     BOOST_CHECK_EQUAL(add_ref[0][i], add_ref[1][i]);
   }
 
+  // Variables are never shared, even with the same name and type
+  term_ref x1 = tm.mk_variable("x", tm.real_type());
+  term_ref x2 = tm.mk_variable("x", tm.real_type());
+  BOOST_CHECK_NE(x1, x2);
+  BOOST_CHECK_EQUAL(tm.hash_of(x1), tm.hash_of(x2));
+
   cout << "Term manager pre-destructor: " << tm << endl;
 
 }
 
+BOOST_AUTO_TEST_CASE(term_manager_stable_terms) {
+
+  // Set the term manager for output
+  cout << set_tm(tm);
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref x_leq = tm.mk_term(TERM_LEQ, x, tm.mk_rational_constant(rational(0, 1)));
+  const term* x_leq_term = &tm.term_of(x_leq);
+
+  // Enough terms to fill several pages, and one term larger than a page
+  std::vector<term_ref> children;
+  for (int i = 0; i < 300000; ++ i) {
+    term_ref c = tm.mk_rational_constant(rational(i, 3));
+    children.push_back(tm.mk_term(TERM_LEQ, x, c));
+  }
+  term_ref big = tm.mk_term(TERM_AND, children);
+  BOOST_CHECK_EQUAL(tm.term_of(big).size(), children.size());
+  BOOST_CHECK_EQUAL(tm.ref_of(tm.term_of(big)), big);
+  term_ref after_big = tm.mk_term(TERM_NOT, big);
+  BOOST_CHECK_EQUAL(tm.term_of(after_big)[0], big);
+
+  // The term didn't move, and is still found
+  BOOST_CHECK_EQUAL(&tm.term_of(x_leq), x_leq_term);
+  BOOST_CHECK_EQUAL(tm.ref_of(*x_leq_term), x_leq);
+  BOOST_CHECK_EQUAL(tm.mk_term(TERM_LEQ, x, tm.mk_rational_constant(rational(0, 1))), x_leq);
+  BOOST_CHECK_EQUAL(tm.mk_term(TERM_LEQ, x, tm.mk_rational_constant(rational(7, 3))), children[7]);
+
+  // Drop the output of all the terms
+  tm.gc();
+}
+
+/** Keeps some terms alive through garbage collection */
+struct gc_test_participant : public gc_participant {
+  std::vector<term_ref_strong> strong;
+  std::vector<term_ref> weak;
+  gc_test_participant(term_manager& tm): gc_participant(tm) {}
+  void gc_collect(const gc_relocator& gc_reloc) {
+    gc_reloc.reloc(strong);
+    gc_reloc.reloc(weak);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(term_manager_gc) {
+
+  // Set the term manager for output
+  cout << set_tm(tm);
+
+  gc_test_participant p(tm);
+
+  // Some garbage
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  for (int i = 0; i < 100; ++ i) {
+    term_ref c = tm.mk_rational_constant(rational(i, 7));
+    term_ref sum = tm.mk_term(TERM_ADD, x, c);
+    tm.mk_term(TERM_LEQ, sum, c);
+  }
+
+  // Some terms we keep
+  term_ref y = tm.mk_variable("y", tm.real_type());
+  term_ref one = tm.mk_rational_constant(rational(1, 1));
+  term_ref y_plus_one = tm.mk_term(TERM_ADD, y, one);
+  term_ref leq = tm.mk_term(TERM_LEQ, y_plus_one, one);
+  tm.type_of(leq);
+  p.strong.push_back(term_ref_strong(tm, leq));
+  p.weak.push_back(x);
+
+  std::string leq_before = tm.to_string(leq);
+  size_t leq_hash = tm.hash_of(leq);
+
+  tm.gc();
+
+  // The weak reference to x is gone
+  BOOST_CHECK_EQUAL(p.weak.size(), 0);
+
+  // The strong reference is alive, and everything is in the same shape
+  BOOST_CHECK_EQUAL(p.strong.size(), 1);
+  term_ref leq_new = p.strong[0];
+  BOOST_CHECK_EQUAL(tm.to_string(leq_new), leq_before);
+  BOOST_CHECK_EQUAL(tm.hash_of(leq_new), leq_hash);
+  BOOST_CHECK_EQUAL(tm.type_of(leq_new), tm.boolean_type());
+
+  // Hash consing finds the relocated terms
+  const term& leq_term = tm.term_of(leq_new);
+  term_ref y_new = tm.term_of(leq_term[0])[0];
+  term_ref one_new = tm.mk_rational_constant(rational(1, 1));
+  BOOST_CHECK_EQUAL(leq_term[1], one_new);
+  term_ref leq_again = tm.mk_term(TERM_LEQ, tm.mk_term(TERM_ADD, y_new, one_new), one_new);
+  BOOST_CHECK_EQUAL(leq_again, leq_new);
+
+  // New terms can be made after collection
+  term_ref z = tm.mk_variable("z", tm.real_type());
+  term_ref z_leq = tm.mk_term(TERM_LEQ, z, one_new);
+  BOOST_CHECK_EQUAL(tm.type_of(z_leq), tm.boolean_type());
+  BOOST_CHECK(z_leq != leq_new);
+
+  // Collect again after dropping the reference
+  p.strong.clear();
+  tm.gc();
+}
+
+/** Value of the statistic with the given id (-1 if none) */
+static int get_stat(const utils::statistics& stats, std::string id) {
+  std::stringstream headers, values;
+  stats.headers_to_stream(headers);
+  stats.values_to_stream(values);
+  std::string header, value;
+  while (std::getline(headers, header, '\t') && std::getline(values, value, '\t')) {
+    if (header == id) {
+      return std::atoi(value.c_str());
+    }
+  }
+  return -1;
+}
+
+BOOST_AUTO_TEST_CASE(term_manager_gc_shrinks) {
+
+  const std::string memory_size = "sally::expr::term_manager_internal::memory_size";
+
+  gc_test_participant p(tm);
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  p.strong.push_back(term_ref_strong(tm, x));
+  tm.gc();
+  int size_live = get_stat(stats, memory_size);
+  BOOST_CHECK(size_live > 0);
+
+  // Lots of garbage
+  for (int i = 0; i < 1000; ++ i) {
+    term_ref c = tm.mk_rational_constant(rational(i, 7));
+    tm.mk_term(TERM_LEQ, tm.mk_term(TERM_ADD, x, c), c);
+  }
+  int size_garbage = get_stat(stats, memory_size);
+  BOOST_CHECK(size_garbage >= size_live + 3000);
+
+  // Collection gets back to the live terms
+  tm.gc();
+  BOOST_CHECK_EQUAL(get_stat(stats, memory_size), size_live);
+  BOOST_CHECK(get_stat(stats, "sally::expr::term_manager_internal::gc_collected") >= 3000);
+  BOOST_CHECK_EQUAL(tm.to_string(p.strong[0]), "x");
+}
+
+/** Deletes itself when its term manager is destructed */
+struct tm_destroyed_participant : public gc_participant {
+  size_t& destroyed;
+  tm_destroyed_participant(term_manager& tm, size_t& destroyed)
+  : gc_participant(tm, false), destroyed(destroyed) {}
+  void gc_collect(const gc_relocator& gc_reloc) {}
+  void gc_tm_destroyed() {
+    destroyed ++;
+    delete this;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(term_manager_destroyed_participants) {
+  size_t destroyed = 0;
+  for (int i = 0; i < 3; ++ i) {
+    term_manager other(stats);
+    new tm_destroyed_participant(other, destroyed);
+    new tm_destroyed_participant(other, destroyed);
+  }
+  BOOST_CHECK_EQUAL(destroyed, 6);
+}
+
+BOOST_AUTO_TEST_CASE(term_manager_translate) {
+
+  // Set the term manager for output
+  cout << set_tm(tm);
+
+  // Some terms in this manager, with payloads
+  std::vector<std::string> names;
+  std::vector<term_ref> types;
+  names.push_back("x");
+  types.push_back(tm.real_type());
+  names.push_back("b");
+  types.push_back(tm.bitvector_type(8));
+  term_ref s_type = tm.mk_struct_type(names, types);
+  term_ref s = tm.mk_variable("s", s_type);
+  std::vector<term_ref> fields;
+  tm.get_struct_fields(tm.term_of(s), fields);
+  term_ref x = fields[0];
+  term_ref b = fields[1];
+  term_ref x_leq = tm.mk_term(TERM_LEQ, x, tm.mk_rational_constant(rational(1, 2)));
+  term_ref b_extract = tm.mk_bitvector_extract(b, bitvector_extract(3, 0));
+  term_ref b_eq = tm.mk_term(TERM_EQ, b_extract, tm.mk_bitvector_constant(bitvector(4, 5)));
+  term_ref f = tm.mk_term(TERM_AND, x_leq, b_eq);
+
+  // Translate into another manager
+  utils::statistics other_stats;
+  term_manager other_tm(other_stats);
+  term_manager::substitution_map to_other;
+  term_ref f_other = other_tm.translate(tm, f, to_other);
+  BOOST_CHECK_EQUAL(other_tm.type_of(f_other), other_tm.boolean_type());
+  BOOST_CHECK_EQUAL(other_tm.translate(tm, f, to_other), f_other);
+
+  // Variables are copied with the same name and type
+  term_ref x_other = to_other[x];
+  BOOST_CHECK_EQUAL(other_tm.term_of(x_other).op(), VARIABLE);
+  BOOST_CHECK_EQUAL(other_tm.get_variable_name(x_other), "s.x");
+  BOOST_CHECK_EQUAL(other_tm.type_of(x_other), other_tm.real_type());
+
+  // Variables are never shared, so a fresh cache gives fresh copies
+  term_manager::substitution_map to_other_fresh;
+  BOOST_CHECK(other_tm.translate(tm, f, to_other_fresh) != f_other);
+
+  // Translate back with the variables mapped back: we get the same term
+  term_manager::substitution_map to_this;
+  term_manager::substitution_map::const_iterator it = to_other.begin();
+  for (; it != to_other.end(); ++ it) {
+    if (other_tm.term_of(it->second).op() == VARIABLE) {
+      to_this[it->second] = it->first;
+    }
+  }
+  BOOST_CHECK_EQUAL(tm.translate(other_tm, f_other, to_this), f);
+}
+
+BOOST_AUTO_TEST_CASE(term_manager_substitute) {
+
+  // Separate manager, so that the deep terms are not printed
+  utils::statistics deep_stats;
+  term_manager deep_tm(deep_stats);
+
+  term_ref x = deep_tm.mk_variable("x", deep_tm.real_type());
+  term_ref y = deep_tm.mk_variable("y", deep_tm.real_type());
+  term_ref one = deep_tm.mk_rational_constant(rational(1, 1));
+
+  // Very deep terms, with shared subterms
+  term_ref t_x = x, t_y = y;
+  for (size_t i = 0; i < 100000; ++ i) {
+    t_x = deep_tm.mk_term(TERM_ADD, t_x, deep_tm.mk_term(TERM_MUL, one, t_x));
+    t_y = deep_tm.mk_term(TERM_ADD, t_y, deep_tm.mk_term(TERM_MUL, one, t_y));
+  }
+
+  // Substitution doesn't change the given map
+  term_manager::substitution_map subst;
+  subst[x] = y;
+  BOOST_CHECK_EQUAL(deep_tm.substitute(t_x, subst), t_y);
+  BOOST_CHECK_EQUAL(subst.size(), 1);
+  BOOST_CHECK_EQUAL(deep_tm.substitute(t_x, subst), t_y);
+  BOOST_CHECK_EQUAL(deep_tm.substitute(one, subst), one);
+
+  // Substitution with caching remembers the results
+  BOOST_CHECK_EQUAL(deep_tm.substitute_and_cache(t_x, subst), t_y);
+  BOOST_CHECK_EQUAL(subst[t_x], t_y);
+  BOOST_CHECK_EQUAL(subst[one], one);
+  BOOST_CHECK_EQUAL(deep_tm.substitute_and_cache(t_x, subst), t_y);
+}
+
+/** Makes the same terms as all other workers, keeping them alive */
+struct concurrent_test_worker {
+  term_manager& tm;
+  term_ref x;
+  std::vector<term_ref_strong>& out;
+  concurrent_test_worker(term_manager& tm, term_ref x, std::vector<term_ref_strong>& out)
+  : tm(tm), x(x), out(out) {}
+  void operator () () {
+    for (int i = 0; i < 1000; ++ i) {
+      term_ref c = tm.mk_rational_constant(rational(i, 7));
+      term_ref sum = tm.mk_term(TERM_ADD, x, c);
+      term_ref leq = tm.mk_term(TERM_LEQ, sum, c);
+      tm.type_of(leq);
+      out.push_back(term_ref_strong(tm, leq));
+    }
+  }
+};
+
+BOOST_AUTO_TEST_CASE(term_manager_concurrent) {
+
+  const int n = 8;
+
+  utils::statistics concurrent_stats;
+  term_manager concurrent_tm(concurrent_stats, true);
+  BOOST_CHECK(concurrent_tm.is_concurrent());
+  term_ref x = concurrent_tm.mk_variable("x", concurrent_tm.real_type());
+
+  // Make the same terms from all threads at once
+  std::vector<term_ref_strong> out[n];
+  std::vector<boost::thread*> threads;
+  for (int k = 0; k < n; ++ k) {
+    threads.push_back(new boost::thread(concurrent_test_worker(concurrent_tm, x, out[k])));
+  }
+  for (int k = 0; k < n; ++ k) {
+    threads[k]->join();
+    delete threads[k];
+  }
+
+  // Everyone got the same terms
+  for (int k = 0; k < n; ++ k) {
+    BOOST_CHECK_EQUAL(out[k].size(), 1000);
+    for (size_t i = 0; i < out[k].size(); ++ i) {
+      BOOST_CHECK_EQUAL(out[k][i], out[0][i]);
+      BOOST_CHECK_EQUAL(concurrent_tm.type_of(out[k][i]), concurrent_tm.boolean_type());
+    }
+  }
+
+  // Hash consing still works after the threads are gone
+  term_ref c = concurrent_tm.mk_rational_constant(rational(5, 7));
+  term_ref leq = concurrent_tm.mk_term(TERM_LEQ, concurrent_tm.mk_term(TERM_ADD, x, c), c);
+  BOOST_CHECK_EQUAL(leq, out[n-1][5]);
+
+  // No garbage collection in concurrent mode
+  BOOST_CHECK_THROW(concurrent_tm.gc(), sally::exception);
+}
+
+BOOST_AUTO_TEST_CASE(rational_small_values) {
+
+  // Overflow of the small form goes to GMP and back
+  rational max(LONG_MAX, 1);
+  rational big = max + rational(1, 1);
+  BOOST_CHECK(big.mpq() == max.mpq() + 1);
+  BOOST_CHECK_EQUAL(big - rational(1, 1), max);
+  BOOST_CHECK_EQUAL((big - rational(1, 1)).hash(), max.hash());
+  BOOST_CHECK(max < big);
+  BOOST_CHECK_EQUAL(-(-big), big);
+
+  // Same value computed in different ways is equal and hashes the same
+  rational q1 = rational(LONG_MAX, 3) * rational(3, LONG_MAX);
+  rational q2("1");
+  BOOST_CHECK_EQUAL(q1, q2);
+  BOOST_CHECK_EQUAL(q1.hash(), q2.hash());
+  rational q3 = rational(1, 3) + rational(1, 6);
+  BOOST_CHECK_EQUAL(q3, rational("1/2"));
+  BOOST_CHECK_EQUAL(q3.get_denominator(), integer(2));
+  BOOST_CHECK_EQUAL(rational(-2, 4) / rational(-1, 2), rational(1, 1));
+  BOOST_CHECK(rational(LONG_MIN, 1).mpq() == LONG_MIN);
+  BOOST_CHECK_EQUAL(rational(2, 3).invert(), rational(3, 2));
+  BOOST_CHECK_EQUAL(rational(-2, 3).invert(), rational(-3, 2));
+
+  // Integers
+  integer z = integer(LONG_MAX) * integer(LONG_MAX);
+  BOOST_CHECK(z.mpz() == mpz_class(LONG_MAX) * LONG_MAX);
+  BOOST_CHECK_EQUAL(integer(3).pow(50).mpz().get_str(), "717897987691852588770249");
+  BOOST_CHECK_EQUAL(integer(2).pow(10), integer(1024));
+
+  // Output
+  std::stringstream ss;
+  ss << set_output_language(output::MCMT) << rational(-1, 2) << " " << integer(-5) << " " << big;
+  BOOST_CHECK_EQUAL(ss.str(), "(/ (- 1) 2) (- 5) 9223372036854775808");
+}
+
+BOOST_AUTO_TEST_CASE(bitvector_operations) {
+
+  // Check narrow (machine word) and wide (GMP) bitvectors against GMP
+  size_t sizes[] = { 1, 8, 63, 64, 65, 100 };
+  for (size_t k = 0; k < sizeof(sizes)/sizeof(sizes[0]); ++ k) {
+    size_t n = sizes[k];
+    mpz_class modulus = mpz_class(1) << n;
+    mpz_class half = mpz_class(1) << (n-1);
+
+    // Some interesting values
+    std::vector<mpz_class> values;
+    values.push_back(0);
+    values.push_back(1);
+    values.push_back(modulus - 1);
+    values.push_back(half);
+    values.push_back(half - 1);
+    values.push_back(mpz_class(123456789) * 987654321 * 1000003);
+    values.push_back(mpz_class(3));
+    values.push_back(modulus - 7);
+    for (size_t i = 0; i < values.size(); ++ i) {
+      mpz_fdiv_r_2exp(values[i].get_mpz_t(), values[i].get_mpz_t(), n);
+    }
+
+    for (size_t i = 0; i < values.size(); ++ i) {
+      for (size_t j = 0; j < values.size(); ++ j) {
+        mpz_class a = values[i], b = values[j];
+        mpz_class sa = a >= half ? mpz_class(a - modulus) : a;
+        mpz_class sb = b >= half ? mpz_class(b - modulus) : b;
+        bitvector bv_a(n, integer(a)), bv_b(n, integer(b));
+        BOOST_CHECK(bv_a.mpz() == a);
+        BOOST_CHECK(bv_a.get_signed().mpz() == sa);
+
+        mpz_class r;
+        #define CHECK_BV(op, value) \
+          r = value; \
+          mpz_fdiv_r_2exp(r.get_mpz_t(), r.get_mpz_t(), n); \
+          BOOST_CHECK_MESSAGE(bv_a.op(bv_b).mpz() == r, #op << " " << n << " " << bv_a << " " << bv_b);
+
+        CHECK_BV(add, a + b);
+        CHECK_BV(sub, a - b);
+        CHECK_BV(mul, a * b);
+        CHECK_BV(bvand, a & b);
+        CHECK_BV(bvor, a | b);
+        CHECK_BV(bvxor, a ^ b);
+        CHECK_BV(udiv, b == 0 ? mpz_class(modulus - 1) : mpz_class(a / b));
+        CHECK_BV(urem, b == 0 ? a : mpz_class(a % b));
+        CHECK_BV(shl, b >= n ? mpz_class(0) : mpz_class(a << b.get_ui()));
+        CHECK_BV(lshr, b >= n ? mpz_class(0) : mpz_class(a >> b.get_ui()));
+        mpz_class ashr;
+        mpz_fdiv_q_2exp(ashr.get_mpz_t(), sa.get_mpz_t(), b >= n ? n : b.get_ui());
+        CHECK_BV(ashr, ashr);
+        if (b != 0) {
+          mpz_class q, rem;
+          mpz_tdiv_q(q.get_mpz_t(), sa.get_mpz_t(), sb.get_mpz_t());
+          CHECK_BV(sdiv, q);
+          mpz_tdiv_r(rem.get_mpz_t(), sa.get_mpz_t(), sb.get_mpz_t());
+          CHECK_BV(srem, rem);
+          mpz_fdiv_r(rem.get_mpz_t(), sa.get_mpz_t(), sb.get_mpz_t());
+          CHECK_BV(smod, rem);
+        }
+        #undef CHECK_BV
+
+        BOOST_CHECK_EQUAL(bv_a.ult(bv_b), a < b);
+        BOOST_CHECK_EQUAL(bv_a.uleq(bv_b), a <= b);
+        BOOST_CHECK_EQUAL(bv_a.slt(bv_b), sa < sb);
+        BOOST_CHECK_EQUAL(bv_a.sgeq(bv_b), sa >= sb);
+        BOOST_CHECK_EQUAL(bv_a == bv_b, a == b);
+      }
+
+      // Unary operations, concatenation and extraction
+      mpz_class a = values[i];
+      bitvector bv_a(n, integer(a));
+      BOOST_CHECK(bv_a.neg().add(bv_a) == bitvector(n));
+      BOOST_CHECK(bv_a.bvnot().bvxor(bv_a) == bitvector::one(n));
+      bitvector c = bv_a.concat(bitvector(3, 5));
+      BOOST_CHECK_EQUAL(c.size(), n + 3);
+      BOOST_CHECK(c.mpz() == a * 8 + 5);
+      BOOST_CHECK(c.extract(3, n + 2) == bv_a);
+      BOOST_CHECK(c.extract(0, 2) == bitvector("101"));
+      BOOST_CHECK_EQUAL(bv_a.msb(), a >= half);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(term_evaluator_models) {
+
+  // Set the term manager for output
+  cout << set_tm(tm);
+
+  term_ref p = tm.mk_variable("p", tm.boolean_type());
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref y = tm.mk_variable("y", tm.real_type());
+  term_ref b = tm.mk_variable("b", tm.bitvector_type(8));
+
+  // (and (or p (<= (+ x y) 3)) (= (bvadd b 1) (ite p 5 7)) (< (ite p x y) (+ x y)))
+  term_ref sum = tm.mk_term(TERM_ADD, x, y);
+  term_ref leq = tm.mk_term(TERM_LEQ, sum, tm.mk_rational_constant(rational(3, 1)));
+  term_ref b_plus_1 = tm.mk_term(TERM_BV_ADD, b, tm.mk_bitvector_constant(bitvector(8, 1)));
+  term_ref ite_bv = tm.mk_term(TERM_ITE, p, tm.mk_bitvector_constant(bitvector(8, 5)), tm.mk_bitvector_constant(bitvector(8, 7)));
+  term_ref ite_real = tm.mk_term(TERM_ITE, p, x, y);
+  std::vector<term_ref> children;
+  children.push_back(tm.mk_term(TERM_OR, p, leq));
+  children.push_back(tm.mk_term(TERM_EQ, b_plus_1, ite_bv));
+  children.push_back(tm.mk_term(TERM_LT, ite_real, sum));
+  term_ref f = tm.mk_term(TERM_AND, children);
+  cout << f << endl;
+
+  // Shared subterms are compiled once
+  term_evaluator evaluator(tm, f);
+  BOOST_CHECK_EQUAL(evaluator.get_term(), f);
+  BOOST_CHECK(evaluator.size() <= 20);
+
+  // Evaluate in a bunch of models, the evaluator is reused
+  model m(tm, false);
+  for (int p_value = 0; p_value < 2; ++ p_value) {
+    for (long x_value = -2; x_value <= 3; ++ x_value) {
+      for (long y_value = -2; y_value <= 3; ++ y_value) {
+        for (long b_value = 3; b_value <= 7; ++ b_value) {
+          m.set_variable_value(p, value(p_value == 1));
+          m.set_variable_value(x, value(rational(x_value, 1)));
+          m.set_variable_value(y, value(rational(y_value, 1)));
+          m.set_variable_value(b, value(bitvector(8, b_value)));
+          bool expected = (p_value == 1 || x_value + y_value <= 3)
+              && b_value + 1 == (p_value == 1 ? 5 : 7)
+              && (p_value == 1 ? x_value : y_value) < x_value + y_value;
+          BOOST_CHECK_EQUAL(evaluator.is_true(m), expected);
+          BOOST_CHECK_EQUAL(m.is_true(f), expected);
+          BOOST_CHECK(evaluator.evaluate(m) == m.get_term_value(f));
+        }
+      }
+    }
+  }
+
+  // Evaluation modulo renaming of the variables
+  term_ref x_other = tm.mk_variable("x_other", tm.real_type());
+  term_manager::substitution_map renaming;
+  renaming[x] = x_other;
+  term_evaluator sum_evaluator(tm, sum);
+  m.set_variable_value(x, value(rational(1, 2)));
+  m.set_variable_value(y, value(rational(1, 3)));
+  m.set_variable_value(x_other, value(rational(2, 1)));
+  BOOST_CHECK(sum_evaluator.evaluate(m) == value(rational(5, 6)));
+  BOOST_CHECK(sum_evaluator.evaluate(m, renaming) == value(rational(7, 3)));
+  BOOST_CHECK(sum_evaluator.evaluate(m, renaming) == m.get_term_value(sum, renaming));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,287 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/program_options.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+#include "expr/model.h"
+
+#include "smt/factory.h"
+
+#include "utils/exception.h"
+#include "utils/options.h"
+#include "utils/statistics.h"
+
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+using namespace smt;
+
+/**
+ * Runs the generic solver against a stub solver. The stub is a shell script
+ * that answers the checks in order, answers (get-value ...) from a fixed table
+ * of values, and logs everything it gets.
+ */
+struct generic_solver_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  boost::program_options::variables_map vm;
+  options* opts;
+  solver* generic;
+
+  /** Check responses, in order */
+  vector<string> checks;
+  /** Values of the variables, by name */
+  map<string, string> values;
+
+  /** The stub script */
+  string stub_file;
+  /** Where the stub logs its input */
+  string log_file;
+
+  /** Make a temporary file */
+  static string mk_temp() {
+    char name[] = "/tmp/sally_generic_XXXXXX";
+    int fd = mkstemp(name);
+    BOOST_REQUIRE(fd != -1);
+    close(fd);
+    return name;
+  }
+
+public:
+
+  generic_solver_test_fixture()
+  : tm(stats)
+  , opts(0)
+  , generic(0)
+  {
+    stub_file = mk_temp();
+    log_file = mk_temp();
+    cout << set_tm(tm);
+  }
+
+  ~generic_solver_test_fixture() {
+    delete generic;
+    delete opts;
+    remove(stub_file.c_str());
+    remove(log_file.c_str());
+  }
+
+  /** Write the stub and start the solver on it */
+  void start(bool global_declarations) {
+    ofstream stub(stub_file.c_str());
+    stub << "#!/bin/sh" << endl;
+    stub << "n=0" << endl;
+    stub << "while read -r line; do" << endl;
+    stub << "  echo \"$line\" >> " << log_file << endl;
+    stub << "  case \"$line\" in" << endl;
+    stub << "  \"(check-sat)\")" << endl;
+    stub << "    n=$((n+1))" << endl;
+    stub << "    case $n in" << endl;
+    for (size_t i = 0; i < checks.size(); ++ i) {
+      stub << "    " << i + 1 << ") echo '" << checks[i] << "' ;;" << endl;
+    }
+    stub << "    esac ;;" << endl;
+    stub << "  \"(get-value (\"*)" << endl;
+    stub << "    vars=${line#\"(get-value (\"}" << endl;
+    stub << "    vars=${vars%\"))\"}" << endl;
+    stub << "    printf '('" << endl;
+    stub << "    for v in $vars; do" << endl;
+    stub << "      case $v in" << endl;
+    map<string, string>::const_iterator it = values.begin();
+    for (; it != values.end(); ++ it) {
+      stub << "      " << it->first << ") printf '(%s %s)' $v '" << it->second << "' ;;" << endl;
+    }
+    stub << "      esac" << endl;
+    stub << "    done" << endl;
+    stub << "    echo ')' ;;" << endl;
+    stub << "  \"(exit)\") exit 0 ;;" << endl;
+    stub << "  esac" << endl;
+    stub << "done" << endl;
+    stub.close();
+    chmod(stub_file.c_str(), 0755);
+
+    boost::program_options::options_description desc;
+    factory::setup_options(desc);
+    vector<string> args;
+    args.push_back("--generic-solver-script");
+    args.push_back(stub_file);
+    args.push_back("--generic-solver-logic");
+    args.push_back("QF_LRA");
+    if (global_declarations) {
+      args.push_back("--generic-solver-global-declarations");
+    }
+    boost::program_options::store(boost::program_options::command_line_parser(args).options(desc).run(), vm);
+    boost::program_options::notify(vm);
+    opts = new options(vm);
+    generic = factory::mk_solver("generic-solver", tm, *opts, stats);
+  }
+
+  /** Number of times the string appears in what the stub got */
+  size_t count_in_log(const string& s) {
+    ifstream log(log_file.c_str());
+    stringstream ss;
+    ss << log.rdbuf();
+    string content = ss.str();
+    size_t count = 0;
+    for (size_t pos = content.find(s); pos != string::npos; pos = content.find(s, pos + 1)) {
+      count ++;
+    }
+    return count;
+  }
+
+  /** A variable mentioned by the assertions and in the model */
+  term_ref mk_variable(const char* name, term_ref type) {
+    term_ref var = tm.mk_variable(name, type);
+    generic->add_variable(var, solver::CLASS_A);
+    return var;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(generic_solver_tests, generic_solver_test_fixture)
+
+BOOST_AUTO_TEST_CASE(generic_check_results) {
+
+  checks.push_back("sat");
+  checks.push_back("unsat");
+  checks.push_back("unknown");
+  checks.push_back("whatever");
+  start(false);
+
+  term_ref x = mk_variable("x", tm.real_type());
+  generic->add(tm.mk_term(TERM_GT, x, tm.mk_rational_constant(rational())), solver::CLASS_A);
+
+  BOOST_CHECK_EQUAL(generic->check(), solver::SAT);
+  BOOST_CHECK_EQUAL(generic->check(), solver::UNSAT);
+  // No model unless sat
+  BOOST_CHECK_THROW(generic->get_model(), sally::exception);
+  BOOST_CHECK_EQUAL(generic->check(), solver::UNKNOWN);
+  BOOST_CHECK_THROW(generic->check(), sally::exception);
+
+  // The assertion went through
+  BOOST_CHECK_EQUAL(count_in_log("(declare-fun x () Real)"), 1);
+  BOOST_CHECK_EQUAL(count_in_log("(check-sat)"), 4);
+}
+
+BOOST_AUTO_TEST_CASE(generic_errors) {
+
+  checks.push_back("(error \"out of memory\")");
+  checks.push_back("success\n; a comment\nunsat");
+  start(false);
+
+  // Errors are reported
+  try {
+    generic->check();
+    BOOST_ERROR("expected an exception");
+  } catch (const sally::exception& e) {
+    BOOST_CHECK_EQUAL(e.get_message(), "generic solver error: out of memory");
+  }
+
+  // Notices and comments are skipped
+  BOOST_CHECK_EQUAL(generic->check(), solver::UNSAT);
+}
+
+BOOST_AUTO_TEST_CASE(generic_model_values) {
+
+  checks.push_back("sat");
+  values["r1"] = "1.25";
+  values["r2"] = "(- 3)";
+  values["r3"] = "(/ 1 3)";
+  values["r4"] = "(- (/ 5.0 2.0))";
+  values["i"] = "(- 7)";
+  values["b"] = "true";
+  values["bv1"] = "#b00000101";
+  values["bv2"] = "#x1f";
+  values["bv3"] = "(_ bv200 8)";
+  start(false);
+
+  term_ref r1 = mk_variable("r1", tm.real_type());
+  term_ref r2 = mk_variable("r2", tm.real_type());
+  term_ref r3 = mk_variable("r3", tm.real_type());
+  term_ref r4 = mk_variable("r4", tm.real_type());
+  term_ref i = mk_variable("i", tm.integer_type());
+  term_ref b = mk_variable("b", tm.boolean_type());
+  term_ref bv1 = mk_variable("bv1", tm.bitvector_type(8));
+  term_ref bv2 = mk_variable("bv2", tm.bitvector_type(8));
+  term_ref bv3 = mk_variable("bv3", tm.bitvector_type(8));
+  // Not in any assertion, the solver doesn't know it
+  term_ref u = mk_variable("u", tm.integer_type());
+
+  vector<term_ref> assertions;
+  assertions.push_back(b);
+  term_ref vars[] = { r1, r2, r3, r4, i, bv1, bv2, bv3 };
+  for (size_t k = 0; k < 8; ++ k) {
+    assertions.push_back(tm.mk_term(TERM_EQ, vars[k], vars[k]));
+  }
+  generic->add(tm.mk_and(assertions), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(generic->check(), solver::SAT);
+
+  model::ref m = generic->get_model();
+  BOOST_CHECK(m->get_variable_value(r1) == value(rational(5, 4)));
+  BOOST_CHECK(m->get_variable_value(r2) == value(rational(-3, 1)));
+  BOOST_CHECK(m->get_variable_value(r3) == value(rational(1, 3)));
+  BOOST_CHECK(m->get_variable_value(r4) == value(rational(-5, 2)));
+  BOOST_CHECK(m->get_variable_value(i) == value(rational(-7, 1)));
+  BOOST_CHECK(m->get_variable_value(b) == value(true));
+  BOOST_CHECK(m->get_variable_value(bv1) == value(bitvector(8, 5)));
+  BOOST_CHECK(m->get_variable_value(bv2) == value(bitvector(8, 31)));
+  BOOST_CHECK(m->get_variable_value(bv3) == value(bitvector(8, 200)));
+  BOOST_CHECK(m->get_variable_value(u) == value(rational()));
+
+  // Only the declared variables were asked for
+  BOOST_CHECK_EQUAL(count_in_log("(get-value ("), 1);
+  BOOST_CHECK_EQUAL(count_in_log(" u"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(generic_declarations_across_pops) {
+
+  checks.push_back("sat");
+  start(false);
+
+  term_ref x = mk_variable("x", tm.real_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+
+  // Declarations are popped, so x is declared again
+  generic->push();
+  generic->add(tm.mk_term(TERM_GT, x, zero), solver::CLASS_A);
+  generic->pop();
+  generic->add(tm.mk_term(TERM_LT, x, zero), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(generic->check(), solver::SAT);
+
+  BOOST_CHECK_EQUAL(count_in_log("(set-option :global-declarations true)"), 0);
+  BOOST_CHECK_EQUAL(count_in_log("(declare-fun x () Real)"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(generic_global_declarations) {
+
+  checks.push_back("sat");
+  start(true);
+
+  term_ref x = mk_variable("x", tm.real_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+
+  // Declarations stay, so x is declared once
+  generic->push();
+  generic->add(tm.mk_term(TERM_GT, x, zero), solver::CLASS_A);
+  generic->pop();
+  generic->push();
+  generic->add(tm.mk_term(TERM_LT, x, zero), solver::CLASS_A);
+  generic->pop();
+  generic->add(tm.mk_term(TERM_EQ, x, zero), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(generic->check(), solver::SAT);
+
+  BOOST_CHECK_EQUAL(count_in_log("(set-option :global-declarations true)"), 1);
+  BOOST_CHECK_EQUAL(count_in_log("(declare-fun x () Real)"), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
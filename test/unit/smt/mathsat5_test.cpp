@@ -167,6 +167,74 @@ BOOST_AUTO_TEST_CASE(mathsat5_interpolation) {
 }
 
 
+BOOST_AUTO_TEST_CASE(mathsat5_assumptions) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref b = tm.mk_variable("b", tm.boolean_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+
+  // x > 0
+  mathsat5->add(tm.mk_term(TERM_GT, x, zero), smt::solver::CLASS_A);
+
+  // Assume b and x < 0
+  std::vector<term_ref> assumptions, core;
+  assumptions.push_back(b);
+  assumptions.push_back(tm.mk_term(TERM_LT, x, zero));
+  solver::result result = mathsat5->check(assumptions, smt::solver::CLASS_A, &core);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  BOOST_CHECK(core.size() == 1 && core[0] == assumptions[1]);
+
+  // Assumptions don't stick
+  result = mathsat5->check();
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+
+  // Assume b only
+  assumptions.pop_back();
+  result = mathsat5->check(assumptions, smt::solver::CLASS_A);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+}
+
+BOOST_AUTO_TEST_CASE(mathsat5_assumptions_classes) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref y = tm.mk_variable("y", tm.real_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+  mathsat5->add_variable(x, smt::solver::CLASS_A);
+  mathsat5->add_variable(y, smt::solver::CLASS_B);
+
+  // A: x > 0 and x = y, B: y < 0
+  term_ref y_neg = tm.mk_term(TERM_LT, y, zero);
+  mathsat5->add(tm.mk_term(TERM_GT, x, zero), smt::solver::CLASS_A);
+  mathsat5->add(tm.mk_term(TERM_EQ, x, y), smt::solver::CLASS_A);
+
+  // First assume y < 0 as part of A
+  std::vector<term_ref> assumptions(1, y_neg);
+  solver::result result = mathsat5->check(assumptions, smt::solver::CLASS_A);
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+
+  // Now assume it as part of B, A alone is satisfiable so the interpolant
+  // can't be false, and it must only talk about y
+  mathsat5->push();
+  result = mathsat5->check(assumptions, smt::solver::CLASS_B);
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  term_ref interpolant = mathsat5->interpolate();
+  cout << "Interpolant: " << interpolant << endl;
+  BOOST_CHECK(interpolant != tm.mk_boolean_constant(false));
+  std::vector<term_ref> vars;
+  tm.get_variables(interpolant, vars);
+  for (size_t i = 0; i < vars.size(); ++ i) {
+    BOOST_CHECK(vars[i] == y);
+  }
+  mathsat5->pop();
+
+  // Without the assumptions, the assertions are satisfiable
+  result = mathsat5->check();
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif
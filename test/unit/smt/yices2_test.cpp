@@ -6,6 +6,12 @@
 #include "expr/term_manager.h"
 
 #include "smt/factory.h"
+#include "smt/async_check.h"
+#include "smt/delayed_wrapper.h"
+#include "smt/incremental_wrapper.h"
+#include "smt/y2z3/y2z3.h"
+#include "smt/y2m5/y2m5.h"
+#include "smt/y2o2/y2o2.h"
 
 #include "utils/options.h"
 #include "utils/statistics.h"
@@ -224,6 +230,145 @@ BOOST_AUTO_TEST_CASE(yices2_generalization_experiment) {
 }
 
 
+BOOST_AUTO_TEST_CASE(yices2_assumptions) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref b = tm.mk_variable("b", tm.boolean_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+
+  // x > 0
+  yices2->add(tm.mk_term(TERM_GT, x, zero), smt::solver::CLASS_A);
+
+  // Assume b and x < 0
+  std::vector<term_ref> assumptions, core;
+  assumptions.push_back(b);
+  assumptions.push_back(tm.mk_term(TERM_LT, x, zero));
+  solver::result result = yices2->check(assumptions, smt::solver::CLASS_A, &core);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  BOOST_CHECK(core.size() == 1 && core[0] == assumptions[1]);
+
+  // Assumptions don't stick
+  result = yices2->check();
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+
+  // Assume b only
+  assumptions.pop_back();
+  result = yices2->check(assumptions, smt::solver::CLASS_A);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+}
+
+BOOST_AUTO_TEST_CASE(yices2_async_check) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+
+  // x > 0
+  yices2->add(tm.mk_term(TERM_GT, x, zero), smt::solver::CLASS_A);
+
+  // Check and wait for it
+  smt::async_check check(yices2);
+  BOOST_CHECK(check.wait_for(10000));
+  BOOST_CHECK(check.done());
+  solver::result result = check.get();
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+
+  // Cancelling a finished check keeps the result
+  check.cancel();
+  BOOST_CHECK(!check.cancelled());
+  BOOST_CHECK_EQUAL(check.get(), solver::SAT);
+
+  // Check under x < 0
+  std::vector<term_ref> assumptions(1, tm.mk_term(TERM_LT, x, zero));
+  smt::async_check check_assumptions(yices2, assumptions, smt::solver::CLASS_A);
+  result = check_assumptions.get();
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+}
+
+/** Scope depth of the solver wrapped by a combination */
+static size_t wrapped_scope(const solver* s) {
+  const delayed_wrapper* delayed = dynamic_cast<const delayed_wrapper*>(s);
+  if (delayed) {
+    return delayed->get_scope();
+  }
+  const incremental_wrapper* incremental = dynamic_cast<const incremental_wrapper*>(s);
+  BOOST_REQUIRE(incremental != 0);
+  return incremental->get_scope();
+}
+
+/**
+ * Check a combination under assumptions, interpolate and pop, the wrapped
+ * interpolating solver should follow the scopes of the combination.
+ */
+static void check_combination(term_manager& tm, solver* s, const solver* wrapped) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref y = tm.mk_variable("y", tm.real_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+  s->add_variable(x, solver::CLASS_A);
+  s->add_variable(y, solver::CLASS_B);
+
+  // A: x > 0 and x = y
+  s->add(tm.mk_term(TERM_GT, x, zero), solver::CLASS_A);
+  s->push();
+  s->add(tm.mk_term(TERM_EQ, x, y), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(wrapped_scope(wrapped), 1);
+
+  // B: assume y < 0
+  std::vector<term_ref> assumptions(1, tm.mk_term(TERM_LT, y, zero));
+  solver::result result = s->check(assumptions, solver::CLASS_B);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+
+  // The assumptions go to the interpolating solver in a scope of their own
+  term_ref interpolant = s->interpolate();
+  cout << "Interpolant: " << interpolant << endl;
+  BOOST_CHECK(interpolant != tm.mk_boolean_constant(false));
+  BOOST_CHECK_EQUAL(wrapped_scope(wrapped), 2);
+
+  // Popping drops the assumptions and the scope
+  s->pop();
+  BOOST_CHECK_EQUAL(wrapped_scope(wrapped), 0);
+  result = s->check();
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+
+  // Still interpolates correctly at the top level
+  s->push();
+  s->add(tm.mk_term(TERM_LT, x, zero), solver::CLASS_B);
+  result = s->check();
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  interpolant = s->interpolate();
+  cout << "Interpolant: " << interpolant << endl;
+  BOOST_CHECK(interpolant != tm.mk_boolean_constant(false));
+  s->pop();
+  BOOST_CHECK_EQUAL(wrapped_scope(wrapped), 0);
+}
+
+#ifdef WITH_Z3
+BOOST_AUTO_TEST_CASE(y2z3_assumptions_interpolation) {
+  y2z3 s(tm, opts, stats);
+  check_combination(tm, &s, s.get_interpolation_solver());
+}
+#endif
+
+#ifdef WITH_MATHSAT5
+BOOST_AUTO_TEST_CASE(y2m5_assumptions_interpolation) {
+  y2m5 s(tm, opts, stats);
+  check_combination(tm, &s, s.get_interpolation_solver());
+}
+#endif
+
+#ifdef WITH_OPENSMT2
+BOOST_AUTO_TEST_CASE(y2o2_assumptions_interpolation) {
+  y2o2 s(tm, opts, stats);
+  check_combination(tm, &s, s.get_interpolation_solver());
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif
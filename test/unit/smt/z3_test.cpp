@@ -0,0 +1,203 @@
+/**
+ * This file is part of sally.
+ * Copyright (C) 2015 SRI International.
+ *
+ * Sally is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sally is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with sally.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef WITH_Z3
+
+#include <boost/test/unit_test.hpp>
+
+#include "expr/term.h"
+#include "expr/term_manager.h"
+
+#include "smt/factory.h"
+#include "smt/async_check.h"
+
+#include "utils/options.h"
+#include "utils/statistics.h"
+
+#include <iostream>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+using namespace std;
+using namespace sally;
+using namespace expr;
+using namespace smt;
+
+struct term_manager_with_z3_test_fixture {
+
+  utils::statistics stats;
+  term_manager tm;
+  solver* z3;
+  options opts;
+
+public:
+
+  term_manager_with_z3_test_fixture()
+  : tm(stats)
+  {
+    z3 = factory::mk_solver("z3", tm, opts, stats);
+    cout << set_tm(tm);
+  }
+
+  ~term_manager_with_z3_test_fixture() {
+    delete z3;
+  }
+
+  /** Integer cubes summing to 33, z3 doesn't get anywhere with it */
+  term_ref mk_hard() {
+    term_ref x = tm.mk_variable("x", tm.integer_type());
+    term_ref y = tm.mk_variable("y", tm.integer_type());
+    term_ref z = tm.mk_variable("z", tm.integer_type());
+    std::vector<term_ref> cubes;
+    cubes.push_back(tm.mk_term(TERM_MUL, x, x, x));
+    cubes.push_back(tm.mk_term(TERM_MUL, y, y, y));
+    cubes.push_back(tm.mk_term(TERM_MUL, z, z, z));
+    return tm.mk_term(TERM_EQ, tm.mk_term(TERM_ADD, cubes), tm.mk_rational_constant(rational(33, 1)));
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(z3_tests, term_manager_with_z3_test_fixture)
+
+BOOST_AUTO_TEST_CASE(z3_short_lived_term_managers) {
+
+  // Each manager gets its own context, removed with the manager
+  for (int i = 0; i < 20; ++ i) {
+    utils::statistics other_stats;
+    term_manager other_tm(other_stats);
+    solver* other = factory::mk_solver("z3", other_tm, opts, other_stats);
+    term_ref x = other_tm.mk_variable("x", other_tm.integer_type());
+    term_ref c = other_tm.mk_rational_constant(rational(i, 1));
+    other->add(other_tm.mk_term(TERM_GT, x, c), solver::CLASS_A);
+    BOOST_CHECK_EQUAL(other->check(), solver::SAT);
+    delete other;
+  }
+
+  // The long-lived manager still works
+  term_ref y = tm.mk_variable("y", tm.real_type());
+  z3->add(tm.mk_term(TERM_LT, y, tm.mk_rational_constant(rational(0, 1))), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(z3->check(), solver::SAT);
+}
+
+BOOST_AUTO_TEST_CASE(z3_assumptions) {
+
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  term_ref b = tm.mk_variable("b", tm.boolean_type());
+  term_ref zero = tm.mk_rational_constant(rational());
+  z3->add_variable(x, solver::CLASS_A);
+  z3->add_variable(b, solver::CLASS_A);
+
+  // x > 0
+  z3->add(tm.mk_term(TERM_GT, x, zero), solver::CLASS_A);
+
+  // Assume b and x < 0, only the latter is in the core
+  std::vector<term_ref> assumptions, core;
+  assumptions.push_back(b);
+  assumptions.push_back(tm.mk_term(TERM_LT, x, zero));
+  solver::result result = z3->check(assumptions, solver::CLASS_A, &core);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  BOOST_CHECK_EQUAL(core.size(), 1);
+  if (core.size() == 1) {
+    BOOST_CHECK(core[0] == assumptions[1]);
+  }
+
+  // Assumptions don't stick
+  result = z3->check();
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+
+  // Assume b only, the model has it
+  assumptions.pop_back();
+  result = z3->check(assumptions, solver::CLASS_A);
+  cout << "Check result: " << result << endl;
+  BOOST_CHECK_EQUAL(result, solver::SAT);
+  expr::model::ref m = z3->get_model();
+  BOOST_CHECK(m->get_variable_value(b).get_bool());
+
+  // Both x < 0 and x > 1 contradict, either one is a core
+  assumptions.clear();
+  assumptions.push_back(tm.mk_term(TERM_LT, x, zero));
+  assumptions.push_back(tm.mk_term(TERM_GT, x, tm.mk_rational_constant(rational(1, 1))));
+  assumptions.push_back(tm.mk_term(TERM_LEQ, x, zero));
+  core.clear();
+  result = z3->check(assumptions, solver::CLASS_A, &core);
+  BOOST_CHECK_EQUAL(result, solver::UNSAT);
+  BOOST_CHECK(core.size() >= 1 && core.size() <= 2);
+  for (size_t i = 0; i < core.size(); ++ i) {
+    BOOST_CHECK(core[i] == assumptions[0] || core[i] == assumptions[2]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(z3_async_wait_until) {
+
+  using namespace boost::posix_time;
+
+  z3->push();
+  z3->add(mk_hard(), solver::CLASS_A);
+
+  // A deadline in the past returns right away
+  smt::async_check check(z3);
+  ptime start = microsec_clock::universal_time();
+  BOOST_CHECK(!check.wait_until(start - milliseconds(100)));
+  // A deadline in the future is waited for
+  BOOST_CHECK(!check.wait_until(start + milliseconds(200)));
+  BOOST_CHECK(microsec_clock::universal_time() >= start + milliseconds(200));
+  BOOST_CHECK(!check.done());
+
+  // Cancel, the result is unknown
+  check.cancel();
+  BOOST_CHECK(check.done());
+  BOOST_CHECK(check.cancelled());
+  BOOST_CHECK_EQUAL(check.get(), solver::UNKNOWN);
+  z3->pop();
+
+  // Easy problem finishes before the deadline
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  z3->add(tm.mk_term(TERM_GT, x, tm.mk_rational_constant(rational())), solver::CLASS_A);
+  smt::async_check easy(z3);
+  BOOST_CHECK(easy.wait_until(microsec_clock::universal_time() + seconds(10)));
+  BOOST_CHECK_EQUAL(easy.get(), solver::SAT);
+}
+
+BOOST_AUTO_TEST_CASE(z3_async_cancel_racing_start) {
+
+  z3->push();
+  z3->add(mk_hard(), solver::CLASS_A);
+
+  // Cancel right away, or just after, the check might not have started yet
+  for (int i = 0; i < 50; ++ i) {
+    smt::async_check check(z3);
+    if (i % 2) {
+      check.wait_for(i % 5);
+    }
+    check.cancel();
+    BOOST_CHECK(check.done());
+    BOOST_CHECK(check.cancelled());
+    BOOST_CHECK_EQUAL(check.get(), solver::UNKNOWN);
+  }
+
+  // The solver is still usable
+  z3->pop();
+  term_ref x = tm.mk_variable("x", tm.real_type());
+  z3->add(tm.mk_term(TERM_GT, x, tm.mk_rational_constant(rational())), solver::CLASS_A);
+  BOOST_CHECK_EQUAL(z3->check(), solver::SAT);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif